@@ -248,11 +248,16 @@ public:
     //! A sleeping thread can be woken early by calling ar_thread_resume().
     //!
     //! @param milliseconds The number of milliseconds to sleep the calling thread. A sleep time
-    //!     of 0 is ignored. If the sleep time is shorter than the scheduler quanta, then the thread
-    //!     will not actually sleep. If #kArInfiniteTimeout is passed for the sleep time, the thread
+    //!     of 0 is ignored. If #kArInfiniteTimeout is passed for the sleep time, the thread
     //!     will simply be suspended.
     static void sleep(unsigned milliseconds) { ar_thread_sleep(milliseconds); }
 
+    //! @brief Put the current thread to sleep for a number of microseconds.
+    //!
+    //! @param microseconds The number of microseconds to sleep the calling thread. A sleep time
+    //!     of 0 is ignored.
+    static void sleepMicroseconds(uint64_t microseconds) { ar_thread_sleep_us(microseconds); }
+
     //! @brief Put the current thread to sleep until a specific time.
     //!
     //! Does nothing if Ar is not running.
@@ -263,6 +268,36 @@ public:
     //!  or equal to the current value returned by ar_get_millisecond_count(), then the sleep request is
     //!  ignored.
     static void sleepUntil(unsigned wakeup) { ar_thread_sleep_until(wakeup); }
+
+    //! @brief Put the current thread to sleep until a specific microsecond time.
+    //!
+    //! @param wakeup The wakeup time in microseconds, as returned by ar_get_microseconds(). If the
+    //!  time is not in the future, then the sleep request is ignored.
+    static void sleepUntilMicroseconds(uint64_t wakeup) { ar_thread_sleep_until_us(wakeup); }
+    //@}
+
+    //! @name Notifications
+    //@{
+    //! @brief Send a notification to the thread.
+    //!
+    //! @param action How the notification value is updated.
+    //! @param value Bits to set or new value, depending on _action_.
+    //!
+    //! @retval kArSuccess
+    //! @retval kArInvalidParameterError
+    //! @retval kArQueueFullError
+    ar_status_t notify(ar_notify_action_t action, uint32_t value=0) { return ar_thread_notify(this, action, value); }
+
+    //! @brief Wait for a notification to the current thread.
+    //!
+    //! @param clearBits Bits to clear in the notification value after it is read.
+    //! @param[out] value Optional pointer to receive the notification value.
+    //! @param timeout The maximum number of milliseconds to wait.
+    //!
+    //! @retval kArSuccess
+    //! @retval kArTimeoutError
+    //! @retval kArNotFromInterruptError
+    static ar_status_t notifyWait(uint32_t clearBits, uint32_t * value, uint32_t timeout=kArInfiniteTimeout) { return ar_thread_notify_wait(clearBits, value, timeout); }
     //@}
 
     //! @name Thread priority
@@ -294,6 +329,15 @@ public:
     //! @brief Get the thread's system load.
     uint32_t getLoad() { return ar_thread_get_load(this); }
 
+    //! @brief Get an average of the thread's system load.
+    uint32_t getLoadAverage(ar_load_average_t average) { return ar_thread_get_load_average(this, average); }
+
+    //! @brief Get the total number of cycles the thread has run.
+    uint64_t getCycles() { return ar_thread_get_cycles(this); }
+
+    //! @brief Get the number of times the thread has been switched in.
+    uint32_t getSwitchCount() { return ar_thread_get_switch_count(this); }
+
     //! @brief Get the thread's maximum stack usage.
     uint32_t getStackUsed() { return ar_thread_get_stack_used(this); }
     //@}
@@ -475,6 +519,87 @@ private:
     Semaphore& operator=(const Semaphore & other);
 };
 
+/*!
+ * @brief Event flags group.
+ *
+ * @ingroup ar_event_flags
+ *
+ * Holds 32 flags that can be set and cleared from threads or interrupts. Threads wait for any
+ * or all of a set of flags, optionally clearing them once the wait is satisfied. Setting flags
+ * wakes every thread whose wait is satisfied at once.
+ */
+class EventFlags : public _ar_event_flags
+{
+public:
+    //! @brief Default constructor.
+    EventFlags() {}
+
+    //! @brief Constructor.
+    EventFlags(const char * name, uint32_t initialFlags=0)
+    {
+        init(name, initialFlags);
+    }
+
+    //! @brief Initialiser.
+    //!
+    //! @param name Pass a name for the event flags group. If NULL is passed the name will be set
+    //!     to an empty string.
+    //! @param initialFlags The initial flag values.
+    //!
+    //! @retval #kArSuccess Event flags group initialised successfully.
+    ar_status_t init(const char * name, uint32_t initialFlags=0) { return ar_event_flags_create(this, name, initialFlags); }
+
+    //! @brief Destructor.
+    //!
+    //! Any threads waiting on the flags will be unblocked immediately. Their return status from
+    //! the wait() method will be #kArObjectDeletedError.
+    ~EventFlags() { ar_event_flags_delete(this); }
+
+    //! @brief Get the event flags group's name.
+    const char * getName() const { return m_name; }
+
+    //! @brief Set flags, waking every thread whose wait is satisfied.
+    //!
+    //! @note This call is safe from interrupt context.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueFullError
+    ar_status_t set(uint32_t bits) { return ar_event_flags_set(this, bits); }
+
+    //! @brief Clear flags.
+    //!
+    //! @note This call is safe from interrupt context.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueFullError
+    ar_status_t clear(uint32_t bits) { return ar_event_flags_clear(this, bits); }
+
+    //! @brief Wait for flags to be set.
+    //!
+    //! @param bits The flags to wait for. Must not be 0.
+    //! @param options Either #kArEventFlagsWaitAny or #kArEventFlagsWaitAll, optionally ORed
+    //!     with #kArEventFlagsClearOnExit.
+    //! @param[out] result Optional pointer to receive the flag values that satisfied the wait.
+    //! @param timeout The maximum number of milliseconds to wait.
+    //!
+    //! @retval #kArSuccess The wait was satisfied.
+    //! @retval #kArTimeoutError The specified amount of time elapsed before the wait was satisfied.
+    //! @retval #kArObjectDeletedError Another thread deleted the flags while the caller was
+    //!     blocked on them.
+    //! @retval #kArNotFromInterruptError This method cannot be called from interrupt context.
+    ar_status_t wait(uint32_t bits, uint32_t options=kArEventFlagsWaitAny, uint32_t * result=NULL, uint32_t timeout=kArInfiniteTimeout) { return ar_event_flags_wait(this, bits, options, result, timeout); }
+
+    //! @brief Returns the current flag values.
+    uint32_t getFlags() const { return m_flags; }
+
+private:
+    //! @brief Disable copy constructor.
+    EventFlags(const EventFlags & other);
+
+    //! @brief Disable assignment operator.
+    EventFlags& operator=(const EventFlags & other);
+};
+
 /*!
  * @brief Mutex object.
  *
@@ -581,6 +706,9 @@ public:
             m_mutex.put();
         }
 
+        //! @brief Return the mutex that is held.
+        Mutex & getMutex() { return m_mutex; }
+
     protected:
         Mutex & m_mutex;  //!< The mutex to hold.
     };
@@ -593,6 +721,204 @@ private:
     Mutex& operator=(const Mutex & other);
 };
 
+/*!
+ * @brief Condition variable.
+ *
+ * @ingroup ar_condvar
+ *
+ * Lets threads wait, with a mutex held, for a condition to become true. The mutex is unlocked
+ * while the thread waits and locked again before wait() returns. Waiters that are woken while
+ * the mutex is locked move straight onto the mutex's blocked list, so a broadcast doesn't make
+ * every waiter ready just to contend for the mutex.
+ *
+ * @code
+ * Ar::Mutex lock("lock");
+ * Ar::ConditionVariable ready("ready");
+ *
+ * void consumer()
+ * {
+ *     Ar::Mutex::Guard guard(lock);
+ *     while (!isReady)
+ *     {
+ *         ready.wait(guard);
+ *     }
+ * }
+ * @endcode
+ */
+class ConditionVariable : public _ar_condvar
+{
+public:
+    //! @brief Default constructor.
+    ConditionVariable() {}
+
+    //! @brief Constructor.
+    ConditionVariable(const char * name)
+    {
+        init(name);
+    }
+
+    //! @brief Initialiser.
+    ar_status_t init(const char * name) { return ar_condvar_create(this, name); }
+
+    //! @brief Destructor.
+    //!
+    //! Any waiting threads are woken with a status of #kArObjectDeletedError.
+    ~ConditionVariable() { ar_condvar_delete(this); }
+
+    //! @brief Get the condition variable's name.
+    const char * getName() const { return m_name; }
+
+    //! @brief Wait to be signalled.
+    //!
+    //! @param mutex The mutex protecting the condition, which must be owned by the caller. It is
+    //!     unlocked while waiting and locked again before returning.
+    //! @param timeout The maximum number of milliseconds to wait for a signal.
+    //!
+    //! @retval #kArSuccess The condition variable was signalled.
+    //! @retval #kArTimeoutError The timeout elapsed before the condition variable was signalled.
+    //! @retval #kArObjectDeletedError The condition variable was deleted while waiting.
+    //! @retval #kArNotOwnerError The caller does not own the mutex.
+    ar_status_t wait(Mutex & mutex, uint32_t timeout=kArInfiniteTimeout) { return ar_condvar_wait(this, &mutex, timeout); }
+
+    //! @brief Wait to be signalled, with the mutex held by a guard.
+    ar_status_t wait(Mutex::Guard & guard, uint32_t timeout=kArInfiniteTimeout) { return wait(guard.getMutex(), timeout); }
+
+    //! @brief Wake the highest priority waiting thread.
+    //!
+    //! @note This call is safe from interrupt context.
+    ar_status_t signal() { return ar_condvar_signal(this); }
+
+    //! @brief Wake all waiting threads.
+    //!
+    //! @note This call is safe from interrupt context.
+    ar_status_t broadcast() { return ar_condvar_broadcast(this); }
+
+private:
+    //! @brief Disable copy constructor.
+    ConditionVariable(const ConditionVariable & other);
+
+    //! @brief Disable assignment operator.
+    ConditionVariable& operator=(const ConditionVariable & other);
+};
+
+/*!
+ * @brief Reader-writer lock.
+ *
+ * @ingroup ar_rwlock
+ *
+ * Many threads can hold the lock for reading at once, while a writer holds it exclusively.
+ * Writers take precedence over new readers so they are not starved. Blocked threads raise the
+ * priority of the threads holding the lock, as with a mutex.
+ *
+ * @see RWLock::ReadGuard, RWLock::WriteGuard
+ */
+class RWLock : public _ar_rwlock
+{
+public:
+    //! @brief Default constructor.
+    RWLock() {}
+
+    //! @brief Constructor.
+    RWLock(const char * name)
+    {
+        init(name);
+    }
+
+    //! @brief Initialiser.
+    ar_status_t init(const char * name) { return ar_rwlock_create(this, name); }
+
+    //! @brief Destructor.
+    ~RWLock() { ar_rwlock_delete(this); }
+
+    //! @brief Get the lock's name.
+    const char * getName() const { return m_name; }
+
+    //! @brief Take the lock for reading.
+    //!
+    //! @param timeout The maximum number of milliseconds to wait for the lock.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArTimeoutError
+    //! @retval #kArObjectDeletedError
+    //! @retval #kArInvalidStateError The caller holds the write lock.
+    ar_status_t getRead(uint32_t timeout=kArInfiniteTimeout) { return ar_rwlock_read_get(this, timeout); }
+
+    //! @brief Release the lock for reading.
+    ar_status_t putRead() { return ar_rwlock_read_put(this); }
+
+    //! @brief Take the lock for writing.
+    //!
+    //! @param timeout The maximum number of milliseconds to wait for the lock.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArTimeoutError
+    //! @retval #kArObjectDeletedError
+    //! @retval #kArInvalidStateError The caller holds the read lock.
+    ar_status_t getWrite(uint32_t timeout=kArInfiniteTimeout) { return ar_rwlock_write_get(this, timeout); }
+
+    //! @brief Release the lock for writing.
+    ar_status_t putWrite() { return ar_rwlock_write_put(this); }
+
+    //! @brief Returns the number of threads holding the lock for reading.
+    unsigned getReaderCount() const { return m_readerCount; }
+
+    //! @brief Returns whether a thread holds the lock for writing.
+    bool isWriteLocked() const { return m_writer != NULL; }
+
+    /*!
+     * @brief Utility class to hold the lock for reading within a scope.
+     */
+    class ReadGuard
+    {
+    public:
+        //! @brief Constructor which takes the read lock.
+        ReadGuard(RWLock & lock)
+        :   m_lock(lock)
+        {
+            m_lock.getRead(kArInfiniteTimeout);
+        }
+
+        //! @brief Destructor that releases the read lock.
+        ~ReadGuard()
+        {
+            m_lock.putRead();
+        }
+
+    protected:
+        RWLock & m_lock;  //!< The lock to hold.
+    };
+
+    /*!
+     * @brief Utility class to hold the lock for writing within a scope.
+     */
+    class WriteGuard
+    {
+    public:
+        //! @brief Constructor which takes the write lock.
+        WriteGuard(RWLock & lock)
+        :   m_lock(lock)
+        {
+            m_lock.getWrite(kArInfiniteTimeout);
+        }
+
+        //! @brief Destructor that releases the write lock.
+        ~WriteGuard()
+        {
+            m_lock.putWrite();
+        }
+
+    protected:
+        RWLock & m_lock;  //!< The lock to hold.
+    };
+
+private:
+    //! @brief Disable copy constructor.
+    RWLock(const RWLock & other);
+
+    //! @brief Disable assignment operator.
+    RWLock& operator=(const RWLock & other);
+};
+
 /*!
  * @brief Channel.
  *
@@ -718,12 +1044,45 @@ public:
         return ar_queue_create(this, name, storage, elementSize, capacity);
     }
 
+    //! @brief Prioritized queue initialiser.
+    //!
+    //! @param name The new queue's name.
+    //! @param storage Pointer to a word aligned buffer of at least
+    //!     AR_QUEUE_PRIORITIZED_STORAGE_SIZE(@a elementSize, @a capacity) bytes.
+    //! @param elementSize Size in bytes of each element in the queue.
+    //! @param capacity The maximum number of elements, up to 65535.
+    //!
+    //! @retval #kArSuccess The queue was initialised.
+    //! @see ar_queue_create_prioritized()
+    ar_status_t initPrioritized(const char * name, void * storage, unsigned elementSize, unsigned capacity)
+    {
+        return ar_queue_create_prioritized(this, name, storage, elementSize, capacity);
+    }
+
+    //! @brief Mailbox initialiser.
+    //!
+    //! @param name The new mailbox's name.
+    //! @param storage Pointer to a buffer of at least AR_QUEUE_MAILBOX_STORAGE_SIZE(@a elementSize)
+    //!     bytes.
+    //! @param elementSize Size in bytes of the value.
+    //!
+    //! @retval #kArSuccess The mailbox was initialised.
+    //! @see ar_queue_create_mailbox()
+    ar_status_t initMailbox(const char * name, void * storage, unsigned elementSize)
+    {
+        return ar_queue_create_mailbox(this, name, storage, elementSize);
+    }
+
     //! @brief Queue cleanup.
     ~Queue() { ar_queue_delete(this); }
 
     //! @brief Get the queue's name.
     const char * getName() const { return m_name; }
 
+    //! @brief Choose whether sends to a full queue drop the oldest elements.
+    //! @see ar_queue_set_overwrite()
+    ar_status_t setOverwrite(bool overwrite) { return ar_queue_set_overwrite(this, overwrite); }
+
     //! @brief Add an item to the queue.
     //!
     //! The caller will block if the queue is full.
@@ -739,6 +1098,19 @@ public:
     //! @retval #kArQueueFullError
     ar_status_t send(const void * element, uint32_t timeout=kArInfiniteTimeout) { return ar_queue_send(this, element, timeout); }
 
+    //! @brief Add an item with a priority to the queue.
+    //!
+    //! @param element Pointer to the element to post to the queue.
+    //! @param priority Priority of the element, where higher values are received first. Ignored
+    //!     unless the queue is prioritized.
+    //! @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+    //!     blocked state before the element can be sent.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueFullError
+    //! @see ar_queue_send_prioritized()
+    ar_status_t sendPrioritized(const void * element, uint8_t priority, uint32_t timeout=kArInfiniteTimeout) { return ar_queue_send_prioritized(this, element, priority, timeout); }
+
     //! @brief Remove an item from the queue.
     //!
     //! @param[out] element
@@ -751,6 +1123,58 @@ public:
     //! @retval #kArQueueEmptyError
     ar_status_t receive(void * element, uint32_t timeout=kArInfiniteTimeout) { return ar_queue_receive(this, element, timeout); }
 
+    //! @brief Add as many of several items as fit to the queue under one lock.
+    //!
+    //! @param elements Pointer to an array of @a count elements.
+    //! @param count Number of elements in the array.
+    //! @param[out] sentCount Optional, set to the number of elements sent.
+    //! @param timeout The maximum number of milliseconds to wait for room in the queue.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueFullError
+    //! @see ar_queue_send_n()
+    ar_status_t sendN(const void * elements, uint32_t count, uint32_t * sentCount=NULL, uint32_t timeout=kArInfiniteTimeout) { return ar_queue_send_n(this, elements, count, sentCount, timeout); }
+
+    //! @brief Remove up to several items from the queue under one lock.
+    //!
+    //! @param[out] elements Pointer to an array with room for @a count elements.
+    //! @param count Maximum number of elements to receive.
+    //! @param[out] receivedCount Optional, set to the number of elements received.
+    //! @param timeout The maximum number of milliseconds to wait for an element.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueEmptyError
+    //! @see ar_queue_receive_n()
+    ar_status_t receiveN(void * elements, uint32_t count, uint32_t * receivedCount=NULL, uint32_t timeout=kArInfiniteTimeout) { return ar_queue_receive_n(this, elements, count, receivedCount, timeout); }
+
+    //! @brief Reserve the next free slot so an element can be written in place.
+    //!
+    //! @param[out] element Set to the address of the reserved slot.
+    //! @param timeout The maximum number of milliseconds to wait for a free slot.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueFullError
+    //! @see ar_queue_reserve_send()
+    ar_status_t reserveSend(void ** element, uint32_t timeout=kArInfiniteTimeout) { return ar_queue_reserve_send(this, element, timeout); }
+
+    //! @brief Add the element written into the reserved slot to the queue.
+    //! @see ar_queue_commit_send()
+    ar_status_t commitSend() { return ar_queue_commit_send(this); }
+
+    //! @brief Get a pointer to the head element without copying it out.
+    //!
+    //! @param[out] element Set to the address of the head element.
+    //! @param timeout The maximum number of milliseconds to wait for an element.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueEmptyError
+    //! @see ar_queue_peek_receive()
+    ar_status_t peekReceive(void ** element, uint32_t timeout=kArInfiniteTimeout) { return ar_queue_peek_receive(this, element, timeout); }
+
+    //! @brief Remove the element obtained with peekReceive() from the queue.
+    //! @see ar_queue_release_receive()
+    ar_status_t releaseReceive() { return ar_queue_release_receive(this); }
+
     //! @brief Returns whether the queue is currently empty.
     bool isEmpty() const { return m_count == 0; }
 
@@ -843,6 +1267,50 @@ public:
         return element;
     }
 
+    //! @brief Typed form of Queue::sendN().
+    ar_status_t sendN(const T * elements, uint32_t count, uint32_t * sentCount=NULL, uint32_t timeout=kArInfiniteTimeout)
+    {
+        return Queue::sendN((const void *)elements, count, sentCount, timeout);
+    }
+
+    //! @brief Typed form of Queue::receiveN().
+    ar_status_t receiveN(T * elements, uint32_t count, uint32_t * receivedCount=NULL, uint32_t timeout=kArInfiniteTimeout)
+    {
+        return Queue::receiveN((void *)elements, count, receivedCount, timeout);
+    }
+
+    //! @brief Typed form of Queue::reserveSend().
+    //!
+    //! @param timeout The maximum number of milliseconds to wait for a free slot.
+    //! @param[out] resultStatus The status of the operation is placed here. May be NULL.
+    //! @return Pointer to the reserved slot, or NULL if no slot was reserved.
+    T * reserveSend(uint32_t timeout=kArInfiniteTimeout, ar_status_t * resultStatus=NULL)
+    {
+        void * element = NULL;
+        ar_status_t status = Queue::reserveSend(&element, timeout);
+        if (resultStatus)
+        {
+            *resultStatus = status;
+        }
+        return reinterpret_cast<T *>(element);
+    }
+
+    //! @brief Typed form of Queue::peekReceive().
+    //!
+    //! @param timeout The maximum number of milliseconds to wait for an element.
+    //! @param[out] resultStatus The status of the operation is placed here. May be NULL.
+    //! @return Pointer to the head element, or NULL if no element is available.
+    T * peekReceive(uint32_t timeout=kArInfiniteTimeout, ar_status_t * resultStatus=NULL)
+    {
+        void * element = NULL;
+        ar_status_t status = Queue::peekReceive(&element, timeout);
+        if (resultStatus)
+        {
+            *resultStatus = status;
+        }
+        return reinterpret_cast<T *>(element);
+    }
+
 protected:
     T m_storage[N]; //!< Static storage for the queue elements.
 
@@ -855,31 +1323,664 @@ private:
 };
 
 /*!
- * @brief Timer object.
+ * @brief Template class to help statically allocate a prioritized Queue.
  *
- * @ingroup ar_timer
+ * Elements are received in order of the priority they were sent with, highest first.
+ *
+ * @code
+ *      StaticPriorityQueue<Command, 8> q("commands");
+ *
+ *      q.send(urgent, 10);
+ *      q.send(routine);
+ *
+ *      Command c = q.receive();
+ * @endcode
+ *
+ * @param T The queue element type.
+ * @param N Maximum number of elements the queue will hold.
  */
-class Timer : public _ar_timer
+template <typename T, unsigned N>
+class StaticPriorityQueue : public Queue
 {
 public:
-
-    //! @brief Timer callback function that takes an instance of this class.
-    typedef void (*callback_t)(Timer * timer, void * param);
-
     //! @brief Default constructor.
-    Timer() {}
+    StaticPriorityQueue() {}
 
     //! @brief Constructor.
-    Timer(const char * name, callback_t callback, void * param, ar_timer_mode_t timerMode, uint32_t delay)
+    StaticPriorityQueue(const char * name)
     {
-        init(name, callback, param, timerMode, delay);
+        Queue::initPrioritized(name, m_storage, sizeof(T), N);
     }
 
-    //! @brief Destructor.
-    ~Timer() { ar_timer_delete(this); }
+    //! @brief Initialiser method.
+    ar_status_t init(const char * name)
+    {
+        return Queue::initPrioritized(name, m_storage, sizeof(T), N);
+    }
 
-    //! @brief Initialize the timer.
-    ar_status_t init(const char * name, callback_t callback, void * param, ar_timer_mode_t timerMode, uint32_t delay);
+    //! @brief Typed form of Queue::sendPrioritized().
+    ar_status_t send(T element, uint8_t priority=0, uint32_t timeout=kArInfiniteTimeout)
+    {
+        return Queue::sendPrioritized((const void *)&element, priority, timeout);
+    }
+
+    //! @copydoc Queue::receive()
+    ar_status_t receive(T * element, uint32_t timeout=kArInfiniteTimeout)
+    {
+        return Queue::receive((void *)element, timeout);
+    }
+
+    //! @brief Alternate form of typed receive.
+    //!
+    //! @param[out] resultStatus The status of the receive operation is placed here.
+    //!     May be NULL, in which case no status is returned.
+    //! @param timeout Maximum time in ticks to wait for a queue element.
+    T receive(uint32_t timeout=kArInfiniteTimeout, ar_status_t * resultStatus=NULL)
+    {
+        T element;
+        ar_status_t status = Queue::receive((void *)&element, timeout);
+        if (resultStatus)
+        {
+            *resultStatus = status;
+        }
+        return element;
+    }
+
+    //! @brief Typed form of Queue::receiveN().
+    ar_status_t receiveN(T * elements, uint32_t count, uint32_t * receivedCount=NULL, uint32_t timeout=kArInfiniteTimeout)
+    {
+        return Queue::receiveN((void *)elements, count, receivedCount, timeout);
+    }
+
+protected:
+    //! Static storage for the keys and queue elements.
+    uint32_t m_storage[(AR_QUEUE_PRIORITIZED_STORAGE_SIZE(sizeof(T), N) + sizeof(uint32_t) - 1) / sizeof(uint32_t)];
+
+private:
+    //! @brief Disable copy constructor.
+    StaticPriorityQueue(const StaticPriorityQueue<T,N> & other);
+
+    //! @brief Disable assignment operator.
+    StaticPriorityQueue& operator=(const StaticPriorityQueue<T,N> & other);
+};
+
+/*!
+ * @brief Template class to help statically allocate a mailbox.
+ *
+ * A mailbox holds only the latest value sent to it. Sends never block, and each value is
+ * received at most once.
+ *
+ * @code
+ *      StaticMailbox<Sample> latest("imu");
+ *
+ *      // In the sampling interrupt:
+ *      latest.send(sample);
+ *
+ *      // In a thread, wait for the next fresh sample:
+ *      Sample s = latest.receive();
+ * @endcode
+ *
+ * @param T The type of the value.
+ */
+template <typename T>
+class StaticMailbox : public Queue
+{
+public:
+    //! @brief Default constructor.
+    StaticMailbox() {}
+
+    //! @brief Constructor.
+    StaticMailbox(const char * name)
+    {
+        Queue::initMailbox(name, m_storage, sizeof(T));
+    }
+
+    //! @brief Initialiser method.
+    ar_status_t init(const char * name)
+    {
+        return Queue::initMailbox(name, m_storage, sizeof(T));
+    }
+
+    //! @brief Replace the value in the mailbox.
+    ar_status_t send(T element)
+    {
+        return Queue::send((const void *)&element, kArNoTimeout);
+    }
+
+    //! @copydoc Queue::receive()
+    ar_status_t receive(T * element, uint32_t timeout=kArInfiniteTimeout)
+    {
+        return Queue::receive((void *)element, timeout);
+    }
+
+    //! @brief Alternate form of typed receive.
+    //!
+    //! @param[out] resultStatus The status of the receive operation is placed here.
+    //!     May be NULL, in which case no status is returned.
+    //! @param timeout Maximum time in ticks to wait for a new value.
+    T receive(uint32_t timeout=kArInfiniteTimeout, ar_status_t * resultStatus=NULL)
+    {
+        T element;
+        ar_status_t status = Queue::receive((void *)&element, timeout);
+        if (resultStatus)
+        {
+            *resultStatus = status;
+        }
+        return element;
+    }
+
+protected:
+    T m_storage[3]; //!< Static storage for the mailbox slots.
+
+private:
+    //! @brief Disable copy constructor.
+    StaticMailbox(const StaticMailbox<T> & other);
+
+    //! @brief Disable assignment operator.
+    StaticMailbox& operator=(const StaticMailbox<T> & other);
+};
+
+/*!
+ * @brief Buffer of variable-length messages.
+ *
+ * @ingroup ar_message_buffer
+ */
+class MessageBuffer : public _ar_message_buffer
+{
+public:
+    //! @brief Default constructor.
+    MessageBuffer() {}
+
+    //! @brief Constructor.
+    MessageBuffer(const char * name, void * storage, uint32_t capacity)
+    {
+        init(name, storage, capacity);
+    }
+
+    //! @brief Message buffer initialiser.
+    //!
+    //! @param name The new message buffer's name.
+    //! @param storage Buffer that holds the messages and their lengths.
+    //! @param capacity Size of @a storage in bytes.
+    //!
+    //! @retval #kArSuccess The message buffer was initialised.
+    ar_status_t init(const char * name, void * storage, uint32_t capacity)
+    {
+        return ar_message_buffer_create(this, name, storage, capacity);
+    }
+
+    //! @brief Message buffer cleanup.
+    ~MessageBuffer() { ar_message_buffer_delete(this); }
+
+    //! @brief Get the message buffer's name.
+    const char * getName() const { return m_name; }
+
+    //! @brief Send a message.
+    //!
+    //! @param data The message contents.
+    //! @param length Number of bytes in the message.
+    //! @param timeout The maximum number of milliseconds to wait for room in the buffer.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueFullError
+    //! @retval #kArTimeoutError
+    //! @see ar_message_buffer_send()
+    ar_status_t send(const void * data, uint32_t length, uint32_t timeout=kArInfiniteTimeout) { return ar_message_buffer_send(this, data, length, timeout); }
+
+    //! @brief Receive the next message.
+    //!
+    //! @param[out] data Buffer to receive the message.
+    //! @param maxLength Size of @a data in bytes.
+    //! @param[out] length Optional, set to the length of the message.
+    //! @param timeout The maximum number of milliseconds to wait for a message.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueEmptyError
+    //! @retval #kArTimeoutError
+    //! @retval #kArInvalidParameterError The message is longer than @a maxLength.
+    //! @see ar_message_buffer_receive()
+    ar_status_t receive(void * data, uint32_t maxLength, uint32_t * length=NULL, uint32_t timeout=kArInfiniteTimeout) { return ar_message_buffer_receive(this, data, maxLength, length, timeout); }
+
+    //! @brief Returns the length of the next message, or 0 if the buffer is empty.
+    uint32_t getNextLength() { return ar_message_buffer_get_next_length(this); }
+
+    //! @brief Returns the number of messages in the buffer.
+    uint32_t getCount() { return ar_message_buffer_get_count(this); }
+
+    //! @brief Returns the number of free bytes, including room for a message's length.
+    uint32_t getFree() { return ar_message_buffer_get_free(this); }
+
+private:
+    //! @brief Disable copy constructor.
+    MessageBuffer(const MessageBuffer & other);
+
+    //! @brief Disable assignment operator.
+    MessageBuffer& operator=(const MessageBuffer & other);
+};
+
+/*!
+ * @brief Template class to help statically allocate a MessageBuffer.
+ *
+ * @ingroup ar_message_buffer
+ *
+ * @param N Size of the message buffer in bytes.
+ */
+template <uint32_t N>
+class StaticMessageBuffer : public MessageBuffer
+{
+public:
+    //! @brief Default constructor.
+    StaticMessageBuffer() {}
+
+    //! @brief Constructor.
+    StaticMessageBuffer(const char * name)
+    {
+        MessageBuffer::init(name, m_storage, N);
+    }
+
+    //! @brief Initialiser method.
+    ar_status_t init(const char * name)
+    {
+        return MessageBuffer::init(name, m_storage, N);
+    }
+
+protected:
+    uint8_t m_storage[N]; //!< Static storage for the messages.
+
+private:
+    //! @brief Disable copy constructor.
+    StaticMessageBuffer(const StaticMessageBuffer<N> & other);
+
+    //! @brief Disable assignment operator.
+    StaticMessageBuffer& operator=(const StaticMessageBuffer<N> & other);
+};
+
+/*!
+ * @brief Lock-free byte stream from one writer to one reader.
+ *
+ * @ingroup ar_stream_buffer
+ */
+class StreamBuffer : public _ar_stream_buffer
+{
+public:
+    //! @brief Default constructor.
+    StreamBuffer() {}
+
+    //! @brief Constructor.
+    StreamBuffer(const char * name, void * storage, uint32_t capacity, uint32_t triggerLevel=1)
+    {
+        init(name, storage, capacity, triggerLevel);
+    }
+
+    //! @brief Stream buffer initialiser.
+    //!
+    //! @param name The new stream buffer's name.
+    //! @param storage Buffer that holds the stream's bytes.
+    //! @param capacity Size of @a storage in bytes.
+    //! @param triggerLevel Number of bytes that must be available before a blocked reader is woken.
+    //!
+    //! @retval #kArSuccess The stream buffer was initialised.
+    ar_status_t init(const char * name, void * storage, uint32_t capacity, uint32_t triggerLevel=1)
+    {
+        return ar_stream_buffer_create(this, name, storage, capacity, triggerLevel);
+    }
+
+    //! @brief Stream buffer cleanup.
+    ~StreamBuffer() { ar_stream_buffer_delete(this); }
+
+    //! @brief Get the stream buffer's name.
+    const char * getName() const { return m_name; }
+
+    //! @brief Write bytes without blocking.
+    //!
+    //! @param data Bytes to write.
+    //! @param length Number of bytes to write.
+    //! @param[out] bytesWritten Optional, set to the number of bytes written.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueFullError
+    //! @see ar_stream_buffer_write()
+    ar_status_t write(const void * data, uint32_t length, uint32_t * bytesWritten=NULL) { return ar_stream_buffer_write(this, data, length, bytesWritten); }
+
+    //! @brief Read bytes, waiting for the trigger level to be reached.
+    //!
+    //! @param[out] data Buffer to receive the bytes.
+    //! @param length Maximum number of bytes to read.
+    //! @param[out] bytesRead Optional, set to the number of bytes read.
+    //! @param timeout The maximum number of milliseconds to wait for the trigger level.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArQueueEmptyError
+    //! @retval #kArTimeoutError
+    //! @see ar_stream_buffer_read()
+    ar_status_t read(void * data, uint32_t length, uint32_t * bytesRead=NULL, uint32_t timeout=kArInfiniteTimeout) { return ar_stream_buffer_read(this, data, length, bytesRead, timeout); }
+
+    //! @brief Change the number of bytes that must be available to wake the reader.
+    ar_status_t setTriggerLevel(uint32_t triggerLevel) { return ar_stream_buffer_set_trigger_level(this, triggerLevel); }
+
+    //! @brief Returns the trigger level.
+    uint32_t getTriggerLevel() const { return m_triggerLevel; }
+
+    //! @brief Returns the number of bytes available to read.
+    uint32_t getCount() { return ar_stream_buffer_get_count(this); }
+
+    //! @brief Returns the number of bytes that can be written.
+    uint32_t getFree() { return ar_stream_buffer_get_free(this); }
+
+private:
+    //! @brief Disable copy constructor.
+    StreamBuffer(const StreamBuffer & other);
+
+    //! @brief Disable assignment operator.
+    StreamBuffer& operator=(const StreamBuffer & other);
+};
+
+/*!
+ * @brief Template class to help statically allocate a StreamBuffer.
+ *
+ * @ingroup ar_stream_buffer
+ *
+ * @param N Size of the stream buffer in bytes.
+ */
+template <uint32_t N>
+class StaticStreamBuffer : public StreamBuffer
+{
+public:
+    //! @brief Default constructor.
+    StaticStreamBuffer() {}
+
+    //! @brief Constructor.
+    StaticStreamBuffer(const char * name, uint32_t triggerLevel=1)
+    {
+        StreamBuffer::init(name, m_storage, N, triggerLevel);
+    }
+
+    //! @brief Initialiser method.
+    ar_status_t init(const char * name, uint32_t triggerLevel=1)
+    {
+        return StreamBuffer::init(name, m_storage, N, triggerLevel);
+    }
+
+protected:
+    uint8_t m_storage[N]; //!< Static storage for the stream's bytes.
+
+private:
+    //! @brief Disable copy constructor.
+    StaticStreamBuffer(const StaticStreamBuffer<N> & other);
+
+    //! @brief Disable assignment operator.
+    StaticStreamBuffer& operator=(const StaticStreamBuffer<N> & other);
+};
+
+/*!
+ * @brief Seqlock.
+ *
+ * @ingroup ar_seqlock
+ *
+ * @see SeqLocked
+ */
+class SeqLock : public _ar_seqlock
+{
+public:
+    //! @brief Default constructor.
+    SeqLock() {}
+
+    //! @brief Constructor.
+    SeqLock(const char * name, void * storage, uint32_t size)
+    {
+        init(name, storage, size);
+    }
+
+    //! @brief Seqlock initialiser.
+    //!
+    //! @param name The new seqlock's name.
+    //! @param storage The protected data.
+    //! @param size Size of @a storage in bytes.
+    //!
+    //! @retval #kArSuccess The seqlock was initialised.
+    ar_status_t init(const char * name, void * storage, uint32_t size)
+    {
+        return ar_seqlock_create(this, name, storage, size);
+    }
+
+    //! @brief Seqlock cleanup.
+    ~SeqLock() { ar_seqlock_delete(this); }
+
+    //! @brief Get the seqlock's name.
+    const char * getName() const { return m_name; }
+
+    //! @brief Replace the protected data.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArInvalidStateError
+    //! @see ar_seqlock_write()
+    ar_status_t write(const void * data) { return ar_seqlock_write(this, data); }
+
+    //! @brief Copy out a consistent snapshot of the protected data.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArInvalidStateError
+    //! @see ar_seqlock_read()
+    ar_status_t read(void * data) { return ar_seqlock_read(this, data); }
+
+    //! @brief Returns the number of writes that have finished.
+    uint32_t getWriteCount() { return ar_seqlock_get_write_count(this); }
+
+private:
+    //! @brief Disable copy constructor.
+    SeqLock(const SeqLock & other);
+
+    //! @brief Disable assignment operator.
+    SeqLock& operator=(const SeqLock & other);
+};
+
+/*!
+ * @brief Template class for a value protected by a seqlock.
+ *
+ * @ingroup ar_seqlock
+ *
+ * @param T Type of the value. It is copied with memcpy(), so it must be a plain data type.
+ */
+template <typename T>
+class SeqLocked : public SeqLock
+{
+public:
+    //! @brief Default constructor.
+    SeqLocked() {}
+
+    //! @brief Constructor.
+    SeqLocked(const char * name)
+    {
+        SeqLock::init(name, &m_storage, sizeof(T));
+    }
+
+    //! @brief Initialiser method.
+    ar_status_t init(const char * name)
+    {
+        return SeqLock::init(name, &m_storage, sizeof(T));
+    }
+
+    //! @brief Replace the value.
+    //! @see ar_seqlock_write()
+    ar_status_t write(const T & value) { return SeqLock::write(&value); }
+
+    //! @brief Copy out a consistent snapshot of the value.
+    //! @see ar_seqlock_read()
+    ar_status_t read(T & value) { return SeqLock::read(&value); }
+
+    //! @brief Returns a consistent snapshot of the value.
+    //!
+    //! Must not be called from an interrupt handler that may preempt a write.
+    T read()
+    {
+        T value;
+        SeqLock::read(&value);
+        return value;
+    }
+
+protected:
+    T m_storage; //!< Storage for the value.
+
+private:
+    //! @brief Disable copy constructor.
+    SeqLocked(const SeqLocked<T> & other);
+
+    //! @brief Disable assignment operator.
+    SeqLocked& operator=(const SeqLocked<T> & other);
+};
+
+#if AR_ENABLE_RCU
+/*!
+ * @brief Template class for read-mostly data shared with read-copy-update.
+ *
+ * Readers get the current version inside a ReadGuard, with nothing more than a pointer load.
+ * A writer builds a new version, publishes it, and reclaims the old one once no reader can
+ * still be using it.
+ *
+ * Example:
+ * @code
+ *  Ar::Rcu<RouteTable> s_routes(&s_initialRoutes);
+ *
+ *  void route(Packet & packet)
+ *  {
+ *      Ar::Rcu<RouteTable>::ReadGuard routes(s_routes);
+ *      packet.port = routes->lookup(packet.address);
+ *  }
+ *
+ *  void updateRoutes(RouteTable * newRoutes)
+ *  {
+ *      RouteTable * oldRoutes;
+ *      s_routes.update(newRoutes, &oldRoutes);
+ *      delete oldRoutes;
+ *  }
+ * @endcode
+ *
+ * @ingroup ar_rcu
+ *
+ * @param T Type of the shared data.
+ */
+template <typename T>
+class Rcu
+{
+public:
+    /*!
+     * @brief Read-side critical section for an Rcu object.
+     *
+     * The version that was current when the guard was created stays valid until the guard is
+     * destroyed.
+     */
+    class ReadGuard
+    {
+    public:
+        //! @brief Enters a read-side critical section and loads the current version.
+        ReadGuard(const Rcu<T> & rcu)
+        {
+            ar_rcu_read_lock();
+            m_value = rcu.get();
+        }
+
+        //! @brief Exits the read-side critical section.
+        ~ReadGuard()
+        {
+            ar_rcu_read_unlock();
+        }
+
+        //! @brief Returns the version being read. May be NULL.
+        const T * get() const { return m_value; }
+
+        //! @brief Access to the version being read.
+        const T * operator->() const { return m_value; }
+
+        //! @brief Access to the version being read.
+        const T & operator*() const { return *m_value; }
+
+    private:
+        const T * m_value;  //!< The version being read.
+    };
+
+    //! @brief Default constructor. There is no current version.
+    Rcu() : m_current(NULL) {}
+
+    //! @brief Constructor taking the first version.
+    Rcu(T * initial) : m_current(initial) {}
+
+    //! @brief Returns the current version.
+    //!
+    //! Readers must call this inside a read-side critical section, and use the result only
+    //! until the section is exited. ReadGuard does both.
+    const T * get() const { return m_current; }
+
+    //! @brief Makes @a newVersion current without waiting for readers.
+    //!
+    //! @return The old version, which readers may still be using. Call synchronize() before
+    //!     reclaiming it.
+    //! @see ar_rcu_exchange()
+    T * publish(T * newVersion)
+    {
+        return static_cast<T *>(ar_rcu_exchange(reinterpret_cast<void * volatile *>(&m_current), newVersion));
+    }
+
+    //! @brief Waits until no reader can be using a version replaced before the call.
+    //! @see ar_rcu_synchronize()
+    ar_status_t synchronize(uint32_t timeout=kArInfiniteTimeout) { return ar_rcu_synchronize(timeout); }
+
+    //! @brief Publishes a new version and waits until the old one can be reclaimed.
+    //!
+    //! @param newVersion The new version.
+    //! @param[out] oldVersion Set to the replaced version. Once this returns #kArSuccess,
+    //!     no reader is using it and it can be freed or reused.
+    //! @param timeout The maximum number of milliseconds to wait for readers.
+    //!
+    //! @retval #kArSuccess
+    //! @retval #kArTimeoutError The old version may still be in use.
+    //! @retval #kArInvalidStateError
+    ar_status_t update(T * newVersion, T ** oldVersion, uint32_t timeout=kArInfiniteTimeout)
+    {
+        *oldVersion = publish(newVersion);
+        return ar_rcu_synchronize(timeout);
+    }
+
+protected:
+    T * volatile m_current; //!< The current version.
+
+private:
+    //! @brief Disable copy constructor.
+    Rcu(const Rcu<T> & other);
+
+    //! @brief Disable assignment operator.
+    Rcu& operator=(const Rcu<T> & other);
+};
+#endif // AR_ENABLE_RCU
+
+/*!
+ * @brief Timer object.
+ *
+ * @ingroup ar_timer
+ */
+class Timer : public _ar_timer
+{
+public:
+
+    //! @brief Timer callback function that takes an instance of this class.
+    typedef void (*callback_t)(Timer * timer, void * param);
+
+    //! @brief Default constructor.
+    Timer() {}
+
+    //! @brief Constructor.
+    Timer(const char * name, callback_t callback, void * param, ar_timer_mode_t timerMode, uint32_t delay)
+    {
+        init(name, callback, param, timerMode, delay);
+    }
+
+    //! @brief Destructor.
+    ~Timer() { ar_timer_delete(this); }
+
+    //! @brief Initialize the timer.
+    ar_status_t init(const char * name, callback_t callback, void * param, ar_timer_mode_t timerMode, uint32_t delay);
+
+    //! @brief Initialize the timer with a delay in microseconds.
+    ar_status_t initMicroseconds(const char * name, callback_t callback, void * param, ar_timer_mode_t timerMode, uint64_t delay);
 
     //! @brief Get the timer's name.
     const char * getName() const { return m_name; }
@@ -896,8 +1997,14 @@ public:
     //! @brief Adjust the timer's delay.
     void setDelay(uint32_t delay) { ar_timer_set_delay(this, delay); }
 
-    //! @brief Get the current delay for the timer.
-    uint32_t getDelay() const { return m_delay; }
+    //! @brief Get the current delay for the timer in milliseconds.
+    uint32_t getDelay() const { return static_cast<uint32_t>(m_delay / 1000); }
+
+    //! @brief Adjust the timer's delay in microseconds.
+    void setDelayMicroseconds(uint64_t delay) { ar_timer_set_delay_us(this, delay); }
+
+    //! @brief Get the current delay for the timer in microseconds.
+    uint64_t getDelayMicroseconds() const { return m_delay; }
 
 protected:
 
@@ -1098,6 +2205,22 @@ public:
      */
     ar_status_t addQueue(ar_queue_t * queue, ar_runloop_queue_handler_t callback=NULL, void * param=NULL) { return ar_runloop_add_queue(this, queue, callback, param); }
 
+    /*!
+     * @brief Add a message buffer to a runloop.
+     *
+     * If the message buffer is already associated with another runloop, the
+     * #kArAlreadyAttachedError error is returned.
+     *
+     * @param buffer The message buffer to associate with the runloop.
+     * @param callback Optional callback to handle a message received on the buffer. May be NULL.
+     * @param param Arbitrary parameter passed to the _callback_ when it is called.
+     *
+     * @retval #kArSuccess The message buffer was added to the runloop.
+     * @retval #kArAlreadyAttachedError A message buffer can only be added to one runloop at a time.
+     * @retval #kArInvalidParameterError The _buffer_ parameter was NULL.
+     */
+    ar_status_t addMessageBuffer(ar_message_buffer_t * buffer, ar_runloop_message_buffer_handler_t callback=NULL, void * param=NULL) { return ar_runloop_add_message_buffer(this, buffer, callback, param); }
+
     /*!
      * @brief Return the current runloop.
      *
@@ -77,6 +77,7 @@ typedef enum _ar_status {
     kArRunLoopAlreadyRunningError, //!< The runloop is already running on another thread.
     kArRunLoopStopped,          //!< The runloop was stopped.
     kArRunLoopQueueReceived,    //!< The runloop exited due to a value received on an associated queue.
+    kArRunLoopMessageBufferReceived,    //!< The runloop exited due to a message received on an associated message buffer.
 } ar_status_t;
 
 //! @brief Options for creating a new thread.
@@ -100,6 +101,27 @@ typedef enum _ar_thread_state {
     kArThreadDone         //!< Thread has exited.
 } ar_thread_state_t;
 
+//! @brief Load average horizons.
+//!
+//! The time constant of each average is set by a configuration macro.
+//!
+//! @ingroup ar_thread
+typedef enum _ar_load_average {
+    kArLoadAverageShort = 0,    //!< #AR_SYSTEM_LOAD_SHORT_HORIZON, nominally 1 second.
+    kArLoadAverageMedium,       //!< #AR_SYSTEM_LOAD_MEDIUM_HORIZON, nominally 10 seconds.
+    kArLoadAverageLong,         //!< #AR_SYSTEM_LOAD_LONG_HORIZON, nominally 60 seconds.
+    kArLoadAverageCount         //!< Number of load averages.
+} ar_load_average_t;
+
+//! @brief Ways a thread notification can update the thread's notification value.
+//!
+//! @ingroup ar_thread
+typedef enum _ar_notify_action {
+    kArNotifyIncrement = 0,     //!< Add one to the value, like putting a counting semaphore.
+    kArNotifySetBits,           //!< OR bits into the value, like setting event flags.
+    kArNotifyOverwrite          //!< Replace the value, like a single entry mailbox.
+} ar_notify_action_t;
+
 //! @brief Range of priorities for threads.
 //!
 //! @ingroup ar_thread
@@ -118,6 +140,18 @@ typedef enum _ar_timer_modes {
     kArPeriodicTimer      //!< Timer repeatedly fires every time the interval elapses.
 } ar_timer_mode_t;
 
+//! @brief Options for waiting on event flags.
+//!
+//! Combine one of the wait modes with #kArEventFlagsClearOnExit if desired.
+//!
+//! @ingroup ar_event_flags
+enum _ar_event_flags_options
+{
+    kArEventFlagsWaitAny = 0,       //!< Wait until any of the requested flags are set.
+    kArEventFlagsWaitAll = 1,       //!< Wait until all of the requested flags are set.
+    kArEventFlagsClearOnExit = 2    //!< Clear the requested flags when the wait is satisfied.
+};
+
 //------------------------------------------------------------------------------
 // Types
 //------------------------------------------------------------------------------
@@ -126,6 +160,7 @@ typedef enum _ar_timer_modes {
 typedef struct _ar_thread ar_thread_t;
 typedef struct _ar_channel ar_channel_t;
 typedef struct _ar_queue ar_queue_t;
+typedef struct _ar_message_buffer ar_message_buffer_t;
 typedef struct _ar_timer ar_timer_t;
 typedef struct _ar_runloop ar_runloop_t;
 typedef struct _ar_list_node ar_list_node_t;
@@ -153,6 +188,9 @@ typedef void (*ar_runloop_queue_handler_t)(ar_queue_t * queue, void * param);
 
 //! @brief
 typedef void (*ar_runloop_channel_handler_t)(ar_channel_t * channel, void * param);
+
+//! @brief
+typedef void (*ar_runloop_message_buffer_handler_t)(ar_message_buffer_t * buffer, void * param);
 //@}
 
 //! @name Linked lists
@@ -188,17 +226,54 @@ typedef struct _ar_list {
     bool contains(ar_list_node_t * item);       //!< @brief Return whether the list contains a given node.
     void add(ar_list_node_t * item);            //!< @brief Add an item to the list.
     inline void add(ar_thread_t * item);        //!< @brief Add a thread to the list.
-    inline void add(ar_timer_t * item);         //!< @brief Add a timer to the list.
     inline void add(ar_queue_t * item);         //!< @brief Add a queue to the list.
     void remove(ar_list_node_t * item);         //!< @brief Remove an item from the list.
     inline void remove(ar_thread_t * item);     //!< @brief Remove a thread from the list.
-    inline void remove(ar_timer_t * item);      //!< @brief Remove a timer from the list.
     inline void remove(ar_queue_t * item);      //!< @brief Remove a queue from the list.
     void check();
 #endif // __cplusplus
 } ar_list_t;
 //@}
 
+//! @name Deferred actions
+//@{
+/*!
+ * @brief Deferred action kept by a kernel object for when the deferred action queue is full.
+ *
+ * An object that stores data from an interrupt and defers only the rest of the work uses
+ * this so the work cannot be lost. If there is no room for the action in the queue, the node
+ * is linked onto a list that the scheduler runs after the queued actions.
+ */
+typedef struct _ar_deferred_node {
+    struct _ar_deferred_node * volatile m_next; //!< Next node on the kernel's list of pending nodes.
+    ar_status_t (*m_action)(void * object, void * arg, uint32_t count);    //!< Action to run.
+    void * m_object;                //!< Object passed to the action.
+    volatile int32_t m_isPending;   //!< Nonzero while the node is on the list of pending nodes.
+} ar_deferred_node_t;
+//@}
+
+//! @name Timer heap
+//@{
+/*!
+ * @brief Min-heap of timers ordered by wakeup time.
+ *
+ * This is an intrusive pairing heap. The links are members of the timers themselves, so no
+ * storage other than the root pointer is needed.
+ */
+typedef struct _ar_timer_heap {
+    ar_timer_t * m_root;    //!< Timer with the earliest wakeup time. Will be NULL if the heap is empty.
+
+    // Internal utility methods.
+#if defined(__cplusplus)
+    bool isEmpty() const { return m_root == 0; }    //!< @brief Return whether the heap is empty.
+    ar_timer_t * getMin() { return m_root; }        //!< @brief Return the timer with the earliest wakeup time.
+    void insert(ar_timer_t * timer);            //!< @brief Add a timer to the heap.
+    void remove(ar_timer_t * timer);            //!< @brief Remove a timer from the heap.
+    void decreaseKey(ar_timer_t * timer, uint64_t wakeupTime); //!< @brief Move a timer's wakeup time earlier.
+#endif // __cplusplus
+} ar_timer_heap_t;
+//@}
+
 /*!
  * @brief Thread.
  *
@@ -217,13 +292,31 @@ struct _ar_thread {
     ar_list_node_t m_createdNode;   //!< Created list node.
 #endif // AR_GLOBAL_OBJECT_LISTS
     ar_list_node_t m_blockedNode;   //!< Blocked list node.
-    uint32_t m_wakeupTime;          //!< Tick count when a sleeping thread will awaken.
+    uint64_t m_wakeupTime;          //!< Microsecond time when a sleeping thread will awaken.
+#if AR_ENABLE_TIMING_WHEEL
+    uint8_t m_wakeupSlot;           //!< Timing wheel slot holding the thread while it is sleeping.
+#endif // AR_ENABLE_TIMING_WHEEL
     ar_status_t m_unblockStatus;       //!< Status code to return from a blocking function upon unblocking.
     void * m_channelData;       //!< Receive or send data pointer for blocked channel.
+    uint32_t m_eventFlags;      //!< Flags a thread blocked on event flags is waiting for, then the flags that woke it.
+    uint8_t m_eventFlagsOptions;    //!< Wait options for a thread blocked on event flags.
     ar_runloop_t * m_runLoop;   //!< Run loop associated with this thread.
+    volatile int32_t m_notifyValue; //!< Notification value updated by ar_thread_notify().
+    volatile bool m_isNotifyPending;    //!< Whether a notification has arrived that has not been waited for.
+    volatile bool m_isWaitingForNotify; //!< Whether the thread is in ar_thread_notify_wait() and may block.
+#if AR_ENABLE_RCU
+    uint32_t m_rcuNesting;      //!< Depth of nested RCU read-side critical sections.
+    bool m_isRcuReader;         //!< Whether the thread is counted as a reader that a grace period must wait for.
+    bool m_hasRcuExited;        //!< Set when the thread exits its outermost read-side critical section.
+    uint8_t m_rcuSlot;          //!< Which of the kernel's RCU reader counts the thread is counted in.
+#endif // AR_ENABLE_RCU
 #if AR_ENABLE_SYSTEM_LOAD
     uint16_t m_permilleCpu;     //!< Per mille of this thread's CPU usage (range of 1-1000).
-    uint32_t m_loadAccumulator; //!< Number of microseconds this thread has run during the current load computation period.
+    uint64_t m_loadAccumulator; //!< Number of cycles this thread has run during its load computation period.
+    uint32_t m_loadPeriod;      //!< Load computation period the accumulator belongs to.
+    uint32_t m_loadAverages[kArLoadAverageCount]; //!< Exponentially weighted per mille CPU usage, in fixed point.
+    uint64_t m_totalCycles;     //!< Number of cycles this thread has run since it was created.
+    uint32_t m_switchCount;     //!< Number of times this thread has been switched in.
 #endif // AR_ENABLE_SYSTEM_LOAD
     uint32_t * m_stackTop;      //!< Saved stack top address for computing stack usage.
     uint32_t m_uniqueId;        //!< Unique ID for this thread.
@@ -248,11 +341,28 @@ typedef struct _ar_thread_status {
     const char * m_name;        //!< Thread's name.
     uint32_t m_uniqueId;        //!< Unique ID for this thread.
     uint32_t m_cpu;             //!< Per mille CPU usage of the thread over the last sampling period, with a range of 1-1000.
+    uint64_t m_cycles;          //!< Total cycles the thread has run, in units of ar_get_cycles().
+    uint32_t m_switchCount;     //!< Number of times the thread has been switched in.
     ar_thread_state_t m_state;  //!< Current thread state.
     uint32_t m_maxStackUsed;    //!< Maximum number of bytes used in the thread's stack.
     uint32_t m_stackSize;       //!< Total bytes allocated to the thread's stack.
 } ar_thread_status_t;
 
+/*!
+ * @brief Usage statistics for a deferred action queue.
+ *
+ * Kernel operations performed by interrupts while the kernel is locked are deferred until the
+ * scheduler runs. Use these statistics to size #AR_DEFERRED_ACTION_QUEUE_SIZE.
+ *
+ * @ingroup ar_kernel
+ */
+typedef struct _ar_deferred_action_stats {
+    uint32_t m_capacity;        //!< Number of entries the queue holds.
+    uint32_t m_highWater;       //!< Maximum number of entries that have been in use at once.
+    uint32_t m_coalesced;       //!< Number of actions merged into an identical queued action.
+    uint32_t m_overflows;       //!< Number of actions that failed because the queue was full.
+} ar_deferred_action_stats_t;
+
 /*!
  * @brief Counting semaphore.
  *
@@ -267,6 +377,20 @@ typedef struct _ar_semaphore {
 #endif // AR_GLOBAL_OBJECT_LISTS
 } ar_semaphore_t;
 
+/*!
+ * @brief Event flags group.
+ *
+ * @ingroup ar_event_flags
+ */
+typedef struct _ar_event_flags {
+    const char * m_name;            //!< Name of the event flags group.
+    volatile uint32_t m_flags;      //!< Current flag values.
+    ar_list_t m_blockedList;        //!< List of threads waiting for flags.
+#if AR_GLOBAL_OBJECT_LISTS
+    ar_list_node_t m_createdNode;   //!< Created list node.
+#endif // AR_GLOBAL_OBJECT_LISTS
+} ar_event_flags_t;
+
 /*!
  * @brief Mutex.
  *
@@ -283,6 +407,50 @@ typedef struct _ar_mutex {
 #endif // AR_GLOBAL_OBJECT_LISTS
 } ar_mutex_t;
 
+/*!
+ * @brief Condition variable.
+ *
+ * @ingroup ar_condvar
+ */
+typedef struct _ar_condvar {
+    const char * m_name;            //!< Name of the condition variable.
+    ar_mutex_t * m_mutex;           //!< Mutex passed in by the waiting threads.
+    ar_list_t m_blockedList;        //!< List of threads waiting on the condition variable.
+#if AR_GLOBAL_OBJECT_LISTS
+    ar_list_node_t m_createdNode;   //!< Created list node.
+#endif // AR_GLOBAL_OBJECT_LISTS
+} ar_condvar_t;
+
+/*!
+ * @brief A thread holding the read lock of a reader-writer lock.
+ *
+ * @ingroup ar_rwlock
+ */
+typedef struct _ar_rwlock_reader {
+    ar_thread_t * m_thread;         //!< Reader thread, or NULL if the slot is free.
+    uint16_t m_lockCount;           //!< Number of times the thread has taken the read lock.
+    uint8_t m_originalPriority;     //!< Original priority of the reader before its priority was raised.
+} ar_rwlock_reader_t;
+
+/*!
+ * @brief Reader-writer lock.
+ *
+ * @ingroup ar_rwlock
+ */
+typedef struct _ar_rwlock {
+    const char * m_name;            //!< Name of the reader-writer lock.
+    volatile ar_thread_t * m_writer;    //!< Thread holding the write lock.
+    volatile unsigned m_writerLockCount; //!< Number of times the writer has taken the write lock.
+    uint8_t m_writerOriginalPriority;   //!< Original priority of the writer before its priority was raised.
+    volatile unsigned m_readerCount;    //!< Number of reader slots in use.
+    ar_rwlock_reader_t m_readers[AR_RWLOCK_MAX_READERS]; //!< Threads holding the read lock.
+    ar_list_t m_readBlockedList;    //!< List of threads waiting for the read lock.
+    ar_list_t m_writeBlockedList;   //!< List of threads waiting for the write lock.
+#if AR_GLOBAL_OBJECT_LISTS
+    ar_list_node_t m_createdNode;   //!< Created list node.
+#endif // AR_GLOBAL_OBJECT_LISTS
+} ar_rwlock_t;
+
 /*!
  * @brief Channel.
  *
@@ -301,6 +469,13 @@ struct _ar_channel {
 /*!
  * @brief Queue.
  *
+ * A prioritized queue keeps its elements in a binary heap, with the highest priority element
+ * in slot 0. Interrupts cannot touch the heap, so they stage elements in slots taken from the
+ * end of the storage, which are moved into the heap under the kernel lock.
+ *
+ * A mailbox uses three slots: one holds the latest value, one may be in the middle of being
+ * read, and one may be in the middle of being written. #m_mailboxState tracks which is which.
+ *
  * @ingroup ar_queue
  */
 struct _ar_queue {
@@ -309,19 +484,106 @@ struct _ar_queue {
     unsigned m_elementSize; //!< Number of bytes occupied by each element.
     unsigned m_capacity;    //!< Maximum number of elements the queue can hold.
     unsigned m_head;        //!< Index of queue head.
-    unsigned m_tail;        //!< Index of queue tail.
-    unsigned m_count;       //!< Current number of elements in the queue.
+    volatile int32_t m_tail;    //!< Index of the next slot to be claimed by a sender.
+    volatile unsigned m_count;  //!< Current number of elements in the queue.
+    volatile int32_t m_reservedCount;   //!< Number of slots claimed by senders but not yet added to the queue.
+    volatile int32_t m_writtenCount;    //!< Number of claimed slots that have been written.
+    volatile int32_t m_droppedCount;    //!< Overwriting queues only: elements at the head dropped by interrupts but not yet removed.
+    uint32_t * m_keys;      //!< Sequence number and priority of each slot of a prioritized queue, NULL for a FIFO queue.
+    volatile int32_t m_slots;   //!< Prioritized queues only: slots held by the heap in the low 16 bits, and slots staged by interrupts in the high 16 bits.
+    volatile int32_t m_sequence;    //!< Prioritized queues only: sequence number for the next element, to keep elements of equal priority in order.
+    volatile int32_t m_mailboxState;    //!< Mailboxes only: latest slot, whether it is unread, slots in use, and a generation count.
+    bool m_isOverwrite;     //!< Whether a send to a full queue drops the oldest element.
+    bool m_isMailbox;       //!< Whether the queue is a mailbox holding only the latest value.
+    bool m_isSendReserved;  //!< Whether the tail slot is reserved by ar_queue_reserve_send().
+    bool m_isReceivePeeked; //!< Whether the head element is held by ar_queue_peek_receive().
+    volatile bool m_isHeadBusy; //!< Whether a thread is reading or removing head elements, so interrupts must not drop them.
     ar_list_t m_sendBlockedList;    //!< List of threads blocked waiting to send.
     ar_list_t m_receiveBlockedList; //!< List of threads blocked waiting to receive data.
     ar_runloop_t * m_runLoop;       //!< Runloop the queue is bound to.
     ar_list_node_t m_runLoopNode;   //!< List node for the runloop's queue list.
     ar_runloop_queue_handler_t m_runLoopHandler;    //!< Handler function.
     void * m_runLoopHandlerParam;   //!< User parameter for handler function.
+    ar_deferred_node_t m_publishNode;   //!< Adds elements sent from interrupts to the queue.
+#if AR_GLOBAL_OBJECT_LISTS
+    ar_list_node_t m_createdNode;   //!< Created list node.
+#endif // AR_GLOBAL_OBJECT_LISTS
+};
+
+/*!
+ * @brief Message buffer.
+ *
+ * Each message is stored as a 16-bit length followed by the message bytes, packed one after
+ * another in a ring. A message may wrap around the end of the storage. Slots are claimed and
+ * published the same way as in a queue, with bytes in place of elements.
+ *
+ * @ingroup ar_message_buffer
+ */
+struct _ar_message_buffer {
+    const char * m_name;        //!< Name of the message buffer.
+    uint8_t * m_data;           //!< Pointer to message storage.
+    uint32_t m_capacity;        //!< Size in bytes of the storage.
+    uint32_t m_head;            //!< Index of the first byte of the oldest message.
+    volatile int32_t m_tail;    //!< Index of the next byte to be claimed by a sender.
+    uint32_t m_usedBytes;       //!< Number of bytes held by messages in the buffer.
+    uint32_t m_count;           //!< Number of messages in the buffer.
+    volatile int32_t m_reservedBytes;   //!< Number of bytes claimed by senders but not yet added to the buffer.
+    volatile int32_t m_writtenBytes;    //!< Number of claimed bytes that have been written.
+    ar_list_t m_sendBlockedList;    //!< List of threads blocked waiting to send.
+    ar_list_t m_receiveBlockedList; //!< List of threads blocked waiting to receive a message.
+    ar_runloop_t * m_runLoop;       //!< Runloop the message buffer is bound to.
+    ar_list_node_t m_runLoopNode;   //!< List node for the runloop's message buffer list.
+    ar_runloop_message_buffer_handler_t m_runLoopHandler;   //!< Handler function.
+    void * m_runLoopHandlerParam;   //!< User parameter for handler function.
+    ar_deferred_node_t m_publishNode;   //!< Adds messages sent from interrupts to the buffer.
 #if AR_GLOBAL_OBJECT_LISTS
     ar_list_node_t m_createdNode;   //!< Created list node.
 #endif // AR_GLOBAL_OBJECT_LISTS
 };
 
+/*!
+ * @brief Stream buffer.
+ *
+ * The writer owns #m_tail and #m_writeCount, and the reader owns #m_head and #m_readCount, so
+ * neither side needs the kernel lock to move data.
+ *
+ * @ingroup ar_stream_buffer
+ */
+typedef struct _ar_stream_buffer {
+    const char * m_name;        //!< Name of the stream buffer.
+    uint8_t * m_data;           //!< Pointer to byte storage.
+    uint32_t m_capacity;        //!< Size in bytes of the storage.
+    uint32_t m_triggerLevel;    //!< Number of bytes that must be available to wake the reader.
+    uint32_t m_head;            //!< Index of the next byte to read.
+    uint32_t m_tail;            //!< Index of the next byte to write.
+    volatile uint32_t m_writeCount; //!< Total number of bytes ever written, wrapping.
+    volatile uint32_t m_readCount;  //!< Total number of bytes ever read, wrapping.
+    volatile bool m_isReaderWaiting;    //!< Whether the reader is blocked, or about to block.
+    ar_list_t m_blockedList;    //!< List holding the blocked reader.
+    ar_deferred_node_t m_wakeNode;  //!< Wakes the reader after a write from interrupt context.
+#if AR_GLOBAL_OBJECT_LISTS
+    ar_list_node_t m_createdNode;   //!< Created list node.
+#endif // AR_GLOBAL_OBJECT_LISTS
+} ar_stream_buffer_t;
+
+/*!
+ * @brief Seqlock.
+ *
+ * #m_sequence is incremented before and after each write, so it is odd while a write is in
+ * progress. A reader copies the data and then checks that the sequence is even and unchanged.
+ *
+ * @ingroup ar_seqlock
+ */
+typedef struct _ar_seqlock {
+    const char * m_name;        //!< Name of the seqlock.
+    uint8_t * m_data;           //!< Pointer to the protected data.
+    uint32_t m_size;            //!< Size in bytes of the protected data.
+    volatile int32_t m_sequence;    //!< Number of writes started and finished.
+#if AR_GLOBAL_OBJECT_LISTS
+    ar_list_node_t m_createdNode;   //!< Created list node.
+#endif // AR_GLOBAL_OBJECT_LISTS
+} ar_seqlock_t;
+
 /*!
  * @brief Timer.
  *
@@ -329,17 +591,19 @@ struct _ar_queue {
  */
 struct _ar_timer {
     const char * m_name;            //!< Name of the timer.
-    ar_list_node_t m_activeNode;    //!< Node for the list of active timers.
+    ar_timer_t * m_heapChild;       //!< First child in the runloop's timer heap.
+    ar_timer_t * m_heapNext;        //!< Next sibling in the runloop's timer heap.
+    ar_timer_t * m_heapPrev;        //!< Previous sibling in the timer heap, or the parent if this is the first child.
 #if AR_GLOBAL_OBJECT_LISTS
     ar_list_node_t m_createdNode;   //!< Created list node.
 #endif // AR_GLOBAL_OBJECT_LISTS
     ar_timer_entry_t m_callback;    //!< Timer expiration callback.
     void * m_param;                 //!< Arbitrary parameter for the callback.
     ar_timer_mode_t m_mode;         //!< One-shot or periodic mode.
-    bool m_isActive;            //!< Whether the timer is running and on the active timers list.
+    bool m_isActive;            //!< Whether the timer is running and in the runloop's timer heap.
     bool m_isRunning;           //!< Whether the timer callback is executing.
-    uint32_t m_delay;           //!< Delay in ticks.
-    uint32_t m_wakeupTime;      //!< Expiration time in ticks.
+    uint64_t m_delay;           //!< Delay in microseconds.
+    uint64_t m_wakeupTime;      //!< Expiration time in microseconds.
     ar_runloop_t * m_runLoop;   //!< Runloop to which the timer is bound.
 };
 
@@ -351,8 +615,9 @@ struct _ar_timer {
 struct _ar_runloop {
     const char * m_name;                //!< Name of the runloop.
     ar_thread_t * m_thread;             //!< Thread the runloop is running on. NULL when the runloop is not running.
-    ar_list_t m_timers;                 //!< Timers associated with the runloop.
+    ar_timer_heap_t m_timers;           //!< Active timers associated with the runloop.
     ar_list_t m_queues;                 //!< Queues associated with the runloop.
+    ar_list_t m_messageBuffers;         //!< Message buffers associated with the runloop that have messages.
     struct _ar_runloop_function_info {
         ar_runloop_function_t function; //!< The callback function pointer.
         void * param;                   //!< User parameter passed to the callback.
@@ -374,6 +639,7 @@ struct _ar_runloop {
  */
 typedef union _ar_runloop_result {
     ar_queue_t * m_queue;       //!< Queue that received an item.
+    ar_message_buffer_t * m_messageBuffer;  //!< Message buffer that received a message.
 } ar_runloop_result_t;
 
 //------------------------------------------------------------------------------
@@ -406,12 +672,34 @@ bool ar_kernel_is_running(void);
 /*!
  * @brief Returns the current system load.
  *
- * The system load is calculated by the idle thread, if the #AR_ENABLE_SYSTEM_LOAD configuration
- * setting is enabled. If this setting is disabled, the load will always be zero.
+ * The system load is the time not spent in the idle thread during the last load sampling
+ * period, if the #AR_ENABLE_SYSTEM_LOAD configuration setting is enabled. If this setting is
+ * disabled, the load will always be zero.
  *
- * @return The current system load percentage from 0-100.
+ * @return The current system load per mille from 0-1000.
  */
 uint32_t ar_get_system_load(void);
+
+/*!
+ * @brief Returns an exponentially weighted average of the system load.
+ *
+ * @param average Which of the load averages to return.
+ * @return The average system load per mille from 0-1000. Always 0 if #AR_ENABLE_SYSTEM_LOAD
+ *      is disabled.
+ */
+uint32_t ar_get_system_load_average(ar_load_average_t average);
+
+/*!
+ * @brief Get usage statistics for the deferred action queues.
+ *
+ * There is one queue for each band of interrupt priorities, as set by
+ * #AR_DEFERRED_ACTION_QUEUE_COUNT. The first queue is for the most urgent priorities.
+ *
+ * @param[out] stats Array to be filled in.
+ * @param maxEntries Maximum number of entries that can be placed into _stats_.
+ * @return Number of entries filled in to _stats_.
+ */
+uint32_t ar_kernel_get_deferred_action_stats(ar_deferred_action_stats_t stats[], uint32_t maxEntries);
 //@}
 
 //! @}
@@ -542,12 +830,23 @@ ar_runloop_t * ar_thread_get_runloop(ar_thread_t * thread);
  * A sleeping thread can be woken early by calling ar_thread_resume().
  *
  * @param milliseconds The number of milliseconds to sleep the calling thread. A sleep time
- *     of 0 is ignored. If the sleep time is shorter than the scheduler quanta, then the thread
- *     will not actually sleep. If #kArInfiniteTimeout is passed for the sleep time, the thread will
+ *     of 0 is ignored. If #kArInfiniteTimeout is passed for the sleep time, the thread will
  *     simply be suspended.
  */
 void ar_thread_sleep(uint32_t milliseconds);
 
+/*!
+ * @brief Put the current thread to sleep for a number of microseconds.
+ *
+ * Does nothing if Ar is not running.
+ *
+ * A sleeping thread can be woken early by calling ar_thread_resume().
+ *
+ * @param microseconds The number of microseconds to sleep the calling thread. A sleep time
+ *     of 0 is ignored.
+ */
+void ar_thread_sleep_us(uint64_t microseconds);
+
 /*!
  * @brief Put the current thread to sleep until a specific time.
  *
@@ -557,10 +856,77 @@ void ar_thread_sleep(uint32_t milliseconds);
  *
  * @param wakeup The wakeup time in milliseconds. If the time is not in the future, i.e., less than
  *  or equal to the current value returned by ar_get_millisecond_count(), then the sleep request is
- *  ignored.
+ *  ignored. Because the millisecond count wraps, the wakeup time must be less than 2^31
+ *  milliseconds in the future.
  */
 void ar_thread_sleep_until(uint32_t wakeup);
 
+/*!
+ * @brief Put the current thread to sleep until a specific microsecond time.
+ *
+ * Does nothing if Ar is not running.
+ *
+ * A sleeping thread can be woken early by calling ar_thread_resume().
+ *
+ * @param wakeup The wakeup time in microseconds. If the time is not in the future, i.e., less than
+ *  or equal to the current value returned by ar_get_microseconds(), then the sleep request is
+ *  ignored.
+ */
+void ar_thread_sleep_until_us(uint64_t wakeup);
+
+/*!
+ * @brief Send a notification to a thread.
+ *
+ * Every thread has a 32-bit notification value and a pending flag, so notifications need no
+ * separate kernel object. Sending a notification updates the value according to _action_ and
+ * marks it pending. If the thread is blocked in ar_thread_notify_wait(), it is unblocked.
+ *
+ * Depending on the action used, a notification can stand in for a binary or counting
+ * semaphore, a set of event flags, or a single entry mailbox that has one receiving thread.
+ * Because there is no list of blocked threads to search, it is the cheapest way for an
+ * interrupt to wake a thread.
+ *
+ * @param thread The thread to notify.
+ * @param action How the notification value is updated.
+ * @param value Bits to set for #kArNotifySetBits, or the new value for #kArNotifyOverwrite.
+ *     Ignored for #kArNotifyIncrement.
+ *
+ * @retval kArSuccess The notification was sent.
+ * @retval kArInvalidParameterError The thread is NULL or the action is unknown.
+ * @retval kArQueueFullError Called from interrupt context while the kernel was locked and the
+ *     thread was waiting, and there was no room to defer waking it. The notification value
+ *     has still been updated.
+ *
+ * @note This call is safe from interrupt context.
+ */
+ar_status_t ar_thread_notify(ar_thread_t * thread, ar_notify_action_t action, uint32_t value);
+
+/*!
+ * @brief Wait for a notification to the current thread.
+ *
+ * If a notification is already pending, this function returns immediately. Otherwise the
+ * calling thread blocks until another thread or an interrupt calls ar_thread_notify() on it.
+ * The notification value is read and then the bits in _clearBits_ are cleared from it, after
+ * which the notification is no longer pending.
+ *
+ * Pass 0 for _clearBits_ to leave the value as is, or 0xffffffff to reset it to 0. For
+ * example, when notifications are sent with #kArNotifyIncrement, clearing all bits makes the
+ * value act like a binary semaphore, and the returned value is the number of notifications
+ * that were sent.
+ *
+ * @param clearBits Bits to clear in the notification value after it is read.
+ * @param[out] value Optional pointer to receive the notification value, before any bits were
+ *     cleared. May be NULL.
+ * @param timeout The maximum number of milliseconds to wait for a notification. Pass 0 to
+ *     return immediately if no notification is pending, or #kArInfiniteTimeout to wait
+ *     forever.
+ *
+ * @retval kArSuccess A notification was received.
+ * @retval kArTimeoutError No notification arrived before the timeout elapsed.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_thread_notify_wait(uint32_t clearBits, uint32_t * value, uint32_t timeout);
+
 /*!
  * @brief Get the thread's name.
  *
@@ -571,12 +937,42 @@ const char * ar_thread_get_name(ar_thread_t * thread);
 /*!
  * @brief Get the amount of CPU time the thread is using.
  *
- * Thread CPU usage is computed once every second for all threads.
+ * Thread CPU usage is computed over each #AR_SYSTEM_LOAD_SAMPLE_PERIOD, nominally one second.
  *
- * @return Per mille of CPU load for the given thread. Value is 0-1000.
+ * @return Per mille of CPU load for the given thread during the last sampling period. Value
+ *      is 0-1000.
  */
 uint32_t ar_thread_get_load(ar_thread_t * thread);
 
+/*!
+ * @brief Get an exponentially weighted average of the thread's CPU usage.
+ *
+ * The averages are updated with the thread's load at the end of each sampling period.
+ *
+ * @param thread The thread to inspect.
+ * @param average Which of the load averages to return.
+ * @return Per mille of CPU load for the given thread. Value is 0-1000.
+ */
+uint32_t ar_thread_get_load_average(ar_thread_t * thread, ar_load_average_t average);
+
+/*!
+ * @brief Get the total CPU time the thread has used.
+ *
+ * Time spent in interrupts is charged to the thread that was running when they occurred.
+ *
+ * @return Number of cycles, as counted by ar_get_cycles(), the thread has run since it was
+ *      created. Always 0 if #AR_ENABLE_SYSTEM_LOAD is disabled.
+ */
+uint64_t ar_thread_get_cycles(ar_thread_t * thread);
+
+/*!
+ * @brief Get the number of times the thread has been switched in.
+ *
+ * @return Number of context switches to the thread since it was created. Always 0 if
+ *      #AR_ENABLE_SYSTEM_LOAD is disabled.
+ */
+uint32_t ar_thread_get_switch_count(ar_thread_t * thread);
+
 /*!
  * @brief Get the maximum stack usage of the specified thread.
  *
@@ -684,6 +1080,112 @@ const char * ar_semaphore_get_name(ar_semaphore_t * sem);
 
 //! @}
 
+//! @addtogroup ar_event_flags
+//! @{
+
+//! @name Event flags
+//@{
+/*!
+ * @brief Create a new event flags group.
+ *
+ * @param flags Pointer to storage for the event flags group.
+ * @param name Pass a name for the event flags group. If NULL is passed the name will be set to
+ *     an empty string.
+ * @param initialFlags The initial flag values.
+ *
+ * @retval kArSuccess Event flags group initialised successfully.
+ */
+ar_status_t ar_event_flags_create(ar_event_flags_t * flags, const char * name, uint32_t initialFlags);
+
+/*!
+ * @brief Delete an event flags group.
+ *
+ * Any threads waiting on the flags will be unblocked immediately. Their return status from the
+ * wait function will be #kArObjectDeletedError.
+ *
+ * @param flags Pointer to the event flags group.
+ * @retval kArSuccess Event flags group deleted successfully.
+ */
+ar_status_t ar_event_flags_delete(ar_event_flags_t * flags);
+
+/*!
+ * @brief Set flags.
+ *
+ * The flags in _bits_ are set. Every waiting thread whose wait is satisfied by the new flag
+ * values is unblocked, and the flags those threads asked to have cleared are cleared after all
+ * waiters have been checked. The scheduler runs once afterwards, no matter how many threads
+ * were unblocked.
+ *
+ * @param flags Pointer to the event flags group.
+ * @param bits The flags to set.
+ *
+ * @retval kArSuccess
+ * @retval kArInvalidParameterError
+ * @retval kArQueueFullError Called from interrupt context while the kernel was locked, and
+ *     there was no room to defer the operation.
+ *
+ * @note This call is safe from interrupt context.
+ */
+ar_status_t ar_event_flags_set(ar_event_flags_t * flags, uint32_t bits);
+
+/*!
+ * @brief Clear flags.
+ *
+ * @param flags Pointer to the event flags group.
+ * @param bits The flags to clear.
+ *
+ * @retval kArSuccess
+ * @retval kArInvalidParameterError
+ * @retval kArQueueFullError Called from interrupt context while the kernel was locked, and
+ *     there was no room to defer the operation.
+ *
+ * @note This call is safe from interrupt context.
+ */
+ar_status_t ar_event_flags_clear(ar_event_flags_t * flags, uint32_t bits);
+
+/*!
+ * @brief Wait for flags to be set.
+ *
+ * Blocks the calling thread until any or all of the flags in _bits_ are set, depending on
+ * _options_. If the wait is already satisfied, this function returns immediately.
+ *
+ * @param flags Pointer to the event flags group.
+ * @param bits The flags to wait for. Must not be 0.
+ * @param options Either #kArEventFlagsWaitAny or #kArEventFlagsWaitAll, optionally ORed with
+ *     #kArEventFlagsClearOnExit to clear the flags in _bits_ once the wait is satisfied.
+ * @param[out] result Optional pointer to receive the flag values that satisfied the wait,
+ *     before any flags were cleared. May be NULL.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait. If this
+ *     value is 0, or #kArNoTimeout, then this function will return immediately if the wait is
+ *     not satisfied. Setting the timeout to #kArInfiniteTimeout will cause the thread to wait
+ *     forever.
+ *
+ * @retval kArSuccess The wait was satisfied.
+ * @retval kArTimeoutError The specified amount of time elapsed before the wait was satisfied.
+ * @retval kArObjectDeletedError Another thread deleted the event flags group while the caller
+ *     was blocked on it.
+ * @retval kArInvalidParameterError No flags were given to wait for.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_event_flags_wait(ar_event_flags_t * flags, uint32_t bits, uint32_t options, uint32_t * result, uint32_t timeout);
+
+/*!
+ * @brief Returns the current flag values.
+ *
+ * @param flags Pointer to the event flags group.
+ */
+uint32_t ar_event_flags_get_flags(ar_event_flags_t * flags);
+
+/*!
+ * @brief Get the event flags group's name.
+ *
+ * @param flags Pointer to the event flags group.
+ */
+const char * ar_event_flags_get_name(ar_event_flags_t * flags);
+//@}
+
+//! @}
+
 //! @addtogroup ar_mutex
 //! @{
 
@@ -783,80 +1285,356 @@ const char * ar_mutex_get_name(ar_mutex_t * mutex);
 
 //! @}
 
-//! @addtogroup ar_chan
+//! @addtogroup ar_condvar
 //! @{
 
-//! @name Channels
+//! @name Condition variables
 //@{
 /*!
- * @brief Create a new channel.
+ * @brief Create a new condition variable.
  *
- * @param channel Pointer to storage for the new channel.
- * @param name Optional name for the new channel.
- * @param width The size in bytes of the data passed through the channel. Set this parameter
- *      to 0 to use the default pointer-sized width.
+ * @param cv Pointer to storage for the condition variable.
+ * @param name The name of the condition variable.
+ *
+ * @retval kArSuccess
  */
-ar_status_t ar_channel_create(ar_channel_t * channel, const char * name, uint32_t width);
+ar_status_t ar_condvar_create(ar_condvar_t * cv, const char * name);
 
 /*!
- * @brief Delete an existing channel.
+ * @brief Delete a condition variable.
  *
- * @param channel Pointer to the channel.
+ * Any waiting threads are woken with a status of #kArObjectDeletedError. As with any other
+ * return from ar_condvar_wait(), they lock the mutex again before returning.
+ *
+ * @param cv Pointer to the condition variable.
+ *
+ * @retval kArSuccess
  */
-ar_status_t ar_channel_delete(ar_channel_t * channel);
+ar_status_t ar_condvar_delete(ar_condvar_t * cv);
 
 /*!
- * @brief Send to a channel.
+ * @brief Wait on a condition variable.
  *
- * This function synchronously sends a value across the specified channel. If there is not a
- * thread waiting to receive on the other side, then this function will block.
+ * The calling thread must own _mutex_. The mutex is unlocked and the thread blocks until the
+ * condition variable is signalled or the timeout elapses. Before returning, the mutex is locked
+ * again, with the same recursive lock count the caller had, whatever the return status.
  *
- * @param channel Pointer to the channel.
- * @param value Pointer to value to send through the channel.
- * @param timeout The maximum number of milliseconds the caller is willing to wait before the
- *      send is completed.
+ * As with any condition variable, callers should recheck the condition they are waiting for
+ * after this function returns.
+ *
+ * All threads waiting on a condition variable at the same time must use the same mutex.
+ *
+ * @param cv Pointer to the condition variable.
+ * @param mutex The mutex protecting the condition, which must be owned by the caller.
+ * @param timeout The maximum number of milliseconds to wait for a signal. Once the condition
+ *     variable is signalled, the thread waits for the mutex with no timeout. If this value is
+ *     0, or #kArNoTimeout, the function returns immediately with the mutex still held.
+ *
+ * @retval kArSuccess The condition variable was signalled.
+ * @retval kArTimeoutError The timeout elapsed before the condition variable was signalled.
+ * @retval kArObjectDeletedError The condition variable was deleted while the caller waited.
+ * @retval kArNotOwnerError The caller does not own the mutex.
+ * @retval kArInvalidParameterError Other threads are waiting with a different mutex.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
  */
-ar_status_t ar_channel_send(ar_channel_t * channel, const void * value, uint32_t timeout);
+ar_status_t ar_condvar_wait(ar_condvar_t * cv, ar_mutex_t * mutex, uint32_t timeout);
 
 /*!
- * @brief Receive from a channel.
+ * @brief Wake the highest priority thread waiting on a condition variable.
  *
- * @param channel Pointer to the channel.
- * @param value Pointer to a location where the received data is written.
- * @param timeout The maximum number of milliseconds the caller is willing to wait before the
- *      receive is completed.
+ * If the mutex is locked, the woken thread is moved straight onto the mutex's blocked list
+ * rather than being made ready only to block again on the mutex.
+ *
+ * @param cv Pointer to the condition variable.
+ *
+ * @retval kArSuccess
+ * @retval kArQueueFullError Called from interrupt context while the kernel was locked, and
+ *     there was no room to defer the operation.
+ *
+ * @note This call is safe from interrupt context.
  */
-ar_status_t ar_channel_receive(ar_channel_t * channel, void * value, uint32_t timeout);
+ar_status_t ar_condvar_signal(ar_condvar_t * cv);
 
 /*!
- * @brief Get a channel's name.
+ * @brief Wake all threads waiting on a condition variable.
  *
- * @param channel Pointer to the channel.
+ * Only one of the woken threads can own the mutex at a time, so instead of making them all
+ * ready to contend for it, they are moved straight onto the mutex's priority sorted blocked
+ * list. Each one then runs in turn as the mutex is unlocked.
+ *
+ * @param cv Pointer to the condition variable.
+ *
+ * @retval kArSuccess
+ * @retval kArQueueFullError Called from interrupt context while the kernel was locked, and
+ *     there was no room to defer the operation.
+ *
+ * @note This call is safe from interrupt context.
  */
-const char * ar_channel_get_name(ar_channel_t * channel);
+ar_status_t ar_condvar_broadcast(ar_condvar_t * cv);
+
+/*!
+ * @brief Get the condition variable's name.
+ *
+ * @param cv Pointer to the condition variable.
+ */
+const char * ar_condvar_get_name(ar_condvar_t * cv);
 //@}
 
 //! @}
 
-//! @addtogroup ar_queue
+//! @addtogroup ar_rwlock
 //! @{
 
-//! @name Queues
+//! @name Reader-writer locks
 //@{
 /*!
- * @brief Create a new queue.
+ * @brief Create a new reader-writer lock.
  *
- * @param queue The storage for the new queue object.
- * @param name The new queue's name.
- * @param storage Pointer to a buffer used to store queue elements. The buffer must be at least
- *     @a elementSize * @a capacity bytes big.
- * @param elementSize Size in bytes of each element in the queue.
- * @param capacity The number of elements that the buffer pointed to by @a storage will hold.
+ * The lock starts out unlocked.
  *
- * @retval kArSuccess The queue was initialised.
- */
+ * @param rwlock Pointer to storage for the reader-writer lock.
+ * @param name The name of the reader-writer lock.
+ *
+ * @retval kArSuccess
+ */
+ar_status_t ar_rwlock_create(ar_rwlock_t * rwlock, const char * name);
+
+/*!
+ * @brief Delete a reader-writer lock.
+ *
+ * Any threads waiting for the lock are unblocked with a status of #kArObjectDeletedError.
+ *
+ * @param rwlock Pointer to the reader-writer lock.
+ *
+ * @retval kArSuccess
+ */
+ar_status_t ar_rwlock_delete(ar_rwlock_t * rwlock);
+
+/*!
+ * @brief Take the lock for reading.
+ *
+ * Any number of threads, up to #AR_RWLOCK_MAX_READERS, can hold the read lock at once. Writers
+ * take precedence: if a thread holds or is waiting for the write lock, new readers wait. A
+ * thread that already holds the read lock may take it again, regardless of waiting writers. The
+ * number of calls to ar_rwlock_read_get() and ar_rwlock_read_put() must match.
+ *
+ * A blocked reader raises the priority of the writer holding the lock. Likewise, a blocked
+ * writer raises the priority of every reader holding the lock.
+ *
+ * @param rwlock Pointer to the reader-writer lock.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state before the lock can be obtained. If this value is 0, or #kArNoTimeout,
+ *     then this function will return immediately if the lock cannot be obtained. Setting
+ *     the timeout to #kArInfiniteTimeout will cause the thread to wait forever.
+ *
+ * @retval kArSuccess The read lock was obtained.
+ * @retval kArTimeoutError The specified amount of time has elapsed before the lock could be
+ *     obtained.
+ * @retval kArObjectDeletedError Another thread deleted the lock while the caller was blocked.
+ * @retval kArInvalidStateError The caller holds the write lock.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_rwlock_read_get(ar_rwlock_t * rwlock, uint32_t timeout);
+
+/*!
+ * @brief Release the lock for reading.
+ *
+ * @param rwlock Pointer to the reader-writer lock.
+ *
+ * @retval kArSuccess The read lock was released.
+ * @retval kArNotOwnerError The caller does not hold the read lock.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_rwlock_read_put(ar_rwlock_t * rwlock);
+
+/*!
+ * @brief Take the lock for writing.
+ *
+ * Only one thread can hold the write lock, and only while no thread holds the read lock. The
+ * write lock is recursive, so the number of calls to ar_rwlock_write_get() and
+ * ar_rwlock_write_put() must match. Waiting writers are woken in priority order.
+ *
+ * @param rwlock Pointer to the reader-writer lock.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state before the lock can be obtained. If this value is 0, or #kArNoTimeout,
+ *     then this function will return immediately if the lock cannot be obtained. Setting
+ *     the timeout to #kArInfiniteTimeout will cause the thread to wait forever.
+ *
+ * @retval kArSuccess The write lock was obtained.
+ * @retval kArTimeoutError The specified amount of time has elapsed before the lock could be
+ *     obtained.
+ * @retval kArObjectDeletedError Another thread deleted the lock while the caller was blocked.
+ * @retval kArInvalidStateError The caller holds the read lock, so waiting would deadlock.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_rwlock_write_get(ar_rwlock_t * rwlock, uint32_t timeout);
+
+/*!
+ * @brief Release the lock for writing.
+ *
+ * @param rwlock Pointer to the reader-writer lock.
+ *
+ * @retval kArSuccess The write lock was released.
+ * @retval kArNotOwnerError The caller does not hold the write lock.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_rwlock_write_put(ar_rwlock_t * rwlock);
+
+/*!
+ * @brief Get the reader-writer lock's name.
+ *
+ * @param rwlock Pointer to the reader-writer lock.
+ */
+const char * ar_rwlock_get_name(ar_rwlock_t * rwlock);
+//@}
+
+//! @}
+
+//! @addtogroup ar_chan
+//! @{
+
+//! @name Channels
+//@{
+/*!
+ * @brief Create a new channel.
+ *
+ * @param channel Pointer to storage for the new channel.
+ * @param name Optional name for the new channel.
+ * @param width The size in bytes of the data passed through the channel. Set this parameter
+ *      to 0 to use the default pointer-sized width.
+ */
+ar_status_t ar_channel_create(ar_channel_t * channel, const char * name, uint32_t width);
+
+/*!
+ * @brief Delete an existing channel.
+ *
+ * @param channel Pointer to the channel.
+ */
+ar_status_t ar_channel_delete(ar_channel_t * channel);
+
+/*!
+ * @brief Send to a channel.
+ *
+ * This function synchronously sends a value across the specified channel. If there is not a
+ * thread waiting to receive on the other side, then this function will block.
+ *
+ * @param channel Pointer to the channel.
+ * @param value Pointer to value to send through the channel.
+ * @param timeout The maximum number of milliseconds the caller is willing to wait before the
+ *      send is completed.
+ */
+ar_status_t ar_channel_send(ar_channel_t * channel, const void * value, uint32_t timeout);
+
+/*!
+ * @brief Receive from a channel.
+ *
+ * @param channel Pointer to the channel.
+ * @param value Pointer to a location where the received data is written.
+ * @param timeout The maximum number of milliseconds the caller is willing to wait before the
+ *      receive is completed.
+ */
+ar_status_t ar_channel_receive(ar_channel_t * channel, void * value, uint32_t timeout);
+
+/*!
+ * @brief Get a channel's name.
+ *
+ * @param channel Pointer to the channel.
+ */
+const char * ar_channel_get_name(ar_channel_t * channel);
+//@}
+
+//! @}
+
+//! @addtogroup ar_queue
+//! @{
+
+//! @name Queues
+//@{
+/*!
+ * @brief Create a new queue.
+ *
+ * @param queue The storage for the new queue object.
+ * @param name The new queue's name.
+ * @param storage Pointer to a buffer used to store queue elements. The buffer must be at least
+ *     @a elementSize * @a capacity bytes big.
+ * @param elementSize Size in bytes of each element in the queue.
+ * @param capacity The number of elements that the buffer pointed to by @a storage will hold.
+ *
+ * @retval kArSuccess The queue was initialised.
+ */
 ar_status_t ar_queue_create(ar_queue_t * queue, const char * name, void * storage, unsigned elementSize, unsigned capacity);
 
+/*!
+ * @brief Returns the number of bytes of storage needed by a prioritized queue.
+ *
+ * Each slot holds an 8-byte key in addition to the element.
+ *
+ * @param elementSize Size in bytes of each element in the queue.
+ * @param capacity Maximum number of elements.
+ */
+#define AR_QUEUE_PRIORITIZED_STORAGE_SIZE(elementSize, capacity) ((capacity) * ((elementSize) + 2 * sizeof(uint32_t)))
+
+/*!
+ * @brief Create a new queue that delivers elements in priority order.
+ *
+ * Elements are sent with a priority using ar_queue_send_prioritized(). Receivers always get
+ * the element with the highest priority, and elements of equal priority in the order they were
+ * sent. Elements are kept in a binary heap, so sending and receiving take O(log n) time in the
+ * number of elements in the queue. Threads blocked waiting to send are woken in order of
+ * thread priority.
+ *
+ * ar_queue_send() and ar_queue_send_n() send with priority 0, the lowest. The zero-copy
+ * functions ar_queue_reserve_send() and ar_queue_peek_receive() are not supported, and return
+ * #kArInvalidStateError.
+ *
+ * @param queue The storage for the new queue object.
+ * @param name The new queue's name.
+ * @param storage Pointer to a word aligned buffer used to store queue elements and their
+ *     priorities. The buffer must be at least AR_QUEUE_PRIORITIZED_STORAGE_SIZE(@a elementSize,
+ *     @a capacity) bytes big.
+ * @param elementSize Size in bytes of each element in the queue.
+ * @param capacity The maximum number of elements, up to 65535.
+ *
+ * @retval kArSuccess The queue was initialised.
+ * @retval kArInvalidParameterError The capacity is too large, or another parameter is invalid.
+ */
+ar_status_t ar_queue_create_prioritized(ar_queue_t * queue, const char * name, void * storage, unsigned elementSize, unsigned capacity);
+
+/*!
+ * @brief Returns the number of bytes of storage needed by a mailbox.
+ *
+ * @param elementSize Size in bytes of the value held by the mailbox.
+ */
+#define AR_QUEUE_MAILBOX_STORAGE_SIZE(elementSize) (3 * (elementSize))
+
+/*!
+ * @brief Create a mailbox, a queue that only holds the latest value sent to it.
+ *
+ * Each send replaces the value in the mailbox, so senders never block and receivers always
+ * get the most recent value. A receive returns the value only once. Later receives block until
+ * a new value is sent.
+ *
+ * Sending takes constant time and needs no kernel lock, so it is suited to interrupts that
+ * publish sensor samples at a high rate. The value is written into a spare slot and then made
+ * the latest with an atomic operation, so a receiver never sees a partly written value. If a
+ * send from an interrupt preempts another send, the interrupt's value wins. A send fails with
+ * #kArQueueFullError only if it preempts both another send and a receive in progress, as there
+ * are then no free slots.
+ *
+ * Only ar_queue_send(), ar_queue_send_prioritized(), ar_queue_send_n(), ar_queue_receive(),
+ * and ar_queue_receive_n() can be used with a mailbox. ar_queue_send_n() sends the last of
+ * the elements.
+ *
+ * @param queue The storage for the new queue object.
+ * @param name The new mailbox's name.
+ * @param storage Pointer to a buffer of at least AR_QUEUE_MAILBOX_STORAGE_SIZE(@a elementSize)
+ *     bytes.
+ * @param elementSize Size in bytes of the value.
+ *
+ * @retval kArSuccess The mailbox was initialised.
+ */
+ar_status_t ar_queue_create_mailbox(ar_queue_t * queue, const char * name, void * storage, unsigned elementSize);
+
 /*!
  * @brief Delete an existing queue.
  *
@@ -864,11 +1642,36 @@ ar_status_t ar_queue_create(ar_queue_t * queue, const char * name, void * storag
  */
 ar_status_t ar_queue_delete(ar_queue_t * queue);
 
+/*!
+ * @brief Choose whether sends to a full queue drop the oldest elements.
+ *
+ * When overwriting is enabled, a send to a full queue removes the oldest elements to make room,
+ * so senders never block and the queue always holds the newest elements. This suits producers
+ * of data such as sensor samples, where stale elements are worthless.
+ *
+ * The head element is not dropped while it is held by ar_queue_peek_receive(). Interrupts drop
+ * elements with atomic operations, so they can make room even while the kernel is locked. An
+ * interrupt that sends to a full queue still gets #kArQueueFullError if it arrives while a
+ * thread is in the middle of receiving, or if every slot is claimed by an unfinished send.
+ *
+ * @param queue The queue object.
+ * @param overwrite Pass true to drop the oldest elements, false to block or fail when full.
+ *
+ * @retval kArSuccess
+ * @retval kArInvalidStateError The queue is prioritized or a mailbox.
+ */
+ar_status_t ar_queue_set_overwrite(ar_queue_t * queue, bool overwrite);
+
 /*!
  * @brief Add an item to the queue.
  *
  * The caller will block if the queue is full.
  *
+ * This function may be called from interrupt context, in which case the timeout is ignored and
+ * #kArQueueFullError is returned if the queue is full. The element is copied into the queue
+ * before the function returns, so it may be in a buffer on the interrupt handler's stack. Only
+ * waking a receiver is deferred until the interrupt returns.
+ *
  * @param queue The queue object.
  * @param element Pointer to the element to post to the queue. The element size was specified
  *     in the init() call.
@@ -882,6 +1685,24 @@ ar_status_t ar_queue_delete(ar_queue_t * queue);
  */
 ar_status_t ar_queue_send(ar_queue_t * queue, const void * element, uint32_t timeout);
 
+/*!
+ * @brief Add an item with a priority to the queue.
+ *
+ * Works the same as ar_queue_send(), including from interrupt context. For a queue created with
+ * ar_queue_create_prioritized(), the element is received before all elements of lower
+ * priority. For other queues, the priority is ignored.
+ *
+ * @param queue The queue object.
+ * @param element Pointer to the element to post to the queue.
+ * @param priority Priority of the element, where higher values are received first.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state before the element can be sent.
+ *
+ * @retval kArSuccess
+ * @retval kArQueueFullError
+ */
+ar_status_t ar_queue_send_prioritized(ar_queue_t * queue, const void * element, uint8_t priority, uint32_t timeout);
+
 /*!
  * @brief Remove an item from the queue.
  *
@@ -897,6 +1718,126 @@ ar_status_t ar_queue_send(ar_queue_t * queue, const void * element, uint32_t tim
  */
 ar_status_t ar_queue_receive(ar_queue_t * queue, void * element, uint32_t timeout);
 
+/*!
+ * @brief Add several items to the queue at once.
+ *
+ * The caller blocks only while the queue is full. As soon as there is room, as many of the
+ * elements as fit are copied into the queue under a single kernel lock, and at most one
+ * receiver is woken. Use the returned count to send any remainder.
+ *
+ * Like ar_queue_send(), this function may be called from interrupt context without blocking.
+ *
+ * @param queue The queue object.
+ * @param elements Pointer to an array of @a count elements.
+ * @param count Number of elements in the array. Must be at least 1.
+ * @param[out] sentCount Optional, set to the number of elements that were added to the queue.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state for room in the queue. If this value is 0, or #kArNoTimeout, then this
+ *     method will return immediately if the queue is full. Setting the timeout to
+ *     #kArInfiniteTimeout will cause the thread to wait forever for room.
+ *
+ * @retval kArSuccess At least one element was sent.
+ * @retval kArQueueFullError
+ */
+ar_status_t ar_queue_send_n(ar_queue_t * queue, const void * elements, uint32_t count, uint32_t * sentCount, uint32_t timeout);
+
+/*!
+ * @brief Remove several items from the queue at once.
+ *
+ * The caller blocks only while the queue is empty. As soon as there are elements, up to
+ * @a count of them are copied out under a single kernel lock, and at most one sender is woken.
+ *
+ * @param queue The queue object.
+ * @param[out] elements Pointer to an array with room for @a count elements.
+ * @param count Maximum number of elements to receive. Must be at least 1.
+ * @param[out] receivedCount Optional, set to the number of elements that were received.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state for an element. If this value is 0, or #kArNoTimeout, then this method
+ *     will return immediately if the queue is empty. Setting the timeout to
+ *     #kArInfiniteTimeout will cause the thread to wait forever for an element.
+ *
+ * @retval kArSuccess At least one element was received.
+ * @retval kArQueueEmptyError
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_queue_receive_n(ar_queue_t * queue, void * elements, uint32_t count, uint32_t * receivedCount, uint32_t timeout);
+
+/*!
+ * @brief Reserve the next free slot of the queue so an element can be written in place.
+ *
+ * Instead of copying an element into the queue, the caller gets a pointer to the slot where
+ * the element will be stored, fills it in, and then calls ar_queue_commit_send() to make the
+ * element available to receivers. This avoids a copy for large elements, and lets the slot be
+ * filled by a peripheral such as DMA.
+ *
+ * Only one slot can be reserved at a time. Other senders, including other callers of this
+ * function, block until the reservation is committed. The caller blocks while the queue is
+ * full, just as with ar_queue_send(). Elements sent from interrupts while a slot is reserved
+ * are stored after it, and are received once it has been committed.
+ *
+ * @param queue The queue object.
+ * @param[out] element On success, set to the address of the reserved slot. The slot is
+ *     elementSize bytes long and remains valid until committed.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state for a free slot. If this value is 0, or #kArNoTimeout, then this method
+ *     will return immediately if no slot is available. Setting the timeout to
+ *     #kArInfiniteTimeout will cause the thread to wait forever for a slot.
+ *
+ * @retval kArSuccess
+ * @retval kArQueueFullError
+ * @retval kArInvalidStateError The queue is prioritized or a mailbox.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_queue_reserve_send(ar_queue_t * queue, void ** element, uint32_t timeout);
+
+/*!
+ * @brief Add the element written into the reserved slot to the queue.
+ *
+ * Wakes a receiver or the queue's runloop exactly as ar_queue_send() does. May be called from
+ * any thread, or from interrupt context, for instance when a DMA transfer into the slot
+ * completes.
+ *
+ * @param queue The queue object.
+ *
+ * @retval kArSuccess
+ * @retval kArInvalidStateError No slot is reserved.
+ */
+ar_status_t ar_queue_commit_send(ar_queue_t * queue);
+
+/*!
+ * @brief Get a pointer to the element at the head of the queue without copying it out.
+ *
+ * The element stays in the queue, and its slot cannot be reused by senders, until
+ * ar_queue_release_receive() is called. Only one element can be held at a time. Other
+ * receivers block until it is released. The caller blocks while the queue is empty, just as
+ * with ar_queue_receive().
+ *
+ * @param queue The queue object.
+ * @param[out] element On success, set to the address of the head element.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state for an element. If this value is 0, or #kArNoTimeout, then this method
+ *     will return immediately if the queue is empty. Setting the timeout to
+ *     #kArInfiniteTimeout will cause the thread to wait forever for an element.
+ *
+ * @retval kArSuccess
+ * @retval kArQueueEmptyError
+ * @retval kArInvalidStateError The queue is prioritized or a mailbox.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_queue_peek_receive(ar_queue_t * queue, void ** element, uint32_t timeout);
+
+/*!
+ * @brief Remove the element obtained with ar_queue_peek_receive() from the queue.
+ *
+ * Frees the element's slot and wakes a blocked sender. May be called from interrupt context.
+ *
+ * @param queue The queue object.
+ *
+ * @retval kArSuccess
+ * @retval kArInvalidStateError No element is held.
+ */
+ar_status_t ar_queue_release_receive(ar_queue_t * queue);
+
 /*!
  * @brief Returns whether the queue is currently empty.
  *
@@ -927,6 +1868,400 @@ const char * ar_queue_get_name(ar_queue_t * queue);
 
 //! @}
 
+//! @addtogroup ar_message_buffer
+//! @{
+
+//! @name Message buffers
+//@{
+/*!
+ * @brief Create a new message buffer.
+ *
+ * A message buffer passes messages of varying length between threads and from interrupts.
+ * Unlike a queue, whose slots are all sized for the largest element, each message takes only
+ * its own length plus a 2-byte length prefix.
+ *
+ * @param buffer Pointer to storage for the message buffer.
+ * @param name Name of the message buffer. May be NULL.
+ * @param storage Buffer that holds the messages.
+ * @param capacity Size of @a storage in bytes.
+ *
+ * @retval kArSuccess The message buffer was created.
+ * @retval kArInvalidParameterError A parameter was NULL or @a capacity was too small to hold
+ *     even an empty message.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_message_buffer_create(ar_message_buffer_t * buffer, const char * name, void * storage, uint32_t capacity);
+
+/*!
+ * @brief Delete a message buffer.
+ *
+ * Threads blocked on the message buffer are woken with #kArObjectDeletedError.
+ *
+ * @param buffer The message buffer object.
+ *
+ * @retval kArSuccess The message buffer was deleted.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_message_buffer_delete(ar_message_buffer_t * buffer);
+
+/*!
+ * @brief Add a message to the message buffer.
+ *
+ * The caller will block until there is room for the whole message.
+ *
+ * This function may be called from interrupt context, in which case the timeout is ignored and
+ * #kArQueueFullError is returned if there is no room. The message is copied into the buffer
+ * before the function returns. Only waking a receiver is deferred.
+ *
+ * @param buffer The message buffer object.
+ * @param data The message bytes. May be NULL if @a length is 0.
+ * @param length Length of the message in bytes, up to 65535.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state for room. If this value is 0, or #kArNoTimeout, then this method will
+ *     return immediately if there is no room. Setting the timeout to #kArInfiniteTimeout will
+ *     cause the thread to wait forever for room.
+ *
+ * @retval kArSuccess
+ * @retval kArQueueFullError
+ * @retval kArInvalidParameterError The message is too long to ever fit in the buffer.
+ */
+ar_status_t ar_message_buffer_send(ar_message_buffer_t * buffer, const void * data, uint32_t length, uint32_t timeout);
+
+/*!
+ * @brief Remove the oldest message from the message buffer.
+ *
+ * @param buffer The message buffer object.
+ * @param[out] data Buffer to receive the message.
+ * @param maxLength Size of @a data in bytes.
+ * @param[out] length Optional, set to the length of the message. If the message is longer than
+ *     @a maxLength, it is left in the buffer and this is set to its length.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state for a message. If this value is 0, or #kArNoTimeout, then this method will
+ *     return immediately if the buffer is empty. Setting the timeout to #kArInfiniteTimeout
+ *     will cause the thread to wait forever for a message.
+ *
+ * @retval kArSuccess
+ * @retval kArQueueEmptyError
+ * @retval kArInvalidParameterError The message is longer than @a maxLength.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_message_buffer_receive(ar_message_buffer_t * buffer, void * data, uint32_t maxLength, uint32_t * length, uint32_t timeout);
+
+/*!
+ * @brief Returns the length of the oldest message, or 0 if the buffer is empty.
+ *
+ * @param buffer The message buffer object.
+ */
+uint32_t ar_message_buffer_get_next_length(ar_message_buffer_t * buffer);
+
+/*!
+ * @brief Returns the number of messages in the buffer.
+ *
+ * @param buffer The message buffer object.
+ */
+uint32_t ar_message_buffer_get_count(ar_message_buffer_t * buffer);
+
+/*!
+ * @brief Returns the number of bytes free, including the space needed for length prefixes.
+ *
+ * @param buffer The message buffer object.
+ */
+uint32_t ar_message_buffer_get_free(ar_message_buffer_t * buffer);
+
+/*!
+ * @brief Get the message buffer's name.
+ *
+ * @param buffer The message buffer object.
+ */
+const char * ar_message_buffer_get_name(ar_message_buffer_t * buffer);
+//@}
+
+//! @}
+
+//! @addtogroup ar_stream_buffer
+//! @{
+
+//! @name Stream buffers
+//@{
+/*!
+ * @brief Create a new stream buffer.
+ *
+ * A stream buffer is a ring of bytes for passing a data stream from one writer to one reader,
+ * such as from a UART interrupt handler to a thread. Writes and reads of any length copy the
+ * data in at most two pieces and never lock the kernel. The kernel is only involved when the
+ * reader is blocked and enough data has arrived to wake it.
+ *
+ * There must be only one writer and one reader at a time. Either may be an interrupt handler.
+ *
+ * @param sb Pointer to storage for the stream buffer.
+ * @param name Name of the stream buffer. May be NULL.
+ * @param storage Buffer that holds the stream's bytes.
+ * @param capacity Size of @a storage in bytes. All of it can be filled.
+ * @param triggerLevel Number of bytes that must be available before a blocked reader is woken.
+ *     Values of 0 are treated as 1, and values larger than @a capacity as @a capacity.
+ *
+ * @retval kArSuccess The stream buffer was created.
+ * @retval kArInvalidParameterError A parameter was NULL or @a capacity was 0.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_stream_buffer_create(ar_stream_buffer_t * sb, const char * name, void * storage, uint32_t capacity, uint32_t triggerLevel);
+
+/*!
+ * @brief Delete a stream buffer.
+ *
+ * A blocked reader is woken with #kArObjectDeletedError.
+ *
+ * @param sb The stream buffer object.
+ *
+ * @retval kArSuccess The stream buffer was deleted.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_stream_buffer_delete(ar_stream_buffer_t * sb);
+
+/*!
+ * @brief Write bytes to the stream buffer.
+ *
+ * Copies as many bytes as there is room for and never blocks. If the reader is blocked and at
+ * least the trigger level of bytes is now available, the reader is woken. From interrupt
+ * context the wakeup is deferred, but the bytes are copied before this function returns.
+ *
+ * @param sb The stream buffer object.
+ * @param data Bytes to write.
+ * @param length Number of bytes to write.
+ * @param[out] bytesWritten Optional, set to the number of bytes written.
+ *
+ * @retval kArSuccess At least one byte was written, or @a length was 0.
+ * @retval kArQueueFullError The stream buffer is full.
+ */
+ar_status_t ar_stream_buffer_write(ar_stream_buffer_t * sb, const void * data, uint32_t length, uint32_t * bytesWritten);
+
+/*!
+ * @brief Read bytes from the stream buffer.
+ *
+ * If fewer bytes than the trigger level are available, the caller blocks until the trigger
+ * level is reached or the timeout expires. It then reads as many bytes as are available, up to
+ * @a length. Bytes that arrived before a timeout are returned rather than being left behind.
+ *
+ * Reading from interrupt context is allowed, in which case the timeout is ignored.
+ *
+ * @param sb The stream buffer object.
+ * @param[out] data Buffer to receive the bytes.
+ * @param length Maximum number of bytes to read.
+ * @param[out] bytesRead Optional, set to the number of bytes read.
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait in a
+ *     blocked state for the trigger level to be reached. If this value is 0, or #kArNoTimeout,
+ *     then this method only reads the bytes already available. Setting the timeout to
+ *     #kArInfiniteTimeout will cause the thread to wait forever.
+ *
+ * @retval kArSuccess At least one byte was read.
+ * @retval kArQueueEmptyError No bytes were available and the timeout was 0.
+ * @retval kArTimeoutError The timeout expired without any bytes arriving.
+ * @retval kArObjectDeletedError The stream buffer was deleted while the caller was blocked.
+ */
+ar_status_t ar_stream_buffer_read(ar_stream_buffer_t * sb, void * data, uint32_t length, uint32_t * bytesRead, uint32_t timeout);
+
+/*!
+ * @brief Change the number of bytes that must be available to wake the reader.
+ *
+ * @param sb The stream buffer object.
+ * @param triggerLevel The new trigger level, limited to between 1 and the capacity.
+ *
+ * @retval kArSuccess The trigger level was changed.
+ */
+ar_status_t ar_stream_buffer_set_trigger_level(ar_stream_buffer_t * sb, uint32_t triggerLevel);
+
+/*!
+ * @brief Returns the number of bytes available to read.
+ *
+ * @param sb The stream buffer object.
+ */
+uint32_t ar_stream_buffer_get_count(ar_stream_buffer_t * sb);
+
+/*!
+ * @brief Returns the number of bytes that can be written without the buffer filling.
+ *
+ * @param sb The stream buffer object.
+ */
+uint32_t ar_stream_buffer_get_free(ar_stream_buffer_t * sb);
+
+/*!
+ * @brief Get the stream buffer's name.
+ *
+ * @param sb The stream buffer object.
+ */
+const char * ar_stream_buffer_get_name(ar_stream_buffer_t * sb);
+//@}
+
+//! @}
+
+//! @addtogroup ar_seqlock
+//! @{
+
+//! @name Seqlocks
+//@{
+/*!
+ * @brief Create a new seqlock.
+ *
+ * A seqlock protects a block of shared data, such as a state structure that an interrupt
+ * handler updates and many threads read. Neither writes nor reads lock the kernel against
+ * interrupts or block. A write never waits for readers. A read copies the data and retries if
+ * a write happened during the copy, so it always returns a consistent snapshot.
+ *
+ * There must be only one writer at a time. Reads may be made from any number of threads, and
+ * from interrupt handlers that cannot preempt a write.
+ *
+ * @param seqlock Pointer to storage for the seqlock.
+ * @param name Name of the seqlock. May be NULL.
+ * @param storage The protected data. Its initial contents are the first value read.
+ * @param size Size of @a storage in bytes.
+ *
+ * @retval kArSuccess The seqlock was created.
+ * @retval kArInvalidParameterError A parameter was NULL or @a size was 0.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_seqlock_create(ar_seqlock_t * seqlock, const char * name, void * storage, uint32_t size);
+
+/*!
+ * @brief Delete a seqlock.
+ *
+ * @param seqlock The seqlock object.
+ *
+ * @retval kArSuccess The seqlock was deleted.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_seqlock_delete(ar_seqlock_t * seqlock);
+
+/*!
+ * @brief Replace the protected data.
+ *
+ * This function may be called from interrupt context. When called from a thread, the kernel
+ * is locked during the copy so that a higher priority reader thread cannot preempt the write
+ * and retry until it finishes.
+ *
+ * @param seqlock The seqlock object.
+ * @param data The new data, of the size given to ar_seqlock_create().
+ *
+ * @retval kArSuccess
+ * @retval kArInvalidStateError Another write is in progress. This only happens when an
+ *     interrupt handler writes while it has preempted another writer. The data is unchanged.
+ */
+ar_status_t ar_seqlock_write(ar_seqlock_t * seqlock, const void * data);
+
+/*!
+ * @brief Copy out a consistent snapshot of the protected data.
+ *
+ * The copy is repeated until no write has happened during it.
+ *
+ * @param seqlock The seqlock object.
+ * @param[out] data Buffer of the size given to ar_seqlock_create().
+ *
+ * @retval kArSuccess
+ * @retval kArInvalidStateError Called from an interrupt handler that preempted a write, which
+ *     cannot finish until the handler returns. The contents of @a data are undefined.
+ */
+ar_status_t ar_seqlock_read(ar_seqlock_t * seqlock, void * data);
+
+/*!
+ * @brief Returns the number of writes that have finished.
+ *
+ * A reader can compare this with an earlier value to see whether the data has changed without
+ * copying it.
+ *
+ * @param seqlock The seqlock object.
+ */
+uint32_t ar_seqlock_get_write_count(ar_seqlock_t * seqlock);
+
+/*!
+ * @brief Get the seqlock's name.
+ *
+ * @param seqlock The seqlock object.
+ */
+const char * ar_seqlock_get_name(ar_seqlock_t * seqlock);
+//@}
+
+//! @}
+
+#if AR_ENABLE_RCU
+//! @addtogroup ar_rcu
+//! @{
+
+//! @name Read-copy-update
+//@{
+/*!
+ * @brief Enter an RCU read-side critical section.
+ *
+ * Data published with ar_rcu_exchange() may be read through a pointer loaded inside a
+ * read-side critical section until the section is exited. A writer that replaces the data
+ * waits in ar_rcu_synchronize() until every section that might still be using the old version
+ * has exited.
+ *
+ * Entering and exiting only change a counter owned by the current thread. Sections may be
+ * nested. A thread should not block inside a section, since that holds up writers.
+ *
+ * This function may be called from interrupt context. An interrupt handler always exits its
+ * section before any writer thread can run again.
+ */
+void ar_rcu_read_lock(void);
+
+/*!
+ * @brief Exit an RCU read-side critical section.
+ *
+ * Pointers loaded inside the section must not be used after it is exited.
+ *
+ * If a writer is waiting in ar_rcu_synchronize() for the current thread, exiting the outermost
+ * section enters the scheduler so the writer is released.
+ */
+void ar_rcu_read_unlock(void);
+
+/*!
+ * @brief Publish a new version of RCU-protected data.
+ *
+ * Stores @a value to @a pointer after making sure that everything the caller wrote to the
+ * new version is visible first. The kernel is locked during the exchange, so when several
+ * writer threads publish to the same pointer, each gets back a different old version.
+ *
+ * The old version may still be in use by readers. Call ar_rcu_synchronize() before reusing
+ * or freeing it.
+ *
+ * @param pointer The shared pointer to the current version.
+ * @param value The new version.
+ *
+ * @return The previous value of @a pointer.
+ *
+ * @note This function cannot be called from interrupt context.
+ */
+void * ar_rcu_exchange(void * volatile * pointer, void * value);
+
+/*!
+ * @brief Wait for a grace period to pass.
+ *
+ * Returns once every read-side critical section that had been entered when this function was
+ * called has been exited. After that, no reader can hold a version of the data that was
+ * replaced before the call.
+ *
+ * The scheduler notes whether the thread it is switching away from is inside a critical
+ * section, so only threads that were preempted or blocked inside one are waited for. If none
+ * are, this function returns right away. Otherwise the caller blocks, and each of those
+ * readers runs the scheduler when it exits its section, which releases the caller once the
+ * last one has.
+ *
+ * @param timeout The maximum number of milliseconds that the caller is willing to wait for
+ *     readers to finish. If this value is 0, or #kArNoTimeout, then this method will return
+ *     immediately if there are readers to wait for. Setting the timeout to
+ *     #kArInfiniteTimeout will cause the thread to wait forever.
+ *
+ * @retval kArSuccess A grace period has passed.
+ * @retval kArTimeoutError Readers were still in their critical sections.
+ * @retval kArInvalidStateError The caller is inside a read-side critical section, so the
+ *     grace period could never end.
+ * @retval kArNotFromInterruptError This function cannot be called from interrupt context.
+ */
+ar_status_t ar_rcu_synchronize(uint32_t timeout);
+//@}
+
+//! @}
+#endif // AR_ENABLE_RCU
+
 //! @addtogroup ar_timer
 //! @{
 
@@ -948,6 +2283,23 @@ const char * ar_queue_get_name(ar_queue_t * queue);
  */
 ar_status_t ar_timer_create(ar_timer_t * timer, const char * name, ar_timer_entry_t callback, void * param, ar_timer_mode_t timerMode, uint32_t delay);
 
+/*!
+ * @brief Create a new timer with a delay in microseconds.
+ *
+ * @param timer Pointer to storage for the new timer.
+ * @param name The name of the timer. May be NULL.
+ * @param callback Callback function that will be executed when the timer expires.
+ * @param param Arbitrary pointer-sized argument that is passed to the timer callback routine.
+ * @param timerMode Whether to create a one-shot or periodic timer. Pass either #kArOneShotTimer or
+ *      #kArPeriodicTimer.
+ * @param delay The timer delay in microseconds. The timer will fire this number of microseconds
+ *      after the ar_timer_start() API is called.
+ *
+ * @retval kArSuccess The timer was created successfully.
+ * @retval kArInvalidParameterError The timer or callback is NULL, or the delay is 0.
+ */
+ar_status_t ar_timer_create_us(ar_timer_t * timer, const char * name, ar_timer_entry_t callback, void * param, ar_timer_mode_t timerMode, uint64_t delay);
+
 /*!
  * @brief Delete a timer.
  *
@@ -1004,6 +2356,26 @@ ar_status_t ar_timer_set_delay(ar_timer_t * timer, uint32_t newDelay);
  */
 uint32_t ar_timer_get_delay(ar_timer_t * timer);
 
+/*!
+ * @brief Adjust the timer's delay in microseconds.
+ *
+ * @param timer The timer object.
+ * @param newDelay New delay value for the timer in microseconds.
+ *
+ * @retval kArSuccess The timer's delay was modified.
+ * @retval kArInvalidParameterError The timer is NULL or the delay is 0.
+ */
+ar_status_t ar_timer_set_delay_us(ar_timer_t * timer, uint64_t newDelay);
+
+/*!
+ * @brief Get the current delay for the timer in microseconds.
+ *
+ * @param timer The timer object.
+ *
+ * @return The timer's delay in microseconds.
+ */
+uint64_t ar_timer_get_delay_us(ar_timer_t * timer);
+
 /*!
  * @brief Get the timer's name.
  *
@@ -1065,7 +2437,7 @@ ar_status_t ar_runloop_delete(ar_runloop_t * runloop);
  * it will return #kArRunLoopQueueReceived and the @a object parameter will be filled in with the
  * queue object that received the item. If @a object is NULL, then the runloop will still exit but
  * you cannot tell which queue received. This is acceptable if only one queue is associated with
- * the runloop.
+ * the runloop. Message buffers added with ar_runloop_add_message_buffer() behave the same way.
  *
  * @param runloop The runloop object.
  * @param timeout The maximum number of milliseconds to run the runloop. If this value is 0, or
@@ -1076,6 +2448,8 @@ ar_status_t ar_runloop_delete(ar_runloop_t * runloop);
  *
  * @retval #kArRunLoopStopped The runloop exited due to a timeout or explict call to ar_runloop_stop().
  * @retval #kArRunLoopQueueReceived A queue associated with the runloop received an item.
+ * @retval #kArRunLoopMessageBufferReceived A message buffer associated with the runloop received
+ *     a message.
  * @retval #kArTimeoutError The runloop timed out.
  * @retval #kArInvalidParameterError Invalid parameter was provided.
  * @retval #kArRunLoopAlreadyRunningError The runloop is already running on another thread, or another
@@ -1148,6 +2522,24 @@ ar_status_t ar_runloop_add_timer(ar_runloop_t * runloop, ar_timer_t * timer);
  */
 ar_status_t ar_runloop_add_queue(ar_runloop_t * runloop, ar_queue_t * queue, ar_runloop_queue_handler_t callback, void * param);
 
+/*!
+ * @brief Add a message buffer to a runloop.
+ *
+ * Works just like ar_runloop_add_queue(). If there is no callback, the runloop exits with
+ * #kArRunLoopMessageBufferReceived when a message arrives, and fills in the @a m_messageBuffer
+ * member of the result.
+ *
+ * @param runloop Pointer to the runloop.
+ * @param buffer The message buffer to associate with the runloop.
+ * @param callback Optional callback to handle a message received on the buffer. May be NULL.
+ * @param param Arbitrary parameter passed to the _callback_ when it is called.
+ *
+ * @retval #kArSuccess The message buffer was added to the runloop.
+ * @retval #kArAlreadyAttachedError A message buffer can only be added to one runloop at a time.
+ * @retval #kArInvalidParameterError The _runloop_ or _buffer_ parameter was NULL.
+ */
+ar_status_t ar_runloop_add_message_buffer(ar_runloop_t * runloop, ar_message_buffer_t * buffer, ar_runloop_message_buffer_handler_t callback, void * param);
+
 /*!
  * @brief Return the current runloop.
  *
@@ -1174,22 +2566,49 @@ const char * ar_runloop_get_name(ar_runloop_t * runloop);
 //@{
 /*!
  * @brief Return the current time in ticks.
+ *
+ * This is the microsecond time divided by the scheduler quanta. It wraps to 0 after 2^32 ticks.
  */
 uint32_t ar_get_tick_count(void);
 
 /*!
  * @brief Return the current time in milliseconds.
  *
- * @return Elapsed time since the kernel was started in milliseconds. Has a resolution of one tick.
+ * @return Elapsed time since the kernel was started in milliseconds. This value wraps to 0
+ *     after about 49.7 days; use ar_get_microseconds() for a time that does not wrap.
  */
 uint32_t ar_get_millisecond_count(void);
 
 /*!
  * @brief Get a microsecond timestamp.
- * @return Elapsed time in microseconds since the system was started.
+ *
+ * This is the kernel's time base. All sleeps, timeouts, and timers are scheduled against it.
+ * It is monotonic and, being 64 bits, will not wrap for over half a million years. It may be
+ * called from any context, including interrupts.
+ *
+ * @return Elapsed time in microseconds since the kernel was started.
  */
 uint64_t ar_get_microseconds(void);
 
+/*!
+ * @brief Get a cycle count timestamp.
+ *
+ * This is the highest resolution clock available, used for CPU load accounting. On Cortex-M3
+ * and later cores it is the DWT cycle counter, extended to 64 bits. Where there is no cycle
+ * counter, it is derived from the system tick timer. It may be called from any context,
+ * including interrupts.
+ *
+ * @return Elapsed cycles since the kernel was started.
+ */
+uint64_t ar_get_cycles(void);
+
+/*!
+ * @brief Get the rate at which the value returned by ar_get_cycles() increases.
+ *
+ * @return Number of cycles per second.
+ */
+uint32_t ar_get_cycles_per_second(void);
+
 /*!
  * @brief Get the number of milliseconds per tick.
  */
@@ -44,7 +44,7 @@ using namespace Ar;
 static ar_status_t ar_channel_block(ar_channel_t * channel, ar_list_t & myDirList, void * value, uint32_t timeout);
 static ar_status_t ar_channel_send_receive(ar_channel_t * channel, bool isSending, ar_list_t & myDirList, ar_list_t & otherDirList, void * value, uint32_t timeout);
 static ar_status_t ar_channel_send_receive_internal(ar_channel_t * channel, bool isSending, ar_list_t & myDirList, ar_list_t & otherDirList, void * value, uint32_t timeout);
-static void ar_channel_deferred_send(void * object, void * object2);
+static ar_status_t ar_channel_deferred_send(void * object, void * object2, uint32_t count);
 
 //------------------------------------------------------------------------------
 // Code
@@ -71,6 +71,8 @@ ar_status_t ar_channel_create(ar_channel_t * channel, const char * name, uint32_
     g_ar_objects.channels.add(&channel->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_created(kArTraceChannelObject, channel, channel->m_name);
+
     return kArSuccess;
 }
 
@@ -104,6 +106,8 @@ ar_status_t ar_channel_delete(ar_channel_t * channel)
     g_ar_objects.channels.remove(&channel->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_object(kArTraceObjectDeleted, kArTraceChannelObject, channel);
+
     return kArSuccess;
 }
 
@@ -179,10 +183,16 @@ static ar_status_t ar_channel_send_receive_internal(ar_channel_t * channel, bool
     return kArSuccess;
 }
 
-static void ar_channel_deferred_send(void * object, void * object2)
+static ar_status_t ar_channel_deferred_send(void * object, void * object2, uint32_t count)
 {
     ar_channel_t * channel = reinterpret_cast<ar_channel_t *>(object);
-    ar_channel_send_receive_internal(channel, true, channel->m_blockedSenders, channel->m_blockedReceivers, object2, kArNoTimeout);
+    ar_status_t status = kArSuccess;
+    for (; count && status == kArSuccess; --count)
+    {
+        status = ar_channel_send_receive_internal(channel, true, channel->m_blockedSenders, channel->m_blockedReceivers, object2, kArNoTimeout);
+    }
+    ar_trace_object(kArTraceChannelSend, status, channel);
+    return status;
 }
 
 //! @brief Common channel send/receive code.
@@ -205,7 +215,9 @@ ar_status_t ar_channel_send_receive(ar_channel_t * channel, bool isSending, ar_l
         return g_ar.deferredActions.post(ar_channel_deferred_send, channel, value);
     }
 
-    return ar_channel_send_receive_internal(channel, isSending, myDirList, otherDirList, value, timeout);
+    ar_status_t status = ar_channel_send_receive_internal(channel, isSending, myDirList, otherDirList, value, timeout);
+    ar_trace_object(isSending ? kArTraceChannelSend : kArTraceChannelReceive, status, channel);
+    return status;
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for Ar microkernel condition variables.
+ */
+
+#include "ar_internal.h"
+#include <string.h>
+#include <assert.h>
+
+using namespace Ar;
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static void ar_condvar_wake(ar_condvar_t * cv, bool canReady);
+static ar_status_t ar_condvar_wait_internal(ar_condvar_t * cv, ar_mutex_t * mutex, uint32_t timeout);
+static ar_status_t ar_condvar_signal_internal(ar_condvar_t * cv);
+static ar_status_t ar_condvar_deferred_signal(void * object, void * object2, uint32_t count);
+static ar_status_t ar_condvar_broadcast_internal(ar_condvar_t * cv);
+static ar_status_t ar_condvar_deferred_broadcast(void * object, void * object2, uint32_t count);
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_condvar_create(ar_condvar_t * cv, const char * name)
+{
+    if (!cv)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    memset(cv, 0, sizeof(ar_condvar_t));
+    cv->m_name = name ? name : AR_ANONYMOUS_OBJECT_NAME;
+
+    // Set the blocked list to sort by priority, so a signal wakes the most important waiter.
+    cv->m_blockedList.m_predicate = ar_thread_sort_by_priority;
+
+#if AR_GLOBAL_OBJECT_LISTS
+    cv->m_createdNode.m_obj = cv;
+    g_ar_objects.condvars.add(&cv->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_created(kArTraceCondVarObject, cv, cv->m_name);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_condvar_delete(ar_condvar_t * cv)
+{
+    if (!cv)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    {
+        KernelLock guard;
+
+        // Unblock all waiting threads. They will relock the mutex before returning.
+        while (cv->m_blockedList.m_head)
+        {
+            cv->m_blockedList.getHead<ar_thread_t>()->unblockWithStatus(cv->m_blockedList, kArObjectDeletedError);
+        }
+    }
+
+#if AR_GLOBAL_OBJECT_LISTS
+    g_ar_objects.condvars.remove(&cv->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_object(kArTraceObjectDeleted, kArTraceCondVarObject, cv);
+
+    return kArSuccess;
+}
+
+//! If the mutex is unlocked and @a canReady is true, the head waiter is simply made ready, and
+//! will lock the mutex once it runs. Otherwise the waiter can't run until the mutex is unlocked,
+//! so it is moved directly from the condition variable's blocked list to the mutex's, with any
+//! timeout cancelled. The mutex owner inherits the waiter's priority as if the waiter had
+//! blocked in ar_mutex_get().
+//!
+//! The kernel must be locked and the condition variable must have a waiting thread.
+static void ar_condvar_wake(ar_condvar_t * cv, bool canReady)
+{
+    ar_thread_t * thread = cv->m_blockedList.getHead<ar_thread_t>();
+    ar_mutex_t * mutex = cv->m_mutex;
+
+    if (canReady && mutex->m_ownerLockCount == 0)
+    {
+        thread->unblockWithStatus(cv->m_blockedList, kArSuccess);
+        return;
+    }
+
+    cv->m_blockedList.remove(&thread->m_blockedNode);
+    if (thread->m_wakeupTime)
+    {
+        g_ar.sleepingList.remove(thread);
+        thread->m_wakeupTime = 0;
+    }
+
+    mutex->m_blockedList.add(&thread->m_blockedNode);
+    ar_mutex_hoist_owner(mutex, thread);
+}
+
+static ar_status_t ar_condvar_wait_internal(ar_condvar_t * cv, ar_mutex_t * mutex, uint32_t timeout)
+{
+    KernelLock guard;
+
+    ar_thread_t * self = g_ar.currentThread;
+    if (mutex->m_owner != self)
+    {
+        return kArNotOwnerError;
+    }
+    if (cv->m_blockedList.m_head && cv->m_mutex != mutex)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Return immediately if the timeout is 0. The caller still owns the mutex.
+    if (timeout == kArNoTimeout)
+    {
+        return kArTimeoutError;
+    }
+
+    // Fully unlock the mutex, remembering the recursive lock count to restore later.
+    cv->m_mutex = mutex;
+    unsigned lockCount = mutex->m_ownerLockCount;
+    mutex->m_ownerLockCount = 0;
+    ar_mutex_release(mutex);
+
+    // Block this thread on the condition variable.
+    self->block(cv->m_blockedList, timeout);
+
+    // We're back from the scheduler. Only a timeout leaves this thread on the blocked list. If
+    // we were signalled while the mutex was locked, we were moved to the mutex's blocked list
+    // and have now been unblocked by the owner releasing it.
+    ar_status_t status = self->m_unblockStatus;
+    if (status == kArTimeoutError)
+    {
+        cv->m_blockedList.remove(&self->m_blockedNode);
+    }
+
+    // Lock the mutex again, whatever the status.
+    ar_mutex_acquire(mutex, kArInfiniteTimeout);
+    assert(mutex->m_owner == self);
+    mutex->m_ownerLockCount = lockCount;
+
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_condvar_wait(ar_condvar_t * cv, ar_mutex_t * mutex, uint32_t timeout)
+{
+    if (!cv || !mutex)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_condvar_wait_internal(cv, mutex, timeout);
+    ar_trace_object(kArTraceCondVarWait, status, cv);
+    return status;
+}
+
+static ar_status_t ar_condvar_signal_internal(ar_condvar_t * cv)
+{
+    KernelLock guard;
+
+    if (cv->m_blockedList.m_head)
+    {
+        ar_condvar_wake(cv, true);
+    }
+
+    return kArSuccess;
+}
+
+static ar_status_t ar_condvar_deferred_signal(void * object, void * object2, uint32_t count)
+{
+    ar_status_t status = kArSuccess;
+    for (; count && status == kArSuccess; --count)
+    {
+        status = ar_condvar_signal_internal(reinterpret_cast<ar_condvar_t *>(object));
+    }
+    ar_trace_object(kArTraceCondVarSignal, status, object);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_condvar_signal(ar_condvar_t * cv)
+{
+    if (!cv)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Handle irq state by deferring the signal.
+    if (ar_port_get_irq_state())
+    {
+        return g_ar.deferredActions.post(ar_condvar_deferred_signal, cv);
+    }
+
+    ar_status_t status = ar_condvar_signal_internal(cv);
+    ar_trace_object(kArTraceCondVarSignal, status, cv);
+    return status;
+}
+
+static ar_status_t ar_condvar_broadcast_internal(ar_condvar_t * cv)
+{
+    KernelLock guard;
+
+    // If the mutex is unlocked, the first (highest priority) waiter is made ready to lock it.
+    // Everyone else waits on the mutex, to be released one at a time as it is unlocked.
+    bool canReady = true;
+    while (cv->m_blockedList.m_head)
+    {
+        ar_condvar_wake(cv, canReady);
+        canReady = false;
+    }
+
+    return kArSuccess;
+}
+
+static ar_status_t ar_condvar_deferred_broadcast(void * object, void * object2, uint32_t count)
+{
+    ar_status_t status = ar_condvar_broadcast_internal(reinterpret_cast<ar_condvar_t *>(object));
+    ar_trace_object(kArTraceCondVarBroadcast, status, object);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_condvar_broadcast(ar_condvar_t * cv)
+{
+    if (!cv)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Handle irq state by deferring the broadcast.
+    if (ar_port_get_irq_state())
+    {
+        return g_ar.deferredActions.post(ar_condvar_deferred_broadcast, cv);
+    }
+
+    ar_status_t status = ar_condvar_broadcast_internal(cv);
+    ar_trace_object(kArTraceCondVarBroadcast, status, cv);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+const char * ar_condvar_get_name(ar_condvar_t * cv)
+{
+    return cv ? cv->m_name : NULL;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
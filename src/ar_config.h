@@ -92,6 +92,9 @@
 
 #if !defined(AR_ENABLE_SYSTEM_LOAD)
     //! @brief When set to 1, per-thread and total system CPU load will be computed.
+    //!
+    //! Thread run time is measured with ar_get_cycles(), so short bursts between ticks are
+    //! counted accurately. Each thread's total cycles and context switch count are also kept.
     #define AR_ENABLE_SYSTEM_LOAD (1)
 #endif
 
@@ -102,6 +105,21 @@
     #define AR_SYSTEM_LOAD_SAMPLE_PERIOD (1000000)
 #endif
 
+#if !defined(AR_SYSTEM_LOAD_SHORT_HORIZON)
+    //! @brief Time constant in microseconds of the short load average.
+    #define AR_SYSTEM_LOAD_SHORT_HORIZON (1000000)
+#endif
+
+#if !defined(AR_SYSTEM_LOAD_MEDIUM_HORIZON)
+    //! @brief Time constant in microseconds of the medium load average.
+    #define AR_SYSTEM_LOAD_MEDIUM_HORIZON (10000000)
+#endif
+
+#if !defined(AR_SYSTEM_LOAD_LONG_HORIZON)
+    //! @brief Time constant in microseconds of the long load average.
+    #define AR_SYSTEM_LOAD_LONG_HORIZON (60000000)
+#endif
+
 //@}
 
 #if !defined(AR_THREAD_STACK_PATTERN_FILL)
@@ -147,11 +165,69 @@
     #define AR_ENABLE_TICKLESS_IDLE (1)
 #endif
 
+#if !defined(AR_ENABLE_READY_QUEUE_BITMAP)
+    //! @brief Set to 1 to use a priority bitmap for the ready thread queue.
+    //!
+    //! With the bitmap enabled, ready threads are held in one FIFO list per priority level and
+    //! a 256-bit bitmap records which levels are occupied. Making a thread ready and selecting
+    //! the highest priority thread are both constant time operations, regardless of the number
+    //! of threads. The cost is roughly 1 kB of additional RAM for the list heads.
+    //!
+    //! Set to 0 to use a single list of ready threads sorted by priority, which is smaller but
+    //! takes linear time to insert a thread.
+    #define AR_ENABLE_READY_QUEUE_BITMAP (1)
+#endif
+
+#if !defined(AR_ENABLE_TIMING_WHEEL)
+    //! @brief Set to 1 to use a hierarchical timing wheel for sleeping threads.
+    //!
+    //! The timing wheel holds threads that are sleeping or blocked with a timeout. It has four
+    //! levels of 32 slots each. Level 0 slots are 1024 µs wide, and every level's slots are 32
+    //! times wider than the level below, covering about 18 minutes. Wakeups further out are
+    //! kept on an overflow list. Adding and removing a thread are constant time operations.
+    //!
+    //! Set to 0 to use a single list sorted by wakeup time, which is smaller but takes linear
+    //! time to insert a thread.
+    #define AR_ENABLE_TIMING_WHEEL (1)
+#endif
+
 #if !defined(AR_DEFERRED_ACTION_QUEUE_SIZE)
-    //! @brief Maximum number of actions deferred from IRQ context.
+    //! @brief Maximum number of actions deferred from IRQ context, per queue.
+    //!
+    //! Must be a power of two. Actions are only deferred while the kernel is locked, and
+    //! identical actions posted back to back share an entry. If a queue is full, the kernel
+    //! call made by the interrupt returns #kArQueueFullError. Use
+    //! ar_kernel_get_deferred_action_stats() to see how much of each queue has been used.
     #define AR_DEFERRED_ACTION_QUEUE_SIZE (8)
 #endif
 
+#if !defined(AR_DEFERRED_ACTION_QUEUE_COUNT)
+    //! @brief Number of deferred action queues.
+    //!
+    //! The range of interrupt priorities is split evenly into this many bands, each with its own
+    //! queue, so interrupts at one priority cannot fill the queue for others. Actions from more
+    //! urgent bands are run first.
+    #define AR_DEFERRED_ACTION_QUEUE_COUNT (1)
+#endif
+
+#if !defined(AR_RWLOCK_MAX_READERS)
+    //! @brief Maximum number of threads that can hold the read lock of one reader-writer lock.
+    //!
+    //! Each reader has a slot in the lock so it can inherit the priority of a blocked writer.
+    //! Once all slots are in use, further readers wait for a slot. Each slot takes 8 bytes.
+    #define AR_RWLOCK_MAX_READERS (4)
+#endif
+
+#if !defined(AR_ENABLE_RCU)
+    //! @brief Set to 1 to enable RCU read-side critical sections and grace periods.
+    //!
+    //! Each time the scheduler runs, it notes whether the current thread is inside a read-side
+    //! critical section. Grace periods are detected from these notes, so readers do not need
+    //! any atomic operations. The cost is a few instructions per scheduler run and 8 bytes per
+    //! thread, so it is disabled by default.
+    #define AR_ENABLE_RCU (0)
+#endif
+
 #if !defined(AR_RUNLOOP_FUNCTION_QUEUE_SIZE)
     //! @brief Maximum number of functions queued in a run loop.
     #define AR_RUNLOOP_FUNCTION_QUEUE_SIZE (8)
@@ -166,9 +242,19 @@
 
 #if !defined(AR_ENABLE_TRACE)
     //! @brief Enable kernel event tracing.
+    //!
+    //! Events are recorded into a ring buffer in RAM, `g_ar_trace`, which can be dumped with a
+    //! debugger and converted for viewing in Perfetto by `tools/ar_trace_decode.py`.
     #define AR_ENABLE_TRACE (DEBUG)
 #endif
 
+#if !defined(AR_TRACE_BUFFER_SIZE)
+    //! @brief Number of events held in the trace ring buffer.
+    //!
+    //! Must be a power of two. Each event takes 8 bytes.
+    #define AR_TRACE_BUFFER_SIZE (512)
+#endif
+
 //! @}
 
 #endif // _AR_CONFIG_H_
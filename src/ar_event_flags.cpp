@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for Ar microkernel event flags.
+ */
+
+#include "ar_internal.h"
+#include <string.h>
+
+using namespace Ar;
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static bool ar_event_flags_is_satisfied(uint32_t flags, uint32_t bits, uint32_t options);
+static ar_status_t ar_event_flags_set_internal(ar_event_flags_t * flags, uint32_t bits);
+static ar_status_t ar_event_flags_deferred_set(void * object, void * object2, uint32_t count);
+static ar_status_t ar_event_flags_clear_internal(ar_event_flags_t * flags, uint32_t bits);
+static ar_status_t ar_event_flags_deferred_clear(void * object, void * object2, uint32_t count);
+static ar_status_t ar_event_flags_wait_internal(ar_event_flags_t * flags, uint32_t bits, uint32_t options, uint32_t * result, uint32_t timeout);
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_event_flags_create(ar_event_flags_t * flags, const char * name, uint32_t initialFlags)
+{
+    if (!flags)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    memset(flags, 0, sizeof(ar_event_flags_t));
+    flags->m_name = name ? name : AR_ANONYMOUS_OBJECT_NAME;
+    flags->m_flags = initialFlags;
+
+#if AR_GLOBAL_OBJECT_LISTS
+    flags->m_createdNode.m_obj = flags;
+    g_ar_objects.eventFlags.add(&flags->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_created(kArTraceEventFlagsObject, flags, flags->m_name);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_event_flags_delete(ar_event_flags_t * flags)
+{
+    if (!flags)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    {
+        KernelLock guard;
+
+        // Unblock all threads waiting on the flags.
+        while (flags->m_blockedList.m_head)
+        {
+            flags->m_blockedList.getHead<ar_thread_t>()->unblockWithStatus(flags->m_blockedList, kArObjectDeletedError);
+        }
+    }
+
+#if AR_GLOBAL_OBJECT_LISTS
+    g_ar_objects.eventFlags.remove(&flags->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_object(kArTraceObjectDeleted, kArTraceEventFlagsObject, flags);
+
+    return kArSuccess;
+}
+
+//! @brief Check whether flag values satisfy a wait.
+static bool ar_event_flags_is_satisfied(uint32_t flags, uint32_t bits, uint32_t options)
+{
+    if (options & kArEventFlagsWaitAll)
+    {
+        return (flags & bits) == bits;
+    }
+    else
+    {
+        return (flags & bits) != 0;
+    }
+}
+
+static ar_status_t ar_event_flags_set_internal(ar_event_flags_t * flags, uint32_t bits)
+{
+    KernelLock guard;
+
+    flags->m_flags |= bits;
+    uint32_t newFlags = flags->m_flags;
+
+    // Unblock every waiter that the new flags satisfy. Unblocking only marks the scheduler as
+    // needed, so it runs once for all of them when the kernel is unlocked. Flags are cleared
+    // after the scan so that every satisfied waiter sees the same values.
+    uint32_t clearBits = 0;
+    ar_list_node_t * node = flags->m_blockedList.m_head;
+    if (node)
+    {
+        ar_list_node_t * last = node->m_prev;
+        bool isLast;
+        do {
+            ar_list_node_t * next = node->m_next;
+            isLast = (node == last);
+
+            ar_thread_t * thread = node->getObject<ar_thread_t>();
+            if (ar_event_flags_is_satisfied(newFlags, thread->m_eventFlags, thread->m_eventFlagsOptions))
+            {
+                if (thread->m_eventFlagsOptions & kArEventFlagsClearOnExit)
+                {
+                    clearBits |= thread->m_eventFlags;
+                }
+
+                // Hand the waiter the flags that woke it.
+                thread->m_eventFlags = newFlags;
+                thread->unblockWithStatus(flags->m_blockedList, kArSuccess);
+            }
+
+            node = next;
+        } while (!isLast);
+    }
+
+    flags->m_flags &= ~clearBits;
+
+    return kArSuccess;
+}
+
+static ar_status_t ar_event_flags_deferred_set(void * object, void * object2, uint32_t count)
+{
+    ar_status_t status = ar_event_flags_set_internal(reinterpret_cast<ar_event_flags_t *>(object), static_cast<uint32_t>(reinterpret_cast<uintptr_t>(object2)));
+    ar_trace_object(kArTraceEventFlagsSet, status, object);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_event_flags_set(ar_event_flags_t * flags, uint32_t bits)
+{
+    if (!flags)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Handle irq state by deferring the set.
+    if (ar_port_get_irq_state())
+    {
+        return g_ar.deferredActions.post(ar_event_flags_deferred_set, flags, reinterpret_cast<void *>(static_cast<uintptr_t>(bits)));
+    }
+
+    ar_status_t status = ar_event_flags_set_internal(flags, bits);
+    ar_trace_object(kArTraceEventFlagsSet, status, flags);
+    return status;
+}
+
+static ar_status_t ar_event_flags_clear_internal(ar_event_flags_t * flags, uint32_t bits)
+{
+    KernelLock guard;
+
+    // Clearing flags can't satisfy a wait, so there is nobody to unblock.
+    flags->m_flags &= ~bits;
+
+    return kArSuccess;
+}
+
+static ar_status_t ar_event_flags_deferred_clear(void * object, void * object2, uint32_t count)
+{
+    ar_status_t status = ar_event_flags_clear_internal(reinterpret_cast<ar_event_flags_t *>(object), static_cast<uint32_t>(reinterpret_cast<uintptr_t>(object2)));
+    ar_trace_object(kArTraceEventFlagsClear, status, object);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_event_flags_clear(ar_event_flags_t * flags, uint32_t bits)
+{
+    if (!flags)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Handle irq state by deferring the clear.
+    if (ar_port_get_irq_state())
+    {
+        return g_ar.deferredActions.post(ar_event_flags_deferred_clear, flags, reinterpret_cast<void *>(static_cast<uintptr_t>(bits)));
+    }
+
+    ar_status_t status = ar_event_flags_clear_internal(flags, bits);
+    ar_trace_object(kArTraceEventFlagsClear, status, flags);
+    return status;
+}
+
+static ar_status_t ar_event_flags_wait_internal(ar_event_flags_t * flags, uint32_t bits, uint32_t options, uint32_t * result, uint32_t timeout)
+{
+    KernelLock guard;
+
+    uint32_t currentFlags = flags->m_flags;
+    if (ar_event_flags_is_satisfied(currentFlags, bits, options))
+    {
+        if (options & kArEventFlagsClearOnExit)
+        {
+            flags->m_flags &= ~bits;
+        }
+    }
+    else
+    {
+        // Return immediately if the timeout is 0.
+        if (timeout == kArNoTimeout)
+        {
+            return kArTimeoutError;
+        }
+
+        // Block this thread on the flags. The thread that sets the flags checks our wait,
+        // performs any clear, and leaves the satisfying flags in m_eventFlags, so there is no
+        // need to recheck once we're unblocked.
+        ar_thread_t * thread = g_ar.currentThread;
+        thread->m_eventFlags = bits;
+        thread->m_eventFlagsOptions = static_cast<uint8_t>(options);
+        thread->block(flags->m_blockedList, timeout);
+
+        // Check for errors and exit early if there was one. Only a timeout leaves the thread on
+        // the blocked list; deleting the flags has already removed it.
+        if (thread->m_unblockStatus != kArSuccess)
+        {
+            if (thread->m_unblockStatus == kArTimeoutError)
+            {
+                flags->m_blockedList.remove(&thread->m_blockedNode);
+            }
+            return thread->m_unblockStatus;
+        }
+
+        currentFlags = thread->m_eventFlags;
+    }
+
+    if (result)
+    {
+        *result = currentFlags;
+    }
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_event_flags_wait(ar_event_flags_t * flags, uint32_t bits, uint32_t options, uint32_t * result, uint32_t timeout)
+{
+    if (!flags || !bits)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_event_flags_wait_internal(flags, bits, options, result, timeout);
+    ar_trace_object(kArTraceEventFlagsWait, status, flags);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_event_flags_get_flags(ar_event_flags_t * flags)
+{
+    return flags ? flags->m_flags : 0;
+}
+
+// See ar_kernel.h for documentation of this function.
+const char * ar_event_flags_get_name(ar_event_flags_t * flags)
+{
+    return flags ? flags->m_name : NULL;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
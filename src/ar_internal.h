@@ -65,69 +65,307 @@ enum
     //! Value to fill the stack with for detection of max stack usage. All bytes of this
     //! fill pattern must be the same.
     kStackFillValue = 0xbabababa,
+
+    //! Number of fractional bits in the fixed point load averages.
+    kLoadAverageShift = 11,
 };
 
-//! All events start with a 32-bit message on ITM port 31, composed of an event ID in the
-//! top 8 bits plus a 24-bit value. Certain events are also followed by a 32-bit value in
-//! ITM port 30.
+//! @brief Kernel trace event IDs.
+//!
+//! Each event is one #ar_trace_record_t holding the event ID, an 8-bit argument, the low
+//! 16 bits of the microsecond time, and a 32-bit data value. Object values are the low 32 bits
+//! of the object's address.
 enum _ar_trace_events
 {
-    kArTraceThreadSwitch = 1,   //!< 2 value: 0=previous thread's new state, 1=new thread id
-    kArTraceThreadCreated = 2,  //!< 2 value: 0=unused, 1=new thread id
-    kArTraceThreadDeleted = 3,  //!< 2 value: 0=unused, 1=deleted thread id
+    kArTraceNone = 0,               //!< Unused record.
+    kArTraceTimeSync = 1,           //!< arg=unused, data=low 32 bits of the microsecond time
+    kArTraceObjectCreated = 2,      //!< arg=object type, data=object; followed by name records
+    kArTraceObjectName = 3,         //!< arg=offset into name, data=up to 4 name characters
+    kArTraceObjectDeleted = 4,      //!< arg=object type, data=object
+    kArTraceThreadSwitch = 5,       //!< arg=previous thread's new state, data=new thread
+    kArTraceThreadState = 6,        //!< arg=new state, data=thread
+    kArTraceSemaphoreGet = 7,       //!< arg=status, data=semaphore
+    kArTraceSemaphorePut = 8,       //!< arg=status, data=semaphore
+    kArTraceMutexGet = 9,           //!< arg=status, data=mutex
+    kArTraceMutexPut = 10,          //!< arg=status, data=mutex
+    kArTraceQueueSend = 11,         //!< arg=status, data=queue
+    kArTraceQueueReceive = 12,      //!< arg=status, data=queue
+    kArTraceChannelSend = 13,       //!< arg=status, data=channel
+    kArTraceChannelReceive = 14,    //!< arg=status, data=channel
+    kArTraceDeferredPost = 15,      //!< arg=status, data=object
+    kArTraceDeferredRun = 16,       //!< arg=count, data=object
+    kArTraceTimerFire = 17,         //!< arg=unused, data=timer
+    kArTraceRunLoopFunction = 18,   //!< arg=unused, data=function
+    kArTraceRunLoopQueue = 19,      //!< arg=unused, data=queue
+    kArTraceThreadNotify = 20,      //!< arg=status, data=thread
+    kArTraceThreadNotifyWait = 21,  //!< arg=status, data=thread
+    kArTraceEventFlagsSet = 22,     //!< arg=status, data=event flags
+    kArTraceEventFlagsClear = 23,   //!< arg=status, data=event flags
+    kArTraceEventFlagsWait = 24,    //!< arg=status, data=event flags
+    kArTraceCondVarWait = 25,       //!< arg=status, data=condition variable
+    kArTraceCondVarSignal = 26,     //!< arg=status, data=condition variable
+    kArTraceCondVarBroadcast = 27,  //!< arg=status, data=condition variable
+    kArTraceRWLockReadGet = 28,     //!< arg=status, data=reader-writer lock
+    kArTraceRWLockReadPut = 29,     //!< arg=status, data=reader-writer lock
+    kArTraceRWLockWriteGet = 30,    //!< arg=status, data=reader-writer lock
+    kArTraceRWLockWritePut = 31,    //!< arg=status, data=reader-writer lock
+    kArTraceStreamBufferWrite = 32, //!< arg=status, data=stream buffer
+    kArTraceStreamBufferRead = 33,  //!< arg=status, data=stream buffer
+    kArTraceMessageBufferSend = 34, //!< arg=status, data=message buffer
+    kArTraceMessageBufferReceive = 35, //!< arg=status, data=message buffer
+    kArTraceSeqlockWrite = 36,      //!< arg=status, data=seqlock
+    kArTraceSeqlockRead = 37,       //!< arg=status, data=seqlock
+    kArTraceRcuSynchronize = 38,    //!< arg=status, data=thread
+};
+
+//! @brief Object types for #kArTraceObjectCreated and #kArTraceObjectDeleted events.
+enum _ar_trace_object_types
+{
+    kArTraceThreadObject = 0,
+    kArTraceSemaphoreObject = 1,
+    kArTraceMutexObject = 2,
+    kArTraceQueueObject = 3,
+    kArTraceChannelObject = 4,
+    kArTraceTimerObject = 5,
+    kArTraceRunLoopObject = 6,
+    kArTraceEventFlagsObject = 7,
+    kArTraceCondVarObject = 8,
+    kArTraceRWLockObject = 9,
+    kArTraceStreamBufferObject = 10,
+    kArTraceMessageBufferObject = 11,
+    kArTraceSeqlockObject = 12,
 };
 
+//! @brief One kernel trace event.
+typedef struct _ar_trace_record {
+    uint32_t m_header;  //!< Event ID in bits 31-24, argument in 23-16, low microseconds in 15-0.
+    uint32_t m_data;    //!< Event data value.
+} ar_trace_record_t;
+
+//! @brief In-memory ring of kernel trace events.
+//!
+//! Writers reserve a record by atomically incrementing #m_head, so recording an event never
+//! blocks. Once the ring is full the oldest records are overwritten. The record for event
+//! number N is at index N modulo #m_size. The host decoder locates the buffer in a memory dump
+//! by its #m_magic value.
+typedef struct _ar_trace_buffer {
+    static const uint32_t kMagic = 0x63727461;   //!< 'atrc' in little endian.
+    static const uint32_t kVersion = 1;         //!< Layout version.
+
+    uint32_t m_magic;                   //!< Always #kMagic.
+    uint32_t m_version;                 //!< Always #kVersion.
+    uint32_t m_size;                    //!< Number of records in the ring.
+    volatile uint32_t m_head;           //!< Total number of records reserved.
+    volatile uint32_t m_lastTime;       //!< Low 32 bits of the microsecond time of a recent record.
+    ar_trace_record_t m_records[AR_TRACE_BUFFER_SIZE];  //!< The ring.
+} ar_trace_buffer_t;
+
+//! @brief The deferred action function pointer.
+//!
+//! The count is the number of identical posts the call stands for, so that for instance a
+//! burst of semaphore puts from an interrupt becomes one put of the whole burst. Actions for
+//! which running more than once has no further effect can ignore it.
+typedef ar_status_t (*ar_deferred_action_t)(void * object, void * arg, uint32_t count);
+
 //! @brief Queue containing deferred actions.
 //!
 //! The deferred action queue is used to postpone kernel operations performed in interrupt context
-//! until the scheduler runs, in the lowest possible interrupt priority. This is part of the
-//! support for never disabling interrupts on Cortex-M.
+//! while the kernel is locked, until the scheduler runs in the lowest possible interrupt priority.
+//! This is part of the support for never disabling interrupts on Cortex-M.
+//!
+//! Each entry is composed of a function pointer, an object, and an argument. The function pointer
+//! points to a very small deferred action stub function that simply calls the right kernel object
+//! operation routine with the correct parameters.
+//!
+//! Entries are reserved by interrupts with atomic operations, so any number of interrupts may
+//! post concurrently. An entry is published by setting its count last. The scheduler is the
+//! only consumer, and it claims an entry by atomically clearing its count. Because the scheduler
+//! runs at the lowest priority, every reserved entry has been published by the time it runs.
 //!
-//! The deferred actions enqueued in this queue are composed of a function pointer and object
-//! value. The function pointer points to a very small deferred action stub function that simply
-//! calls the right kernel object operation routine with the correct parameters. If a deferred
-//! action requires two parameters, a special #kActionExtraValue constant can be inserted
-//! in the queue to mark an entry as holding the second parameter for the previous action.
+//! When an action is posted that is identical to the most recent published entry, that entry's
+//! count is incremented instead of reserving a new one, and the action is run once with the
+//! count. Each entry's count shares a word with a generation number that the scheduler bumps
+//! when it claims the entry. An interrupt that read the entry's fields before it was claimed
+//! and filled in again then fails to merge, because its compare and swap expects the old
+//! generation.
 typedef struct _ar_deferred_action_queue {
-    //! @brief Constant used to mark an action queue entry as containing an extra argument for the
-    //!     previous action.
-    static const uint32_t kActionExtraValue = 0xfeedf00d;
-
-    //! @brief The deferred action function pointer.
-    typedef void (*deferred_action_t)(void * object, void * object2);
+    //! @brief Mask for wrapping queue indexes.
+    static const int32_t kIndexMask = AR_DEFERRED_ACTION_QUEUE_SIZE - 1;
 
     volatile int32_t m_count;   //!< Number of queue entries.
     volatile int32_t m_first;   //!< First entry index.
-    volatile int32_t m_last;    //!< Last entry index.
+    volatile int32_t m_last;    //!< Index following the last entry.
+    volatile int32_t m_highWater;   //!< Maximum number of entries ever in the queue.
+    volatile int32_t m_coalesced;   //!< Number of actions merged into an existing entry.
+    volatile int32_t m_overflows;   //!< Number of actions dropped because the queue was full.
+    //! @brief Mask for the count in an entry's state.
+    static const uint32_t kCountMask = 0xffff;
+
+    //! @brief Amount added to an entry's state to advance its generation.
+    static const uint32_t kGenerationIncrement = kCountMask + 1;
+
     struct _ar_deferred_action_queue_entry {
-        deferred_action_t action; //!< Enqueued action.
-        void * object;    //!< Kernel object or parameter for enqueued action.
+        ar_deferred_action_t m_action;  //!< Enqueued action.
+        void * m_object;                //!< Kernel object for enqueued action.
+        void * m_arg;                   //!< Extra argument for enqueued action.
+        volatile int32_t m_state;       //!< Generation in the upper bits, and the number of posts in the lower bits, or 0 if not published.
     } m_entries[AR_DEFERRED_ACTION_QUEUE_SIZE]; //!< The deferred action queue entries.
 
     //! @brief Returns whether the queue is currently empty.
     bool isEmpty() const { return m_count == 0; }
 
-    //! @brief Enqueues a new deferred action.
-    ar_status_t post(deferred_action_t action, void * object);
+    //! @brief Adds an action to the queue.
+    //! @retval #kArSuccess The action was enqueued.
+    //! @retval #kArQueueFullError There is no room in the queue.
+    ar_status_t insert(ar_deferred_action_t action, void * object, void * arg);
+
+    //! @brief Runs and removes the first entry in the queue, which must not be empty.
+    void runFirst();
+} ar_deferred_action_queue_t;
+
+//! @brief Deferred actions, with a queue for each band of interrupt priorities.
+//!
+//! Actions posted from interrupts in the same priority band run in the order they were posted.
+//! Bands of more urgent interrupt priorities are run first. Giving each band its own queue means
+//! a storm of interrupts at one priority cannot use up the room needed by interrupts at another.
+typedef struct _ar_deferred_actions {
+    ar_deferred_action_queue_t m_queues[AR_DEFERRED_ACTION_QUEUE_COUNT];    //!< Queue for each priority band.
+    ar_deferred_node_t * volatile m_pendingNodes;   //!< Nodes posted while their band's queue was full, most recent first.
+
+    //! @brief Returns whether all queues are empty.
+    bool isEmpty() const;
+
+    //! @brief Runs an action from interrupt context, or enqueues it if the kernel is locked.
+    //!
+    //! @return The action's status if it was run immediately, otherwise #kArSuccess if it was
+    //!     enqueued or #kArQueueFullError if the queue has no room.
+    ar_status_t post(ar_deferred_action_t action, void * object, void * arg=NULL);
+
+    //! @brief Posts an object's own action, which is never dropped.
+    //!
+    //! If the queue has no room, the node is linked onto #m_pendingNodes instead. The node's
+    //! action must not fail with #kArQueueFullError.
+    void post(ar_deferred_node_t * node);
+
+    //! @brief Runs all queued actions, most urgent band first, then the pending nodes.
+    void run();
+} ar_deferred_actions_t;
+
+//! @brief Callback used to iterate over threads.
+//! @return Return true to continue iterating, or false to stop.
+typedef bool (*ar_thread_iterator_t)(ar_thread_t * thread, void * param);
+
+/*!
+ * @brief Queue of threads that are ready to run.
+ *
+ * If #AR_ENABLE_READY_QUEUE_BITMAP is set, there is a separate FIFO list for each of the 256
+ * thread priority levels. Each level has a bit in a 256-bit bitmap that is set when the level
+ * is not empty, and each of the eight words of the bitmap has a bit in a summary word. Finding
+ * the highest priority ready thread takes just two count leading zeroes operations.
+ *
+ * Otherwise, the ready threads are kept in a single list sorted by priority.
+ *
+ * In both cases, the thread's m_threadNode is used to link the thread into the queue.
+ */
+typedef struct _ar_ready_list {
+#if AR_ENABLE_READY_QUEUE_BITMAP
+    uint32_t m_summary;                 //!< Bit n is set if word n of the bitmap is non-zero.
+    uint32_t m_bitmap[8];               //!< Bit n is set if there are ready threads with priority n.
+    ar_list_node_t * m_levels[256];     //!< Head of the circular list of threads for each priority.
+#else // AR_ENABLE_READY_QUEUE_BITMAP
+    ar_list_t m_list;                   //!< Ready threads sorted by priority.
+#endif // AR_ENABLE_READY_QUEUE_BITMAP
+
+    //! @brief Return whether there are no ready threads.
+    inline bool isEmpty() const;
+
+    //! @brief Add a thread to the end of the list for its priority.
+    void add(ar_thread_t * thread);
+
+    //! @brief Remove a thread.
+    //!
+    //! The thread's priority must not have changed since it was added.
+    void remove(ar_thread_t * thread);
+
+    //! @brief Returns the first thread of the highest priority that is ready.
+    ar_thread_t * getHighest();
+
+    //! @brief Returns whether more than one thread is ready at the highest priority.
+    bool hasMultipleAtHighest();
+
+    //! @brief Invoke a callback for each ready thread.
+    bool iterate(ar_thread_iterator_t iterator, void * param);
+} ar_ready_list_t;
+
+/*!
+ * @brief Queue of threads waiting for a wakeup time.
+ *
+ * Holds threads that are sleeping as well as blocked threads with a timeout.
+ *
+ * If #AR_ENABLE_TIMING_WHEEL is set, the queue is a hierarchical timing wheel. The wheel works
+ * in units of 1024 µs (about a millisecond). Level 0 has one slot per unit for the next 32
+ * units, and wakeups within a slot are compared at full microsecond precision. Each higher
+ * level has slots 32 times wider than the level below, and a slot's threads are redistributed
+ * to lower levels when the wheel time reaches the start of the slot. Wakeups beyond the top
+ * level are held on an overflow list that is redistributed each time the top level wraps. Each
+ * level has a bitmap of non-empty slots, so the next slot with work to do is found without
+ * scanning.
+ *
+ * Otherwise, the threads are kept in a single list sorted by wakeup time.
+ *
+ * In both cases, the thread's m_threadNode is used to link the thread into the queue.
+ */
+typedef struct _ar_sleep_queue {
+#if AR_ENABLE_TIMING_WHEEL
+    enum
+    {
+        kSlotBits = 5,                                  //!< Log2 of the number of slots per level.
+        kSlotCount = 1 << kSlotBits,                    //!< Number of slots per level.
+        kLevelCount = 4,                                //!< Number of wheel levels.
+        kOverflowSlot = kLevelCount * kSlotCount,       //!< Slot index of the overflow list.
+        kUnitShift = 10,                                //!< Log2 of the microseconds per level 0 slot.
+    };
+
+    uint64_t m_time;                                //!< Microsecond time up to which the wheel has been advanced.
+    uint32_t m_occupied[kLevelCount];               //!< Bit (31 - n) is set if slot n of the level is non-empty.
+    ar_list_node_t * m_slots[kOverflowSlot + 1];    //!< Head of the circular list of threads for each slot.
+#else // AR_ENABLE_TIMING_WHEEL
+    ar_list_t m_list;                               //!< Sleeping threads sorted by wakeup time.
+#endif // AR_ENABLE_TIMING_WHEEL
+
+    //! @brief Add a thread whose m_wakeupTime has been set.
+    void add(ar_thread_t * thread);
+
+    //! @brief Remove a thread before its wakeup time has arrived.
+    void remove(ar_thread_t * thread);
+
+    //! @brief Remove all threads whose wakeup time is at or before the given time.
+    bool advance(uint64_t time, ar_thread_iterator_t expired, void * param);
+
+    //! @brief Returns the microsecond time at which the queue next needs to be advanced.
+    uint64_t getNextWakeup();
 
-    //! @brief Enqueues a new deferred action with two arguments.
-    ar_status_t post(deferred_action_t action, void * object, void * arg);
+    //! @brief Invoke a callback for each thread in the queue.
+    bool iterate(ar_thread_iterator_t iterator, void * param);
 
+#if AR_ENABLE_TIMING_WHEEL
 protected:
-    //! @brief Reserves room to insert a number of new entries.
-    //! @return First index in queue where the requested number of entries can be inserted. If there
-    //!     is not room in the queue for the requested entries, then -1 is returned.
-    int32_t insert(int32_t entryCount);
-} ar_deferred_action_queue_t;
+    //! @brief Insert a thread into the slot for a wakeup time relative to a base time.
+    void insert(ar_thread_t * thread, uint64_t wakeup, uint64_t base);
+
+    //! @brief Remove and return the list of threads in a slot.
+    ar_list_node_t * detach(uint32_t index);
+#endif // AR_ENABLE_TIMING_WHEEL
+} ar_sleep_queue_t;
 
 /*!
  * @brief Argon kernel state.
  */
 typedef struct _ar_kernel {
     ar_thread_t * currentThread;    //!< The currently running thread.
-    ar_list_t readyList;            //!< List of threads ready to run.
+    ar_ready_list_t readyList;      //!< Threads ready to run.
     ar_list_t suspendedList;        //!< List of suspended threads.
-    ar_list_t sleepingList;         //!< List of sleeping threads.
+    ar_sleep_queue_t sleepingList;  //!< Sleeping threads and blocked threads with a timeout.
     struct _ar_kernel_flags {
         uint32_t isRunning:1;           //!< True if the kernel has been started.
         uint32_t needsReschedule:1;     //!< True if we need to reschedule once the kernel is unlocked.
@@ -136,17 +374,23 @@ typedef struct _ar_kernel {
         uint32_t _reservedFlags:28;
     } flags;                        //!< Kernel flags.
     uint32_t version;               //!< Argon version in BCD, same as #AR_VERSION.
-    ar_deferred_action_queue_t deferredActions; //!< Actions deferred from interrupt context.
+    ar_deferred_actions_t deferredActions; //!< Actions deferred from interrupt context.
     volatile int32_t lockCount;     //!< Whether the kernel is locked.
-    volatile uint32_t tickCount;    //!< Current tick count.
-    int32_t missedTickCount;        //!< Number of ticks that occurred while the kernel was locked.
-    uint32_t nextWakeup;            //!< Time of the next wakeup event.
+    uint64_t nextWakeup;            //!< Microsecond time of the next wakeup event.
     uint32_t threadIdCounter;       //!< Counter for generating unique thread IDs.
 #if AR_ENABLE_SYSTEM_LOAD
-    uint64_t lastLoadStart;         //!< Microseconds timestamp for last load computation start.
-    uint64_t lastSwitchIn;          //!< Microseconds timestamp when current thread was switched in.
-    uint32_t systemLoad;            //!< Per mille of system load from 0-1000.
+    uint64_t lastLoadStart;         //!< Cycle timestamp for last load computation start.
+    uint64_t lastSwitchIn;          //!< Cycle timestamp when current thread was switched in.
+    uint64_t loadPeriodCycles;      //!< Length of the load computation period in cycles.
+    uint64_t loadScale;             //!< Converts cycles in a load period to fixed point per mille, times 2^32.
+    uint32_t loadPeriod;            //!< Number of load computation periods since the kernel started.
+    uint32_t loadDecay[kArLoadAverageCount]; //!< Fixed point decay factor applied to each load average per period.
 #endif // AR_ENABLE_SYSTEM_LOAD
+#if AR_ENABLE_RCU
+    uint32_t rcuGeneration;         //!< Number of RCU grace periods started. The low bit selects the reader count for new readers.
+    uint32_t rcuReaderCounts[2];    //!< Number of threads counted as readers in each of the last two grace periods.
+    ar_list_t rcuWaitingList;       //!< Threads waiting in ar_rcu_synchronize().
+#endif // AR_ENABLE_RCU
     ar_thread_t idleThread;         //!< The lowest priority thread in the system. Executes only when no other threads are ready.
 } ar_kernel_t;
 
@@ -160,6 +404,12 @@ typedef struct _ar_all_objects {
     ar_list_t queues;           //!< All existing queues.
     ar_list_t timers;           //!< All existing timers.
     ar_list_t runloops;         //!< All existing runloops.
+    ar_list_t eventFlags;       //!< All existing event flags groups.
+    ar_list_t condvars;         //!< All existing condition variables.
+    ar_list_t rwlocks;          //!< All existing reader-writer locks.
+    ar_list_t streamBuffers;    //!< All existing stream buffers.
+    ar_list_t messageBuffers;   //!< All existing message buffers.
+    ar_list_t seqlocks;         //!< All existing seqlocks.
 } ar_all_objects_t;
 
 extern ar_all_objects_t g_ar_objects;
@@ -176,25 +426,62 @@ extern ar_kernel_t g_ar;
 void ar_port_init_system();
 void ar_port_init_tick_timer();
 void ar_port_set_timer_delay(bool enable, uint32_t delay_us);
-uint32_t ar_port_get_timer_elapsed_us();
 void ar_port_prepare_stack(ar_thread_t * thread, uint32_t stackSize, void * param);
 void ar_port_service_call();
 bool ar_port_get_irq_state();
+bool ar_port_atomic_cas_pointer(void * volatile * value, void * expectedValue, void * newValue);
 //@}
 
 //! @name Kernel internals
 //@{
-bool ar_kernel_increment_tick_count(unsigned ticks);
+bool ar_kernel_process_wakeups();
 void ar_kernel_enter_scheduler();
 void ar_kernel_run_deferred_actions();
 void ar_kernel_scheduler();
 void ar_kernel_update_round_robin();
-uint32_t ar_kernel_get_next_wakeup_time();
-void ar_kernel_run_timers(ar_list_t & timersList);
+uint64_t ar_kernel_get_next_wakeup_time();
+bool ar_kernel_iterate_list(ar_list_t & list, ar_thread_iterator_t iterator, void * param);
+void ar_kernel_iterate_threads(ar_thread_iterator_t iterator, void * param);
+void ar_kernel_run_timers(ar_timer_heap_t & timers);
+#if AR_ENABLE_SYSTEM_LOAD
+void ar_kernel_update_thread_load(ar_thread_t * thread);
+#endif // AR_ENABLE_SYSTEM_LOAD
 int32_t ar_kernel_atomic_queue_insert(int32_t entryCount, volatile int32_t & qCount, volatile int32_t & qTail, int32_t qSize);
 void ar_runloop_wake(ar_runloop_t * runloop);
 //@}
 
+//! @name Mutex internals
+//@{
+//! @brief Raise a mutex owner's priority to that of a thread waiting for the mutex.
+void ar_mutex_hoist_owner(ar_mutex_t * mutex, ar_thread_t * thread);
+
+//! @brief Block until a mutex is unlocked and take ownership of it.
+ar_status_t ar_mutex_acquire(ar_mutex_t * mutex, uint32_t timeout);
+
+//! @brief Give up ownership of a mutex whose lock count has reached zero.
+void ar_mutex_release(ar_mutex_t * mutex);
+//@}
+
+#if AR_ENABLE_RCU
+//! @name RCU internals
+//@{
+//! @brief Count or uncount a thread as an RCU reader, according to its nesting depth.
+void ar_rcu_note_thread(ar_thread_t * thread);
+
+//! @brief Stop counting a thread as an RCU reader and wake grace period waiters if needed.
+void ar_rcu_remove_reader(ar_thread_t * thread);
+//@}
+#endif // AR_ENABLE_RCU
+
+//! @name Priority inheritance
+//@{
+//! @brief Raise the priority of a thread holding a lock to that of a waiting thread.
+void ar_thread_hoist_priority(ar_thread_t * thread, uint8_t priority, uint8_t & originalPriority);
+
+//! @brief Restore the priority of a thread releasing a lock, if it was raised.
+void ar_thread_restore_priority(ar_thread_t * thread, uint8_t & originalPriority);
+//@}
+
 //! @name Thread entry point wrapper
 //@{
 //! @brief Thread entry point.
@@ -208,44 +495,55 @@ bool ar_thread_sort_by_priority(ar_list_node_t * a, ar_list_node_t * b);
 
 //! @brief Sort thread list by ascending wakeup time.
 bool ar_thread_sort_by_wakeup(ar_list_node_t * a, ar_list_node_t * b);
-
-//! @brief Sort timer list by ascending wakeup time.
-bool ar_timer_sort_by_wakeup(ar_list_node_t * a, ar_list_node_t * b);
 //@}
 
 //! @name Interrupt handlers
 //@{
 extern "C" void ar_kernel_periodic_timer_isr(void);
-extern "C" uint32_t ar_kernel_yield_isr(uint32_t topOfStack);
+extern "C" uintptr_t ar_kernel_yield_isr(uintptr_t topOfStack);
 //@}
 
 #if AR_ENABLE_TRACE
 //! @name Kernel trace
 //@{
-//! @brief
-WEAK void ar_trace_init();
+extern ar_trace_buffer_t g_ar_trace;
+
+//! @brief Start a new trace.
+void ar_trace_init();
 
-//! @brief
-WEAK void ar_trace_1(uint8_t eventID, uint32_t data);
+//! @brief Record one trace event. Safe to call from any context.
+void ar_trace_event(uint8_t eventID, uint8_t arg, uint32_t data);
 
-//! @brief
-WEAK void ar_trace_2(uint8_t eventID, uint32_t data0, void * data1);
+//! @brief Record the creation of a kernel object and its name.
+void ar_trace_created(uint8_t objectType, const volatile void * object, const char * name);
+
+//! @brief Record an event whose data is an object or function address.
+static inline void ar_trace_object(uint8_t eventID, uint8_t arg, const volatile void * object)
+{
+    ar_trace_event(eventID, arg, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(object)));
+}
 //@}
 #else
 static inline ALWAYS_INLINE void ar_trace_init() {}
-static inline ALWAYS_INLINE void ar_trace_1(uint8_t eventID, uint32_t data) {}
-static inline ALWAYS_INLINE void ar_trace_2(uint8_t eventID, uint32_t data0, void * data1) {}
+static inline ALWAYS_INLINE void ar_trace_event(uint8_t eventID, uint8_t arg, uint32_t data) {}
+static inline ALWAYS_INLINE void ar_trace_created(uint8_t objectType, const volatile void * object, const char * name) {}
+static inline ALWAYS_INLINE void ar_trace_object(uint8_t eventID, uint8_t arg, const volatile void * object) {}
 #endif // AR_ENABLE_TRACE
 
 // Inline list method implementation.
 inline bool _ar_list::isEmpty() const { return m_head == NULL; }
 inline void _ar_list::add(ar_thread_t * item) { add(&item->m_threadNode); }
-inline void _ar_list::add(ar_timer_t * item) { add(&item->m_activeNode); }
 inline void _ar_list::add(ar_queue_t * item) { add(&item->m_runLoopNode); }
 inline void _ar_list::remove(ar_thread_t * item) { remove(&item->m_threadNode); }
-inline void _ar_list::remove(ar_timer_t * item) { remove(&item->m_activeNode); }
 inline void _ar_list::remove(ar_queue_t * item) { remove(&item->m_runLoopNode); }
 
+// Inline ready list method implementation.
+#if AR_ENABLE_READY_QUEUE_BITMAP
+inline bool _ar_ready_list::isEmpty() const { return m_summary == 0; }
+#else // AR_ENABLE_READY_QUEUE_BITMAP
+inline bool _ar_ready_list::isEmpty() const { return m_list.isEmpty(); }
+#endif // AR_ENABLE_READY_QUEUE_BITMAP
+
 /*!
  * @brief Utility class to temporarily lock or unlock the kernel.
  *
@@ -291,6 +589,38 @@ public:
 typedef KernelGuard<true> KernelLock;       //!< Lock kernel.
 typedef KernelGuard<false> KernelUnlock;    //!< Unlock kernel.
 
+/*!
+ * @brief Utility class to lock the kernel from an interrupt, only if it is unlocked.
+ *
+ * Unlike KernelLock, this never nests. If the kernel is already locked by a thread, the
+ * scheduler, or a lower priority interrupt, nothing is done and isLocked() returns false.
+ */
+class KernelTryLock
+{
+public:
+    //! @brief Locks the kernel if it is unlocked.
+    KernelTryLock() : m_isLocked(ar_atomic_cas32(&g_ar.lockCount, 0, 1)) {}
+
+    //! @brief Unlocks the kernel if it was locked, entering the scheduler if required.
+    ~KernelTryLock()
+    {
+        if (m_isLocked)
+        {
+            ar_atomic_add32(&g_ar.lockCount, -1);
+            if (g_ar.lockCount == 0 && g_ar.flags.needsReschedule && !g_ar.flags.isRunningDeferred)
+            {
+                ar_kernel_enter_scheduler();
+            }
+        }
+    }
+
+    //! @brief Returns whether this object locked the kernel.
+    bool isLocked() const { return m_isLocked; }
+
+protected:
+    bool m_isLocked;    //!< Whether the kernel was locked.
+};
+
 #endif // _AR_INTERNAL_H_
 //------------------------------------------------------------------------------
 // EOF
@@ -37,19 +37,34 @@
 
 using namespace Ar;
 
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+#if (AR_DEFERRED_ACTION_QUEUE_SIZE & (AR_DEFERRED_ACTION_QUEUE_SIZE - 1))
+#error "AR_DEFERRED_ACTION_QUEUE_SIZE must be a power of two"
+#endif
+
 //------------------------------------------------------------------------------
 // Prototypes
 //------------------------------------------------------------------------------
 
 static void THREAD_STACK_OVERFLOW_DETECTED();
-static void DEFERRED_ACTION_QUEUE_OVERFLOW_DETECTED();
 
 static void idle_entry(void * param);
 
 #if AR_ENABLE_SYSTEM_LOAD
-static void ar_kernel_update_thread_loads();
+static void ar_kernel_init_load();
+static uint32_t ar_kernel_load_decay(uint32_t horizon);
 #endif // AR_ENABLE_SYSTEM_LOAD
 
+static bool ar_kernel_wake_thread(ar_thread_t * thread, void * param);
+
+#if AR_ENABLE_READY_QUEUE_BITMAP || AR_ENABLE_TIMING_WHEEL
+static bool ar_kernel_list_append(ar_list_node_t *& head, ar_list_node_t * item);
+static bool ar_kernel_list_unlink(ar_list_node_t *& head, ar_list_node_t * item);
+#endif // AR_ENABLE_READY_QUEUE_BITMAP || AR_ENABLE_TIMING_WHEEL
+
 //------------------------------------------------------------------------------
 // Variables
 //------------------------------------------------------------------------------
@@ -59,22 +74,35 @@ static void ar_kernel_update_thread_loads();
 //! @internal
 //! The initializer for this struct sets the readyList and sleepingList sort
 //! predicates so that those lists will be properly sorted when populated by
-//! threads created through static initialization. Although static initialization
+//! threads created through static initialization. (The lists only have predicates
+//! when #AR_ENABLE_READY_QUEUE_BITMAP or #AR_ENABLE_TIMING_WHEEL are disabled.) Although static initialization
 //! order is not guaranteed, we can be sure that initialization of `g_ar` from
 //! .rodata will happen before static initializers are called.
 //!
 //! (Unfortunately we can't use C-style designated initializers until C++20.)
 ar_kernel_t g_ar = {
         0,                                  // currentThread,
+#if AR_ENABLE_READY_QUEUE_BITMAP
+        { 0 },                              // readyList
+#else // AR_ENABLE_READY_QUEUE_BITMAP
         {                                   // readyList
-            0,                                  // m_head
-            ar_thread_sort_by_priority,         // m_predicate
+            {                                   // m_list
+                0,                                  // m_head
+                ar_thread_sort_by_priority,         // m_predicate
+            },
         },
+#endif // AR_ENABLE_READY_QUEUE_BITMAP
         { 0 },                              // suspendedList
+#if AR_ENABLE_TIMING_WHEEL
+        { 0 },                              // sleepingList
+#else // AR_ENABLE_TIMING_WHEEL
         {                                   // sleepingList
-            0,                                  // m_head
-            ar_thread_sort_by_wakeup,           // m_predicate
+            {                                   // m_list
+                0,                                  // m_head
+                ar_thread_sort_by_wakeup,           // m_predicate
+            },
         },
+#endif // AR_ENABLE_TIMING_WHEEL
         { 0 },                              // flags
         AR_VERSION,                         // version
         // the rest...
@@ -104,7 +132,7 @@ static void idle_entry(void * param)
 {
     while (1)
     {
-        while (g_ar.tickCount < g_ar.nextWakeup)
+        while (ar_get_microseconds() < g_ar.nextWakeup)
         {
         }
 
@@ -148,7 +176,7 @@ void ar_kernel_enter_scheduler()
 void ar_kernel_run(void)
 {
     // Assert if there is no thread ready to run.
-    assert(g_ar.readyList.m_head);
+    assert(!g_ar.readyList.isEmpty());
 
     // Init some misc fields.
     // Note: we do _not_ init threadIdCounter since it will already have been incremented
@@ -158,15 +186,7 @@ void ar_kernel_run(void)
     g_ar.flags.isRunningDeferred = false;
     g_ar.flags.needsRoundRobin = false;
     g_ar.nextWakeup = 0;
-    g_ar.deferredActions.m_count = 0;
-    g_ar.deferredActions.m_first = 0;
-    g_ar.deferredActions.m_last = 0;
-
-#if AR_ENABLE_SYSTEM_LOAD
-    g_ar.lastLoadStart = ar_get_microseconds();
-    g_ar.lastSwitchIn = 0;
-    g_ar.systemLoad = 0;
-#endif // AR_ENABLE_SYSTEM_LOAD
+    memset(&g_ar.deferredActions, 0, sizeof(g_ar.deferredActions));
 
     // Create the idle thread. Priority 1 is passed to init function to pass the
     // assertion and then set to the correct 0 manually.
@@ -177,6 +197,11 @@ void ar_kernel_run(void)
     // Set up system tick timer
     ar_port_init_tick_timer();
 
+#if AR_ENABLE_SYSTEM_LOAD
+    // The cycle counter is started along with the tick timer.
+    ar_kernel_init_load();
+#endif // AR_ENABLE_SYSTEM_LOAD
+
     // Init port.
     ar_port_init_system();
 
@@ -203,29 +228,45 @@ void ar_kernel_periodic_timer_isr()
         return;
     }
 
-    // If the kernel is locked, record that we missed this tick and come back as soon
-    // as the kernel gets unlocked.
-    if (g_ar.lockCount)
+#if AR_ENABLE_TICKLESS_IDLE
+    // The wakeup time may not have been reached yet if the delay was longer than the timer
+    // can count. In that case, just restart the timer for the remaining time.
+    uint64_t now = ar_get_microseconds();
+    if (g_ar.nextWakeup > now)
+    {
+        uint64_t delay = g_ar.nextWakeup - now;
+        ar_port_set_timer_delay(true, delay > 0xffffffffu ? 0xffffffffu : static_cast<uint32_t>(delay));
+        return;
+    }
+
+    // Force the scheduler to program the timer for the next wakeup.
+    g_ar.nextWakeup = 0;
+#endif // AR_ENABLE_TICKLESS_IDLE
+
+    // Lock the kernel so higher priority interrupts can't modify it directly while wakeups are
+    // processed. If the kernel is already locked, come back as soon as it gets unlocked.
+    // Elapsed time is processed then.
+    KernelTryLock guard;
+    if (!guard.isLocked())
     {
-        ar_atomic_add32(&g_ar.missedTickCount, 1);
         g_ar.flags.needsReschedule = true;
         return;
     }
 
 #if AR_ENABLE_TICKLESS_IDLE
-    // Get the elapsed time since the last timer tick.
-    uint32_t us = ar_port_get_timer_elapsed_us();
-    uint32_t elapsed_ticks = us / (kSchedulerQuanta_ms * 1000);
+    // Always run the scheduler, so the timer is reprogrammed.
+    ar_kernel_process_wakeups();
+    g_ar.flags.needsReschedule = true;
 #else // AR_ENABLE_TICKLESS_IDLE
-    uint32_t elapsed_ticks = 1;
-#endif // AR_ENABLE_TICKLESS_IDLE
-
     // Process elapsed time. Invoke the scheduler if any threads were woken or if
     // round robin scheduling is in effect.
-    if (ar_kernel_increment_tick_count(elapsed_ticks) || g_ar.flags.needsRoundRobin)
+    if (ar_kernel_process_wakeups() || g_ar.flags.needsRoundRobin)
     {
-        ar_port_service_call();
+        g_ar.flags.needsReschedule = true;
     }
+#endif // AR_ENABLE_TICKLESS_IDLE
+
+    // The scheduler is entered when the guard unlocks the kernel.
 }
 
 //! @param topOfStack This parameter should be the stack pointer of the thread that was
@@ -233,9 +274,12 @@ void ar_kernel_periodic_timer_isr()
 //! @return The value of the current thread's stack pointer is returned. If the scheduler
 //!     changed the current thread, this will be a different value from what was passed
 //!     in @a topOfStack.
-uint32_t ar_kernel_yield_isr(uint32_t topOfStack)
+uintptr_t ar_kernel_yield_isr(uintptr_t topOfStack)
 {
+    // Lock the kernel while the scheduler runs, so interrupts that preempt it defer their
+    // kernel operations instead of performing them directly.
     assert(!g_ar.lockCount);
+    ar_atomic_add32(&g_ar.lockCount, 1);
 
     // save top of stack for the thread we interrupted
     if (g_ar.currentThread)
@@ -243,149 +287,86 @@ uint32_t ar_kernel_yield_isr(uint32_t topOfStack)
         g_ar.currentThread->m_stackPointer = reinterpret_cast<uint8_t *>(topOfStack);
     }
 
-    // Handle any missed ticks.
-    {
-        uint32_t missedTicks = g_ar.missedTickCount;
-        while (!ar_atomic_cas32(&g_ar.missedTickCount, missedTicks, 0))
-        {
-            missedTicks = g_ar.missedTickCount;
-        }
-
-        if (missedTicks)
-        {
-            ar_kernel_increment_tick_count(missedTicks);
-        }
-    }
-
     // Process any deferred actions.
     ar_kernel_run_deferred_actions();
 
-#if AR_ENABLE_TICKLESS_IDLE
-    // Process elapsed time to keep tick count up to date.
-    uint32_t elapsed_ticks = ar_port_get_timer_elapsed_us() / (kSchedulerQuanta_ms * 1000);
-    ar_kernel_increment_tick_count(elapsed_ticks);
-#endif // AR_ENABLE_TICKLESS_IDLE
+    // Wake threads whose wakeup time has arrived, including any that came due while the
+    // kernel was locked.
+    ar_kernel_process_wakeups();
 
     // Run the scheduler. It will modify g_ar.currentThread if switching threads.
     ar_kernel_scheduler();
     g_ar.flags.needsReschedule = 0;
 
+    // Come straight back for any actions deferred by interrupts while the kernel was locked.
+    ar_atomic_add32(&g_ar.lockCount, -1);
+    if (!g_ar.deferredActions.isEmpty())
+    {
+        ar_port_service_call();
+    }
+
     // The idle thread prevents this condition.
     assert(g_ar.currentThread);
 
     // return the new thread's stack pointer
-    return (uint32_t)g_ar.currentThread->m_stackPointer;
+    return reinterpret_cast<uintptr_t>(g_ar.currentThread->m_stackPointer);
 }
 
-//! Increments the system tick count and wakes any sleeping threads whose wakeup time
-//! has arrived. If the thread's state is #kArThreadBlocked then its unblock status
-//! is set to #kArTimeoutError.
+//! Wakes any sleeping threads whose wakeup time has arrived. If the thread's state is
+//! #kArThreadBlocked then its unblock status is set to #kArTimeoutError.
 //!
-//! @param ticks The number of ticks that have elapsed. Normally this will only be 1,
-//!     and must be at least 1, but may be higher if interrupts are disabled for a
-//!     long time.
-//! @return Flag indicating whether any threads were modified.
-bool ar_kernel_increment_tick_count(unsigned ticks)
+//! @return Flag indicating whether any threads were modified. This is also true if the timing
+//! wheel redistributed threads between its levels, since the next wakeup time must then be
+//! recomputed by the scheduler.
+bool ar_kernel_process_wakeups()
 {
-//     assert(ticks > 0);
-
-    // Increment tick count.
-    g_ar.tickCount += ticks;
-
     // Compare against next wakeup time we previously computed.
-    if (g_ar.tickCount < g_ar.nextWakeup)
+    uint64_t now = ar_get_microseconds();
+    if (now < g_ar.nextWakeup)
     {
         return false;
     }
 
-    // Scan list of sleeping threads to see if any should wake up.
-    ar_list_node_t * node = g_ar.sleepingList.m_head;
-    bool wasThreadWoken = false;
+    // Wake any sleeping threads whose wakeup time has arrived.
+    return g_ar.sleepingList.advance(now, ar_kernel_wake_thread, NULL);
+}
 
-    if (node)
+//! @brief Sleep queue callback that moves a thread whose wakeup time has arrived to the ready list.
+bool ar_kernel_wake_thread(ar_thread_t * thread, void * param)
+{
+    // State-specific actions
+    switch (thread->m_state)
     {
-        do {
-            ar_thread_t * thread = node->getObject<ar_thread_t>();
-            ar_list_node_t * next = node->m_next;
-
-            // Is it time to wake this thread?
-            if (g_ar.tickCount >= thread->m_wakeupTime)
-            {
-                wasThreadWoken = true;
-
-                // State-specific actions
-                switch (thread->m_state)
-                {
-                    case kArThreadSleeping:
-                        // The thread was just sleeping.
-                        break;
-
-                    case kArThreadBlocked:
-                        // The thread has timed out waiting for a resource.
-                        thread->m_unblockStatus = kArTimeoutError;
-                        break;
-
-                    default:
-                        // Should not have threads in other states on this list!
-                        _halt();
-                }
+        case kArThreadSleeping:
+            // The thread was just sleeping.
+            break;
 
-                // Put thread in ready state.
-                g_ar.sleepingList.remove(thread);
-                thread->m_state = kArThreadReady;
-                g_ar.readyList.add(thread);
-                ar_kernel_update_round_robin();
-            }
-            // Exit loop if we hit a thread with a wakeup time in the future. The sleeping list
-            // is sorted, so there will be no further threads to handle in the list.
-            else
-            {
-                break;
-            }
+        case kArThreadBlocked:
+            // The thread has timed out waiting for a resource.
+            thread->m_unblockStatus = kArTimeoutError;
+            break;
 
-            node = next;
-        } while (g_ar.sleepingList.m_head && node != g_ar.sleepingList.m_head);
+        default:
+            // Should not have threads in other states on this list!
+            _halt();
     }
 
-    return wasThreadWoken;
+    // Put thread in ready state.
+    thread->m_state = kArThreadReady;
+    ar_trace_object(kArTraceThreadState, kArThreadReady, thread);
+    g_ar.readyList.add(thread);
+    ar_kernel_update_round_robin();
+    return true;
 }
 
 //! @brief Execute actions deferred from interrupt context.
 void ar_kernel_run_deferred_actions()
 {
-    // Kernel must not be locked. However, executing deferred actions will temporarily
-    // lock the kernel below.
-    assert(g_ar.lockCount == 0);
+    // Kernel must be locked only by the scheduler.
+    assert(g_ar.lockCount == 1);
 
     g_ar.flags.isRunningDeferred = 1;
-
-    // Pull actions from the head of the queue and execute them.
-    ar_deferred_action_queue_t & queue = g_ar.deferredActions;
-    int32_t i = queue.m_first;
-    while (!queue.isEmpty())
-    {
-        int32_t iPlusOne = i + 1;
-        if (iPlusOne >= AR_DEFERRED_ACTION_QUEUE_SIZE)
-        {
-            iPlusOne = 0;
-        }
-
-        ar_deferred_action_queue_t::_ar_deferred_action_queue_entry & entry = queue.m_entries[i];
-
-        // Ignore action entries that contain an extra argument value for the previous action.
-        if (reinterpret_cast<uint32_t>(entry.action) != ar_deferred_action_queue_t::kActionExtraValue)
-        {
-            assert(entry.action);
-            entry.action(entry.object, queue.m_entries[iPlusOne].object);
-        }
-
-        // Atomically remove the entry we just processed from the queue.
-        // This is the only code that modifies the m_first member of the queue.
-        i = iPlusOne;
-        ar_atomic_add32(&queue.m_count, -1);
-        queue.m_first = i;
-    }
-
+    g_ar.deferredActions.run();
     g_ar.flags.isRunningDeferred = 0;
 }
 
@@ -396,70 +377,183 @@ void THREAD_STACK_OVERFLOW_DETECTED()
 }
 
 #if AR_ENABLE_SYSTEM_LOAD
-//! Update the CPU load for all threads based on the current load accumulator values.
-//! Also updates the total system load.
-void ar_kernel_update_thread_loads()
+//! @brief Computes a fixed point load average decay factor.
+//!
+//! The factor is e^(-period/horizon), computed without floating point by squaring a Taylor
+//! series approximation of e^(-period/(horizon * 2^8)) eight times.
+//!
+//! @param horizon Time constant of the load average in microseconds.
+//! @return Factor to multiply a load average by each sampling period, with
+//!     #kLoadAverageShift fractional bits.
+uint32_t ar_kernel_load_decay(uint32_t horizon)
 {
-    // Scan threads in all states in a way that doesn't depend on g_ar_objects.
-    ar_list_t * const threadLists[] = {
-#if AR_GLOBAL_OBJECT_LISTS
-        &g_ar_objects.threads
-#else
-        &g_ar.readyList, &g_ar.suspendedList, &g_ar.sleepingList
-#endif // AR_GLOBAL_OBJECT_LISTS
-    };
-    uint32_t i = 0;
-    for (; i < ARRAY_SIZE(threadLists); ++i)
+    const uint32_t kShift = 30;
+    const uint64_t kOne = 1ull << kShift;
+    uint64_t x = (static_cast<uint64_t>(AR_SYSTEM_LOAD_SAMPLE_PERIOD) << (kShift - 8)) / horizon;
+    if (x >= kOne)
+    {
+        return 0;
+    }
+    uint64_t e = kOne - x + ((x * x) >> (kShift + 1));
+    for (uint32_t i = 0; i < 8; ++i)
     {
-        if (!threadLists[i]->isEmpty())
+        e = (e * e) >> kShift;
+    }
+    return static_cast<uint32_t>(e >> (kShift - kLoadAverageShift));
+}
+
+//! @brief Sets up load accounting once the cycle counter is running.
+void ar_kernel_init_load()
+{
+    g_ar.loadPeriodCycles = static_cast<uint64_t>(ar_get_cycles_per_second()) * AR_SYSTEM_LOAD_SAMPLE_PERIOD / 1000000;
+    g_ar.loadScale = (1000ull << (32 + kLoadAverageShift)) / g_ar.loadPeriodCycles;
+    g_ar.loadPeriod = 0;
+    g_ar.loadDecay[kArLoadAverageShort] = ar_kernel_load_decay(AR_SYSTEM_LOAD_SHORT_HORIZON);
+    g_ar.loadDecay[kArLoadAverageMedium] = ar_kernel_load_decay(AR_SYSTEM_LOAD_MEDIUM_HORIZON);
+    g_ar.loadDecay[kArLoadAverageLong] = ar_kernel_load_decay(AR_SYSTEM_LOAD_LONG_HORIZON);
+    g_ar.lastLoadStart = ar_get_cycles();
+    g_ar.lastSwitchIn = g_ar.lastLoadStart;
+
+    // Start the system load averages at zero by treating the idle thread as having always run.
+    for (uint32_t i = 0; i < kArLoadAverageCount; ++i)
+    {
+        g_ar.idleThread.m_loadAverages[i] = 1000 << kLoadAverageShift;
+    }
+}
+
+//! @brief Raises a load average decay factor to a power.
+//!
+//! Uses repeated squaring, so the cost grows with the number of bits in @a count rather than
+//! with @a count itself.
+//!
+//! @param decay Decay factor with #kLoadAverageShift fractional bits.
+//! @param count Exponent.
+//! @return @a decay to the power of @a count, with #kLoadAverageShift fractional bits.
+static uint32_t ar_kernel_load_decay_power(uint32_t decay, uint32_t count)
+{
+    uint32_t result = 1 << kLoadAverageShift;
+    while (count && result)
+    {
+        if (count & 1)
         {
-            ar_list_node_t * node = threadLists[i]->m_head;
-            do {
-                ar_thread_t * thread = node->getObject<ar_thread_t>();
-                thread->m_permilleCpu = 1000 * thread->m_loadAccumulator / AR_SYSTEM_LOAD_SAMPLE_PERIOD;
-                thread->m_loadAccumulator = 0;
-                node = node->m_next;
-            } while (node != threadLists[i]->m_head);
+            result = (static_cast<uint64_t>(result) * decay) >> kLoadAverageShift;
         }
+        decay = (static_cast<uint64_t>(decay) * decay) >> kLoadAverageShift;
+        count >>= 1;
+    }
+    return result;
+}
+
+//! @brief Folds a number of identical samples into a thread's load averages.
+//!
+//! Applying a sample @a s to an average @a a moves it to s + (a - s) * decay, so applying it
+//! @a count times in a row moves it to s + (a - s) * decay^count. This gives the same result
+//! as applying the samples one at a time, in constant time.
+static void ar_kernel_apply_load_samples(ar_thread_t * thread, uint32_t sample, uint32_t count)
+{
+    for (uint32_t i = 0; i < kArLoadAverageCount; ++i)
+    {
+        uint32_t decay = (count == 1) ? g_ar.loadDecay[i] : ar_kernel_load_decay_power(g_ar.loadDecay[i], count);
+        int64_t delta = static_cast<int64_t>(thread->m_loadAverages[i]) - sample;
+        thread->m_loadAverages[i] = static_cast<uint32_t>(sample + ((delta * decay) >> kLoadAverageShift));
+    }
+}
+
+//! @brief Brings a thread's load up to date with the current load computation period.
+//!
+//! A thread's accumulator only covers the period it was last run in. When a later period has
+//! started, the accumulator is folded into the thread's load and averages, followed by a zero
+//! sample for each period the thread did not run at all. This is constant time no matter how
+//! many periods have passed, so the scheduler only ever pays for the thread being switched.
+//! Threads that have not run are caught up when their load is read.
+//!
+//! The kernel must be locked, or this must be called from the scheduler.
+void ar_kernel_update_thread_load(ar_thread_t * thread)
+{
+    uint32_t periods = g_ar.loadPeriod - thread->m_loadPeriod;
+    if (!periods)
+    {
+        return;
     }
 
-    // Update total system load based on the idle thread's load.
-    g_ar.systemLoad = 1000 - g_ar.idleThread.m_permilleCpu;
+    uint32_t sample = static_cast<uint32_t>((thread->m_loadAccumulator * g_ar.loadScale) >> 32);
+    if (sample > (1000 << kLoadAverageShift))
+    {
+        sample = 1000 << kLoadAverageShift;
+    }
+    thread->m_permilleCpu = (periods == 1) ? ((sample + (1 << (kLoadAverageShift - 1))) >> kLoadAverageShift) : 0;
+    thread->m_loadAccumulator = 0;
+    thread->m_loadPeriod = g_ar.loadPeriod;
+
+    ar_kernel_apply_load_samples(thread, sample, 1);
+    if (periods > 1)
+    {
+        ar_kernel_apply_load_samples(thread, 0, periods - 1);
+    }
 }
 #endif // AR_ENABLE_SYSTEM_LOAD
 
 void ar_kernel_scheduler()
 {
     // There must always be at least one thread on the ready list.
-    assert(g_ar.readyList.m_head);
+    assert(!g_ar.readyList.isEmpty());
 
 #if AR_ENABLE_SYSTEM_LOAD
     // Update thread active time accumulator.
     if (g_ar.currentThread)
     {
-        uint64_t now = ar_get_microseconds();
-        uint64_t w = now - g_ar.lastLoadStart;
-        if (w >= AR_SYSTEM_LOAD_SAMPLE_PERIOD)
+        uint64_t now = ar_get_cycles();
+        ar_thread_t * thread = g_ar.currentThread;
+        thread->m_totalCycles += now - g_ar.lastSwitchIn;
+
+        // Close out the load periods that ended while this thread was running. Only this
+        // thread's load is updated; others catch up when they are next run or inspected.
+        uint64_t elapsed = now - g_ar.lastLoadStart;
+        if (elapsed >= g_ar.loadPeriodCycles)
         {
-            uint64_t o = w - AR_SYSTEM_LOAD_SAMPLE_PERIOD;
-            g_ar.currentThread->m_loadAccumulator += static_cast<uint32_t>(now - g_ar.lastSwitchIn - o);
-            ar_kernel_update_thread_loads();
-            g_ar.lastLoadStart = now - o;
+            // The division is skipped in the usual case of the scheduler running at least
+            // once per period. Only a long tickless idle spans several periods.
+            uint32_t periods = (elapsed < 2 * g_ar.loadPeriodCycles) ? 1 : static_cast<uint32_t>(elapsed / g_ar.loadPeriodCycles);
+
+            // The first period is the only one the thread may not have run for all of.
+            uint64_t periodEnd = g_ar.lastLoadStart + g_ar.loadPeriodCycles;
+            thread->m_loadAccumulator += periodEnd - g_ar.lastSwitchIn;
+            ++g_ar.loadPeriod;
+            ar_kernel_update_thread_load(thread);
+
+            // The thread ran for the whole of every other period.
+            if (periods > 1)
+            {
+                ar_kernel_apply_load_samples(thread, 1000 << kLoadAverageShift, periods - 1);
+                thread->m_permilleCpu = 1000;
+                g_ar.loadPeriod += periods - 1;
+                thread->m_loadPeriod = g_ar.loadPeriod;
+            }
+
+            g_ar.lastLoadStart += periods * g_ar.loadPeriodCycles;
             g_ar.lastSwitchIn = g_ar.lastLoadStart;
         }
 
-        g_ar.currentThread->m_loadAccumulator += static_cast<uint32_t>(now - g_ar.lastSwitchIn);
+        thread->m_loadAccumulator += now - g_ar.lastSwitchIn;
         g_ar.lastSwitchIn = now;
     }
 #endif // AR_ENABLE_SYSTEM_LOAD
 
+#if AR_ENABLE_RCU
+    // Note whether the outgoing thread is inside an RCU read-side critical section. This is
+    // done before picking the next thread, since it may wake a grace period waiter.
+    if (g_ar.currentThread)
+    {
+        ar_rcu_note_thread(g_ar.currentThread);
+    }
+#endif // AR_ENABLE_RCU
+
     // Find the next ready thread.
-    ar_list_node_t * firstNode = g_ar.readyList.m_head;
-    ar_thread_t * first = firstNode->getObject<ar_thread_t>();
+    ar_thread_t * first = g_ar.readyList.getHighest();
     ar_thread_t * highest = NULL;
 
-    // Handle these cases by selecting the first thread in the ready list, which will have the
-    // highest priority since the ready list is sorted.
+    // Handle these cases by selecting the first thread of the highest priority in the
+    // ready list.
     // 1. The first time the scheduler runs and g_ar.currentThread is NULL.
     // 2. The current thread was suspended.
     // 3. Higher priority thread became ready.
@@ -478,11 +572,13 @@ void ar_kernel_scheduler()
         ar_list_node_t * startNode = &g_ar.currentThread->m_threadNode;
         uint8_t startPriority = startNode->getObject<ar_thread_t>()->m_priority;
 
-        // Pick up the next thread in the ready list.
+        // Pick up the next thread in the ready list. With the ready queue bitmap, this is always
+        // a thread of the same priority since each priority has its own circular list.
         ar_list_node_t * nextNode = startNode->m_next;
         highest = nextNode->getObject<ar_thread_t>();
 
-        // If the next thread is not the same priority, then go back to the start of the ready list.
+        // If the next thread is not the same priority, then go back to the first thread of
+        // the highest priority.
         if (highest->m_priority != startPriority)
         {
             highest = first;
@@ -499,17 +595,21 @@ void ar_kernel_scheduler()
             g_ar.currentThread->m_state = kArThreadReady;
         }
 
-        ar_trace_1(kArTraceThreadSwitch, (g_ar.currentThread->m_state << 16) | highest->m_uniqueId);
+        ar_trace_object(kArTraceThreadSwitch, g_ar.currentThread ? g_ar.currentThread->m_state : kArThreadUnknown, highest);
 
         highest->m_state = kArThreadRunning;
+#if AR_ENABLE_SYSTEM_LOAD
+        ++highest->m_switchCount;
+        ar_kernel_update_thread_load(highest);
+#endif // AR_ENABLE_SYSTEM_LOAD
         g_ar.currentThread = highest;
     }
 
     // Check for stack overflow on the current thread.
     if (g_ar.currentThread)
     {
-        uint32_t current = reinterpret_cast<uint32_t>(g_ar.currentThread->m_stackPointer);
-        uint32_t bottom = reinterpret_cast<uint32_t>(g_ar.currentThread->m_stackBottom);
+        uintptr_t current = reinterpret_cast<uintptr_t>(g_ar.currentThread->m_stackPointer);
+        uintptr_t bottom = reinterpret_cast<uintptr_t>(g_ar.currentThread->m_stackBottom);
         uint32_t check = *(g_ar.currentThread->m_stackBottom);
         if ((current < bottom) || (check != kStackCheckValue))
         {
@@ -519,14 +619,16 @@ void ar_kernel_scheduler()
 
 #if AR_ENABLE_TICKLESS_IDLE
     // Compute delay until next wakeup event and adjust timer.
-    uint32_t wakeup = ar_kernel_get_next_wakeup_time();
+    uint64_t wakeup = ar_kernel_get_next_wakeup_time();
     if (wakeup != g_ar.nextWakeup)
     {
         g_ar.nextWakeup = wakeup;
         uint32_t delay = 0;
-        if (g_ar.nextWakeup && g_ar.nextWakeup > g_ar.tickCount)
+        uint64_t now = ar_get_microseconds();
+        if (g_ar.nextWakeup && g_ar.nextWakeup > now)
         {
-            delay = (g_ar.nextWakeup - g_ar.tickCount) * kSchedulerQuanta_ms * 1000;
+            uint64_t delta = g_ar.nextWakeup - now;
+            delay = delta > 0xffffffffu ? 0xffffffffu : static_cast<uint32_t>(delta);
         }
         bool enable = (g_ar.nextWakeup != 0);
         ar_port_set_timer_delay(enable, delay);
@@ -536,25 +638,10 @@ void ar_kernel_scheduler()
 
 //! @brief Cache whether round-robin scheduling needs to be used.
 //!
-//! Round-robin is required if there are multiple ready threads with the same priority. Since the
-//! ready list is sorted by priority, we can just check the first two nodes to see if they are the
-//! same priority.
+//! Round-robin is required if there are multiple ready threads with the highest priority.
 void ar_kernel_update_round_robin()
 {
-    ar_list_node_t * node = g_ar.readyList.m_head;
-    assert(node);
-    uint8_t pri1 = node->getObject<ar_thread_t>()->m_priority;
-    if (node->m_next != node)
-    {
-        node = node->m_next;
-        uint8_t pri2 = node->getObject<ar_thread_t>()->m_priority;
-
-        g_ar.flags.needsRoundRobin = (pri1 == pri2);
-    }
-    else
-    {
-        g_ar.flags.needsRoundRobin = false;
-    }
+    g_ar.flags.needsRoundRobin = g_ar.readyList.hasMultipleAtHighest();
 }
 
 //! @brief Determine the delay to the next wakeup event.
@@ -562,35 +649,70 @@ void ar_kernel_update_round_robin()
 //! Wakeup events are either sleeping threads that are scheduled to wake, or a timer that is
 //! scheduled to fire.
 //!
-//! @return The number of ticks until the next wakup event. If the result is 0, then there are no
+//! @return The microsecond time of the next wakeup event. If the result is 0, then there are no
 //!     wakeup events pending.
-uint32_t ar_kernel_get_next_wakeup_time()
+uint64_t ar_kernel_get_next_wakeup_time()
 {
-    uint32_t wakeup = 0;
+    uint64_t wakeup = 0;
 
     // See if round-robin needs to be used.
     if (g_ar.flags.needsRoundRobin)
     {
         // No need to check sleeping threads!
-        return g_ar.tickCount + 1;
+        return ar_get_microseconds() + kSchedulerQuanta_ms * 1000;
     }
 
-    // Check for a sleeping thread. The sleeping list is sorted by wakeup time, so we only
-    // need to look at the list head.
-    ar_list_node_t * node = g_ar.sleepingList.m_head;
-    if (node)
+    // Check for a sleeping thread.
+    uint64_t sleepWakeup = g_ar.sleepingList.getNextWakeup();
+    if (sleepWakeup && (wakeup == 0 || sleepWakeup < wakeup))
     {
-        ar_thread_t * thread = node->getObject<ar_thread_t>();
-        uint32_t sleepWakeup = thread->m_wakeupTime;
-        if (wakeup == 0 || sleepWakeup < wakeup)
-        {
-            wakeup = sleepWakeup;
-        }
+        wakeup = sleepWakeup;
     }
 
     return wakeup;
 }
 
+//! @brief Invoke a callback for each thread on a list of threads.
+//!
+//! The list may be any thread list that links threads by m_threadNode, or by another node whose
+//! m_obj member points at the thread.
+//!
+//! @return False if the iterator stopped the iteration, otherwise true.
+bool ar_kernel_iterate_list(ar_list_t & list, ar_thread_iterator_t iterator, void * param)
+{
+    ar_list_node_t * node = list.m_head;
+    if (node)
+    {
+        do {
+            ar_list_node_t * next = node->m_next;
+            if (!iterator(node->getObject<ar_thread_t>(), param))
+            {
+                return false;
+            }
+            node = next;
+        } while (node != list.m_head);
+    }
+    return true;
+}
+
+//! @brief Invoke a callback for each thread.
+//!
+//! If #AR_GLOBAL_OBJECT_LISTS is enabled, all created threads are visited. Otherwise only
+//! threads that are ready, suspended, or sleeping are found, since blocked threads without a
+//! timeout are only known to the object they are blocked on.
+void ar_kernel_iterate_threads(ar_thread_iterator_t iterator, void * param)
+{
+#if AR_GLOBAL_OBJECT_LISTS
+    ar_kernel_iterate_list(g_ar_objects.threads, iterator, param);
+#else // AR_GLOBAL_OBJECT_LISTS
+    if (g_ar.readyList.iterate(iterator, param)
+        && ar_kernel_iterate_list(g_ar.suspendedList, iterator, param))
+    {
+        g_ar.sleepingList.iterate(iterator, param);
+    }
+#endif // AR_GLOBAL_OBJECT_LISTS
+}
+
 // See ar_kernel.h for documentation of this function.
 bool ar_kernel_is_running(void)
 {
@@ -601,32 +723,52 @@ bool ar_kernel_is_running(void)
 uint32_t ar_get_system_load(void)
 {
 #if AR_ENABLE_SYSTEM_LOAD
-    return g_ar.systemLoad;
+    // Nothing is known until the first sampling period has completed.
+    if (!g_ar.loadPeriod)
+    {
+        return 0;
+    }
+    return 1000 - ar_thread_get_load(&g_ar.idleThread);
+#else // AR_ENABLE_SYSTEM_LOAD
+    return 0;
+#endif // AR_ENABLE_SYSTEM_LOAD
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_get_system_load_average(ar_load_average_t average)
+{
+#if AR_ENABLE_SYSTEM_LOAD
+    return 1000 - ar_thread_get_load_average(&g_ar.idleThread, average);
 #else // AR_ENABLE_SYSTEM_LOAD
     return 0;
 #endif // AR_ENABLE_SYSTEM_LOAD
 }
 
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_kernel_get_deferred_action_stats(ar_deferred_action_stats_t stats[], uint32_t maxEntries)
+{
+    uint32_t i = 0;
+    for (; i < AR_DEFERRED_ACTION_QUEUE_COUNT && i < maxEntries; ++i)
+    {
+        ar_deferred_action_queue_t & queue = g_ar.deferredActions.m_queues[i];
+        stats[i].m_capacity = AR_DEFERRED_ACTION_QUEUE_SIZE;
+        stats[i].m_highWater = queue.m_highWater;
+        stats[i].m_coalesced = queue.m_coalesced;
+        stats[i].m_overflows = queue.m_overflows;
+    }
+    return i;
+}
+
 // See ar_kernel.h for documentation of this function.
 uint32_t ar_get_tick_count(void)
 {
-#if AR_ENABLE_TICKLESS_IDLE
-    uint32_t elapsed_ticks = ar_port_get_timer_elapsed_us() / (kSchedulerQuanta_ms * 1000);
-    return g_ar.tickCount + elapsed_ticks;
-#else
-    return g_ar.tickCount;
-#endif // AR_ENABLE_TICKLESS_IDLE
+    return static_cast<uint32_t>(ar_get_microseconds() / (kSchedulerQuanta_ms * 1000));
 }
 
 // See ar_kernel.h for documentation of this function.
 uint32_t ar_get_millisecond_count(void)
 {
-#if AR_ENABLE_TICKLESS_IDLE
-    uint32_t elapsed_ms = ar_port_get_timer_elapsed_us() / 1000;
-    return g_ar.tickCount * ar_get_milliseconds_per_tick() + elapsed_ms;
-#else
-    return g_ar.tickCount * ar_get_milliseconds_per_tick();
-#endif // AR_ENABLE_TICKLESS_IDLE
+    return static_cast<uint32_t>(ar_get_microseconds() / 1000);
 }
 
 //! Updates the list node's links and those of @a node so that the object is inserted before
@@ -829,6 +971,464 @@ void _ar_list::check()
 }
 #endif // AR_ENABLE_LIST_CHECKS
 
+#if AR_ENABLE_READY_QUEUE_BITMAP || AR_ENABLE_TIMING_WHEEL
+//! @brief Append a node to a circular list that is referenced only by its head pointer.
+//! @return True if the list was empty before the node was added.
+bool ar_kernel_list_append(ar_list_node_t *& head, ar_list_node_t * item)
+{
+    assert(item->m_next == NULL && item->m_prev == NULL);
+
+    if (!head)
+    {
+        head = item;
+        item->m_next = item;
+        item->m_prev = item;
+        return true;
+    }
+
+    item->insertBefore(head);
+    return false;
+}
+
+//! @brief Unlink a node from a circular list that is referenced only by its head pointer.
+//! @return True if the list is empty after the node was removed.
+bool ar_kernel_list_unlink(ar_list_node_t *& head, ar_list_node_t * item)
+{
+    assert(item->m_next && item->m_prev);
+    assert(head);
+
+    bool isNowEmpty = false;
+    if (item->m_next == item)
+    {
+        // Removing the only node.
+        assert(head == item);
+        head = NULL;
+        isNowEmpty = true;
+    }
+    else
+    {
+        item->m_prev->m_next = item->m_next;
+        item->m_next->m_prev = item->m_prev;
+
+        if (head == item)
+        {
+            head = item->m_next;
+        }
+    }
+
+    // Clear links.
+    item->m_next = NULL;
+    item->m_prev = NULL;
+    return isNowEmpty;
+}
+#endif // AR_ENABLE_READY_QUEUE_BITMAP || AR_ENABLE_TIMING_WHEEL
+
+#if AR_ENABLE_READY_QUEUE_BITMAP
+//! The thread is appended to the circular list for its priority level, so threads of the same
+//! priority are kept in FIFO order. If the level was empty, its bits in the bitmap and summary
+//! word are set.
+void _ar_ready_list::add(ar_thread_t * thread)
+{
+    uint32_t priority = thread->m_priority;
+    if (ar_kernel_list_append(m_levels[priority], &thread->m_threadNode))
+    {
+        uint32_t word = priority >> 5;
+        m_bitmap[word] |= 1u << (priority & 31);
+        m_summary |= 1u << word;
+    }
+}
+
+//! If this was the last thread of its priority, the bitmap bit for the priority is cleared.
+void _ar_ready_list::remove(ar_thread_t * thread)
+{
+    uint32_t priority = thread->m_priority;
+    if (ar_kernel_list_unlink(m_levels[priority], &thread->m_threadNode))
+    {
+        uint32_t word = priority >> 5;
+        m_bitmap[word] &= ~(1u << (priority & 31));
+        if (!m_bitmap[word])
+        {
+            m_summary &= ~(1u << word);
+        }
+    }
+}
+
+//! @return The first thread on the list for the highest priority level with ready threads. If
+//!     there are no ready threads, NULL is returned.
+ar_thread_t * _ar_ready_list::getHighest()
+{
+    if (!m_summary)
+    {
+        return NULL;
+    }
+    uint32_t word = 31 - ar_port_count_leading_zeros(m_summary);
+    uint32_t bit = 31 - ar_port_count_leading_zeros(m_bitmap[word]);
+    return m_levels[(word << 5) | bit]->getObject<ar_thread_t>();
+}
+
+bool _ar_ready_list::hasMultipleAtHighest()
+{
+    ar_thread_t * thread = getHighest();
+    assert(thread);
+    return thread->m_threadNode.m_next != &thread->m_threadNode;
+}
+
+//! Threads are visited in order from highest to lowest priority.
+//!
+//! @return False if the iterator stopped the iteration, otherwise true.
+bool _ar_ready_list::iterate(ar_thread_iterator_t iterator, void * param)
+{
+    uint32_t summary = m_summary;
+    while (summary)
+    {
+        uint32_t word = 31 - ar_port_count_leading_zeros(summary);
+        summary &= ~(1u << word);
+
+        uint32_t bits = m_bitmap[word];
+        while (bits)
+        {
+            uint32_t bit = 31 - ar_port_count_leading_zeros(bits);
+            bits &= ~(1u << bit);
+
+            ar_list_node_t * head = m_levels[(word << 5) | bit];
+            ar_list_node_t * node = head;
+            do {
+                ar_list_node_t * next = node->m_next;
+                if (!iterator(node->getObject<ar_thread_t>(), param))
+                {
+                    return false;
+                }
+                node = next;
+            } while (node != head);
+        }
+    }
+    return true;
+}
+#else // AR_ENABLE_READY_QUEUE_BITMAP
+void _ar_ready_list::add(ar_thread_t * thread)
+{
+    m_list.add(thread);
+}
+
+void _ar_ready_list::remove(ar_thread_t * thread)
+{
+    m_list.remove(thread);
+}
+
+ar_thread_t * _ar_ready_list::getHighest()
+{
+    return m_list.getHead<ar_thread_t>();
+}
+
+//! Since the list is sorted by priority, we can just check the first two nodes to see if they
+//! are the same priority.
+bool _ar_ready_list::hasMultipleAtHighest()
+{
+    ar_list_node_t * node = m_list.m_head;
+    assert(node);
+    if (node->m_next == node)
+    {
+        return false;
+    }
+    return node->getObject<ar_thread_t>()->m_priority == node->m_next->getObject<ar_thread_t>()->m_priority;
+}
+
+bool _ar_ready_list::iterate(ar_thread_iterator_t iterator, void * param)
+{
+    return ar_kernel_iterate_list(m_list, iterator, param);
+}
+#endif // AR_ENABLE_READY_QUEUE_BITMAP
+
+#if AR_ENABLE_TIMING_WHEEL
+//! @brief Rotate a 32-bit value left.
+static inline uint32_t ar_kernel_rotate_left(uint32_t value, uint32_t shift)
+{
+    shift &= 31;
+    return shift ? ((value << shift) | (value >> (32 - shift))) : value;
+}
+
+//! A wakeup time that has already passed is placed in the current level 0 slot, so the thread
+//! will be woken the next time the wheel is advanced.
+void _ar_sleep_queue::add(ar_thread_t * thread)
+{
+    insert(thread, thread->m_wakeupTime, m_time);
+}
+
+//! The slot is selected by how many units @a wakeup is from @a base. Wakeups within 32 units go
+//! into the level 0 slot for that unit. Otherwise the lowest level whose range covers the wakeup
+//! is used, or the overflow list if no level does.
+//!
+//! @param thread The thread to insert.
+//! @param wakeup Microsecond time used to select the slot. Normally this is the thread's wakeup
+//!     time. If it is earlier than @a base, the slot for @a base is used.
+//! @param base The current wheel time.
+void _ar_sleep_queue::insert(ar_thread_t * thread, uint64_t wakeup, uint64_t base)
+{
+    uint64_t wakeupUnit = wakeup >> kUnitShift;
+    uint64_t baseUnit = base >> kUnitShift;
+    if (wakeupUnit < baseUnit)
+    {
+        wakeupUnit = baseUnit;
+    }
+
+    uint64_t delta = wakeupUnit - baseUnit;
+    uint32_t level = 0;
+    uint32_t slot = 0;
+    uint32_t index = kOverflowSlot;
+    for (; level < kLevelCount; ++level)
+    {
+        uint32_t shift = kSlotBits * level;
+        if (delta < (1ull << (shift + kSlotBits)))
+        {
+            slot = static_cast<uint32_t>(wakeupUnit >> shift) & (kSlotCount - 1);
+            index = level * kSlotCount + slot;
+            break;
+        }
+    }
+
+    thread->m_wakeupSlot = index;
+    if (ar_kernel_list_append(m_slots[index], &thread->m_threadNode) && index != kOverflowSlot)
+    {
+        m_occupied[level] |= 0x80000000u >> slot;
+    }
+}
+
+//! The thread's slot was recorded when it was inserted, so removal is constant time.
+void _ar_sleep_queue::remove(ar_thread_t * thread)
+{
+    uint32_t index = thread->m_wakeupSlot;
+    if (ar_kernel_list_unlink(m_slots[index], &thread->m_threadNode) && index != kOverflowSlot)
+    {
+        m_occupied[index / kSlotCount] &= ~(0x80000000u >> (index % kSlotCount));
+    }
+}
+
+//! @return The circular list of threads that were in the slot, or NULL if it was empty.
+ar_list_node_t * _ar_sleep_queue::detach(uint32_t index)
+{
+    ar_list_node_t * head = m_slots[index];
+    if (head)
+    {
+        m_slots[index] = NULL;
+        if (index != kOverflowSlot)
+        {
+            m_occupied[index / kSlotCount] &= ~(0x80000000u >> (index % kSlotCount));
+        }
+    }
+    return head;
+}
+
+//! This is the earliest of the wakeup time of the first thread in level 0, and the start times
+//! of the first non-empty slot in each higher level, when those slots must be redistributed.
+//! So the result may be earlier than the wakeup time of any thread. Non-empty slots are found
+//! with the occupancy bitmaps, so only the threads in a single level 0 slot are examined.
+//!
+//! @return The microsecond time at which the wheel next needs to be advanced, or 0 if the wheel
+//!     is empty.
+uint64_t _ar_sleep_queue::getNextWakeup()
+{
+    uint64_t next = 0;
+    uint64_t currentUnit = m_time >> kUnitShift;
+
+    // Rotate the bitmap so the current slot is in the top bit. Then the leading zero count is
+    // the distance from the current slot to the first non-empty one. The threads within that
+    // slot are not sorted, so find the earliest.
+    if (m_occupied[0])
+    {
+        uint32_t current = static_cast<uint32_t>(currentUnit);
+        uint32_t distance = ar_port_count_leading_zeros(ar_kernel_rotate_left(m_occupied[0], current));
+        ar_list_node_t * head = m_slots[(current + distance) & (kSlotCount - 1)];
+        ar_list_node_t * node = head;
+        do {
+            uint64_t wakeup = node->getObject<ar_thread_t>()->m_wakeupTime;
+            if (next == 0 || wakeup < next)
+            {
+                next = wakeup;
+            }
+            node = node->m_next;
+        } while (node != head);
+    }
+
+    // For higher levels, rotate so the slot following the current one is in the top bit.
+    uint32_t level = 1;
+    for (; level < kLevelCount; ++level)
+    {
+        uint32_t occupied = m_occupied[level];
+        if (occupied)
+        {
+            uint32_t shift = kSlotBits * level;
+            uint64_t current = currentUnit >> shift;
+            uint32_t distance = ar_port_count_leading_zeros(ar_kernel_rotate_left(occupied, static_cast<uint32_t>(current) + 1)) + 1;
+            uint64_t time = ((current + distance) << shift) << kUnitShift;
+            if (next == 0 || time < next)
+            {
+                next = time;
+            }
+        }
+    }
+
+    // The overflow list is redistributed whenever the top level wraps.
+    if (m_slots[kOverflowSlot])
+    {
+        uint32_t shift = kSlotBits * kLevelCount;
+        uint64_t time = (((currentUnit >> shift) + 1) << shift) << kUnitShift;
+        if (next == 0 || time < next)
+        {
+            next = time;
+        }
+    }
+
+    return next;
+}
+
+//! The wheel jumps directly between the times when it has work to do, so advancing over a
+//! long period of tickless idle does not require stepping through every unit. At each
+//! of these times, slots of the higher levels and the overflow list that start at that time
+//! are redistributed to lower levels, then the threads in the current level 0 slot whose wakeup
+//! time has arrived are expired.
+//!
+//! @param time The current microsecond time.
+//! @param expired Callback invoked for each thread whose wakeup time has arrived. The thread has
+//!     already been removed from the queue when the callback is invoked.
+//! @param param Arbitrary parameter passed to @a expired.
+//! @return True if any threads were expired or redistributed.
+bool _ar_sleep_queue::advance(uint64_t time, ar_thread_iterator_t expired, void * param)
+{
+    bool didProcess = false;
+    while (true)
+    {
+        uint64_t next = getNextWakeup();
+        if (next == 0 || next > time)
+        {
+            if (time > m_time)
+            {
+                m_time = time;
+            }
+            break;
+        }
+        if (next > m_time)
+        {
+            m_time = next;
+        }
+        didProcess = true;
+
+        // Redistribute slots that start at this unit, from the highest level down. A slot
+        // can only hold threads for the unit it starts at once the wheel has reached it.
+        uint64_t unit = m_time >> kUnitShift;
+        uint32_t level = kLevelCount;
+        for (; level > 0; --level)
+        {
+            uint32_t shift = kSlotBits * level;
+            if ((unit & ((1ull << shift) - 1)) == 0)
+            {
+                uint32_t index = (level == kLevelCount)
+                                    ? kOverflowSlot
+                                    : (level * kSlotCount + (static_cast<uint32_t>(unit >> shift) & (kSlotCount - 1)));
+                ar_list_node_t * head = detach(index);
+                if (head)
+                {
+                    ar_list_node_t * node = head;
+                    do {
+                        ar_list_node_t * nextNode = node->m_next;
+                        node->m_next = NULL;
+                        node->m_prev = NULL;
+                        ar_thread_t * thread = node->getObject<ar_thread_t>();
+                        insert(thread, thread->m_wakeupTime, m_time);
+                        node = nextNode;
+                    } while (node != head);
+                }
+            }
+        }
+
+        // Expire threads in the current level 0 slot whose wakeup time has arrived. The
+        // others in the slot wake later in the same unit, so are put back.
+        ar_list_node_t * head = detach(static_cast<uint32_t>(unit) & (kSlotCount - 1));
+        if (head)
+        {
+            ar_list_node_t * node = head;
+            do {
+                ar_list_node_t * nextNode = node->m_next;
+                node->m_next = NULL;
+                node->m_prev = NULL;
+                ar_thread_t * thread = node->getObject<ar_thread_t>();
+                if (thread->m_wakeupTime <= time)
+                {
+                    expired(thread, param);
+                }
+                else
+                {
+                    insert(thread, thread->m_wakeupTime, m_time);
+                }
+                node = nextNode;
+            } while (node != head);
+        }
+    }
+    return didProcess;
+}
+
+//! Threads are visited in slot order, which is not necessarily wakeup order.
+//!
+//! @return False if the iterator stopped the iteration, otherwise true.
+bool _ar_sleep_queue::iterate(ar_thread_iterator_t iterator, void * param)
+{
+    uint32_t index = 0;
+    for (; index <= kOverflowSlot; ++index)
+    {
+        ar_list_node_t * head = m_slots[index];
+        if (head)
+        {
+            ar_list_node_t * node = head;
+            do {
+                ar_list_node_t * next = node->m_next;
+                if (!iterator(node->getObject<ar_thread_t>(), param))
+                {
+                    return false;
+                }
+                node = next;
+            } while (node != head);
+        }
+    }
+    return true;
+}
+#else // AR_ENABLE_TIMING_WHEEL
+void _ar_sleep_queue::add(ar_thread_t * thread)
+{
+    m_list.add(thread);
+}
+
+void _ar_sleep_queue::remove(ar_thread_t * thread)
+{
+    m_list.remove(thread);
+}
+
+//! The list is sorted by wakeup time, so threads are removed from the head until one is found
+//! with a wakeup time in the future.
+bool _ar_sleep_queue::advance(uint64_t time, ar_thread_iterator_t expired, void * param)
+{
+    bool didProcess = false;
+    ar_thread_t * thread;
+    while ((thread = m_list.getHead<ar_thread_t>()) && thread->m_wakeupTime <= time)
+    {
+        m_list.remove(thread);
+        expired(thread, param);
+        didProcess = true;
+    }
+    return didProcess;
+}
+
+//! The list is sorted by wakeup time, so we only need to look at the list head.
+uint64_t _ar_sleep_queue::getNextWakeup()
+{
+    ar_thread_t * thread = m_list.getHead<ar_thread_t>();
+    return thread ? thread->m_wakeupTime : 0;
+}
+
+bool _ar_sleep_queue::iterate(ar_thread_iterator_t iterator, void * param)
+{
+    return ar_kernel_iterate_list(m_list, iterator, param);
+}
+#endif // AR_ENABLE_TIMING_WHEEL
+
 //! @brief Atomically allocate entries at the end of a queue.
 int32_t ar_kernel_atomic_queue_insert(int32_t entryCount, volatile int32_t & qCount, volatile int32_t & qTail, int32_t qSize)
 {
@@ -855,62 +1455,181 @@ int32_t ar_kernel_atomic_queue_insert(int32_t entryCount, volatile int32_t & qCo
     return last;
 }
 
-//! @brief There is no more room available in the deferred action queue.
-void DEFERRED_ACTION_QUEUE_OVERFLOW_DETECTED()
+ar_status_t _ar_deferred_action_queue::insert(ar_deferred_action_t action, void * object, void * arg)
 {
-    _halt();
+    // Merge with the most recently published entry if it holds the same action. A count of 0
+    // means the entry is still being written by an interrupt we preempted, or the scheduler
+    // has already claimed it. The fields are read after the state, so if the entry is claimed
+    // and reused after that, the generation in the state will have changed and the compare and
+    // swap fails.
+    if (m_count)
+    {
+        _ar_deferred_action_queue_entry & last = m_entries[(m_last - 1) & kIndexMask];
+        uint32_t state = static_cast<uint32_t>(ar_atomic_add32(&last.m_state, 0));
+        uint32_t count = state & kCountMask;
+        if (count
+            && count < kCountMask
+            && last.m_action == action
+            && last.m_object == object
+            && last.m_arg == arg
+            && ar_atomic_cas32(&last.m_state, static_cast<int32_t>(state), static_cast<int32_t>(state + 1)))
+        {
+            ar_atomic_add32(&m_coalesced, 1);
+            return kArSuccess;
+        }
+    }
+
+    // Reserve an entry.
+    int32_t count;
+    do {
+        count = m_count;
+        if (count >= AR_DEFERRED_ACTION_QUEUE_SIZE)
+        {
+            ar_atomic_add32(&m_overflows, 1);
+            return kArQueueFullError;
+        }
+    } while (!ar_atomic_cas32(&m_count, count, count + 1));
+
+    int32_t highWater;
+    do {
+        highWater = m_highWater;
+    } while (count + 1 > highWater && !ar_atomic_cas32(&m_highWater, highWater, count + 1));
+
+    int32_t index;
+    do {
+        index = m_last;
+    } while (!ar_atomic_cas32(&m_last, index, (index + 1) & kIndexMask));
+
+    // Fill in the entry, then publish it by setting the count. The entry is ours until then,
+    // so its generation can be kept with a plain write.
+    _ar_deferred_action_queue_entry & entry = m_entries[index];
+    entry.m_action = action;
+    entry.m_object = object;
+    entry.m_arg = arg;
+    ar_atomic_add32(&entry.m_state, 1);
+
+    return kArSuccess;
 }
 
-int32_t _ar_deferred_action_queue::insert(int32_t entryCount)
+void _ar_deferred_action_queue::runFirst()
 {
-    int32_t last = ar_kernel_atomic_queue_insert(entryCount, m_count, m_last, AR_DEFERRED_ACTION_QUEUE_SIZE);
-    if (last == -1)
+    _ar_deferred_action_queue_entry & entry = m_entries[m_first];
+
+    // Claim the entry by clearing its count and advancing its generation, so interrupts stop
+    // merging actions into it.
+    uint32_t state;
+    do {
+        state = static_cast<uint32_t>(entry.m_state);
+    } while (!ar_atomic_cas32(&entry.m_state, static_cast<int32_t>(state), static_cast<int32_t>((state & ~kCountMask) + kGenerationIncrement)));
+    uint32_t count = state & kCountMask;
+    assert(count);
+
+    ar_trace_object(kArTraceDeferredRun, count > 0xff ? 0xff : count, entry.m_object);
+    entry.m_action(entry.m_object, entry.m_arg, count);
+
+    // Remove the entry we just processed from the queue.
+    // This is the only code that modifies the m_first member of the queue.
+    m_first = (m_first + 1) & kIndexMask;
+    ar_atomic_add32(&m_count, -1);
+}
+
+bool _ar_deferred_actions::isEmpty() const
+{
+    for (uint32_t i = 0; i < AR_DEFERRED_ACTION_QUEUE_COUNT; ++i)
     {
-        DEFERRED_ACTION_QUEUE_OVERFLOW_DETECTED();
+        if (!m_queues[i].isEmpty())
+        {
+            return false;
+        }
     }
-    return last;
+    return m_pendingNodes == NULL;
 }
 
-ar_status_t _ar_deferred_action_queue::post(deferred_action_t action, void * object)
+//! If the kernel is unlocked and no earlier actions from the same priority band are waiting,
+//! the action is performed right away from the interrupt. Otherwise it is queued to run in the
+//! scheduler.
+ar_status_t _ar_deferred_actions::post(ar_deferred_action_t action, void * object, void * arg)
 {
-    int32_t index = insert(1);
-    if (index < 0)
+#if AR_DEFERRED_ACTION_QUEUE_COUNT > 1
+    ar_deferred_action_queue_t & queue = m_queues[(ar_port_get_irq_priority() * AR_DEFERRED_ACTION_QUEUE_COUNT) >> 8];
+#else // AR_DEFERRED_ACTION_QUEUE_COUNT > 1
+    ar_deferred_action_queue_t & queue = m_queues[0];
+#endif // AR_DEFERRED_ACTION_QUEUE_COUNT > 1
+
+    if (queue.isEmpty())
     {
-        assert(false);
-        return kArQueueFullError;
+        KernelTryLock guard;
+        if (guard.isLocked())
+        {
+            return action(object, arg, 1);
+        }
     }
 
-    m_entries[index].action = action;
-    m_entries[index].object = object;
-
-    ar_kernel_enter_scheduler();
+    ar_status_t status = queue.insert(action, object, arg);
+    ar_trace_object(kArTraceDeferredPost, status, object);
+    if (status == kArSuccess)
+    {
+        ar_kernel_enter_scheduler();
+    }
 
-    return kArSuccess;
+    return status;
 }
 
-ar_status_t _ar_deferred_action_queue::post(deferred_action_t action, void * object, void * arg)
+//! Nodes are pushed onto #m_pendingNodes with a compare and swap, and the scheduler takes the
+//! whole list at once, so interrupts may post nodes while it runs them. A node that is already
+//! pending is not linked again, since one run of its action covers every post.
+void _ar_deferred_actions::post(ar_deferred_node_t * node)
 {
-    int32_t index = insert(2);
-    if (index < 0)
+    if (post(node->m_action, node->m_object) != kArQueueFullError)
     {
-        assert(false);
-        return kArQueueFullError;
+        return;
     }
 
-    m_entries[index].action = action;
-    m_entries[index].object = object;
-
-    ++index;
-    if (index >= AR_DEFERRED_ACTION_QUEUE_SIZE)
+    if (ar_atomic_cas32(&node->m_isPending, 0, 1))
     {
-        index = 0;
+        ar_deferred_node_t * head;
+        do {
+            head = m_pendingNodes;
+            node->m_next = head;
+        } while (!ar_port_atomic_cas_pointer(reinterpret_cast<void * volatile *>(&m_pendingNodes), head, node));
     }
-    m_entries[index].action = reinterpret_cast<deferred_action_t>(kActionExtraValue);
-    m_entries[index].object = arg;
 
     ar_kernel_enter_scheduler();
+}
 
-    return kArSuccess;
+void _ar_deferred_actions::run()
+{
+    // Always take the next action from the most urgent band that has one, since interrupts may
+    // post more actions while these run.
+    uint32_t i = 0;
+    while (i < AR_DEFERRED_ACTION_QUEUE_COUNT)
+    {
+        if (m_queues[i].isEmpty())
+        {
+            ++i;
+        }
+        else
+        {
+            m_queues[i].runFirst();
+            i = 0;
+        }
+    }
+
+    // Take the whole list of pending nodes. The next pointer is read before the node is
+    // marked as no longer pending, after which an interrupt may link it again.
+    ar_deferred_node_t * node;
+    do {
+        node = m_pendingNodes;
+    } while (node && !ar_port_atomic_cas_pointer(reinterpret_cast<void * volatile *>(&m_pendingNodes), node, NULL));
+
+    while (node)
+    {
+        ar_deferred_node_t * next = node->m_next;
+        node->m_isPending = 0;
+        ar_trace_object(kArTraceDeferredRun, 1, node->m_object);
+        node->m_action(node->m_object, NULL, 1);
+        node = next;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for Ar microkernel message buffers.
+ */
+
+#include "ar_internal.h"
+#include <string.h>
+
+using namespace Ar;
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! Size in bytes of the length stored before each message.
+static const uint32_t kArMessageHeaderSize = sizeof(uint16_t);
+
+//! Longest message that the length prefix can describe.
+static const uint32_t kArMessageMaxLength = 0xffff;
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static inline uint32_t ar_message_buffer_advance(ar_message_buffer_t * buffer, uint32_t index, uint32_t count);
+static void ar_message_buffer_copy_in(ar_message_buffer_t * buffer, uint32_t index, const void * data, uint32_t count);
+static void ar_message_buffer_copy_out(ar_message_buffer_t * buffer, uint32_t index, void * data, uint32_t count);
+static inline int32_t ar_message_buffer_get_free_internal(ar_message_buffer_t * buffer);
+static bool ar_message_buffer_claim(ar_message_buffer_t * buffer, uint32_t size, int32_t * index);
+static void ar_message_buffer_write(ar_message_buffer_t * buffer, int32_t index, const void * data, uint32_t length);
+static void ar_message_buffer_publish(ar_message_buffer_t * buffer, uint32_t written);
+static ar_status_t ar_message_buffer_deferred_publish(void * object, void * object2, uint32_t count);
+static ar_status_t ar_message_buffer_send_internal(ar_message_buffer_t * buffer, const void * data, uint32_t length, uint32_t timeout);
+static ar_status_t ar_message_buffer_receive_internal(ar_message_buffer_t * buffer, void * data, uint32_t maxLength, uint32_t * length, uint32_t timeout);
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_message_buffer_create(ar_message_buffer_t * buffer, const char * name, void * storage, uint32_t capacity)
+{
+    if (!buffer || !storage || capacity < kArMessageHeaderSize)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    memset(buffer, 0, sizeof(ar_message_buffer_t));
+    buffer->m_name = name ? name : AR_ANONYMOUS_OBJECT_NAME;
+    buffer->m_data = reinterpret_cast<uint8_t *>(storage);
+    buffer->m_capacity = capacity;
+
+    buffer->m_runLoopNode.m_obj = buffer;
+    buffer->m_publishNode.m_action = ar_message_buffer_deferred_publish;
+    buffer->m_publishNode.m_object = buffer;
+
+#if AR_GLOBAL_OBJECT_LISTS
+    buffer->m_createdNode.m_obj = buffer;
+    g_ar_objects.messageBuffers.add(&buffer->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_created(kArTraceMessageBufferObject, buffer, buffer->m_name);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_message_buffer_delete(ar_message_buffer_t * buffer)
+{
+    if (!buffer)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    {
+        KernelLock guard;
+
+        // Unblock all threads waiting on the message buffer.
+        while (buffer->m_sendBlockedList.m_head)
+        {
+            buffer->m_sendBlockedList.getHead<ar_thread_t>()->unblockWithStatus(buffer->m_sendBlockedList, kArObjectDeletedError);
+        }
+        while (buffer->m_receiveBlockedList.m_head)
+        {
+            buffer->m_receiveBlockedList.getHead<ar_thread_t>()->unblockWithStatus(buffer->m_receiveBlockedList, kArObjectDeletedError);
+        }
+    }
+
+#if AR_GLOBAL_OBJECT_LISTS
+    g_ar_objects.messageBuffers.remove(&buffer->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_object(kArTraceObjectDeleted, kArTraceMessageBufferObject, buffer);
+
+    return kArSuccess;
+}
+
+//! @brief Returns the index @a count bytes after @a index, wrapping around the storage.
+static inline uint32_t ar_message_buffer_advance(ar_message_buffer_t * buffer, uint32_t index, uint32_t count)
+{
+    index += count;
+    if (index >= buffer->m_capacity)
+    {
+        index -= buffer->m_capacity;
+    }
+    return index;
+}
+
+//! @brief Copy bytes into the storage, in two parts if they wrap around the end.
+static void ar_message_buffer_copy_in(ar_message_buffer_t * buffer, uint32_t index, const void * data, uint32_t count)
+{
+    uint32_t first = buffer->m_capacity - index;
+    if (first > count)
+    {
+        first = count;
+    }
+    const uint8_t * source = reinterpret_cast<const uint8_t *>(data);
+    memcpy(&buffer->m_data[index], source, first);
+    memcpy(buffer->m_data, source + first, count - first);
+}
+
+//! @brief Copy bytes out of the storage, in two parts if they wrap around the end.
+static void ar_message_buffer_copy_out(ar_message_buffer_t * buffer, uint32_t index, void * data, uint32_t count)
+{
+    uint32_t first = buffer->m_capacity - index;
+    if (first > count)
+    {
+        first = count;
+    }
+    uint8_t * dest = reinterpret_cast<uint8_t *>(data);
+    memcpy(dest, &buffer->m_data[index], first);
+    memcpy(dest + first, buffer->m_data, count - first);
+}
+
+//! @brief Returns the number of bytes neither holding messages nor claimed by a sender.
+static inline int32_t ar_message_buffer_get_free_internal(ar_message_buffer_t * buffer)
+{
+    return static_cast<int32_t>(buffer->m_capacity) - static_cast<int32_t>(buffer->m_usedBytes) - buffer->m_reservedBytes;
+}
+
+//! @brief Claim room for a whole message at the tail of the buffer.
+//!
+//! Works like ar_queue_claim(), so interrupts can claim room without the kernel lock.
+//!
+//! @return Whether the room was claimed.
+static bool ar_message_buffer_claim(ar_message_buffer_t * buffer, uint32_t size, int32_t * index)
+{
+    // Reserve room.
+    int32_t reserved;
+    do {
+        reserved = buffer->m_reservedBytes;
+        if (ar_message_buffer_get_free_internal(buffer) < static_cast<int32_t>(size))
+        {
+            return false;
+        }
+    } while (!ar_atomic_cas32(&buffer->m_reservedBytes, reserved, reserved + size));
+
+    // Take the bytes at the tail.
+    int32_t tail;
+    do {
+        tail = buffer->m_tail;
+    } while (!ar_atomic_cas32(&buffer->m_tail, tail, ar_message_buffer_advance(buffer, tail, size)));
+
+    *index = tail;
+    return true;
+}
+
+//! @brief Write a message and its length prefix into claimed room.
+static void ar_message_buffer_write(ar_message_buffer_t * buffer, int32_t index, const void * data, uint32_t length)
+{
+    uint16_t header = static_cast<uint16_t>(length);
+    ar_message_buffer_copy_in(buffer, index, &header, kArMessageHeaderSize);
+    ar_message_buffer_copy_in(buffer, ar_message_buffer_advance(buffer, index, kArMessageHeaderSize), data, length);
+}
+
+//! @brief Add written messages to the buffer, and wake a receiver or the runloop.
+//!
+//! Follows the same rules as ar_queue_publish(). Since messages vary in length, the number
+//! of messages added is found by walking their length prefixes.
+//!
+//! The kernel must be locked.
+static void ar_message_buffer_publish(ar_message_buffer_t * buffer, uint32_t written)
+{
+    int32_t otherWritten = buffer->m_writtenBytes;
+    int32_t total = otherWritten + written;
+    if (!total || total != buffer->m_reservedBytes)
+    {
+        if (written)
+        {
+            ar_atomic_add32(&buffer->m_writtenBytes, written);
+        }
+        return;
+    }
+
+    // Count the new messages.
+    uint32_t index = ar_message_buffer_advance(buffer, buffer->m_head, buffer->m_usedBytes);
+    uint32_t remaining = total;
+    uint32_t messages = 0;
+    while (remaining)
+    {
+        uint16_t length;
+        ar_message_buffer_copy_out(buffer, index, &length, kArMessageHeaderSize);
+        index = ar_message_buffer_advance(buffer, index, kArMessageHeaderSize + length);
+        remaining -= kArMessageHeaderSize + length;
+        ++messages;
+    }
+
+    // Count the bytes before releasing their claims, so the free count seen by an interrupt
+    // never overstates the room in the buffer.
+    buffer->m_usedBytes += total;
+    buffer->m_count += messages;
+    ar_atomic_add32(&buffer->m_reservedBytes, -total);
+    if (otherWritten)
+    {
+        ar_atomic_add32(&buffer->m_writtenBytes, -otherWritten);
+    }
+
+    // Are there any threads waiting to receive?
+    if (buffer->m_receiveBlockedList.m_head)
+    {
+        // Unblock the head of the blocked list.
+        ar_thread_t * thread = buffer->m_receiveBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(buffer->m_receiveBlockedList, kArSuccess);
+    }
+    // Is the message buffer associated with a runloop?
+    else if (buffer->m_runLoop)
+    {
+        // Add this message buffer to the list of pending sources for the runloop, but first
+        // check whether it is already pending so we don't attempt to add it twice.
+        if (!buffer->m_runLoop->m_messageBuffers.contains(&buffer->m_runLoopNode))
+        {
+            buffer->m_runLoop->m_messageBuffers.add(&buffer->m_runLoopNode);
+            ar_runloop_wake(buffer->m_runLoop);
+        }
+    }
+
+    // Let another sender try if there is room left.
+    if (buffer->m_sendBlockedList.m_head && ar_message_buffer_get_free_internal(buffer) > static_cast<int32_t>(kArMessageHeaderSize))
+    {
+        ar_thread_t * thread = buffer->m_sendBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(buffer->m_sendBlockedList, kArSuccess);
+    }
+}
+
+static ar_status_t ar_message_buffer_deferred_publish(void * object, void * object2, uint32_t count)
+{
+    KernelLock guard;
+    ar_message_buffer_publish(reinterpret_cast<ar_message_buffer_t *>(object), 0);
+    return kArSuccess;
+}
+
+static ar_status_t ar_message_buffer_send_internal(ar_message_buffer_t * buffer, const void * data, uint32_t length, uint32_t timeout)
+{
+    KernelLock guard;
+
+    // Wait for room for the whole message.
+    uint32_t size = kArMessageHeaderSize + length;
+    int32_t index;
+    while (!ar_message_buffer_claim(buffer, size, &index))
+    {
+        // If there is no room and a zero timeout was given, return immediately.
+        if (timeout == kArNoTimeout)
+        {
+            return kArQueueFullError;
+        }
+
+        // Otherwise block until a message is received.
+        ar_thread_t * thread = g_ar.currentThread;
+        thread->block(buffer->m_sendBlockedList, timeout);
+
+        // We're back from the scheduler.
+        // Check for errors and exit early if there was one.
+        if (thread->m_unblockStatus != kArSuccess)
+        {
+            // Probably timed out waiting for room.
+            if (thread->m_unblockStatus == kArTimeoutError)
+            {
+                buffer->m_sendBlockedList.remove(&thread->m_blockedNode);
+            }
+            return thread->m_unblockStatus;
+        }
+    }
+
+    ar_message_buffer_write(buffer, index, data, length);
+    ar_message_buffer_publish(buffer, size);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_message_buffer_send(ar_message_buffer_t * buffer, const void * data, uint32_t length, uint32_t timeout)
+{
+    if (!buffer || (!data && length))
+    {
+        return kArInvalidParameterError;
+    }
+    if (length > kArMessageMaxLength || kArMessageHeaderSize + length > buffer->m_capacity)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_status_t status;
+    if (ar_port_get_irq_state())
+    {
+        // Copy the message in now, and defer only adding it to the buffer.
+        int32_t index;
+        uint32_t size = kArMessageHeaderSize + length;
+        if (ar_message_buffer_claim(buffer, size, &index))
+        {
+            ar_message_buffer_write(buffer, index, data, length);
+            ar_atomic_add32(&buffer->m_writtenBytes, size);
+            g_ar.deferredActions.post(&buffer->m_publishNode);
+            status = kArSuccess;
+        }
+        else
+        {
+            status = kArQueueFullError;
+        }
+    }
+    else
+    {
+        status = ar_message_buffer_send_internal(buffer, data, length, timeout);
+    }
+
+    ar_trace_object(kArTraceMessageBufferSend, status, buffer);
+    return status;
+}
+
+static ar_status_t ar_message_buffer_receive_internal(ar_message_buffer_t * buffer, void * data, uint32_t maxLength, uint32_t * length, uint32_t timeout)
+{
+    KernelLock guard;
+
+    // Check for empty buffer.
+    while (buffer->m_count == 0)
+    {
+        if (timeout == kArNoTimeout)
+        {
+            return kArQueueEmptyError;
+        }
+
+        // Otherwise block until a message arrives.
+        ar_thread_t * thread = g_ar.currentThread;
+        thread->block(buffer->m_receiveBlockedList, timeout);
+
+        // We're back from the scheduler.
+        // Check for errors and exit early if there was one.
+        if (thread->m_unblockStatus != kArSuccess)
+        {
+            // Probably timed out waiting for a message.
+            if (thread->m_unblockStatus == kArTimeoutError)
+            {
+                buffer->m_receiveBlockedList.remove(&thread->m_blockedNode);
+            }
+            return thread->m_unblockStatus;
+        }
+    }
+
+    // Read the length, and leave the message in place if it doesn't fit.
+    uint16_t messageLength;
+    ar_message_buffer_copy_out(buffer, buffer->m_head, &messageLength, kArMessageHeaderSize);
+    if (length)
+    {
+        *length = messageLength;
+    }
+    if (messageLength > maxLength)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_message_buffer_copy_out(buffer, ar_message_buffer_advance(buffer, buffer->m_head, kArMessageHeaderSize), data, messageLength);
+
+    uint32_t size = kArMessageHeaderSize + messageLength;
+    buffer->m_head = ar_message_buffer_advance(buffer, buffer->m_head, size);
+    buffer->m_usedBytes -= size;
+    --buffer->m_count;
+
+    // Are there any threads waiting to send?
+    if (buffer->m_sendBlockedList.m_head)
+    {
+        // Unblock the head of the blocked list.
+        ar_thread_t * thread = buffer->m_sendBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(buffer->m_sendBlockedList, kArSuccess);
+    }
+
+    // Let another receiver have the next message if there is one.
+    if (buffer->m_receiveBlockedList.m_head && buffer->m_count)
+    {
+        ar_thread_t * thread = buffer->m_receiveBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(buffer->m_receiveBlockedList, kArSuccess);
+    }
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_message_buffer_receive(ar_message_buffer_t * buffer, void * data, uint32_t maxLength, uint32_t * length, uint32_t timeout)
+{
+    if (length)
+    {
+        *length = 0;
+    }
+    if (!buffer || (!data && maxLength))
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_message_buffer_receive_internal(buffer, data, maxLength, length, timeout);
+    ar_trace_object(kArTraceMessageBufferReceive, status, buffer);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_message_buffer_get_next_length(ar_message_buffer_t * buffer)
+{
+    if (!buffer)
+    {
+        return 0;
+    }
+
+    KernelLock guard;
+    if (!buffer->m_count)
+    {
+        return 0;
+    }
+    uint16_t length;
+    ar_message_buffer_copy_out(buffer, buffer->m_head, &length, kArMessageHeaderSize);
+    return length;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_message_buffer_get_count(ar_message_buffer_t * buffer)
+{
+    return buffer ? buffer->m_count : 0;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_message_buffer_get_free(ar_message_buffer_t * buffer)
+{
+    if (!buffer)
+    {
+        return 0;
+    }
+    int32_t freeBytes = ar_message_buffer_get_free_internal(buffer);
+    return freeBytes > 0 ? freeBytes : 0;
+}
+
+// See ar_kernel.h for documentation of this function.
+const char * ar_message_buffer_get_name(ar_message_buffer_t * buffer)
+{
+    return buffer ? buffer->m_name : NULL;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -42,9 +42,9 @@ using namespace Ar;
 //------------------------------------------------------------------------------
 
 static ar_status_t ar_mutex_get_internal(ar_mutex_t * mutex, uint32_t timeout);
-static void ar_mutex_deferred_get(void * object, void * object2);
+static ar_status_t ar_mutex_deferred_get(void * object, void * object2, uint32_t count);
 static ar_status_t ar_mutex_put_internal(ar_mutex_t * mutex);
-static void ar_mutex_deferred_put(void * object, void * object2);
+static ar_status_t ar_mutex_deferred_put(void * object, void * object2, uint32_t count);
 
 //------------------------------------------------------------------------------
 // Implementation
@@ -73,6 +73,8 @@ ar_status_t ar_mutex_create(ar_mutex_t * mutex, const char * name)
     g_ar_objects.mutexes.add(&mutex->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_created(kArTraceMutexObject, mutex, mutex->m_name);
+
     return kArSuccess;
 }
 
@@ -93,71 +95,118 @@ ar_status_t ar_mutex_delete(ar_mutex_t * mutex)
     g_ar_objects.mutexes.remove(&mutex->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_object(kArTraceObjectDeleted, kArTraceMutexObject, mutex);
+
     return kArSuccess;
 }
 
-static ar_status_t ar_mutex_get_internal(ar_mutex_t * mutex, uint32_t timeout)
+//! Raises the owner's priority to that of @a thread if it is lower, remembering the owner's
+//! original priority so ar_mutex_release() can restore it. Does nothing if the mutex has no
+//! owner.
+//!
+//! The kernel must be locked.
+void ar_mutex_hoist_owner(ar_mutex_t * mutex, ar_thread_t * thread)
 {
-    KernelLock guard;
-
-    // If this thread already owns the mutex, just increment the count.
-    if (g_ar.currentThread == mutex->m_owner)
+    if (mutex->m_owner)
     {
-        ++mutex->m_ownerLockCount;
+        ar_thread_hoist_priority(const_cast<ar_thread_t *>(mutex->m_owner), thread->m_priority, mutex->m_originalPriority);
     }
-    // Otherwise attempt to get the mutex.
-    else
+}
+
+//! Blocks the current thread until the mutex is unlocked, then takes ownership of it with a
+//! lock count of 1. The current thread must not already own the mutex.
+//!
+//! The kernel must be locked.
+ar_status_t ar_mutex_acquire(ar_mutex_t * mutex, uint32_t timeout)
+{
+    ar_thread_t * self = g_ar.currentThread;
+
+    // Will we block?
+    while (mutex->m_ownerLockCount != 0)
     {
-        // Will we block?
-        while (mutex->m_ownerLockCount != 0)
+        // Return immediately if the timeout is 0.
+        if (timeout == kArNoTimeout)
         {
-            // Return immediately if the timeout is 0.
-            if (timeout == kArNoTimeout)
-            {
-                return kArTimeoutError;
-            }
-
-            // Check if we need to hoist the owning thread's priority to our own.
-            ar_thread_t * self = g_ar.currentThread;
-            assert(mutex->m_owner);
-            if (self->m_priority > mutex->m_owner->m_priority)
-            {
-                if (!mutex->m_originalPriority)
-                {
-                    mutex->m_originalPriority = mutex->m_owner->m_priority;
-                }
-                mutex->m_owner->m_priority = self->m_priority;
-            }
-
-            // Block this thread on the mutex.
-            self->block(mutex->m_blockedList, timeout);
-
-            // We're back from the scheduler. We'll loop and recheck the ownership counter, in case
-            // a higher priority thread grabbed the lock between when we were unblocked and when we
-            // actually started running.
-
-            // Check for errors and exit early if there was one.
-            if (self->m_unblockStatus != kArSuccess)
-            {
-                //! @todo Need to handle timeout after hoisting the owner thread.
-                // Failed to gain the mutex, probably due to a timeout.
-                mutex->m_blockedList.remove(&self->m_blockedNode);
-                return self->m_unblockStatus;
-            }
+            return kArTimeoutError;
         }
 
-        // Take ownership of the lock.
-        assert(mutex->m_owner == NULL && mutex->m_ownerLockCount == 0);
-        mutex->m_owner = g_ar.currentThread;
-        ++mutex->m_ownerLockCount;
+        // Check if we need to hoist the owning thread's priority to our own.
+        assert(mutex->m_owner);
+        ar_mutex_hoist_owner(mutex, self);
+
+        // Block this thread on the mutex.
+        self->block(mutex->m_blockedList, timeout);
+
+        // We're back from the scheduler. We'll loop and recheck the ownership counter, in case
+        // a higher priority thread grabbed the lock between when we were unblocked and when we
+        // actually started running.
+
+        // Check for errors and exit early if there was one.
+        if (self->m_unblockStatus != kArSuccess)
+        {
+            //! @todo Need to handle timeout after hoisting the owner thread.
+            // Failed to gain the mutex, probably due to a timeout.
+            mutex->m_blockedList.remove(&self->m_blockedNode);
+            return self->m_unblockStatus;
+        }
     }
 
+    // Take ownership of the lock.
+    assert(mutex->m_owner == NULL && mutex->m_ownerLockCount == 0);
+    mutex->m_owner = self;
+    mutex->m_ownerLockCount = 1;
+
     return kArSuccess;
 }
 
-static void ar_mutex_deferred_get(void * object, void * object2)
+//! Clears the owner, restores the owner's priority if it was raised, and unblocks the highest
+//! priority thread waiting on the mutex. The lock count must already be zero.
+//!
+//! The kernel must be locked.
+void ar_mutex_release(ar_mutex_t * mutex)
+{
+    ar_thread_t * self = const_cast<ar_thread_t *>(mutex->m_owner);
+    assert(mutex->m_ownerLockCount == 0);
+
+    // Clear the owner.
+    mutex->m_owner = NULL;
+
+    // Restore the owner's priority if it had been raised.
+    ar_thread_restore_priority(self, mutex->m_originalPriority);
+
+    // Unblock a waiting thread.
+    if (mutex->m_blockedList.m_head)
+    {
+        // Unblock the head of the blocked list.
+        ar_thread_t * thread = mutex->m_blockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(mutex->m_blockedList, kArSuccess);
+    }
+}
+
+static ar_status_t ar_mutex_get_internal(ar_mutex_t * mutex, uint32_t timeout)
+{
+    KernelLock guard;
+
+    // If this thread already owns the mutex, just increment the count.
+    if (g_ar.currentThread == mutex->m_owner)
+    {
+        ++mutex->m_ownerLockCount;
+        return kArSuccess;
+    }
+
+    // Otherwise attempt to get the mutex.
+    return ar_mutex_acquire(mutex, timeout);
+}
+
+static ar_status_t ar_mutex_deferred_get(void * object, void * object2, uint32_t count)
 {
-    ar_mutex_get_internal(reinterpret_cast<ar_mutex_t *>(object), kArNoTimeout);
+    ar_status_t status = kArSuccess;
+    for (; count && status == kArSuccess; --count)
+    {
+        status = ar_mutex_get_internal(reinterpret_cast<ar_mutex_t *>(object), kArNoTimeout);
+    }
+    ar_trace_object(kArTraceMutexGet, status, object);
+    return status;
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -174,7 +223,9 @@ ar_status_t ar_mutex_get(ar_mutex_t * mutex, uint32_t timeout)
         return g_ar.deferredActions.post(ar_mutex_deferred_get, mutex);
     }
 
-    return ar_mutex_get_internal(mutex, timeout);
+    ar_status_t status = ar_mutex_get_internal(mutex, timeout);
+    ar_trace_object(kArTraceMutexGet, status, mutex);
+    return status;
 }
 
 static ar_status_t ar_mutex_put_internal(ar_mutex_t * mutex)
@@ -194,35 +245,25 @@ static ar_status_t ar_mutex_put_internal(ar_mutex_t * mutex)
         return kArNotOwnerError;
     }
 
-    // We are the owner of the mutex, so decrement its recursive lock count.
+    // We are the owner of the mutex, so decrement its recursive lock count. Once it reaches
+    // zero, give up ownership.
     if (--mutex->m_ownerLockCount == 0)
     {
-        // The lock count has reached zero, so clear the owner.
-        mutex->m_owner = NULL;
-
-        // Restore this thread's priority if it had been raised.
-        uint8_t original = mutex->m_originalPriority;
-        if (original)
-        {
-            mutex->m_originalPriority = 0;
-            ar_thread_set_priority(self, original);
-        }
-
-        // Unblock a waiting thread.
-        if (mutex->m_blockedList.m_head)
-        {
-            // Unblock the head of the blocked list.
-            ar_thread_t * thread = mutex->m_blockedList.getHead<ar_thread_t>();
-            thread->unblockWithStatus(mutex->m_blockedList, kArSuccess);
-        }
+        ar_mutex_release(mutex);
     }
 
     return kArSuccess;
 }
 
-static void ar_mutex_deferred_put(void * object, void * object2)
+static ar_status_t ar_mutex_deferred_put(void * object, void * object2, uint32_t count)
 {
-    ar_mutex_put_internal(reinterpret_cast<ar_mutex_t *>(object));
+    ar_status_t status = kArSuccess;
+    for (; count && status == kArSuccess; --count)
+    {
+        status = ar_mutex_put_internal(reinterpret_cast<ar_mutex_t *>(object));
+    }
+    ar_trace_object(kArTraceMutexPut, status, object);
+    return status;
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -239,7 +280,9 @@ ar_status_t ar_mutex_put(ar_mutex_t * mutex)
         return g_ar.deferredActions.post(ar_mutex_deferred_put, mutex);
     }
 
-    return ar_mutex_put_internal(mutex);
+    ar_status_t status = ar_mutex_put_internal(mutex);
+    ar_trace_object(kArTraceMutexPut, status, mutex);
+    return status;
 }
 
 // See ar_kernel.h for documentation of this function.
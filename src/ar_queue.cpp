@@ -46,12 +46,62 @@ using namespace Ar;
 //! @param i Index of the queue element, base 0.
 #define QUEUE_ELEMENT(q, i) (&(q)->m_elements[(q)->m_elementSize * (i)])
 
+//! Packs the heap and staged slot counts of a prioritized queue into a value for #m_slots.
+#define QUEUE_SLOTS(heap, staged) (static_cast<int32_t>(((staged) << 16) | (heap)))
+
+//! Returns the number of slots held by the heap of a prioritized queue.
+#define QUEUE_HEAP_SLOTS(slots) (static_cast<uint32_t>(slots) & 0xffff)
+
+//! Returns the number of slots staged by interrupts in a prioritized queue.
+#define QUEUE_STAGED_SLOTS(slots) (static_cast<uint32_t>(slots) >> 16)
+
+//! @name Mailbox state
+//@{
+#define MAILBOX_LATEST_MASK (0x3)   //!< Slot holding the latest value.
+#define MAILBOX_NO_VALUE (0x3)      //!< Latest slot value when nothing has been sent.
+#define MAILBOX_UNREAD (0x4)        //!< Set when the latest value has not been received.
+#define MAILBOX_BUSY(i) (0x10 << (i))   //!< Set while slot @a i is being written or read.
+#define MAILBOX_BUSY_SHIFT (4)      //!< Bit position of the busy flags.
+#define MAILBOX_GENERATION (0x100)  //!< Added each time a value is made the latest.
+#define MAILBOX_GENERATION_MASK (0xffffff00)    //!< Bits holding the generation count.
+//@}
+
 //------------------------------------------------------------------------------
 // Prototypes
 //------------------------------------------------------------------------------
 
-static ar_status_t ar_queue_send_internal(ar_queue_t * queue, const void * element, uint32_t timeout);
-static void ar_queue_deferred_send(void * object, void * object2);
+static inline int32_t ar_queue_get_free_count(ar_queue_t * queue);
+static uint32_t ar_queue_claim(ar_queue_t * queue, uint32_t count, int32_t * index);
+static void ar_queue_copy_in(ar_queue_t * queue, int32_t index, const void * elements, uint32_t count);
+static uint32_t ar_queue_stage(ar_queue_t * queue, uint32_t count, int32_t * index);
+static void ar_queue_set_keys(ar_queue_t * queue, int32_t index, uint32_t count, uint8_t priority);
+static inline bool ar_queue_precedes(ar_queue_t * queue, uint32_t a, uint32_t b);
+static void ar_queue_swap(ar_queue_t * queue, uint32_t a, uint32_t b);
+static void ar_queue_move(ar_queue_t * queue, uint32_t to, uint32_t from);
+static void ar_queue_sift_up(ar_queue_t * queue, uint32_t index);
+static void ar_queue_remove_root(ar_queue_t * queue);
+static uint32_t ar_queue_publish_staged(ar_queue_t * queue);
+static void ar_queue_remove_head(ar_queue_t * queue, uint32_t count);
+static void ar_queue_hold_head(ar_queue_t * queue);
+static void ar_queue_drop_oldest(ar_queue_t * queue, uint32_t count);
+static void ar_queue_drop_oldest_from_irq(ar_queue_t * queue, uint32_t count);
+static ar_status_t ar_queue_mailbox_send(ar_queue_t * queue, const void * element);
+static void ar_queue_mailbox_read(ar_queue_t * queue, void * element);
+static ar_status_t ar_queue_claim_wait(ar_queue_t * queue, uint32_t count, int32_t * index, uint32_t * claimed, uint32_t timeout);
+static void ar_queue_publish(ar_queue_t * queue, uint32_t written);
+static ar_status_t ar_queue_deferred_publish(void * object, void * object2, uint32_t count);
+static ar_status_t ar_queue_send_from_irq(ar_queue_t * queue, const void * elements, uint32_t count, uint8_t priority, uint32_t * sentCount);
+static ar_status_t ar_queue_send_internal(ar_queue_t * queue, const void * elements, uint32_t count, uint8_t priority, uint32_t * sentCount, uint32_t timeout);
+static ar_status_t ar_queue_reserve_send_internal(ar_queue_t * queue, void ** element, uint32_t timeout);
+static ar_status_t ar_queue_commit_send_internal(ar_queue_t * queue);
+static ar_status_t ar_queue_deferred_commit_send(void * object, void * object2, uint32_t count);
+static ar_status_t ar_queue_wait_for_element(ar_queue_t * queue, uint32_t timeout);
+static void ar_queue_pop(ar_queue_t * queue, unsigned count);
+static ar_status_t ar_queue_receive_internal(ar_queue_t * queue, void * element, uint32_t timeout);
+static ar_status_t ar_queue_receive_n_internal(ar_queue_t * queue, void * elements, uint32_t count, uint32_t * receivedCount, uint32_t timeout);
+static ar_status_t ar_queue_peek_receive_internal(ar_queue_t * queue, void ** element, uint32_t timeout);
+static ar_status_t ar_queue_release_receive_internal(ar_queue_t * queue);
+static ar_status_t ar_queue_deferred_release_receive(void * object, void * object2, uint32_t count);
 
 //------------------------------------------------------------------------------
 // Implementation
@@ -77,15 +127,50 @@ ar_status_t ar_queue_create(ar_queue_t * queue, const char * name, void * storag
     queue->m_capacity = capacity;
 
     queue->m_runLoopNode.m_obj = queue;
+    queue->m_publishNode.m_action = ar_queue_deferred_publish;
+    queue->m_publishNode.m_object = queue;
 
 #if AR_GLOBAL_OBJECT_LISTS
     queue->m_createdNode.m_obj = queue;
     g_ar_objects.queues.add(&queue->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_created(kArTraceQueueObject, queue, queue->m_name);
+
     return kArSuccess;
 }
 
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_create_prioritized(ar_queue_t * queue, const char * name, void * storage, unsigned elementSize, unsigned capacity)
+{
+    if (capacity > 0xffff)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // The keys come first in the storage, so they are word aligned.
+    uint32_t * keys = reinterpret_cast<uint32_t *>(storage);
+    ar_status_t status = ar_queue_create(queue, name, keys + 2 * capacity, elementSize, capacity);
+    if (status == kArSuccess)
+    {
+        queue->m_keys = keys;
+        queue->m_sendBlockedList.m_predicate = ar_thread_sort_by_priority;
+    }
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_create_mailbox(ar_queue_t * queue, const char * name, void * storage, unsigned elementSize)
+{
+    ar_status_t status = ar_queue_create(queue, name, storage, elementSize, 3);
+    if (status == kArSuccess)
+    {
+        queue->m_isMailbox = true;
+        queue->m_mailboxState = MAILBOX_NO_VALUE;
+    }
+    return status;
+}
+
 // See ar_kernel.h for documentation of this function.
 ar_status_t ar_queue_delete(ar_queue_t * queue)
 {
@@ -116,15 +201,506 @@ ar_status_t ar_queue_delete(ar_queue_t * queue)
     g_ar_objects.queues.remove(&queue->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_object(kArTraceObjectDeleted, kArTraceQueueObject, queue);
+
     return kArSuccess;
 }
 
-static ar_status_t ar_queue_send_internal(ar_queue_t * queue, const void * element, uint32_t timeout)
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_set_overwrite(ar_queue_t * queue, bool overwrite)
 {
-    KernelLock guard;
+    if (!queue)
+    {
+        return kArInvalidParameterError;
+    }
+    if (queue->m_keys || queue->m_isMailbox)
+    {
+        return kArInvalidStateError;
+    }
+
+    queue->m_isOverwrite = overwrite;
+    return kArSuccess;
+}
+
+//! Returns the number of slots that are neither holding an element nor claimed by a sender.
+//! Elements dropped by interrupts no longer hold their slots.
+static inline int32_t ar_queue_get_free_count(ar_queue_t * queue)
+{
+    if (queue->m_keys)
+    {
+        int32_t slots = queue->m_slots;
+        return static_cast<int32_t>(queue->m_capacity - QUEUE_HEAP_SLOTS(slots) - QUEUE_STAGED_SLOTS(slots));
+    }
+    return static_cast<int32_t>(queue->m_capacity) - static_cast<int32_t>(queue->m_count) - queue->m_reservedCount + queue->m_droppedCount;
+}
+
+//! Claims up to @a count consecutive slots at the tail of the queue.
+//!
+//! Claims are made with atomic operations and do not need the kernel lock, so interrupts can
+//! claim slots even while a thread is in the middle of a send. Slots are handed out in order
+//! starting at #m_tail, and are added to the queue by ar_queue_publish() once written.
+//!
+//! For a prioritized queue, the slots claimed are the ones just past the end of the heap.
+//! These are only claimed by threads, with the kernel locked.
+//!
+//! @return The number of slots claimed, which is 0 if the queue is full.
+static uint32_t ar_queue_claim(ar_queue_t * queue, uint32_t count, int32_t * index)
+{
+    if (queue->m_keys)
+    {
+        int32_t slots;
+        uint32_t heap;
+        uint32_t n;
+        do {
+            slots = queue->m_slots;
+            heap = QUEUE_HEAP_SLOTS(slots);
+            n = queue->m_capacity - heap - QUEUE_STAGED_SLOTS(slots);
+            if (!n)
+            {
+                return 0;
+            }
+            if (n > count)
+            {
+                n = count;
+            }
+        } while (!ar_atomic_cas32(&queue->m_slots, slots, slots + n));
+
+        *index = heap;
+        return n;
+    }
+
+    // Reserve room.
+    int32_t reserved;
+    int32_t n;
+    do {
+        reserved = queue->m_reservedCount;
+        n = ar_queue_get_free_count(queue);
+        if (n <= 0)
+        {
+            return 0;
+        }
+        if (n > static_cast<int32_t>(count))
+        {
+            n = count;
+        }
+    } while (!ar_atomic_cas32(&queue->m_reservedCount, reserved, reserved + n));
+
+    // Take the slots at the tail.
+    int32_t tail;
+    int32_t newTail;
+    do {
+        tail = queue->m_tail;
+        newTail = tail + n;
+        if (newTail >= static_cast<int32_t>(queue->m_capacity))
+        {
+            newTail -= queue->m_capacity;
+        }
+    } while (!ar_atomic_cas32(&queue->m_tail, tail, newTail));
+
+    *index = tail;
+    return n;
+}
+
+//! Copies elements into claimed slots, in two parts if they wrap around the end of the storage.
+static void ar_queue_copy_in(ar_queue_t * queue, int32_t index, const void * elements, uint32_t count)
+{
+    uint32_t first = queue->m_capacity - index;
+    if (first > count)
+    {
+        first = count;
+    }
+    const uint8_t * source = reinterpret_cast<const uint8_t *>(elements);
+    memcpy(QUEUE_ELEMENT(queue, index), source, first * queue->m_elementSize);
+    if (count > first)
+    {
+        memcpy(queue->m_elements, source + first * queue->m_elementSize, (count - first) * queue->m_elementSize);
+    }
+}
+
+//! Claims up to @a count slots of a prioritized queue for an interrupt.
+//!
+//! Staged slots are taken from the end of the storage downwards, so they never overlap the
+//! heap. The claim is made with an atomic operation on #m_slots, which holds both the heap and
+//! staged slot counts, and is moved into the heap by ar_queue_publish_staged().
+//!
+//! @return The number of slots claimed, which is 0 if the queue is full.
+static uint32_t ar_queue_stage(ar_queue_t * queue, uint32_t count, int32_t * index)
+{
+    int32_t slots;
+    uint32_t staged;
+    uint32_t n;
+    do {
+        slots = queue->m_slots;
+        staged = QUEUE_STAGED_SLOTS(slots);
+        n = queue->m_capacity - QUEUE_HEAP_SLOTS(slots) - staged;
+        if (!n)
+        {
+            return 0;
+        }
+        if (n > count)
+        {
+            n = count;
+        }
+    } while (!ar_atomic_cas32(&queue->m_slots, slots, slots + QUEUE_SLOTS(0, n)));
+
+    *index = queue->m_capacity - staged - n;
+    return n;
+}
+
+//! Sets the keys of newly written slots of a prioritized queue. Sequence numbers are handed
+//! out atomically, so interrupts and threads can set keys at the same time.
+static void ar_queue_set_keys(ar_queue_t * queue, int32_t index, uint32_t count, uint8_t priority)
+{
+    uint32_t sequence = ar_atomic_add32(&queue->m_sequence, count);
+    uint32_t * key = &queue->m_keys[2 * index];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        *key++ = sequence++;
+        *key++ = priority;
+    }
+}
+
+//! Returns whether the element in slot @a a of a prioritized queue must be received before
+//! the element in slot @a b.
+static inline bool ar_queue_precedes(ar_queue_t * queue, uint32_t a, uint32_t b)
+{
+    uint32_t * keyA = &queue->m_keys[2 * a];
+    uint32_t * keyB = &queue->m_keys[2 * b];
+    if (keyA[1] != keyB[1])
+    {
+        return keyA[1] > keyB[1];
+    }
+    // Compare sequence numbers so they can wrap.
+    return static_cast<int32_t>(keyA[0] - keyB[0]) < 0;
+}
+
+//! Exchanges two slots of a prioritized queue, along with their keys.
+static void ar_queue_swap(ar_queue_t * queue, uint32_t a, uint32_t b)
+{
+    uint32_t * keyA = &queue->m_keys[2 * a];
+    uint32_t * keyB = &queue->m_keys[2 * b];
+    uint32_t temp = keyA[0];
+    keyA[0] = keyB[0];
+    keyB[0] = temp;
+    temp = keyA[1];
+    keyA[1] = keyB[1];
+    keyB[1] = temp;
+
+    uint8_t * elementA = QUEUE_ELEMENT(queue, a);
+    uint8_t * elementB = QUEUE_ELEMENT(queue, b);
+    for (unsigned i = 0; i < queue->m_elementSize; ++i)
+    {
+        uint8_t byte = elementA[i];
+        elementA[i] = elementB[i];
+        elementB[i] = byte;
+    }
+}
+
+//! Copies one slot of a prioritized queue over another, along with its key.
+static void ar_queue_move(ar_queue_t * queue, uint32_t to, uint32_t from)
+{
+    queue->m_keys[2 * to] = queue->m_keys[2 * from];
+    queue->m_keys[2 * to + 1] = queue->m_keys[2 * from + 1];
+    memcpy(QUEUE_ELEMENT(queue, to), QUEUE_ELEMENT(queue, from), queue->m_elementSize);
+}
+
+//! Moves the element in slot @a index up the heap until its parent precedes it.
+static void ar_queue_sift_up(ar_queue_t * queue, uint32_t index)
+{
+    while (index)
+    {
+        uint32_t parent = (index - 1) / 2;
+        if (!ar_queue_precedes(queue, index, parent))
+        {
+            break;
+        }
+        ar_queue_swap(queue, index, parent);
+        index = parent;
+    }
+}
+
+//! Removes the root element, which has been read, from the heap of a prioritized queue.
+//!
+//! The last element of the heap replaces the root and is moved down until both of its
+//! children follow it. The kernel must be locked.
+static void ar_queue_remove_root(ar_queue_t * queue)
+{
+    uint32_t count = --queue->m_count;
+    if (count)
+    {
+        ar_queue_move(queue, 0, count);
+
+        uint32_t index = 0;
+        uint32_t child;
+        while ((child = 2 * index + 1) < count)
+        {
+            if (child + 1 < count && ar_queue_precedes(queue, child + 1, child))
+            {
+                ++child;
+            }
+            if (!ar_queue_precedes(queue, child, index))
+            {
+                break;
+            }
+            ar_queue_swap(queue, index, child);
+            index = child;
+        }
+    }
+
+    // Free the last slot of the heap.
+    ar_atomic_add32(&queue->m_slots, -1);
+}
+
+//! Moves elements staged by interrupts into the heap of a prioritized queue.
+//!
+//! Staged slots are moved one at a time, starting with the lowest, which is the one most
+//! recently staged. The heap slot it is copied into is claimed first, so an interrupt cannot
+//! stage into it during the copy. The staged slot is then released with a compare-and-swap
+//! that fails if an interrupt staged more elements meanwhile, since the copied slot is then no
+//! longer the lowest. In that case the copy is dropped and the move is retried.
+//!
+//! Nothing is moved while an interrupt is still writing a staged slot. That interrupt's
+//! deferred publish moves them once it is done.
+//!
+//! The kernel must be locked.
+//!
+//! @return The number of elements added to the heap.
+static uint32_t ar_queue_publish_staged(ar_queue_t * queue)
+{
+    uint32_t moved = 0;
+    while (true)
+    {
+        int32_t slots = queue->m_slots;
+        uint32_t heap = QUEUE_HEAP_SLOTS(slots);
+        uint32_t staged = QUEUE_STAGED_SLOTS(slots);
+        if (!staged || queue->m_writtenCount != static_cast<int32_t>(staged))
+        {
+            break;
+        }
+
+        uint32_t from = queue->m_capacity - staged;
+        if (from == heap)
+        {
+            // The lowest staged slot is already just past the end of the heap.
+            if (!ar_atomic_cas32(&queue->m_slots, slots, slots + 1 - QUEUE_SLOTS(0, 1)))
+            {
+                continue;
+            }
+        }
+        else
+        {
+            if (!ar_atomic_cas32(&queue->m_slots, slots, slots + 1))
+            {
+                continue;
+            }
+            ar_queue_move(queue, heap, from);
+            if (!ar_atomic_cas32(&queue->m_slots, slots + 1, slots + 1 - QUEUE_SLOTS(0, 1)))
+            {
+                // An interrupt staged more elements, so drop the copy and free the heap slot.
+                ar_atomic_add32(&queue->m_slots, -1);
+                continue;
+            }
+        }
+        ar_atomic_add32(&queue->m_writtenCount, -1);
+
+        ar_queue_sift_up(queue, heap);
+        ++queue->m_count;
+        ++moved;
+    }
+    return moved;
+}
+
+//! Removes @a count elements from the head of a FIFO queue without reading them.
+//!
+//! Interrupts that keep sending while the kernel is locked can drop more elements than the
+//! queue holds, so the head may wrap more than once.
+//!
+//! The kernel must be locked.
+static void ar_queue_remove_head(ar_queue_t * queue, uint32_t count)
+{
+    queue->m_head += count;
+    while (queue->m_head >= queue->m_capacity)
+    {
+        queue->m_head -= queue->m_capacity;
+    }
+    queue->m_count -= count;
+}
+
+//! Keeps interrupts from dropping the elements of a FIFO queue, then removes the ones they have
+//! already dropped. The head is released again by clearing #m_isHeadBusy, which ar_queue_pop()
+//! does.
+//!
+//! The kernel must be locked.
+static void ar_queue_hold_head(ar_queue_t * queue)
+{
+    if (queue->m_keys || queue->m_isMailbox)
+    {
+        return;
+    }
+
+    queue->m_isHeadBusy = true;
+
+    // Take back the dropped count before reducing the element count, so the free count seen by
+    // an interrupt never overstates the room in the queue. Dropped elements that have not been
+    // published yet are removed once they are.
+    int32_t dropped = queue->m_droppedCount;
+    if (dropped > static_cast<int32_t>(queue->m_count))
+    {
+        dropped = queue->m_count;
+    }
+    if (dropped)
+    {
+        ar_atomic_add32(&queue->m_droppedCount, -dropped);
+        ar_queue_remove_head(queue, dropped);
+    }
+}
+
+//! Drops the oldest elements of an overwriting queue until there is room for @a count more,
+//! or the queue is empty.
+//!
+//! The kernel must be locked.
+static void ar_queue_drop_oldest(ar_queue_t * queue, uint32_t count)
+{
+    // Pick up elements sent from interrupts first, so they are dropped in order.
+    ar_queue_publish(queue, 0);
+
+    ar_queue_hold_head(queue);
+
+    int32_t needed = static_cast<int32_t>(count) - ar_queue_get_free_count(queue);
+    if (needed > 0 && !queue->m_isReceivePeeked)
+    {
+        if (needed > static_cast<int32_t>(queue->m_count))
+        {
+            needed = queue->m_count;
+        }
+        ar_queue_remove_head(queue, needed);
+    }
+
+    queue->m_isHeadBusy = false;
+}
+
+//! Drops the oldest elements of an overwriting queue from interrupt context, until there is
+//! room for @a count more or no elements are left.
+//!
+//! Interrupts cannot move the head without the kernel lock, so the elements are only counted
+//! in #m_droppedCount, and removed by the next thread to hold the head. Their slots are free
+//! as soon as they are counted. Nothing is dropped while a thread holds the head, or while the
+//! head element is held by ar_queue_peek_receive().
+//!
+//! Elements sent by interrupts while the kernel is locked are not published until it is
+//! unlocked. They follow the published elements in order, so they can be dropped too once
+//! every claimed slot has been written.
+static void ar_queue_drop_oldest_from_irq(ar_queue_t * queue, uint32_t count)
+{
+    int32_t dropped;
+    int32_t needed;
+    do {
+        if (queue->m_isHeadBusy || queue->m_isReceivePeeked)
+        {
+            return;
+        }
+
+        dropped = queue->m_droppedCount;
+        int32_t available = static_cast<int32_t>(queue->m_count) - dropped;
+        int32_t reserved = queue->m_reservedCount;
+        if (queue->m_writtenCount == reserved)
+        {
+            available += reserved;
+        }
+
+        needed = static_cast<int32_t>(count) - ar_queue_get_free_count(queue);
+        if (needed > available)
+        {
+            needed = available;
+        }
+        if (needed <= 0)
+        {
+            return;
+        }
+    } while (!ar_atomic_cas32(&queue->m_droppedCount, dropped, dropped + needed));
+}
+
+//! Makes @a element the latest value of a mailbox.
+//!
+//! The value is written into a slot that holds neither the latest value nor one being read or
+//! written, which is claimed and then published with atomic operations on #m_mailboxState.
+//! If another value is published while this one is being written, it must be from an
+//! interrupt that preempted the caller and is newer, so this one is dropped.
+static ar_status_t ar_queue_mailbox_send(ar_queue_t * queue, const void * element)
+{
+    // Claim a free slot.
+    int32_t state;
+    uint32_t slot;
+    do {
+        state = queue->m_mailboxState;
+        uint32_t used = (state >> MAILBOX_BUSY_SHIFT) & 0x7;
+        if ((state & MAILBOX_LATEST_MASK) != MAILBOX_NO_VALUE)
+        {
+            used |= 1 << (state & MAILBOX_LATEST_MASK);
+        }
+        if (used == 0x7)
+        {
+            return kArQueueFullError;
+        }
+        slot = (used & 0x1) ? ((used & 0x2) ? 2 : 1) : 0;
+    } while (!ar_atomic_cas32(&queue->m_mailboxState, state, state | MAILBOX_BUSY(slot)));
+
+    uint32_t generation = state & MAILBOX_GENERATION_MASK;
+    memcpy(QUEUE_ELEMENT(queue, slot), element, queue->m_elementSize);
+
+    // Make it the latest value, freeing the slot of the previous one.
+    int32_t newState;
+    do {
+        state = queue->m_mailboxState;
+        if ((state & MAILBOX_GENERATION_MASK) != generation)
+        {
+            ar_atomic_add32(&queue->m_mailboxState, -MAILBOX_BUSY(slot));
+            return kArSuccess;
+        }
+        newState = ((state & ~(MAILBOX_LATEST_MASK | MAILBOX_BUSY(slot))) | slot | MAILBOX_UNREAD) + MAILBOX_GENERATION;
+    } while (!ar_atomic_cas32(&queue->m_mailboxState, state, newState));
+
+    // Wake a receiver.
+    g_ar.deferredActions.post(&queue->m_publishNode);
+    return kArSuccess;
+}
+
+//! Copies out the latest value of a mailbox, which must not have been read yet.
+//!
+//! The slot is marked busy while it is copied, so senders do not reuse it even if a newer
+//! value is sent meanwhile.
+//!
+//! The kernel must be locked.
+static void ar_queue_mailbox_read(ar_queue_t * queue, void * element)
+{
+    int32_t state;
+    uint32_t slot;
+    do {
+        state = queue->m_mailboxState;
+        slot = state & MAILBOX_LATEST_MASK;
+    } while (!ar_atomic_cas32(&queue->m_mailboxState, state, (state & ~MAILBOX_UNREAD) | MAILBOX_BUSY(slot)));
+
+    memcpy(element, QUEUE_ELEMENT(queue, slot), queue->m_elementSize);
+    ar_atomic_add32(&queue->m_mailboxState, -MAILBOX_BUSY(slot));
+
+    // A value sent during the copy is counted by its deferred publish.
+    queue->m_count = 0;
+}
+
+//! Blocks until slots can be claimed, then claims up to @a count of them. Slots cannot be
+//! claimed while the queue is full, and also while a slot is reserved by ar_queue_reserve_send().
+//!
+//! The kernel must be locked.
+static ar_status_t ar_queue_claim_wait(ar_queue_t * queue, uint32_t count, int32_t * index, uint32_t * claimed, uint32_t timeout)
+{
+    // Make room in an overwriting queue.
+    if (queue->m_isOverwrite)
+    {
+        ar_queue_drop_oldest(queue, count);
+    }
 
     // Check for full queue.
-    while (queue->m_count >= queue->m_capacity)
+    while (queue->m_isSendReserved || (*claimed = ar_queue_claim(queue, count, index)) == 0)
     {
         // If the queue is full and a zero timeout was given, return immediately.
         if (timeout == kArNoTimeout)
@@ -146,16 +722,72 @@ static ar_status_t ar_queue_send_internal(ar_queue_t * queue, const void * eleme
         }
     }
 
-    // Copy queue element into place.
-    uint8_t * elementSlot = QUEUE_ELEMENT(queue, queue->m_tail);
-    memcpy(elementSlot, element, queue->m_elementSize);
+    return kArSuccess;
+}
 
-    // Update queue tail pointer and count.
-    if (++queue->m_tail >= queue->m_capacity)
+//! Adds claimed slots that have been written to the queue, and wakes a receiver or the queue's
+//! runloop.
+//!
+//! Nothing is added until every claimed slot has been written, so elements always become
+//! visible in order. A sender that was interrupted while writing its slots, or that holds a
+//! reservation, adds the slots of the interrupts that claimed after it once it finishes.
+//!
+//! For a prioritized queue, elements written by a thread are added to the heap right away,
+//! and elements staged by interrupts are moved in by ar_queue_publish_staged().
+//!
+//! @param queue The queue object.
+//! @param written Number of slots the caller has just written that are not yet counted in
+//!     #m_writtenCount. Passing them here saves an atomic operation in the common case. For a
+//!     prioritized queue, these are the slots just past the end of the heap.
+//!
+//! Only one thread is woken in each direction. If room remains, a blocked sender is also
+//! woken, so senders that were waiting behind a reservation or a batch pass the wakeup along.
+//!
+//! The kernel must be locked.
+static void ar_queue_publish(ar_queue_t * queue, uint32_t written)
+{
+    if (queue->m_isMailbox)
     {
-        queue->m_tail = 0;
+        queue->m_count = (queue->m_mailboxState & MAILBOX_UNREAD) ? 1 : 0;
+        if (!queue->m_count)
+        {
+            return;
+        }
+    }
+    else if (queue->m_keys)
+    {
+        // Add the caller's elements to the heap, then the ones staged by interrupts.
+        for (uint32_t i = 0; i < written; ++i)
+        {
+            ar_queue_sift_up(queue, queue->m_count++);
+        }
+        if (!ar_queue_publish_staged(queue) && !written)
+        {
+            return;
+        }
+    }
+    else
+    {
+        int32_t otherWritten = queue->m_writtenCount;
+        int32_t total = otherWritten + written;
+        if (!total || total != queue->m_reservedCount)
+        {
+            if (written)
+            {
+                ar_atomic_add32(&queue->m_writtenCount, written);
+            }
+            return;
+        }
+
+        // Count the elements before releasing their claims, so the free count seen by an
+        // interrupt never overstates the room in the queue.
+        queue->m_count += total;
+        ar_atomic_add32(&queue->m_reservedCount, -total);
+        if (otherWritten)
+        {
+            ar_atomic_add32(&queue->m_writtenCount, -otherWritten);
+        }
     }
-    ++queue->m_count;
 
     // Are there any threads waiting to receive?
     if (queue->m_receiveBlockedList.m_head)
@@ -176,12 +808,90 @@ static ar_status_t ar_queue_send_internal(ar_queue_t * queue, const void * eleme
         }
     }
 
+    // Let another sender have the tail slot if there is room.
+    if (queue->m_sendBlockedList.m_head && !queue->m_isSendReserved && ar_queue_get_free_count(queue) > 0)
+    {
+        ar_thread_t * thread = queue->m_sendBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(queue->m_sendBlockedList, kArSuccess);
+    }
+}
+
+static ar_status_t ar_queue_deferred_publish(void * object, void * object2, uint32_t count)
+{
+    KernelLock guard;
+    ar_queue_t * queue = reinterpret_cast<ar_queue_t *>(object);
+    ar_queue_publish(queue, 0);
+
+    // Remove any elements the sending interrupts dropped, so they are no longer counted.
+    ar_queue_hold_head(queue);
+    queue->m_isHeadBusy = false;
+    return kArSuccess;
+}
+
+//! Sends from interrupt context without blocking.
+//!
+//! The elements are copied into claimed slots right away, so the caller's buffer does not need
+//! to outlive the call. Only adding the elements to the queue and waking a receiver is deferred.
+static ar_status_t ar_queue_send_from_irq(ar_queue_t * queue, const void * elements, uint32_t count, uint8_t priority, uint32_t * sentCount)
+{
+    if (queue->m_isMailbox)
+    {
+        *sentCount = count;
+        return ar_queue_mailbox_send(queue, reinterpret_cast<const uint8_t *>(elements) + (count - 1) * queue->m_elementSize);
+    }
+
+    // Make room in an overwriting queue.
+    if (queue->m_isOverwrite)
+    {
+        ar_queue_drop_oldest_from_irq(queue, count);
+    }
+
+    int32_t index;
+    uint32_t n = queue->m_keys ? ar_queue_stage(queue, count, &index) : ar_queue_claim(queue, count, &index);
+    if (!n)
+    {
+        return kArQueueFullError;
+    }
+
+    ar_queue_copy_in(queue, index, elements, n);
+    if (queue->m_keys)
+    {
+        ar_queue_set_keys(queue, index, n, priority);
+    }
+    ar_atomic_add32(&queue->m_writtenCount, n);
+    *sentCount = n;
+
+    // The elements are already stored, so the send has succeeded even if the deferred action
+    // queue is full. In that case the queue's own node is used to add them.
+    g_ar.deferredActions.post(&queue->m_publishNode);
     return kArSuccess;
 }
 
-static void ar_queue_deferred_send(void * object, void * object2)
+static ar_status_t ar_queue_send_internal(ar_queue_t * queue, const void * elements, uint32_t count, uint8_t priority, uint32_t * sentCount, uint32_t timeout)
 {
-    ar_queue_send_internal(reinterpret_cast<ar_queue_t *>(object), object2, kArNoTimeout);
+    if (queue->m_isMailbox)
+    {
+        *sentCount = count;
+        return ar_queue_mailbox_send(queue, reinterpret_cast<const uint8_t *>(elements) + (count - 1) * queue->m_elementSize);
+    }
+
+    KernelLock guard;
+
+    int32_t index;
+    ar_status_t status = ar_queue_claim_wait(queue, count, &index, sentCount, timeout);
+    if (status != kArSuccess)
+    {
+        return status;
+    }
+
+    ar_queue_copy_in(queue, index, elements, *sentCount);
+    if (queue->m_keys)
+    {
+        ar_queue_set_keys(queue, index, *sentCount, priority);
+    }
+    ar_queue_publish(queue, *sentCount);
+
+    return kArSuccess;
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -192,17 +902,93 @@ ar_status_t ar_queue_send(ar_queue_t * queue, const void * element, uint32_t tim
         return kArInvalidParameterError;
     }
 
-    // Handle irq state by deferring the operation.
+    ar_status_t status;
+    uint32_t n;
+    if (ar_port_get_irq_state())
+    {
+        status = ar_queue_send_from_irq(queue, element, 1, 0, &n);
+    }
+    else
+    {
+        status = ar_queue_send_internal(queue, element, 1, 0, &n, timeout);
+    }
+    ar_trace_object(kArTraceQueueSend, status, queue);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_send_prioritized(ar_queue_t * queue, const void * element, uint8_t priority, uint32_t timeout)
+{
+    if (!queue || !element)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_status_t status;
+    uint32_t n;
+    if (ar_port_get_irq_state())
+    {
+        status = ar_queue_send_from_irq(queue, element, 1, priority, &n);
+    }
+    else
+    {
+        status = ar_queue_send_internal(queue, element, 1, priority, &n, timeout);
+    }
+    ar_trace_object(kArTraceQueueSend, status, queue);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_send_n(ar_queue_t * queue, const void * elements, uint32_t count, uint32_t * sentCount, uint32_t timeout)
+{
+    uint32_t n = 0;
+    if (sentCount)
+    {
+        *sentCount = 0;
+    }
+    if (!queue || !elements || !count)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_status_t status;
     if (ar_port_get_irq_state())
     {
-        return g_ar.deferredActions.post(ar_queue_deferred_send, queue, const_cast<void *>(element));
+        status = ar_queue_send_from_irq(queue, elements, count, 0, &n);
+    }
+    else
+    {
+        status = ar_queue_send_internal(queue, elements, count, 0, &n, timeout);
+    }
+    ar_trace_object(kArTraceQueueSend, status, queue);
+    if (sentCount)
+    {
+        *sentCount = n;
+    }
+    return status;
+}
+
+static ar_status_t ar_queue_reserve_send_internal(ar_queue_t * queue, void ** element, uint32_t timeout)
+{
+    KernelLock guard;
+
+    int32_t index;
+    uint32_t n;
+    ar_status_t status = ar_queue_claim_wait(queue, 1, &index, &n, timeout);
+    if (status != kArSuccess)
+    {
+        return status;
     }
 
-    return ar_queue_send_internal(queue, element, timeout);
+    // Hand out the claimed slot. Other senders wait until it is committed.
+    queue->m_isSendReserved = true;
+    *element = QUEUE_ELEMENT(queue, index);
+
+    return kArSuccess;
 }
 
 // See ar_kernel.h for documentation of this function.
-ar_status_t ar_queue_receive(ar_queue_t * queue, void * element, uint32_t timeout)
+ar_status_t ar_queue_reserve_send(ar_queue_t * queue, void ** element, uint32_t timeout)
 {
     if (!queue || !element)
     {
@@ -212,55 +998,350 @@ ar_status_t ar_queue_receive(ar_queue_t * queue, void * element, uint32_t timeou
     {
         return kArNotFromInterruptError;
     }
+    if (queue->m_keys || queue->m_isMailbox)
+    {
+        return kArInvalidStateError;
+    }
+
+    return ar_queue_reserve_send_internal(queue, element, timeout);
+}
 
+static ar_status_t ar_queue_commit_send_internal(ar_queue_t * queue)
+{
+    KernelLock guard;
+
+    if (!queue->m_isSendReserved)
     {
-        KernelLock guard;
+        return kArInvalidStateError;
+    }
 
-        // Check for empty queue.
-        while (queue->m_count == 0)
-        {
-            if (timeout == kArNoTimeout)
-            {
-                return kArQueueEmptyError;
-            }
+    queue->m_isSendReserved = false;
+    ar_queue_publish(queue, 1);
 
-            // Otherwise block until the queue has room.
-            ar_thread_t * thread = g_ar.currentThread;
-            thread->block(queue->m_receiveBlockedList, timeout);
+    return kArSuccess;
+}
 
-            // We're back from the scheduler.
-            // Check for errors and exit early if there was one.
-            if (thread->m_unblockStatus != kArSuccess)
-            {
-                // Timed out waiting for the queue to not be empty, or another error occurred.
-                queue->m_receiveBlockedList.remove(&thread->m_blockedNode);
-                return thread->m_unblockStatus;
-            }
+static ar_status_t ar_queue_deferred_commit_send(void * object, void * object2, uint32_t count)
+{
+    ar_status_t status = kArSuccess;
+    for (; count && status == kArSuccess; --count)
+    {
+        status = ar_queue_commit_send_internal(reinterpret_cast<ar_queue_t *>(object));
+    }
+    ar_trace_object(kArTraceQueueSend, status, object);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_commit_send(ar_queue_t * queue)
+{
+    if (!queue)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Handle irq state by deferring the operation.
+    if (ar_port_get_irq_state())
+    {
+        return g_ar.deferredActions.post(ar_queue_deferred_commit_send, queue);
+    }
+
+    ar_status_t status = ar_queue_commit_send_internal(queue);
+    ar_trace_object(kArTraceQueueSend, status, queue);
+    return status;
+}
+
+//! Blocks until the head element can be read. The head element is unavailable while the queue
+//! is empty, and also while it is held by ar_queue_peek_receive().
+//!
+//! On success the head is held by ar_queue_hold_head(), so interrupts do not drop the elements
+//! being read. The caller must release it.
+//!
+//! The kernel must be locked.
+static ar_status_t ar_queue_wait_for_element(ar_queue_t * queue, uint32_t timeout)
+{
+    ar_queue_hold_head(queue);
+
+    // Check for empty queue.
+    while (queue->m_isReceivePeeked || queue->m_count == 0)
+    {
+        queue->m_isHeadBusy = false;
+
+        if (timeout == kArNoTimeout)
+        {
+            return kArQueueEmptyError;
         }
 
-        // Read out data.
-        uint8_t * elementSlot = QUEUE_ELEMENT(queue, queue->m_head);
-        memcpy(element, elementSlot, queue->m_elementSize);
+        // Otherwise block until an element is available.
+        ar_thread_t * thread = g_ar.currentThread;
+        thread->block(queue->m_receiveBlockedList, timeout);
 
-        // Update queue head and count.
-        if (++queue->m_head >= queue->m_capacity)
+        // We're back from the scheduler.
+        // Check for errors and exit early if there was one.
+        if (thread->m_unblockStatus != kArSuccess)
         {
-            queue->m_head = 0;
+            // Timed out waiting for the queue to not be empty, or another error occurred.
+            queue->m_receiveBlockedList.remove(&thread->m_blockedNode);
+            return thread->m_unblockStatus;
         }
-        --queue->m_count;
 
-        // Are there any threads waiting to send?
-        if (queue->m_sendBlockedList.m_head)
+        ar_queue_hold_head(queue);
+    }
+
+    return kArSuccess;
+}
+
+//! Removes the elements at the head of the queue, which have been read, and wakes a sender.
+//!
+//! If elements remain, a blocked receiver is also woken, so receivers pass the wakeup along
+//! in the same way as senders do in ar_queue_push().
+//!
+//! The head of a prioritized queue is the root of its heap, which is always in slot 0, so
+//! only one element can be read and popped at a time.
+//!
+//! The kernel must be locked.
+static void ar_queue_pop(ar_queue_t * queue, unsigned count)
+{
+    if (queue->m_keys)
+    {
+        assert(count == 1);
+        ar_queue_remove_root(queue);
+    }
+    else
+    {
+        // Update queue head and count, then let interrupts drop elements again.
+        ar_queue_remove_head(queue, count);
+        queue->m_isHeadBusy = false;
+    }
+
+    // Are there any threads waiting to send?
+    if (queue->m_sendBlockedList.m_head)
+    {
+        // Unblock the head of the blocked list.
+        ar_thread_t * thread = queue->m_sendBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(queue->m_sendBlockedList, kArSuccess);
+    }
+
+    // Let another receiver have the head element if there is one.
+    if (queue->m_receiveBlockedList.m_head && !queue->m_isReceivePeeked && queue->m_count)
+    {
+        ar_thread_t * thread = queue->m_receiveBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(queue->m_receiveBlockedList, kArSuccess);
+    }
+}
+
+static ar_status_t ar_queue_receive_internal(ar_queue_t * queue, void * element, uint32_t timeout)
+{
+    KernelLock guard;
+
+    ar_status_t status = ar_queue_wait_for_element(queue, timeout);
+    if (status != kArSuccess)
+    {
+        return status;
+    }
+
+    if (queue->m_isMailbox)
+    {
+        ar_queue_mailbox_read(queue, element);
+        return kArSuccess;
+    }
+
+    // Read out data.
+    uint8_t * elementSlot = QUEUE_ELEMENT(queue, queue->m_head);
+    memcpy(element, elementSlot, queue->m_elementSize);
+
+    ar_queue_pop(queue, 1);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_receive(ar_queue_t * queue, void * element, uint32_t timeout)
+{
+    if (!queue || !element)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_queue_receive_internal(queue, element, timeout);
+    ar_trace_object(kArTraceQueueReceive, status, queue);
+    return status;
+}
+
+static ar_status_t ar_queue_receive_n_internal(ar_queue_t * queue, void * elements, uint32_t count, uint32_t * receivedCount, uint32_t timeout)
+{
+    KernelLock guard;
+
+    ar_status_t status = ar_queue_wait_for_element(queue, timeout);
+    if (status != kArSuccess)
+    {
+        return status;
+    }
+
+    // Receive as many elements as are available.
+    unsigned n = queue->m_count;
+    if (n > count)
+    {
+        n = count;
+    }
+
+    uint8_t * dest = reinterpret_cast<uint8_t *>(elements);
+    if (queue->m_isMailbox)
+    {
+        ar_queue_mailbox_read(queue, dest);
+
+        *receivedCount = 1;
+        return kArSuccess;
+    }
+    else if (queue->m_keys)
+    {
+        // Take the elements off the heap one at a time, leaving the last for ar_queue_pop().
+        for (unsigned i = 1; i < n; ++i)
         {
-            // Unblock the head of the blocked list.
-            ar_thread_t * thread = queue->m_sendBlockedList.getHead<ar_thread_t>();
-            thread->unblockWithStatus(queue->m_sendBlockedList, kArSuccess);
+            memcpy(dest, QUEUE_ELEMENT(queue, 0), queue->m_elementSize);
+            dest += queue->m_elementSize;
+            ar_queue_remove_root(queue);
         }
+        memcpy(dest, QUEUE_ELEMENT(queue, 0), queue->m_elementSize);
+        ar_queue_pop(queue, 1);
+
+        *receivedCount = n;
+        return kArSuccess;
+    }
+
+    // Copy the elements out, in two parts if they wrap around the end of the storage.
+    unsigned first = queue->m_capacity - queue->m_head;
+    if (first > n)
+    {
+        first = n;
+    }
+    memcpy(dest, QUEUE_ELEMENT(queue, queue->m_head), first * queue->m_elementSize);
+    if (n > first)
+    {
+        memcpy(dest + first * queue->m_elementSize, queue->m_elements, (n - first) * queue->m_elementSize);
+    }
+
+    ar_queue_pop(queue, n);
+
+    *receivedCount = n;
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_receive_n(ar_queue_t * queue, void * elements, uint32_t count, uint32_t * receivedCount, uint32_t timeout)
+{
+    uint32_t n = 0;
+    if (receivedCount)
+    {
+        *receivedCount = 0;
+    }
+    if (!queue || !elements || !count)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_queue_receive_n_internal(queue, elements, count, &n, timeout);
+    ar_trace_object(kArTraceQueueReceive, status, queue);
+    if (receivedCount)
+    {
+        *receivedCount = n;
+    }
+    return status;
+}
+
+static ar_status_t ar_queue_peek_receive_internal(ar_queue_t * queue, void ** element, uint32_t timeout)
+{
+    KernelLock guard;
+
+    ar_status_t status = ar_queue_wait_for_element(queue, timeout);
+    if (status != kArSuccess)
+    {
+        return status;
     }
 
+    // Hand out the head element. Other receivers wait until it is released, and interrupts do
+    // not drop it.
+    queue->m_isReceivePeeked = true;
+    queue->m_isHeadBusy = false;
+    *element = QUEUE_ELEMENT(queue, queue->m_head);
+
     return kArSuccess;
 }
 
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_peek_receive(ar_queue_t * queue, void ** element, uint32_t timeout)
+{
+    if (!queue || !element)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+    if (queue->m_keys || queue->m_isMailbox)
+    {
+        return kArInvalidStateError;
+    }
+
+    return ar_queue_peek_receive_internal(queue, element, timeout);
+}
+
+static ar_status_t ar_queue_release_receive_internal(ar_queue_t * queue)
+{
+    KernelLock guard;
+
+    if (!queue->m_isReceivePeeked)
+    {
+        return kArInvalidStateError;
+    }
+
+    // Hold the head until it is popped, now that it is no longer protected by the peek.
+    queue->m_isHeadBusy = true;
+    queue->m_isReceivePeeked = false;
+    ar_queue_pop(queue, 1);
+
+    return kArSuccess;
+}
+
+static ar_status_t ar_queue_deferred_release_receive(void * object, void * object2, uint32_t count)
+{
+    ar_status_t status = kArSuccess;
+    for (; count && status == kArSuccess; --count)
+    {
+        status = ar_queue_release_receive_internal(reinterpret_cast<ar_queue_t *>(object));
+    }
+    ar_trace_object(kArTraceQueueReceive, status, object);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_queue_release_receive(ar_queue_t * queue)
+{
+    if (!queue)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Handle irq state by deferring the operation.
+    if (ar_port_get_irq_state())
+    {
+        return g_ar.deferredActions.post(ar_queue_deferred_release_receive, queue);
+    }
+
+    ar_status_t status = ar_queue_release_receive_internal(queue);
+    ar_trace_object(kArTraceQueueReceive, status, queue);
+    return status;
+}
+
 // See ar_kernel.h for documentation of this function.
 const char * ar_queue_get_name(ar_queue_t * queue)
 {
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for Ar microkernel read-copy-update.
+ *
+ * A thread is counted as a reader when the scheduler runs while the thread is inside a
+ * read-side critical section, which is always the case for a reader that is preempted or
+ * blocks inside one. It stays counted until the scheduler runs again after the thread has
+ * left the section. A counted reader enters the scheduler as it leaves its section if a writer
+ * is waiting, so it is released right away. Readers are counted in one of two counts, selected
+ * by the low bit of the grace period generation. Starting a grace period switches new readers
+ * to the other count, so the grace period ends when the count it started with reaches zero.
+ */
+
+#include "ar_internal.h"
+
+using namespace Ar;
+
+#if AR_ENABLE_RCU
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static ar_status_t ar_rcu_wait(uint32_t slot, uint32_t start, uint32_t timeout);
+static ar_status_t ar_rcu_synchronize_internal(uint32_t timeout);
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+// See ar_kernel.h for documentation of this function.
+void ar_rcu_read_lock(void)
+{
+    ar_thread_t * thread = g_ar.currentThread;
+    if (thread)
+    {
+        ++thread->m_rcuNesting;
+    }
+}
+
+// See ar_kernel.h for documentation of this function.
+void ar_rcu_read_unlock(void)
+{
+    ar_thread_t * thread = g_ar.currentThread;
+    if (thread)
+    {
+        assert(thread->m_rcuNesting);
+        if (--thread->m_rcuNesting == 0)
+        {
+            thread->m_hasRcuExited = true;
+
+            // Let the scheduler take this thread out of the reader count now if a writer is
+            // waiting, rather than whenever it next switches threads.
+            if (thread->m_isRcuReader && g_ar.rcuWaitingList.m_head)
+            {
+                ar_kernel_enter_scheduler();
+            }
+        }
+    }
+}
+
+// See ar_kernel.h for documentation of this function.
+void * ar_rcu_exchange(void * volatile * pointer, void * value)
+{
+    assert(!ar_port_get_irq_state());
+
+    // Locking the kernel is an atomic operation, which is also a barrier that makes the
+    // contents of the new version visible before the pointer to it.
+    KernelLock guard;
+    void * oldValue = *pointer;
+    *pointer = value;
+    return oldValue;
+}
+
+//! The scheduler calls this for the current thread each time it runs.
+//!
+//! The kernel must be locked.
+void ar_rcu_note_thread(ar_thread_t * thread)
+{
+    // A reader that has exited the section it was counted for is done with it, even if it has
+    // entered another one since. Otherwise a thread that is nearly always reading could hold
+    // up writers forever.
+    if (thread->m_isRcuReader && (thread->m_hasRcuExited || !thread->m_rcuNesting))
+    {
+        ar_rcu_remove_reader(thread);
+    }
+    thread->m_hasRcuExited = false;
+
+    if (thread->m_rcuNesting && !thread->m_isRcuReader)
+    {
+        thread->m_isRcuReader = true;
+        thread->m_rcuSlot = g_ar.rcuGeneration & 1;
+        ++g_ar.rcuReaderCounts[thread->m_rcuSlot];
+    }
+}
+
+//! The kernel must be locked.
+void ar_rcu_remove_reader(ar_thread_t * thread)
+{
+    thread->m_isRcuReader = false;
+    if (--g_ar.rcuReaderCounts[thread->m_rcuSlot] == 0)
+    {
+        // Waiters check which count they need to be zero.
+        while (g_ar.rcuWaitingList.m_head)
+        {
+            ar_thread_t * waiter = g_ar.rcuWaitingList.getHead<ar_thread_t>();
+            if (waiter->m_state == kArThreadBlocked)
+            {
+                waiter->unblockWithStatus(g_ar.rcuWaitingList, kArSuccess);
+            }
+            else
+            {
+                // The waiter has timed out, so it is already ready but has not yet run to take
+                // itself off the list.
+                g_ar.rcuWaitingList.remove(&waiter->m_blockedNode);
+                waiter->m_unblockStatus = kArSuccess;
+            }
+        }
+    }
+}
+
+//! @brief Block until the reader count for @a slot reaches zero.
+//!
+//! Waiters are woken whenever either count reaches zero, so the wait is repeated with the time
+//! that remains until the count for @a slot is the one that did.
+//!
+//! The kernel must be locked.
+static ar_status_t ar_rcu_wait(uint32_t slot, uint32_t start, uint32_t timeout)
+{
+    ar_thread_t * thread = g_ar.currentThread;
+    while (g_ar.rcuReaderCounts[slot])
+    {
+        uint32_t remaining = timeout;
+        if (timeout != kArInfiniteTimeout)
+        {
+            uint32_t elapsed = ar_get_millisecond_count() - start;
+            if (elapsed >= timeout)
+            {
+                return kArTimeoutError;
+            }
+            remaining = timeout - elapsed;
+        }
+
+        thread->block(g_ar.rcuWaitingList, remaining);
+
+        // We're back from the scheduler.
+        // Check for errors and exit early if there was one.
+        if (thread->m_unblockStatus != kArSuccess)
+        {
+            g_ar.rcuWaitingList.remove(&thread->m_blockedNode);
+            return thread->m_unblockStatus;
+        }
+    }
+
+    return kArSuccess;
+}
+
+static ar_status_t ar_rcu_synchronize_internal(uint32_t timeout)
+{
+    KernelLock guard;
+
+    // There are no readers before the kernel starts.
+    ar_thread_t * thread = g_ar.currentThread;
+    if (!thread)
+    {
+        return kArSuccess;
+    }
+    if (thread->m_rcuNesting)
+    {
+        return kArInvalidStateError;
+    }
+
+    // The caller is outside of any critical section, so it may have been counted only for one
+    // it has since left.
+    if (thread->m_isRcuReader)
+    {
+        ar_rcu_remove_reader(thread);
+    }
+
+    // Readers left over from an earlier grace period that has not ended are also readers that
+    // entered before this call, and their count must be free before it can be reused.
+    uint32_t start = ar_get_millisecond_count();
+    ar_status_t status = ar_rcu_wait((g_ar.rcuGeneration + 1) & 1, start, timeout);
+    if (status != kArSuccess)
+    {
+        return status;
+    }
+
+    // Start a new grace period. Readers counted from now on entered their sections after the
+    // caller published, so only those already counted need to finish.
+    uint32_t slot = g_ar.rcuGeneration & 1;
+    ++g_ar.rcuGeneration;
+    return ar_rcu_wait(slot, start, timeout);
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_rcu_synchronize(uint32_t timeout)
+{
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_rcu_synchronize_internal(timeout);
+    ar_trace_object(kArTraceRcuSynchronize, status, g_ar.currentThread);
+    return status;
+}
+
+#endif // AR_ENABLE_RCU
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
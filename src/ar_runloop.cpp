@@ -56,13 +56,14 @@ ar_status_t ar_runloop_create(ar_runloop_t * runloop, const char * name)
     memset(runloop, 0, sizeof(ar_runloop_t));
 
     runloop->m_name = name ? name : AR_ANONYMOUS_OBJECT_NAME;
-    runloop->m_timers.m_predicate = ar_timer_sort_by_wakeup;
 
 #if AR_GLOBAL_OBJECT_LISTS
     runloop->m_createdNode.m_obj = runloop;
     g_ar_objects.runloops.add(&runloop->m_createdNode);
 #endif
 
+    ar_trace_created(kArTraceRunLoopObject, runloop, runloop->m_name);
+
     return kArSuccess;
 }
 
@@ -86,6 +87,8 @@ ar_status_t ar_runloop_delete(ar_runloop_t * runloop)
     g_ar_objects.runloops.remove(&runloop->m_createdNode);
 #endif
 
+    ar_trace_object(kArTraceObjectDeleted, kArTraceRunLoopObject, runloop);
+
     return kArSuccess;
 }
 
@@ -132,11 +135,10 @@ ar_status_t ar_runloop_run(ar_runloop_t * runloop, uint32_t timeout, ar_runloop_
     }
 
     // Prepare timeout.
-    uint32_t startTime = g_ar.tickCount;
-    uint32_t timeoutTicks = timeout;
+    uint64_t timeoutTime = 0;
     if (timeout != kArInfiniteTimeout)
     {
-        timeoutTicks = ar_milliseconds_to_ticks(timeout);
+        timeoutTime = ar_get_microseconds() + timeout * 1000ull;
     }
 
     ar_status_t returnStatus = kArRunLoopStopped;
@@ -159,6 +161,7 @@ ar_status_t ar_runloop_run(ar_runloop_t * runloop, uint32_t timeout, ar_runloop_
             runloop->m_functionHead = iPlusOne;
 
             assert(fn.function);
+            ar_trace_object(kArTraceRunLoopFunction, 0, reinterpret_cast<void *>(fn.function));
             fn.function(fn.param);
         }
 
@@ -177,6 +180,7 @@ ar_status_t ar_runloop_run(ar_runloop_t * runloop, uint32_t timeout, ar_runloop_
                 if (queue->m_runLoopHandler)
                 {
                     // Call out to run loop queue source handler.
+                    ar_trace_object(kArTraceRunLoopQueue, 0, queue);
                     queue->m_runLoopHandler(queue, queue->m_runLoopHandlerParam);
                 }
                 else
@@ -193,46 +197,66 @@ ar_status_t ar_runloop_run(ar_runloop_t * runloop, uint32_t timeout, ar_runloop_
             }
         }
 
-        // Check timeout. Adjust the timeout based on how long we've run so far.
-        uint32_t blockTimeoutTicks = timeoutTicks;
-        if (blockTimeoutTicks != kArInfiniteTimeout)
+        // Check pending message buffers.
+        if (!runloop->m_messageBuffers.isEmpty())
         {
-            uint32_t deltaTicks = g_ar.tickCount - startTime;
-            if (deltaTicks >= timeoutTicks)
+            ar_message_buffer_t * buffer = runloop->m_messageBuffers.getHead<ar_message_buffer_t>();
+            assert(buffer);
+            if (buffer->m_count < 2)
+            {
+                runloop->m_messageBuffers.remove(&buffer->m_runLoopNode);
+            }
+
+            if (buffer->m_count > 0)
             {
-                // Timed out, exit runloop.
-                returnStatus = kArTimeoutError;
-                break;
+                if (buffer->m_runLoopHandler)
+                {
+                    // Call out to run loop message buffer source handler.
+                    buffer->m_runLoopHandler(buffer, buffer->m_runLoopHandlerParam);
+                }
+                else
+                {
+                    // No handler associated with this message buffer, so exit the run loop.
+                    if (object)
+                    {
+                        object->m_messageBuffer = buffer;
+                    }
+
+                    returnStatus = kArRunLoopMessageBufferReceived;
+                    break;
+                }
             }
-            blockTimeoutTicks -= deltaTicks;
         }
 
-        // Make sure we don't sleep past the next scheduled timer.
-        if (!runloop->m_timers.isEmpty())
+        // Check timeout.
+        if (timeoutTime && ar_get_microseconds() >= timeoutTime)
         {
-            ar_timer_t * timer = runloop->m_timers.getHead<ar_timer_t>();
-
-            // Timers should always have a wakeup time in the future.
-            assert (timer->m_wakeupTime >= g_ar.tickCount);
+            // Timed out, exit runloop.
+            returnStatus = kArTimeoutError;
+            break;
+        }
 
-            uint32_t wakeupDeltaTicks = timer->m_wakeupTime - g_ar.tickCount;
-            // kArInfiniteTimeout is the max 32-bit value, so wakeupDeltaTicks will always be <=
-            if (wakeupDeltaTicks < blockTimeoutTicks)
-            {
-                blockTimeoutTicks = wakeupDeltaTicks;
-            }
+        // Make sure we don't sleep past the next scheduled timer. A wakeup time of 0 means
+        // there is nothing to wake for.
+        uint64_t wakeupTime = timeoutTime;
+        ar_timer_t * timer = runloop->m_timers.getMin();
+        if (timer && (!wakeupTime || timer->m_wakeupTime < wakeupTime))
+        {
+            wakeupTime = timer->m_wakeupTime;
         }
 
         // Don't sleep if there are queued functions or sources.
-        if (!runloop->m_functionCount && runloop->m_queues.isEmpty())
+        if (!runloop->m_functionCount && runloop->m_queues.isEmpty() && runloop->m_messageBuffers.isEmpty())
         {
-            // Sleep the runloop's thread for the adjusted timeout.
-            uint32_t blockTimeout = (blockTimeoutTicks == kArInfiniteTimeout)
-                                        ? kArInfiniteTimeout
-                                        : ar_ticks_to_milliseconds(blockTimeoutTicks);
-            if (blockTimeout)
+            // Sleep the runloop's thread until the wakeup time. This returns immediately if
+            // a timer is already due.
+            if (wakeupTime)
             {
-                ar_thread_sleep(blockTimeout);
+                ar_thread_sleep_until_us(wakeupTime);
+            }
+            else
+            {
+                ar_thread_sleep(kArInfiniteTimeout);
             }
         }
     } while (!runloop->m_stop);
@@ -332,6 +356,27 @@ ar_status_t ar_runloop_add_queue(ar_runloop_t * runloop, ar_queue_t * queue, ar_
     return kArSuccess;
 }
 
+ar_status_t ar_runloop_add_message_buffer(ar_runloop_t * runloop, ar_message_buffer_t * buffer, ar_runloop_message_buffer_handler_t callback, void * param)
+{
+    if (!runloop || !buffer)
+    {
+        return kArInvalidParameterError;
+    }
+
+    // A message buffer can only be added to one runloop at a time.
+    if (buffer->m_runLoop != NULL && buffer->m_runLoop != runloop)
+    {
+        return kArAlreadyAttachedError;
+    }
+
+    // Set runloop on the message buffer.
+    buffer->m_runLoopHandler = callback;
+    buffer->m_runLoopHandlerParam = param;
+    buffer->m_runLoop = runloop;
+
+    return kArSuccess;
+}
+
 ar_runloop_t * ar_runloop_get_current(void)
 {
     return g_ar.currentThread->m_runLoop;
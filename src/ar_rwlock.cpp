@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for Ar microkernel reader-writer locks.
+ */
+
+#include "ar_internal.h"
+#include <string.h>
+#include <assert.h>
+
+using namespace Ar;
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static ar_rwlock_reader_t * ar_rwlock_find_reader(ar_rwlock_t * rwlock, ar_thread_t * thread);
+static void ar_rwlock_hoist_holders(ar_rwlock_t * rwlock, ar_thread_t * thread);
+static void ar_rwlock_wake(ar_rwlock_t * rwlock);
+static ar_status_t ar_rwlock_read_get_internal(ar_rwlock_t * rwlock, uint32_t timeout);
+static ar_status_t ar_rwlock_read_put_internal(ar_rwlock_t * rwlock);
+static ar_status_t ar_rwlock_write_get_internal(ar_rwlock_t * rwlock, uint32_t timeout);
+static ar_status_t ar_rwlock_write_put_internal(ar_rwlock_t * rwlock);
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_rwlock_create(ar_rwlock_t * rwlock, const char * name)
+{
+    if (!rwlock)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    memset(rwlock, 0, sizeof(ar_rwlock_t));
+    rwlock->m_name = name ? name : AR_ANONYMOUS_OBJECT_NAME;
+
+    // Set the blocked lists to sort by priority.
+    rwlock->m_readBlockedList.m_predicate = ar_thread_sort_by_priority;
+    rwlock->m_writeBlockedList.m_predicate = ar_thread_sort_by_priority;
+
+#if AR_GLOBAL_OBJECT_LISTS
+    rwlock->m_createdNode.m_obj = rwlock;
+    g_ar_objects.rwlocks.add(&rwlock->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_created(kArTraceRWLockObject, rwlock, rwlock->m_name);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_rwlock_delete(ar_rwlock_t * rwlock)
+{
+    if (!rwlock)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    {
+        KernelLock guard;
+
+        // Unblock all waiting threads.
+        while (rwlock->m_readBlockedList.m_head)
+        {
+            rwlock->m_readBlockedList.getHead<ar_thread_t>()->unblockWithStatus(rwlock->m_readBlockedList, kArObjectDeletedError);
+        }
+        while (rwlock->m_writeBlockedList.m_head)
+        {
+            rwlock->m_writeBlockedList.getHead<ar_thread_t>()->unblockWithStatus(rwlock->m_writeBlockedList, kArObjectDeletedError);
+        }
+    }
+
+#if AR_GLOBAL_OBJECT_LISTS
+    g_ar_objects.rwlocks.remove(&rwlock->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_object(kArTraceObjectDeleted, kArTraceRWLockObject, rwlock);
+
+    return kArSuccess;
+}
+
+//! @brief Find the reader slot belonging to a thread.
+//!
+//! Pass NULL for @a thread to find a free slot.
+static ar_rwlock_reader_t * ar_rwlock_find_reader(ar_rwlock_t * rwlock, ar_thread_t * thread)
+{
+    for (uint32_t i = 0; i < AR_RWLOCK_MAX_READERS; ++i)
+    {
+        if (rwlock->m_readers[i].m_thread == thread)
+        {
+            return &rwlock->m_readers[i];
+        }
+    }
+    return NULL;
+}
+
+//! Raises the writer holding the lock, or else every reader holding it, to the priority of
+//! @a thread, which is about to block on the lock. This is the same priority inheritance that
+//! mutexes use.
+static void ar_rwlock_hoist_holders(ar_rwlock_t * rwlock, ar_thread_t * thread)
+{
+    if (rwlock->m_writer)
+    {
+        ar_thread_hoist_priority(const_cast<ar_thread_t *>(rwlock->m_writer), thread->m_priority, rwlock->m_writerOriginalPriority);
+        return;
+    }
+
+    for (uint32_t i = 0; i < AR_RWLOCK_MAX_READERS; ++i)
+    {
+        ar_rwlock_reader_t & reader = rwlock->m_readers[i];
+        if (reader.m_thread)
+        {
+            ar_thread_hoist_priority(reader.m_thread, thread->m_priority, reader.m_originalPriority);
+        }
+    }
+}
+
+//! Called whenever the lock is released, or a waiting writer gives up. A waiting writer is
+//! preferred, and is woken once the last reader leaves. Readers are only woken when no writer
+//! is waiting, and then only as many as there are free reader slots.
+static void ar_rwlock_wake(ar_rwlock_t * rwlock)
+{
+    if (rwlock->m_writer)
+    {
+        return;
+    }
+
+    if (rwlock->m_writeBlockedList.m_head)
+    {
+        if (rwlock->m_readerCount == 0)
+        {
+            ar_thread_t * thread = rwlock->m_writeBlockedList.getHead<ar_thread_t>();
+            thread->unblockWithStatus(rwlock->m_writeBlockedList, kArSuccess);
+        }
+        return;
+    }
+
+    uint32_t freeSlots = AR_RWLOCK_MAX_READERS - rwlock->m_readerCount;
+    while (freeSlots && rwlock->m_readBlockedList.m_head)
+    {
+        ar_thread_t * thread = rwlock->m_readBlockedList.getHead<ar_thread_t>();
+        thread->unblockWithStatus(rwlock->m_readBlockedList, kArSuccess);
+        --freeSlots;
+    }
+}
+
+static ar_status_t ar_rwlock_read_get_internal(ar_rwlock_t * rwlock, uint32_t timeout)
+{
+    KernelLock guard;
+
+    ar_thread_t * self = g_ar.currentThread;
+    if (rwlock->m_writer == self)
+    {
+        return kArInvalidStateError;
+    }
+
+    // If this thread already holds the read lock, just increment its count. This is allowed even
+    // with a writer waiting, since the writer can't proceed until we release anyway.
+    ar_rwlock_reader_t * reader = ar_rwlock_find_reader(rwlock, self);
+    if (reader)
+    {
+        ++reader->m_lockCount;
+        return kArSuccess;
+    }
+
+    // Wait while there is a writer, a writer waiting, or no free reader slot.
+    while (rwlock->m_writer || rwlock->m_writeBlockedList.m_head || rwlock->m_readerCount == AR_RWLOCK_MAX_READERS)
+    {
+        // Return immediately if the timeout is 0.
+        if (timeout == kArNoTimeout)
+        {
+            return kArTimeoutError;
+        }
+
+        ar_rwlock_hoist_holders(rwlock, self);
+
+        // Block this thread on the lock.
+        self->block(rwlock->m_readBlockedList, timeout);
+
+        // Check for errors and exit early if there was one. Only a timeout leaves the thread on
+        // the blocked list.
+        if (self->m_unblockStatus != kArSuccess)
+        {
+            if (self->m_unblockStatus == kArTimeoutError)
+            {
+                rwlock->m_readBlockedList.remove(&self->m_blockedNode);
+            }
+            return self->m_unblockStatus;
+        }
+    }
+
+    // Take a reader slot.
+    reader = ar_rwlock_find_reader(rwlock, NULL);
+    assert(reader);
+    reader->m_thread = self;
+    reader->m_lockCount = 1;
+    reader->m_originalPriority = 0;
+    ++rwlock->m_readerCount;
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_rwlock_read_get(ar_rwlock_t * rwlock, uint32_t timeout)
+{
+    if (!rwlock)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_rwlock_read_get_internal(rwlock, timeout);
+    ar_trace_object(kArTraceRWLockReadGet, status, rwlock);
+    return status;
+}
+
+static ar_status_t ar_rwlock_read_put_internal(ar_rwlock_t * rwlock)
+{
+    KernelLock guard;
+
+    ar_thread_t * self = g_ar.currentThread;
+    ar_rwlock_reader_t * reader = ar_rwlock_find_reader(rwlock, self);
+    if (!reader)
+    {
+        return kArNotOwnerError;
+    }
+
+    if (--reader->m_lockCount == 0)
+    {
+        // Give up the reader slot, restoring our priority if a writer raised it.
+        reader->m_thread = NULL;
+        --rwlock->m_readerCount;
+        ar_thread_restore_priority(self, reader->m_originalPriority);
+
+        ar_rwlock_wake(rwlock);
+    }
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_rwlock_read_put(ar_rwlock_t * rwlock)
+{
+    if (!rwlock)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_rwlock_read_put_internal(rwlock);
+    ar_trace_object(kArTraceRWLockReadPut, status, rwlock);
+    return status;
+}
+
+static ar_status_t ar_rwlock_write_get_internal(ar_rwlock_t * rwlock, uint32_t timeout)
+{
+    KernelLock guard;
+
+    // If this thread already holds the write lock, just increment the count.
+    ar_thread_t * self = g_ar.currentThread;
+    if (rwlock->m_writer == self)
+    {
+        ++rwlock->m_writerLockCount;
+        return kArSuccess;
+    }
+
+    // We would wait forever for ourself to release the read lock.
+    if (ar_rwlock_find_reader(rwlock, self))
+    {
+        return kArInvalidStateError;
+    }
+
+    while (rwlock->m_writer || rwlock->m_readerCount)
+    {
+        // Return immediately if the timeout is 0.
+        if (timeout == kArNoTimeout)
+        {
+            return kArTimeoutError;
+        }
+
+        ar_rwlock_hoist_holders(rwlock, self);
+
+        // Block this thread on the lock. While we wait, new readers are held off.
+        self->block(rwlock->m_writeBlockedList, timeout);
+
+        // Check for errors and exit early if there was one.
+        if (self->m_unblockStatus != kArSuccess)
+        {
+            if (self->m_unblockStatus == kArTimeoutError)
+            {
+                // Readers we were holding off may be able to proceed now.
+                rwlock->m_writeBlockedList.remove(&self->m_blockedNode);
+                ar_rwlock_wake(rwlock);
+            }
+            return self->m_unblockStatus;
+        }
+    }
+
+    // Take the write lock.
+    rwlock->m_writer = self;
+    rwlock->m_writerLockCount = 1;
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_rwlock_write_get(ar_rwlock_t * rwlock, uint32_t timeout)
+{
+    if (!rwlock)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_rwlock_write_get_internal(rwlock, timeout);
+    ar_trace_object(kArTraceRWLockWriteGet, status, rwlock);
+    return status;
+}
+
+static ar_status_t ar_rwlock_write_put_internal(ar_rwlock_t * rwlock)
+{
+    KernelLock guard;
+
+    ar_thread_t * self = g_ar.currentThread;
+    if (rwlock->m_writer != self)
+    {
+        return kArNotOwnerError;
+    }
+
+    if (--rwlock->m_writerLockCount == 0)
+    {
+        // Give up the write lock, restoring our priority if it was raised.
+        rwlock->m_writer = NULL;
+        ar_thread_restore_priority(self, rwlock->m_writerOriginalPriority);
+
+        ar_rwlock_wake(rwlock);
+    }
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_rwlock_write_put(ar_rwlock_t * rwlock)
+{
+    if (!rwlock)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_status_t status = ar_rwlock_write_put_internal(rwlock);
+    ar_trace_object(kArTraceRWLockWritePut, status, rwlock);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+const char * ar_rwlock_get_name(ar_rwlock_t * rwlock)
+{
+    return rwlock ? rwlock->m_name : NULL;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -42,9 +42,9 @@ using namespace Ar;
 //------------------------------------------------------------------------------
 
 static ar_status_t ar_semaphore_get_internal(ar_semaphore_t * sem, uint32_t timeout);
-static void ar_semaphore_deferred_get(void * object, void * object2);
-static ar_status_t ar_semaphore_put_internal(ar_semaphore_t * sem);
-static void ar_semaphore_deferred_put(void * object, void * object2);
+static ar_status_t ar_semaphore_deferred_get(void * object, void * object2, uint32_t count);
+static ar_status_t ar_semaphore_put_internal(ar_semaphore_t * sem, uint32_t count);
+static ar_status_t ar_semaphore_deferred_put(void * object, void * object2, uint32_t count);
 
 //------------------------------------------------------------------------------
 // Code
@@ -71,6 +71,8 @@ ar_status_t ar_semaphore_create(ar_semaphore_t * sem, const char * name, unsigne
     g_ar_objects.semaphores.add(&sem->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_created(kArTraceSemaphoreObject, sem, sem->m_name);
+
     return kArSuccess;
 }
 
@@ -96,6 +98,8 @@ ar_status_t ar_semaphore_delete(ar_semaphore_t * sem)
     g_ar_objects.semaphores.remove(&sem->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
+    ar_trace_object(kArTraceObjectDeleted, kArTraceSemaphoreObject, sem);
+
     return kArSuccess;
 }
 
@@ -135,9 +139,15 @@ static ar_status_t ar_semaphore_get_internal(ar_semaphore_t * sem, uint32_t time
     return kArSuccess;
 }
 
-static void ar_semaphore_deferred_get(void * object, void * object2)
+static ar_status_t ar_semaphore_deferred_get(void * object, void * object2, uint32_t count)
 {
-    ar_semaphore_get_internal(reinterpret_cast<ar_semaphore_t *>(object), kArNoTimeout);
+    ar_status_t status = kArSuccess;
+    for (; count && status == kArSuccess; --count)
+    {
+        status = ar_semaphore_get_internal(reinterpret_cast<ar_semaphore_t *>(object), kArNoTimeout);
+    }
+    ar_trace_object(kArTraceSemaphoreGet, status, object);
+    return status;
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -160,20 +170,21 @@ ar_status_t ar_semaphore_get(ar_semaphore_t * sem, uint32_t timeout)
         return g_ar.deferredActions.post(ar_semaphore_deferred_get, sem);
     }
 
-    return ar_semaphore_get_internal(sem, timeout);
+    ar_status_t status = ar_semaphore_get_internal(sem, timeout);
+    ar_trace_object(kArTraceSemaphoreGet, status, sem);
+    return status;
 }
 
-static ar_status_t ar_semaphore_put_internal(ar_semaphore_t * sem)
+static ar_status_t ar_semaphore_put_internal(ar_semaphore_t * sem, uint32_t count)
 {
     KernelLock guard;
 
     // Increment count.
-    ++sem->m_count;
+    sem->m_count += count;
 
-    // Are there any threads waiting on this semaphore?
-    if (sem->m_blockedList.m_head)
+    // Unblock a waiting thread for each unit of the put, from the head of the blocked list.
+    for (; count && sem->m_blockedList.m_head; --count)
     {
-        // Unblock the head of the blocked list.
         ar_thread_t * thread = sem->m_blockedList.getHead<ar_thread_t>();
         thread->unblockWithStatus(sem->m_blockedList, kArSuccess);
     }
@@ -181,9 +192,11 @@ static ar_status_t ar_semaphore_put_internal(ar_semaphore_t * sem)
     return kArSuccess;
 }
 
-static void ar_semaphore_deferred_put(void * object, void * object2)
+static ar_status_t ar_semaphore_deferred_put(void * object, void * object2, uint32_t count)
 {
-    ar_semaphore_put_internal(reinterpret_cast<ar_semaphore_t *>(object));
+    ar_status_t status = ar_semaphore_put_internal(reinterpret_cast<ar_semaphore_t *>(object), count);
+    ar_trace_object(kArTraceSemaphorePut, status, object);
+    return status;
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -200,7 +213,9 @@ ar_status_t ar_semaphore_put(ar_semaphore_t * sem)
         return g_ar.deferredActions.post(ar_semaphore_deferred_put, sem);
     }
 
-    return ar_semaphore_put_internal(sem);
+    ar_status_t status = ar_semaphore_put_internal(sem, 1);
+    ar_trace_object(kArTraceSemaphorePut, status, sem);
+    return status;
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for Ar microkernel seqlocks.
+ */
+
+#include "ar_internal.h"
+#include <string.h>
+
+using namespace Ar;
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static ar_status_t ar_seqlock_write_internal(ar_seqlock_t * seqlock, const void * data);
+static ar_status_t ar_seqlock_read_internal(ar_seqlock_t * seqlock, void * data);
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_seqlock_create(ar_seqlock_t * seqlock, const char * name, void * storage, uint32_t size)
+{
+    if (!seqlock || !storage || !size)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    memset(seqlock, 0, sizeof(ar_seqlock_t));
+    seqlock->m_name = name ? name : AR_ANONYMOUS_OBJECT_NAME;
+    seqlock->m_data = reinterpret_cast<uint8_t *>(storage);
+    seqlock->m_size = size;
+
+#if AR_GLOBAL_OBJECT_LISTS
+    seqlock->m_createdNode.m_obj = seqlock;
+    g_ar_objects.seqlocks.add(&seqlock->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_created(kArTraceSeqlockObject, seqlock, seqlock->m_name);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_seqlock_delete(ar_seqlock_t * seqlock)
+{
+    if (!seqlock)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+#if AR_GLOBAL_OBJECT_LISTS
+    g_ar_objects.seqlocks.remove(&seqlock->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_object(kArTraceObjectDeleted, kArTraceSeqlockObject, seqlock);
+
+    return kArSuccess;
+}
+
+//! @brief Copy in new data between two increments of the sequence.
+//!
+//! The first increment is made with a compare and swap from an even value, so a writer that
+//! preempted another one fails instead of mixing its data with the other's.
+static ar_status_t ar_seqlock_write_internal(ar_seqlock_t * seqlock, const void * data)
+{
+    int32_t sequence;
+    do {
+        sequence = seqlock->m_sequence;
+        if (sequence & 1)
+        {
+            return kArInvalidStateError;
+        }
+    } while (!ar_atomic_cas32(&seqlock->m_sequence, sequence, sequence + 1));
+
+    memcpy(seqlock->m_data, data, seqlock->m_size);
+
+    // The atomic add performs a barrier first, so the data is stored before the sequence
+    // becomes even again.
+    ar_atomic_add32(&seqlock->m_sequence, 1);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_seqlock_write(ar_seqlock_t * seqlock, const void * data)
+{
+    if (!seqlock || !data)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_status_t status;
+    if (ar_port_get_irq_state())
+    {
+        status = ar_seqlock_write_internal(seqlock, data);
+    }
+    else
+    {
+        // Keep reader threads from preempting the write, since they would retry until it is
+        // finished.
+        KernelLock guard;
+        status = ar_seqlock_write_internal(seqlock, data);
+    }
+
+    ar_trace_object(kArTraceSeqlockWrite, status, seqlock);
+    return status;
+}
+
+//! @brief Copy out the data until the sequence is even and unchanged across the copy.
+//!
+//! The sequence is read with an atomic add of 0 rather than a plain load, because the atomic
+//! operation is also a compiler and memory barrier. That keeps the copy between the two reads.
+static ar_status_t ar_seqlock_read_internal(ar_seqlock_t * seqlock, void * data)
+{
+    while (true)
+    {
+        int32_t sequence = ar_atomic_add32(&seqlock->m_sequence, 0);
+        if (sequence & 1)
+        {
+            // An interrupt handler that preempted the writer would wait forever.
+            if (ar_port_get_irq_state())
+            {
+                return kArInvalidStateError;
+            }
+            continue;
+        }
+
+        memcpy(data, seqlock->m_data, seqlock->m_size);
+
+        if (ar_atomic_add32(&seqlock->m_sequence, 0) == sequence)
+        {
+            return kArSuccess;
+        }
+    }
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_seqlock_read(ar_seqlock_t * seqlock, void * data)
+{
+    if (!seqlock || !data)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_status_t status = ar_seqlock_read_internal(seqlock, data);
+    ar_trace_object(kArTraceSeqlockRead, status, seqlock);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_seqlock_get_write_count(ar_seqlock_t * seqlock)
+{
+    return seqlock ? static_cast<uint32_t>(seqlock->m_sequence) >> 1 : 0;
+}
+
+// See ar_kernel.h for documentation of this function.
+const char * ar_seqlock_get_name(ar_seqlock_t * seqlock)
+{
+    return seqlock ? seqlock->m_name : NULL;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
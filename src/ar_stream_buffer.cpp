@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for Ar microkernel stream buffers.
+ */
+
+#include "ar_internal.h"
+#include <string.h>
+
+using namespace Ar;
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static uint32_t ar_stream_buffer_clamp_trigger_level(ar_stream_buffer_t * sb, uint32_t triggerLevel);
+static void ar_stream_buffer_wake_reader(ar_stream_buffer_t * sb);
+static ar_status_t ar_stream_buffer_deferred_wake_reader(void * object, void * object2, uint32_t count);
+static void ar_stream_buffer_check_reader(ar_stream_buffer_t * sb);
+static uint32_t ar_stream_buffer_copy_out(ar_stream_buffer_t * sb, void * data, uint32_t length);
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+//! @brief Limit a trigger level to between 1 and the capacity.
+static uint32_t ar_stream_buffer_clamp_trigger_level(ar_stream_buffer_t * sb, uint32_t triggerLevel)
+{
+    if (triggerLevel == 0)
+    {
+        return 1;
+    }
+    else if (triggerLevel > sb->m_capacity)
+    {
+        return sb->m_capacity;
+    }
+    return triggerLevel;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_stream_buffer_create(ar_stream_buffer_t * sb, const char * name, void * storage, uint32_t capacity, uint32_t triggerLevel)
+{
+    if (!sb || !storage || !capacity)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    memset(sb, 0, sizeof(ar_stream_buffer_t));
+    sb->m_name = name ? name : AR_ANONYMOUS_OBJECT_NAME;
+    sb->m_data = reinterpret_cast<uint8_t *>(storage);
+    sb->m_capacity = capacity;
+    sb->m_triggerLevel = ar_stream_buffer_clamp_trigger_level(sb, triggerLevel);
+    sb->m_wakeNode.m_action = ar_stream_buffer_deferred_wake_reader;
+    sb->m_wakeNode.m_object = sb;
+
+#if AR_GLOBAL_OBJECT_LISTS
+    sb->m_createdNode.m_obj = sb;
+    g_ar_objects.streamBuffers.add(&sb->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_created(kArTraceStreamBufferObject, sb, sb->m_name);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_stream_buffer_delete(ar_stream_buffer_t * sb)
+{
+    if (!sb)
+    {
+        return kArInvalidParameterError;
+    }
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    {
+        KernelLock guard;
+
+        // Unblock the reader.
+        sb->m_isReaderWaiting = false;
+        while (sb->m_blockedList.m_head)
+        {
+            sb->m_blockedList.getHead<ar_thread_t>()->unblockWithStatus(sb->m_blockedList, kArObjectDeletedError);
+        }
+    }
+
+#if AR_GLOBAL_OBJECT_LISTS
+    g_ar_objects.streamBuffers.remove(&sb->m_createdNode);
+#endif // AR_GLOBAL_OBJECT_LISTS
+
+    ar_trace_object(kArTraceObjectDeleted, kArTraceStreamBufferObject, sb);
+
+    return kArSuccess;
+}
+
+//! @brief Unblock the reader if the trigger level has been reached.
+//!
+//! The kernel must be locked.
+static void ar_stream_buffer_wake_reader(ar_stream_buffer_t * sb)
+{
+    if (sb->m_blockedList.m_head && ar_stream_buffer_get_count(sb) >= sb->m_triggerLevel)
+    {
+        sb->m_isReaderWaiting = false;
+        sb->m_blockedList.getHead<ar_thread_t>()->unblockWithStatus(sb->m_blockedList, kArSuccess);
+    }
+}
+
+static ar_status_t ar_stream_buffer_deferred_wake_reader(void * object, void * object2, uint32_t count)
+{
+    KernelLock guard;
+    ar_stream_buffer_wake_reader(reinterpret_cast<ar_stream_buffer_t *>(object));
+    return kArSuccess;
+}
+
+//! @brief Wake the reader if it is waiting and the trigger level has been reached.
+//!
+//! This is the only place the writer touches the kernel, and it does so at most once per
+//! blocked read, because the wakeup clears #m_isReaderWaiting.
+static void ar_stream_buffer_check_reader(ar_stream_buffer_t * sb)
+{
+    if (!sb->m_isReaderWaiting || ar_stream_buffer_get_count(sb) < sb->m_triggerLevel)
+    {
+        return;
+    }
+
+    if (ar_port_get_irq_state())
+    {
+        g_ar.deferredActions.post(&sb->m_wakeNode);
+    }
+    else
+    {
+        KernelLock guard;
+        ar_stream_buffer_wake_reader(sb);
+    }
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_stream_buffer_write(ar_stream_buffer_t * sb, const void * data, uint32_t length, uint32_t * bytesWritten)
+{
+    if (bytesWritten)
+    {
+        *bytesWritten = 0;
+    }
+    if (!sb || (!data && length))
+    {
+        return kArInvalidParameterError;
+    }
+
+    // Write as many bytes as there is room for.
+    uint32_t n = ar_stream_buffer_get_free(sb);
+    if (n > length)
+    {
+        n = length;
+    }
+    if (n == 0)
+    {
+        ar_status_t status = length ? kArQueueFullError : kArSuccess;
+        ar_trace_object(kArTraceStreamBufferWrite, status, sb);
+        return status;
+    }
+
+    // Copy the bytes in, in two parts if they wrap around the end of the storage.
+    uint32_t first = sb->m_capacity - sb->m_tail;
+    if (first > n)
+    {
+        first = n;
+    }
+    const uint8_t * source = reinterpret_cast<const uint8_t *>(data);
+    memcpy(&sb->m_data[sb->m_tail], source, first);
+    memcpy(sb->m_data, source + first, n - first);
+
+    sb->m_tail += n;
+    if (sb->m_tail >= sb->m_capacity)
+    {
+        sb->m_tail -= sb->m_capacity;
+    }
+
+    // Make sure the bytes are in memory before the reader can see them.
+    __DSB();
+    sb->m_writeCount += n;
+
+    ar_stream_buffer_check_reader(sb);
+
+    if (bytesWritten)
+    {
+        *bytesWritten = n;
+    }
+    ar_trace_object(kArTraceStreamBufferWrite, kArSuccess, sb);
+    return kArSuccess;
+}
+
+//! @brief Copy out up to @a length available bytes and release their space to the writer.
+static uint32_t ar_stream_buffer_copy_out(ar_stream_buffer_t * sb, void * data, uint32_t length)
+{
+    uint32_t n = ar_stream_buffer_get_count(sb);
+    if (n > length)
+    {
+        n = length;
+    }
+
+    // Make sure the bytes counted are read from memory after the count.
+    __DSB();
+
+    // Copy the bytes out, in two parts if they wrap around the end of the storage.
+    uint32_t first = sb->m_capacity - sb->m_head;
+    if (first > n)
+    {
+        first = n;
+    }
+    uint8_t * dest = reinterpret_cast<uint8_t *>(data);
+    memcpy(dest, &sb->m_data[sb->m_head], first);
+    memcpy(dest + first, sb->m_data, n - first);
+
+    sb->m_head += n;
+    if (sb->m_head >= sb->m_capacity)
+    {
+        sb->m_head -= sb->m_capacity;
+    }
+
+    // Finish reading before the writer can reuse the space.
+    __DSB();
+    sb->m_readCount += n;
+
+    return n;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_stream_buffer_read(ar_stream_buffer_t * sb, void * data, uint32_t length, uint32_t * bytesRead, uint32_t timeout)
+{
+    if (bytesRead)
+    {
+        *bytesRead = 0;
+    }
+    if (!sb || !data || !length)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_status_t status = kArSuccess;
+    if (ar_port_get_irq_state())
+    {
+        timeout = kArNoTimeout;
+    }
+
+    // Block until the trigger level is reached.
+    if (timeout != kArNoTimeout && ar_stream_buffer_get_count(sb) < sb->m_triggerLevel)
+    {
+        KernelLock guard;
+
+        // Announce that we are waiting before checking the count again, so a writer that adds
+        // bytes in between either sees the flag or is seen by the check.
+        sb->m_isReaderWaiting = true;
+        if (ar_stream_buffer_get_count(sb) < sb->m_triggerLevel)
+        {
+            ar_thread_t * thread = g_ar.currentThread;
+            thread->block(sb->m_blockedList, timeout);
+
+            // We're back from the scheduler.
+            status = thread->m_unblockStatus;
+            if (status == kArTimeoutError)
+            {
+                sb->m_blockedList.remove(&thread->m_blockedNode);
+            }
+        }
+        sb->m_isReaderWaiting = false;
+
+        if (status == kArObjectDeletedError)
+        {
+            ar_trace_object(kArTraceStreamBufferRead, status, sb);
+            return status;
+        }
+    }
+
+    // Read whatever is available, even if the wait timed out.
+    uint32_t n = ar_stream_buffer_copy_out(sb, data, length);
+    if (bytesRead)
+    {
+        *bytesRead = n;
+    }
+
+    if (n)
+    {
+        status = kArSuccess;
+    }
+    else if (timeout == kArNoTimeout)
+    {
+        status = kArQueueEmptyError;
+    }
+    ar_trace_object(kArTraceStreamBufferRead, status, sb);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_stream_buffer_set_trigger_level(ar_stream_buffer_t * sb, uint32_t triggerLevel)
+{
+    if (!sb)
+    {
+        return kArInvalidParameterError;
+    }
+
+    sb->m_triggerLevel = ar_stream_buffer_clamp_trigger_level(sb, triggerLevel);
+
+    // A lower level may already be met.
+    ar_stream_buffer_check_reader(sb);
+
+    return kArSuccess;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_stream_buffer_get_count(ar_stream_buffer_t * sb)
+{
+    return sb ? sb->m_writeCount - sb->m_readCount : 0;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_stream_buffer_get_free(ar_stream_buffer_t * sb)
+{
+    return sb ? sb->m_capacity - (sb->m_writeCount - sb->m_readCount) : 0;
+}
+
+// See ar_kernel.h for documentation of this function.
+const char * ar_stream_buffer_get_name(ar_stream_buffer_t * sb)
+{
+    return sb ? sb->m_name : NULL;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
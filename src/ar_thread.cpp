@@ -43,9 +43,13 @@ using namespace Ar;
 //------------------------------------------------------------------------------
 
 static ar_status_t ar_thread_resume_internal(ar_thread_t * thread);
-static void ar_thread_deferred_resume(void * object, void * object2);
+static ar_status_t ar_thread_deferred_resume(void * object, void * object2, uint32_t count);
 static ar_status_t ar_thread_suspend_internal(ar_thread_t * thread);
-static void ar_thread_deferred_suspend(void * object, void * object2);
+static ar_status_t ar_thread_deferred_suspend(void * object, void * object2, uint32_t count);
+static void ar_thread_notify_update(ar_thread_t * thread, ar_notify_action_t action, uint32_t value);
+static ar_status_t ar_thread_notify_wake(ar_thread_t * thread);
+static ar_status_t ar_thread_deferred_notify_wake(void * object, void * object2, uint32_t count);
+static bool ar_thread_add_to_report(ar_thread_t * thread, void * param);
 
 //------------------------------------------------------------------------------
 // Code
@@ -103,7 +107,7 @@ ar_status_t ar_thread_create(ar_thread_t * thread, const char * name, ar_thread_
         g_ar.suspendedList.add(thread);
     }
 
-    ar_trace_2(kArTraceThreadCreated, 0, thread);
+    ar_trace_created(kArTraceThreadObject, thread, thread->m_name);
 
     // Resume thread if requested.
     if (startImmediately)
@@ -137,7 +141,7 @@ ar_status_t ar_thread_delete(ar_thread_t * thread)
     g_ar_objects.threads.remove(&thread->m_createdNode);
 #endif // AR_GLOBAL_OBJECT_LISTS
 
-    ar_trace_2(kArTraceThreadDeleted, 0, thread);
+    ar_trace_object(kArTraceObjectDeleted, kArTraceThreadObject, thread);
 
     // Remove from whatever list the thread is on, and set state to done.
     // If we're deleting the current thread, then execution will never proceed past
@@ -158,6 +162,13 @@ ar_status_t ar_thread_delete(ar_thread_t * thread)
                 break;
 
             case kArThreadBlocked:
+                // Blocked threads are only on the sleeping list if they have a timeout.
+                if (thread->m_wakeupTime)
+                {
+                    g_ar.sleepingList.remove(thread);
+                }
+                break;
+
             case kArThreadSleeping:
                 g_ar.sleepingList.remove(thread);
                 break;
@@ -169,8 +180,18 @@ ar_status_t ar_thread_delete(ar_thread_t * thread)
                 return kArInvalidStateError;
         }
 
+#if AR_ENABLE_RCU
+        // A finished thread cannot be reading, so grace periods must not wait for it.
+        if (thread->m_isRcuReader)
+        {
+            ar_rcu_remove_reader(thread);
+        }
+        thread->m_rcuNesting = 0;
+#endif // AR_ENABLE_RCU
+
         // Mark thread as finished.
         thread->m_state = kArThreadDone;
+        ar_trace_object(kArTraceThreadState, kArThreadDone, thread);
 
         // Are we deleting ourself?
         if (thread == g_ar.currentThread)
@@ -208,12 +229,13 @@ static ar_status_t ar_thread_resume_internal(ar_thread_t * thread)
 
     // Put the thread back on the ready list.
     thread->m_state = kArThreadReady;
+    ar_trace_object(kArTraceThreadState, kArThreadReady, thread);
     g_ar.readyList.add(thread);
     ar_kernel_update_round_robin();
 
     // yield to scheduler if there is not a running thread or if this thread
     // has a higher priority that the running one
-    if (thread->m_priority > g_ar.currentThread->m_priority)
+    if (!g_ar.currentThread || thread->m_priority > g_ar.currentThread->m_priority)
     {
         g_ar.flags.needsReschedule = true;
     }
@@ -221,9 +243,9 @@ static ar_status_t ar_thread_resume_internal(ar_thread_t * thread)
     return kArSuccess;
 }
 
-static void ar_thread_deferred_resume(void * object, void * object2)
+static ar_status_t ar_thread_deferred_resume(void * object, void * object2, uint32_t count)
 {
-    ar_thread_resume_internal(reinterpret_cast<ar_thread_t *>(object));
+    return ar_thread_resume_internal(reinterpret_cast<ar_thread_t *>(object));
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -296,6 +318,7 @@ static ar_status_t ar_thread_suspend_internal(ar_thread_t * thread)
 
     // Move the thread to the suspended list.
     thread->m_state = kArThreadSuspended;
+    ar_trace_object(kArTraceThreadState, kArThreadSuspended, thread);
     g_ar.suspendedList.add(thread);
 
     // are we suspending the current thread?
@@ -307,9 +330,9 @@ static ar_status_t ar_thread_suspend_internal(ar_thread_t * thread)
     return kArSuccess;
 }
 
-static void ar_thread_deferred_suspend(void * object, void * object2)
+static ar_status_t ar_thread_deferred_suspend(void * object, void * object2, uint32_t count)
 {
-    ar_thread_suspend_internal(reinterpret_cast<ar_thread_t *>(object));
+    return ar_thread_suspend_internal(reinterpret_cast<ar_thread_t *>(object));
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -372,19 +395,24 @@ ar_status_t ar_thread_set_priority(ar_thread_t * thread, uint8_t priority)
     {
         KernelLock guard;
 
-        // Set new priority.
-        thread->m_priority = priority;
-
-        // Resort ready list.
+        // Move a ready thread to its new priority in the ready list. The thread must be removed
+        // before its priority is changed.
         if (thread->m_state == kArThreadReady || thread->m_state == kArThreadRunning)
         {
             g_ar.readyList.remove(thread);
+            thread->m_priority = priority;
             g_ar.readyList.add(thread);
             ar_kernel_update_round_robin();
         }
-        else if (thread->m_state == kArThreadBlocked)
+        else
         {
-            //! @todo Resort blocked list and handle priority inheritence.
+            // Set new priority.
+            thread->m_priority = priority;
+
+            if (thread->m_state == kArThreadBlocked)
+            {
+                //! @todo Resort blocked list and handle priority inheritence.
+            }
         }
 
         g_ar.flags.needsReschedule = true;
@@ -393,6 +421,40 @@ ar_status_t ar_thread_set_priority(ar_thread_t * thread, uint8_t priority)
     return kArSuccess;
 }
 
+//! Used for priority inheritance by locks. The first time the thread is raised on behalf of a
+//! lock, its priority is saved in @a originalPriority, which belongs to the lock, so that
+//! ar_thread_restore_priority() can undo it when the thread releases the lock.
+//!
+//! @param thread The thread holding the lock.
+//! @param priority Priority of the thread waiting for the lock.
+//! @param[in,out] originalPriority The holder's saved priority, or 0 if it has not been raised.
+void ar_thread_hoist_priority(ar_thread_t * thread, uint8_t priority, uint8_t & originalPriority)
+{
+    if (priority > thread->m_priority)
+    {
+        if (!originalPriority)
+        {
+            originalPriority = thread->m_priority;
+        }
+
+        // Use ar_thread_set_priority() so a ready thread is moved in the ready list.
+        ar_thread_set_priority(thread, priority);
+    }
+}
+
+//! @param thread The thread releasing the lock.
+//! @param[in,out] originalPriority The thread's saved priority, or 0 if it was not raised.
+//!     Cleared on return.
+void ar_thread_restore_priority(ar_thread_t * thread, uint8_t & originalPriority)
+{
+    uint8_t original = originalPriority;
+    if (original)
+    {
+        originalPriority = 0;
+        ar_thread_set_priority(thread, original);
+    }
+}
+
 // See ar_kernel.h for documentation of this function.
 void ar_thread_sleep(uint32_t milliseconds)
 {
@@ -415,12 +477,34 @@ void ar_thread_sleep(uint32_t milliseconds)
     }
     else
     {
-        ar_thread_sleep_until(ar_ticks_to_milliseconds(g_ar.tickCount) + milliseconds);
+        ar_thread_sleep_until_us(ar_get_microseconds() + milliseconds * 1000ull);
+    }
+}
+
+// See ar_kernel.h for documentation of this function.
+void ar_thread_sleep_us(uint64_t microseconds)
+{
+    if (microseconds)
+    {
+        ar_thread_sleep_until_us(ar_get_microseconds() + microseconds);
     }
 }
 
 // See ar_kernel.h for documentation of this function.
 void ar_thread_sleep_until(uint32_t wakeup)
+{
+    // The wakeup time is relative to the 32-bit millisecond count, so compare using the
+    // signed difference to handle the count wrapping.
+    uint64_t now = ar_get_microseconds();
+    int32_t delta = static_cast<int32_t>(wakeup - static_cast<uint32_t>(now / 1000));
+    if (delta > 0)
+    {
+        ar_thread_sleep_until_us((now / 1000 + delta) * 1000);
+    }
+}
+
+// See ar_kernel.h for documentation of this function.
+void ar_thread_sleep_until_us(uint64_t wakeup)
 {
     // Cannot sleep in interrup context.
     if (ar_port_get_irq_state())
@@ -429,7 +513,7 @@ void ar_thread_sleep_until(uint32_t wakeup)
     }
 
     // bail if there is not a running thread to put to sleep
-    if (wakeup <= ar_get_millisecond_count() || !g_ar.currentThread)
+    if (wakeup <= ar_get_microseconds() || !g_ar.currentThread)
     {
         return;
     }
@@ -438,10 +522,11 @@ void ar_thread_sleep_until(uint32_t wakeup)
         KernelLock guard;
 
         // put the current thread on the sleeping list
-        g_ar.currentThread->m_wakeupTime = ar_milliseconds_to_ticks(wakeup);
+        g_ar.currentThread->m_wakeupTime = wakeup;
 
         g_ar.readyList.remove(g_ar.currentThread);
         g_ar.currentThread->m_state = kArThreadSleeping;
+        ar_trace_object(kArTraceThreadState, kArThreadSleeping, g_ar.currentThread);
         g_ar.sleepingList.add(g_ar.currentThread);
         ar_kernel_update_round_robin();
 
@@ -450,6 +535,149 @@ void ar_thread_sleep_until(uint32_t wakeup)
     }
 }
 
+//! @brief Updates a thread's notification value and marks it pending.
+//!
+//! The value is only ever changed with atomic operations, so interrupts can notify without
+//! locking the kernel, even while the thread itself is clearing bits.
+static void ar_thread_notify_update(ar_thread_t * thread, ar_notify_action_t action, uint32_t value)
+{
+    int32_t oldValue;
+    switch (action)
+    {
+        case kArNotifyIncrement:
+            ar_atomic_add32(&thread->m_notifyValue, 1);
+            break;
+        case kArNotifySetBits:
+            do {
+                oldValue = thread->m_notifyValue;
+            } while (!ar_atomic_cas32(&thread->m_notifyValue, oldValue, oldValue | static_cast<int32_t>(value)));
+            break;
+        case kArNotifyOverwrite:
+            do {
+                oldValue = thread->m_notifyValue;
+            } while (!ar_atomic_cas32(&thread->m_notifyValue, oldValue, static_cast<int32_t>(value)));
+            break;
+    }
+    thread->m_isNotifyPending = true;
+}
+
+//! @brief Unblocks the thread if it is waiting for a notification.
+static ar_status_t ar_thread_notify_wake(ar_thread_t * thread)
+{
+    KernelLock guard;
+
+    // The thread is the only one on its wait list, so a list headed by its blocked node is
+    // enough to unblock it.
+    if (thread->m_isWaitingForNotify && thread->m_state == kArThreadBlocked)
+    {
+        ar_list_t waitList = { &thread->m_blockedNode, NULL };
+        thread->unblockWithStatus(waitList, kArSuccess);
+    }
+
+    return kArSuccess;
+}
+
+static ar_status_t ar_thread_deferred_notify_wake(void * object, void * object2, uint32_t count)
+{
+    return ar_thread_notify_wake(reinterpret_cast<ar_thread_t *>(object));
+}
+
+//! From interrupt context the value is updated right away, and only waking the thread is
+//! deferred, and only if the thread is waiting. So notifying a thread that is busy costs an
+//! interrupt a few atomic operations, and does not use the deferred action queue.
+ar_status_t ar_thread_notify(ar_thread_t * thread, ar_notify_action_t action, uint32_t value)
+{
+    if (!thread || action > kArNotifyOverwrite)
+    {
+        return kArInvalidParameterError;
+    }
+
+    ar_status_t status = kArSuccess;
+    ar_thread_notify_update(thread, action, value);
+    if (ar_port_get_irq_state())
+    {
+        // The waiting flag is set before the thread checks for a pending notification, so
+        // either it sees the update or we see the flag.
+        if (thread->m_isWaitingForNotify)
+        {
+            status = g_ar.deferredActions.post(ar_thread_deferred_notify_wake, thread);
+        }
+    }
+    else
+    {
+        status = ar_thread_notify_wake(thread);
+    }
+
+    ar_trace_object(kArTraceThreadNotify, status, thread);
+    return status;
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_thread_notify_wait(uint32_t clearBits, uint32_t * value, uint32_t timeout)
+{
+    if (ar_port_get_irq_state())
+    {
+        return kArNotFromInterruptError;
+    }
+
+    ar_thread_t * thread = g_ar.currentThread;
+    ar_status_t status = kArSuccess;
+    {
+        KernelLock guard;
+
+        // Say we are waiting before checking for a notification. An interrupt that notifies
+        // after the check then defers waking us, which can't run until we have blocked.
+        thread->m_isWaitingForNotify = true;
+        while (!thread->m_isNotifyPending)
+        {
+            if (timeout == kArNoTimeout)
+            {
+                status = kArTimeoutError;
+                break;
+            }
+
+            // Block on a wait list of our own. The list lives on this stack only while we
+            // are blocked, and ar_thread_notify_wake() unblocks us without needing it.
+            ar_list_t waitList = { NULL, NULL };
+            thread->block(waitList, timeout);
+
+            // We're back from the scheduler. A wakeup deferred by an interrupt during an
+            // earlier wait may have woken us with nothing pending, in which case we loop.
+            if (thread->m_unblockStatus != kArSuccess)
+            {
+                // Timed out, so we are still on the wait list.
+                waitList.remove(&thread->m_blockedNode);
+
+                // A notification may have arrived after the timeout woke us.
+                if (!thread->m_isNotifyPending)
+                {
+                    status = thread->m_unblockStatus;
+                }
+                break;
+            }
+        }
+        thread->m_isWaitingForNotify = false;
+
+        if (status == kArSuccess)
+        {
+            // Clear the pending flag before taking the value, so that a notification from an
+            // interrupt in between leaves it set instead of being lost.
+            thread->m_isNotifyPending = false;
+            int32_t notifyValue;
+            do {
+                notifyValue = thread->m_notifyValue;
+            } while (!ar_atomic_cas32(&thread->m_notifyValue, notifyValue, notifyValue & ~static_cast<int32_t>(clearBits)));
+            if (value)
+            {
+                *value = static_cast<uint32_t>(notifyValue);
+            }
+        }
+    }
+
+    ar_trace_object(kArTraceThreadNotifyWait, status, thread);
+    return status;
+}
+
 //! The thread wrapper calls the thread entry function that was set in
 //! the init() call. When and if the function returns, the thread is removed
 //! from the ready list and its state set to #kArThreadDone.
@@ -484,6 +712,7 @@ void ar_thread_wrapper(ar_thread_t * thread, void * param)
 
         // Mark this thread as finished
         thread->m_state = kArThreadDone;
+        ar_trace_object(kArTraceThreadState, kArThreadDone, thread);
     }
 
     // Switch to the scheduler to let another thread take over
@@ -519,7 +748,7 @@ bool ar_thread_sort_by_wakeup(ar_list_node_t * a, ar_list_node_t * b)
 //!
 //! @param[in,out] blockedList Reference to the head of the linked list of
 //!     blocked threads.
-//! @param timeout The maximum number of ticks that the thread can remain
+//! @param timeout The maximum number of milliseconds that the thread can remain
 //!     blocked. A value of #kArInfiniteTimeout means the thread can be
 //!     blocked forever. A timeout of 0 is not allowed and should be handled
 //!     by the caller.
@@ -534,6 +763,7 @@ void _ar_thread::block(ar_list_t & blockedList, uint32_t timeout)
     // Update its state.
     m_state = kArThreadBlocked;
     m_unblockStatus = kArSuccess;
+    ar_trace_object(kArTraceThreadState, kArThreadBlocked, this);
 
     // Add to blocked list.
     blockedList.add(&m_blockedNode);
@@ -541,7 +771,7 @@ void _ar_thread::block(ar_list_t & blockedList, uint32_t timeout)
     // If a valid timeout was given, put the thread on the sleeping list.
     if (timeout != kArInfiniteTimeout)
     {
-        m_wakeupTime = g_ar.tickCount + ar_milliseconds_to_ticks(timeout);
+        m_wakeupTime = ar_get_microseconds() + timeout * 1000ull;
         g_ar.sleepingList.add(this);
     }
     else
@@ -572,9 +802,8 @@ void _ar_thread::unblockWithStatus(ar_list_t & blockedList, ar_status_t unblockS
 {
     assert(m_state == kArThreadBlocked);
 
-    // Remove from the sleeping list if it was on there. Won't hurt if
-    // the thread is not on that list.
-    if (m_wakeupTime && g_ar.sleepingList.m_head)
+    // Remove from the sleeping list if it was on there.
+    if (m_wakeupTime)
     {
         g_ar.sleepingList.remove(this);
     }
@@ -585,11 +814,12 @@ void _ar_thread::unblockWithStatus(ar_list_t & blockedList, ar_status_t unblockS
     // Put the unblocked thread back onto the ready list.
     m_state = kArThreadReady;
     m_unblockStatus = unblockStatus;
+    ar_trace_object(kArTraceThreadState, kArThreadReady, this);
     g_ar.readyList.add(this);
     ar_kernel_update_round_robin();
 
     // Invoke the scheduler if the unblocked thread is higher priority than the current one.
-    if (m_priority > g_ar.currentThread->m_priority)
+    if (!g_ar.currentThread || m_priority > g_ar.currentThread->m_priority)
     {
         g_ar.flags.needsReschedule = true;
     }
@@ -624,10 +854,66 @@ ar_runloop_t * ar_thread_get_runloop(ar_thread_t * thread)
     return thread ? thread->m_runLoop : 0;
 }
 
+#if AR_ENABLE_SYSTEM_LOAD
+//! @brief Catch up a thread's load if it has not run recently.
+//!
+//! From interrupt context the load may be out of date, since the kernel can't be locked
+//! against the scheduler there.
+static void ar_thread_refresh_load(ar_thread_t * thread)
+{
+    if (!ar_port_get_irq_state())
+    {
+        KernelLock guard;
+        ar_kernel_update_thread_load(thread);
+    }
+}
+#endif // AR_ENABLE_SYSTEM_LOAD
+
+// See ar_kernel.h for documentation of this function.
 uint32_t ar_thread_get_load(ar_thread_t * thread)
 {
 #if AR_ENABLE_SYSTEM_LOAD
-    return thread ? thread->m_permilleCpu : 0;
+    if (!thread)
+    {
+        return 0;
+    }
+    ar_thread_refresh_load(thread);
+    return thread->m_permilleCpu;
+#else // AR_ENABLE_SYSTEM_LOAD
+    return 0;
+#endif // AR_ENABLE_SYSTEM_LOAD
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_thread_get_load_average(ar_thread_t * thread, ar_load_average_t average)
+{
+#if AR_ENABLE_SYSTEM_LOAD
+    if (!thread || average >= kArLoadAverageCount)
+    {
+        return 0;
+    }
+    ar_thread_refresh_load(thread);
+    return (thread->m_loadAverages[average] + (1 << (kLoadAverageShift - 1))) >> kLoadAverageShift;
+#else // AR_ENABLE_SYSTEM_LOAD
+    return 0;
+#endif // AR_ENABLE_SYSTEM_LOAD
+}
+
+// See ar_kernel.h for documentation of this function.
+uint64_t ar_thread_get_cycles(ar_thread_t * thread)
+{
+#if AR_ENABLE_SYSTEM_LOAD
+    return thread ? thread->m_totalCycles : 0;
+#else // AR_ENABLE_SYSTEM_LOAD
+    return 0;
+#endif // AR_ENABLE_SYSTEM_LOAD
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_thread_get_switch_count(ar_thread_t * thread)
+{
+#if AR_ENABLE_SYSTEM_LOAD
+    return thread ? thread->m_switchCount : 0;
 #else // AR_ENABLE_SYSTEM_LOAD
     return 0;
 #endif // AR_ENABLE_SYSTEM_LOAD
@@ -656,55 +942,57 @@ uint32_t ar_thread_get_stack_used(ar_thread_t * thread)
             break;
         }
     }
-    uint32_t stackSize = reinterpret_cast<uint32_t>(thread->m_stackTop) - reinterpret_cast<uint32_t>(thread->m_stackBottom);
+    uint32_t stackSize = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(thread->m_stackTop) - reinterpret_cast<uintptr_t>(thread->m_stackBottom));
     return stackSize - (unusedWords * sizeof(uint32_t));
 }
 
-// See ar_kernel.h for documentation of this function.
-uint32_t ar_thread_get_report(ar_thread_status_t report[], uint32_t maxEntries)
+//! @brief State for building a thread report.
+struct ar_thread_report_info {
+    ar_thread_status_t * report;    //!< Next report entry to fill in, or NULL.
+    uint32_t threadCount;           //!< Number of threads found so far.
+    uint32_t maxEntries;            //!< Maximum number of report entries.
+};
+
+//! @brief Thread iterator that adds a thread to the report.
+bool ar_thread_add_to_report(ar_thread_t * thread, void * param)
 {
-    uint32_t threadCount = 0;
-    ar_list_t * const threadLists[] = {
-#if AR_GLOBAL_OBJECT_LISTS
-        &g_ar_objects.threads
-#else
-        &g_ar.readyList, &g_ar.suspendedList, &g_ar.sleepingList
-#endif // AR_GLOBAL_OBJECT_LISTS
-    };
-    uint32_t i = 0;
-    for (; i < ARRAY_SIZE(threadLists) && threadCount < maxEntries; ++i)
-    {
-        ar_list_node_t * start = threadLists[i]->m_head;
-        if (start)
-        {
-            ar_list_node_t * node = start;
-            do {
-                ar_thread_t * thread = node->getObject<ar_thread_t>();
+    ar_thread_report_info * info = reinterpret_cast<ar_thread_report_info *>(param);
 
-                if (report)
-                {
-                    report->m_thread = thread;
-                    report->m_name = thread->m_name;
-                    report->m_uniqueId = thread->m_uniqueId;
+    if (info->report)
+    {
+        ar_thread_status_t * report = info->report;
+        report->m_thread = thread;
+        report->m_name = thread->m_name;
+        report->m_uniqueId = thread->m_uniqueId;
 #if AR_ENABLE_SYSTEM_LOAD
-                    report->m_cpu = thread->m_permilleCpu;
+        report->m_cpu = ar_thread_get_load(thread);
+        report->m_cycles = thread->m_totalCycles;
+        report->m_switchCount = thread->m_switchCount;
 #else // AR_ENABLE_SYSTEM_LOAD
-                    report->m_cpu = 0;
+        report->m_cpu = 0;
+        report->m_cycles = 0;
+        report->m_switchCount = 0;
 #endif // AR_ENABLE_SYSTEM_LOAD
-                    report->m_state = thread->m_state;
-                    report->m_maxStackUsed = ar_thread_get_stack_used(thread);
-                    report->m_stackSize = reinterpret_cast<uint32_t>(thread->m_stackTop) - reinterpret_cast<uint32_t>(thread->m_stackBottom);
+        report->m_state = thread->m_state;
+        report->m_maxStackUsed = ar_thread_get_stack_used(thread);
+        report->m_stackSize = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(thread->m_stackTop) - reinterpret_cast<uintptr_t>(thread->m_stackBottom));
 
-                    ++report;
-                }
-                ++threadCount;
-
-                node = node->m_next;
-            } while (node != start && threadCount < maxEntries);
-        }
+        ++info->report;
     }
+    ++info->threadCount;
 
-    return threadCount;
+    return info->threadCount < info->maxEntries;
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_thread_get_report(ar_thread_status_t report[], uint32_t maxEntries)
+{
+    ar_thread_report_info info = { report, 0, maxEntries };
+    if (maxEntries)
+    {
+        ar_kernel_iterate_threads(ar_thread_add_to_report, &info);
+    }
+    return info.threadCount;
 }
 
 // See ar_classes.h for documentation of this function.
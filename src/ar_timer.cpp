@@ -41,10 +41,13 @@ using namespace Ar;
 // Code
 //------------------------------------------------------------------------------
 
-static ar_status_t ar_timer_start_internal(ar_timer_t * timer, uint32_t wakeupTime);
-static void ar_timer_deferred_start(void * object, void * object2);
+static ar_status_t ar_timer_start_internal(ar_timer_t * timer, uint64_t wakeupTime);
+static ar_status_t ar_timer_deferred_start(void * object, void * object2, uint32_t count);
 static ar_status_t ar_timer_stop_internal(ar_timer_t * timer);
-static void ar_timer_deferred_stop(void * object, void * object2);
+static ar_status_t ar_timer_deferred_stop(void * object, void * object2, uint32_t count);
+static ar_timer_t * ar_timer_heap_link(ar_timer_t * a, ar_timer_t * b);
+static ar_timer_t * ar_timer_heap_merge_pairs(ar_timer_t * first);
+static void ar_timer_heap_detach(ar_timer_t * timer);
 
 //------------------------------------------------------------------------------
 // Code
@@ -52,6 +55,12 @@ static void ar_timer_deferred_stop(void * object, void * object2);
 
 // See ar_kernel.h for documentation of this function.
 ar_status_t ar_timer_create(ar_timer_t * timer, const char * name, ar_timer_entry_t callback, void * param, ar_timer_mode_t timerMode, uint32_t delay)
+{
+    return ar_timer_create_us(timer, name, callback, param, timerMode, delay * 1000ull);
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_timer_create_us(ar_timer_t * timer, const char * name, ar_timer_entry_t callback, void * param, ar_timer_mode_t timerMode, uint64_t delay)
 {
     if (!timer || !callback || !delay)
     {
@@ -68,14 +77,15 @@ ar_status_t ar_timer_create(ar_timer_t * timer, const char * name, ar_timer_entr
     timer->m_callback = callback;
     timer->m_param = param;
     timer->m_mode = timerMode;
-    timer->m_delay = ar_milliseconds_to_ticks(delay);
-    timer->m_activeNode.m_obj = timer;
+    timer->m_delay = delay;
 
 #if AR_GLOBAL_OBJECT_LISTS
     timer->m_createdNode.m_obj = timer;
     g_ar_objects.timers.add(&timer->m_createdNode);
 #endif
 
+    ar_trace_created(kArTraceTimerObject, timer, timer->m_name);
+
     return kArSuccess;
 }
 
@@ -97,26 +107,38 @@ ar_status_t ar_timer_delete(ar_timer_t * timer)
     g_ar_objects.timers.remove(&timer->m_createdNode);
 #endif
 
+    ar_trace_object(kArTraceObjectDeleted, kArTraceTimerObject, timer);
+
     return kArSuccess;
 }
 
 //! @brief Handles starting or restarting a timer.
-static ar_status_t ar_timer_start_internal(ar_timer_t * timer, uint32_t wakeupTime)
+static ar_status_t ar_timer_start_internal(ar_timer_t * timer, uint64_t wakeupTime)
 {
     KernelLock guard;
 
     assert(timer->m_runLoop);
 
-    // Handle a timer that is already active.
-    if (timer->m_isActive)
+    ar_timer_heap_t & timers = timer->m_runLoop->m_timers;
+
+    // Handle a timer that is already active. If the new wakeup time is not later than the
+    // current one, the timer can just be moved up in the heap.
+    if (timer->m_isActive && wakeupTime <= timer->m_wakeupTime)
     {
-        timer->m_runLoop->m_timers.remove(timer);
+        timers.decreaseKey(timer, wakeupTime);
     }
+    else
+    {
+        if (timer->m_isActive)
+        {
+            timers.remove(timer);
+        }
 
-    timer->m_wakeupTime = wakeupTime;
-    timer->m_isActive = true;
+        timer->m_wakeupTime = wakeupTime;
+        timer->m_isActive = true;
 
-    timer->m_runLoop->m_timers.add(timer);
+        timers.insert(timer);
+    }
 
     // Wake runloop so it will recompute its sleep time.
     ar_runloop_wake(timer->m_runLoop);
@@ -124,9 +146,16 @@ static ar_status_t ar_timer_start_internal(ar_timer_t * timer, uint32_t wakeupTi
     return kArSuccess;
 }
 
-static void ar_timer_deferred_start(void * object, void * object2)
+//! The start time doesn't fit in the deferred action's argument, so only its low 32 bits are
+//! passed. The full time is reconstructed relative to the current time, which is valid as long
+//! as the action runs within 71 minutes.
+static ar_status_t ar_timer_deferred_start(void * object, void * object2, uint32_t count)
 {
-    ar_timer_start_internal(reinterpret_cast<ar_timer_t *>(object), reinterpret_cast<uint32_t>(object2));
+    ar_timer_t * timer = reinterpret_cast<ar_timer_t *>(object);
+    uint64_t now = ar_get_microseconds();
+    uint32_t startTimeLow = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(object2));
+    uint64_t startTime = now - static_cast<uint32_t>(static_cast<uint32_t>(now) - startTimeLow);
+    return ar_timer_start_internal(timer, startTime + timer->m_delay);
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -144,21 +173,28 @@ ar_status_t ar_timer_start(ar_timer_t * timer)
     // The callback should have been verified by the create function.
     assert(timer->m_callback);
 
-    uint32_t wakeupTime = g_ar.tickCount + timer->m_delay;
+    uint64_t startTime = ar_get_microseconds();
 
     // Handle irq state by deferring the operation.
     if (ar_port_get_irq_state())
     {
-        return g_ar.deferredActions.post(ar_timer_deferred_start, timer, reinterpret_cast<void *>(wakeupTime));
+        uintptr_t startTimeLow = static_cast<uint32_t>(startTime);
+        return g_ar.deferredActions.post(ar_timer_deferred_start, timer, reinterpret_cast<void *>(startTimeLow));
     }
 
-    return ar_timer_start_internal(timer, wakeupTime);
+    return ar_timer_start_internal(timer, startTime + timer->m_delay);
 }
 
 static ar_status_t ar_timer_stop_internal(ar_timer_t * timer)
 {
     KernelLock guard;
 
+    // The timer may have already been stopped if this action was deferred.
+    if (!timer->m_isActive)
+    {
+        return kArSuccess;
+    }
+
     if (timer->m_runLoop)
     {
         timer->m_runLoop->m_timers.remove(timer);
@@ -173,9 +209,9 @@ static ar_status_t ar_timer_stop_internal(ar_timer_t * timer)
     return kArSuccess;
 }
 
-static void ar_timer_deferred_stop(void * object, void * object2)
+static ar_status_t ar_timer_deferred_stop(void * object, void * object2, uint32_t count)
 {
-    ar_timer_stop_internal(reinterpret_cast<ar_timer_t *>(object));
+    return ar_timer_stop_internal(reinterpret_cast<ar_timer_t *>(object));
 }
 
 // See ar_kernel.h for documentation of this function.
@@ -203,15 +239,33 @@ ar_status_t ar_timer_stop(ar_timer_t * timer)
     return ar_timer_stop_internal(timer);
 }
 
+// See ar_kernel.h for documentation of this function.
+bool ar_timer_is_active(ar_timer_t * timer)
+{
+    return timer ? timer->m_isActive : false;
+}
+
 // See ar_kernel.h for documentation of this function.
 ar_status_t ar_timer_set_delay(ar_timer_t * timer, uint32_t delay)
+{
+    return ar_timer_set_delay_us(timer, delay * 1000ull);
+}
+
+// See ar_kernel.h for documentation of this function.
+uint32_t ar_timer_get_delay(ar_timer_t * timer)
+{
+    return static_cast<uint32_t>(ar_timer_get_delay_us(timer) / 1000);
+}
+
+// See ar_kernel.h for documentation of this function.
+ar_status_t ar_timer_set_delay_us(ar_timer_t * timer, uint64_t delay)
 {
     if (!timer || !delay)
     {
         return kArInvalidParameterError;
     }
 
-    timer->m_delay = ar_milliseconds_to_ticks(delay);
+    timer->m_delay = delay;
 
     // If the timer is running, we need to restart it, unless it is a periodic
     // timer whose callback is currently executing. In that case, the timer will
@@ -225,6 +279,12 @@ ar_status_t ar_timer_set_delay(ar_timer_t * timer, uint32_t delay)
     return kArSuccess;
 }
 
+// See ar_kernel.h for documentation of this function.
+uint64_t ar_timer_get_delay_us(ar_timer_t * timer)
+{
+    return timer ? timer->m_delay : 0;
+}
+
 //! @brief Execute callbacks for all expired timers.
 //!
 //! While a timer callback is running, the m_isRunning flag on the timer is set to true.
@@ -232,73 +292,195 @@ ar_status_t ar_timer_set_delay(ar_timer_t * timer, uint32_t delay)
 //! rescheduled based on its delay. If a periodic timer's callback runs so long that the next
 //! wakeup time is in the past, it will be rescheduled to a time in the future that is aligned
 //! with the period.
-void ar_kernel_run_timers(ar_list_t & timersList)
+void ar_kernel_run_timers(ar_timer_heap_t & timers)
 {
-    // Check if we need to handle a timer.
-    if (timersList.m_head)
+    // Handle timers in order of wakeup time until all remaining timers wake up in the future.
+    ar_timer_t * timer;
+    uint64_t now;
+    while ((timer = timers.getMin()) && timer->m_wakeupTime <= (now = ar_get_microseconds()))
     {
-        ar_list_node_t * timerNode = timersList.m_head;
-        do {
-            ar_timer_t * timer = timerNode->getObject<ar_timer_t>();
-            assert(timer);
-
-            // Exit loop if all remaining timers on the list wake up in the future.
-            if (timer->m_wakeupTime > g_ar.tickCount)
+        // Invoke the timer callback.
+        assert(timer->m_callback);
+        ar_trace_object(kArTraceTimerFire, 0, timer);
+        timer->m_isRunning = true;
+        timer->m_callback(timer, timer->m_param);
+        timer->m_isRunning = false;
+
+        // Check that the timer wasn't stopped in its callback.
+        if (timer->m_isActive)
+        {
+            switch (timer->m_mode)
             {
-                break;
-            }
-
-            // Invoke the timer callback.
-            assert(timer->m_callback);
-            timer->m_isRunning = true;
-            timer->m_callback(timer, timer->m_param);
-            timer->m_isRunning = false;
+                case kArOneShotTimer:
+                    // Stop a one shot timer after it has fired.
+                    ar_timer_stop(timer);
+                    break;
 
-            // Check that the timer wasn't stopped in its callback.
-            if (timer->m_isActive)
-            {
-                switch (timer->m_mode)
+                case kArPeriodicTimer:
                 {
-                    case kArOneShotTimer:
-                        // Stop a one shot timer after it has fired.
-                        ar_timer_stop(timer);
-                        break;
-
-                    case kArPeriodicTimer:
+                    // Restart a periodic timer without introducing (much) jitter. Also handle
+                    // the cases where the timer callback ran longer than the next wakeup.
+                    uint64_t wakeupTime = timer->m_wakeupTime + timer->m_delay;
+                    if (wakeupTime < now)
                     {
-                        // Restart a periodic timer without introducing (much) jitter. Also handle
-                        // the cases where the timer callback ran longer than the next wakeup.
-                        uint32_t wakeupTime = timer->m_wakeupTime + timer->m_delay;
-                        if (wakeupTime == g_ar.tickCount)
-                        {
-                            // Push the wakeup out another period into the future.
-                            wakeupTime += timer->m_delay;
-                        }
-                        else if (wakeupTime < g_ar.tickCount)
-                        {
-                            // Compute the delay to the next wakeup in the future that is aligned
-                            // to the timer's period.
-                            uint32_t delta = (g_ar.tickCount - timer->m_wakeupTime + timer->m_delay - 1)
-                                                / timer->m_delay * timer->m_delay;
-                            wakeupTime = timer->m_wakeupTime + delta;
-                        }
-                        ar_timer_start_internal(timer, wakeupTime);
-                        break;
+                        // Compute the delay to the next wakeup that is aligned to the timer's
+                        // period and not in the past.
+                        uint64_t delta = (now - timer->m_wakeupTime + timer->m_delay - 1)
+                                            / timer->m_delay * timer->m_delay;
+                        wakeupTime = timer->m_wakeupTime + delta;
                     }
+                    ar_timer_start_internal(timer, wakeupTime);
+                    break;
                 }
             }
+        }
+    }
+}
 
-            timerNode = timerNode->m_next;
-        } while (timerNode != timersList.m_head);
+//! @brief Meld two timer heaps.
+//!
+//! Both timers must be heap roots, without siblings. The timer with the later wakeup time
+//! becomes the first child of the other. Ties keep @a a as the root.
+//!
+//! @return The root of the combined heap.
+static ar_timer_t * ar_timer_heap_link(ar_timer_t * a, ar_timer_t * b)
+{
+    if (b->m_wakeupTime < a->m_wakeupTime)
+    {
+        ar_timer_t * temp = a;
+        a = b;
+        b = temp;
     }
+
+    b->m_heapPrev = a;
+    b->m_heapNext = a->m_heapChild;
+    if (a->m_heapChild)
+    {
+        a->m_heapChild->m_heapPrev = b;
+    }
+    a->m_heapChild = b;
+    return a;
 }
 
-//! @brief Sort timers ascending by wakeup time.
-bool ar_timer_sort_by_wakeup(ar_list_node_t * a, ar_list_node_t * b)
+//! @brief Combine a list of sibling subheaps into a single heap.
+//!
+//! This is the standard two-pass pairing: siblings are melded in pairs from left to right, then
+//! the pairs are melded from right to left. It is done iteratively so the stack depth does not
+//! depend on the number of timers.
+//!
+//! @return The root of the combined heap, or NULL if @a first is NULL.
+static ar_timer_t * ar_timer_heap_merge_pairs(ar_timer_t * first)
 {
-    ar_timer_t * timerA = a->getObject<ar_timer_t>();
-    ar_timer_t * timerB = b->getObject<ar_timer_t>();
-    return (timerA->m_isActive && timerA->m_wakeupTime < timerB->m_wakeupTime);
+    // First pass. The melded pairs are pushed onto a stack linked through m_heapNext, so they
+    // come off in reverse order for the second pass.
+    ar_timer_t * pairs = NULL;
+    while (first)
+    {
+        ar_timer_t * a = first;
+        ar_timer_t * b = a->m_heapNext;
+        first = b ? b->m_heapNext : NULL;
+
+        a->m_heapNext = NULL;
+        a->m_heapPrev = NULL;
+        if (b)
+        {
+            b->m_heapNext = NULL;
+            b->m_heapPrev = NULL;
+            a = ar_timer_heap_link(a, b);
+        }
+
+        a->m_heapNext = pairs;
+        pairs = a;
+    }
+
+    // Second pass.
+    ar_timer_t * root = NULL;
+    while (pairs)
+    {
+        ar_timer_t * next = pairs->m_heapNext;
+        pairs->m_heapNext = NULL;
+        root = root ? ar_timer_heap_link(pairs, root) : pairs;
+        pairs = next;
+    }
+    return root;
+}
+
+//! @brief Unlink a non-root timer and its subheap from its parent and siblings.
+static void ar_timer_heap_detach(ar_timer_t * timer)
+{
+    ar_timer_t * prev = timer->m_heapPrev;
+    assert(prev);
+
+    if (prev->m_heapChild == timer)
+    {
+        prev->m_heapChild = timer->m_heapNext;
+    }
+    else
+    {
+        prev->m_heapNext = timer->m_heapNext;
+    }
+    if (timer->m_heapNext)
+    {
+        timer->m_heapNext->m_heapPrev = prev;
+    }
+
+    timer->m_heapNext = NULL;
+    timer->m_heapPrev = NULL;
+}
+
+//! Insertion is constant time.
+//!
+//! @param timer The timer to insert. Its wakeup time must already be set, and it must not
+//!     already be in the heap.
+void _ar_timer_heap::insert(ar_timer_t * timer)
+{
+    timer->m_heapChild = NULL;
+    timer->m_heapNext = NULL;
+    timer->m_heapPrev = NULL;
+    m_root = m_root ? ar_timer_heap_link(m_root, timer) : timer;
+}
+
+//! Removal takes amortized logarithmic time.
+//!
+//! @param timer The timer to remove. It must be in the heap.
+void _ar_timer_heap::remove(ar_timer_t * timer)
+{
+    assert(m_root);
+
+    ar_timer_t * children = timer->m_heapChild;
+    timer->m_heapChild = NULL;
+
+    if (timer == m_root)
+    {
+        m_root = ar_timer_heap_merge_pairs(children);
+    }
+    else
+    {
+        ar_timer_heap_detach(timer);
+
+        ar_timer_t * subheap = ar_timer_heap_merge_pairs(children);
+        if (subheap)
+        {
+            m_root = ar_timer_heap_link(m_root, subheap);
+        }
+    }
+}
+
+//! The timer's subheap is cut away and melded with the root, which is constant time.
+//!
+//! @param timer The timer to update. It must be in the heap.
+//! @param wakeupTime New wakeup time for the timer. Must not be later than the current
+//!     wakeup time.
+void _ar_timer_heap::decreaseKey(ar_timer_t * timer, uint64_t wakeupTime)
+{
+    assert(wakeupTime <= timer->m_wakeupTime);
+    timer->m_wakeupTime = wakeupTime;
+
+    if (timer != m_root)
+    {
+        ar_timer_heap_detach(timer);
+        m_root = ar_timer_heap_link(m_root, timer);
+    }
 }
 
 const char * ar_timer_get_name(ar_timer_t * timer)
@@ -313,6 +495,13 @@ ar_status_t Timer::init(const char * name, callback_t callback, void * param, ar
     return ar_timer_create(this, name, timer_wrapper, param, timerMode, delay);
 }
 
+ar_status_t Timer::initMicroseconds(const char * name, callback_t callback, void * param, ar_timer_mode_t timerMode, uint64_t delay)
+{
+    m_userCallback = callback;
+
+    return ar_timer_create_us(this, name, timer_wrapper, param, timerMode, delay);
+}
+
 void Timer::timer_wrapper(ar_timer_t * timer, void * arg)
 {
     Timer * _this = static_cast<Timer *>(timer);
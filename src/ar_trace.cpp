@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file
+ * @brief Source for the Ar microkernel trace buffer.
+ */
+
+#include "ar_internal.h"
+
+using namespace Ar;
+
+#if AR_ENABLE_TRACE
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+#if (AR_TRACE_BUFFER_SIZE & (AR_TRACE_BUFFER_SIZE - 1))
+#error "AR_TRACE_BUFFER_SIZE must be a power of two"
+#endif
+
+//! @brief Largest gap between records that the 16-bit time field can represent.
+static const uint32_t kMaxTraceTimeDelta = 0xffff;
+
+//------------------------------------------------------------------------------
+// Variables
+//------------------------------------------------------------------------------
+
+//! The trace buffer. A debugger can dump it with, for example:
+//! `dump binary value trace.bin g_ar_trace`
+ar_trace_buffer_t g_ar_trace = {
+        ar_trace_buffer_t::kMagic,
+        ar_trace_buffer_t::kVersion,
+        AR_TRACE_BUFFER_SIZE,
+        0,
+        0,
+        {}
+    };
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+//! Objects created before the kernel starts have already been recorded, so the buffer is not
+//! cleared. A time sync record marks the point where the kernel's time base starts running.
+void ar_trace_init()
+{
+    ar_trace_event(kArTraceTimeSync, 0, static_cast<uint32_t>(ar_get_microseconds()));
+}
+
+//! Reserving the record and reading the time are done together in a compare-and-swap loop,
+//! so records are always in time order even if an interrupt records events between the two.
+//! A time sync record is inserted ahead of an event that is too long after the previous one
+//! for its 16-bit time to be unambiguous.
+//!
+//! The m_lastTime member is updated without synchronization. It can only lag behind the
+//! time of the newest record, which at worst causes an unnecessary time sync.
+void ar_trace_event(uint8_t eventID, uint8_t arg, uint32_t data)
+{
+    uint32_t head;
+    uint32_t now;
+    uint32_t count;
+    do {
+        head = g_ar_trace.m_head;
+        now = static_cast<uint32_t>(ar_get_microseconds());
+        count = (now - g_ar_trace.m_lastTime > kMaxTraceTimeDelta) ? 2 : 1;
+    } while (!ar_atomic_cas32(reinterpret_cast<volatile int32_t *>(&g_ar_trace.m_head),
+                static_cast<int32_t>(head), static_cast<int32_t>(head + count)));
+    g_ar_trace.m_lastTime = now;
+
+    uint32_t timeBits = now & kMaxTraceTimeDelta;
+    ar_trace_record_t * record;
+    if (count == 2)
+    {
+        record = &g_ar_trace.m_records[head++ & (AR_TRACE_BUFFER_SIZE - 1)];
+        record->m_data = now;
+        record->m_header = (kArTraceTimeSync << 24) | timeBits;
+    }
+
+    record = &g_ar_trace.m_records[head & (AR_TRACE_BUFFER_SIZE - 1)];
+    record->m_data = data;
+    record->m_header = (static_cast<uint32_t>(eventID) << 24) | (static_cast<uint32_t>(arg) << 16) | timeBits;
+}
+
+//! The name follows the created event as a series of #kArTraceObjectName records, each with
+//! up to four characters. Names are truncated to 255 characters.
+void ar_trace_created(uint8_t objectType, const volatile void * object, const char * name)
+{
+    ar_trace_object(kArTraceObjectCreated, objectType, object);
+
+    if (!name)
+    {
+        return;
+    }
+
+    uint32_t offset;
+    for (offset = 0; offset < 256 && name[offset]; offset += 4)
+    {
+        uint32_t chars = 0;
+        uint32_t i;
+        for (i = 0; i < 4 && name[offset + i]; ++i)
+        {
+            chars |= static_cast<uint32_t>(static_cast<uint8_t>(name[offset + i])) << (i * 8);
+        }
+        ar_trace_event(kArTraceObjectName, offset, chars);
+        if (i < 4)
+        {
+            break;
+        }
+    }
+}
+
+#endif // AR_ENABLE_TRACE
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -57,6 +57,8 @@ enum _exception_priorities
 //------------------------------------------------------------------------------
 
 extern "C" void SysTick_Handler(void);
+static uint32_t ar_port_get_elapsed_cycles();
+static void ar_port_update_clock(uint32_t elapsedCycles, uint32_t load);
 extern "C" uint32_t ar_port_yield_isr(uint32_t topOfStack, uint32_t isExtendedFrame);
 
 //------------------------------------------------------------------------------
@@ -66,6 +68,29 @@ extern "C" uint32_t ar_port_yield_isr(uint32_t topOfStack, uint32_t isExtendedFr
 //! @brief Global used solely to pass info back to asm PendSV handler code.
 bool g_ar_hasExtendedFrame = false;
 
+//! @brief State of the microsecond clock maintained with SysTick.
+//!
+//! The current time is the base time plus the SysTick cycles elapsed since then. The clock is
+//! only updated by the SysTick and PendSV handlers, which cannot preempt each other. The sequence
+//! number is incremented before and after each update, so readers can detect and retry reads that
+//! raced with an update.
+//!
+//! The cycle count is kept alongside. With the DWT cycle counter, the base cycle count is paired
+//! with the counter value it was taken at, so the 32-bit counter is extended to 64 bits as long as
+//! the clock is updated at least once per counter wrap. The SysTick period is at most 2^24 cycles,
+//! so that is always the case. Without a cycle counter, the SysTick cycles are counted instead.
+static struct _ar_port_clock {
+    volatile uint32_t sequence;     //!< Odd while an update is in progress.
+    volatile uint64_t baseTime;     //!< Microseconds at the start of the current SysTick period.
+    volatile uint64_t updateTime;   //!< Time returned to readers that interrupt an update.
+    volatile uint64_t baseCycles;   //!< Cycle count at the base time.
+    volatile uint64_t updateCycles; //!< Cycle count returned to readers that interrupt an update.
+    uint32_t baseCycleCounter;      //!< DWT cycle counter value at the base cycle count.
+    bool hasCycleCounter;           //!< Whether the DWT cycle counter is used.
+    uint32_t remainderCycles;       //!< Cycles at the base time not making up a whole microsecond.
+    uint32_t cyclesPerMicrosecond;  //!< SysTick clock cycles per microsecond.
+} s_clock = { 0 };
+
 //------------------------------------------------------------------------------
 // Code
 //------------------------------------------------------------------------------
@@ -93,6 +118,19 @@ void ar_port_init_system()
 
 void ar_port_init_tick_timer()
 {
+#if (__CORTEX_M >= 3)
+    // Start the DWT cycle counter, if the core has one.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    if (!(DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk))
+    {
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        s_clock.baseCycleCounter = DWT->CYCCNT;
+        s_clock.hasCycleCounter = true;
+    }
+#endif // (__CORTEX_M >= 3)
+
+    s_clock.cyclesPerMicrosecond = SystemCoreClock / 1000000;
+
     // Set SysTick clock source to processor clock.
     SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk;
 
@@ -100,68 +138,97 @@ void ar_port_init_tick_timer()
     SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
 
 #if AR_ENABLE_TICKLESS_IDLE
-    ar_port_set_timer_delay(false, 0);
+    SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
 #else // AR_ENABLE_TICKLESS_IDLE
-    ar_port_set_timer_delay(true, kSchedulerQuanta_ms * 1000);
+    SysTick->LOAD = s_clock.cyclesPerMicrosecond * kSchedulerQuanta_ms * 1000 - 1;
 #endif // AR_ENABLE_TICKLESS_IDLE
+    SysTick->VAL = 0;
+
+    // The SysTick and its IRQ are left running from here on, since they maintain the clock.
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
 }
 
-void ar_port_set_timer_delay(bool enable, uint32_t delay_us)
+//! @brief Returns the SysTick cycles elapsed since the clock's base time.
+//!
+//! If the counter has wrapped but the SysTick IRQ has not yet been handled, the wrapped period
+//! is included. The pending bit is read both before and after the counter so a wrap between the
+//! two reads is not missed.
+static uint32_t ar_port_get_elapsed_cycles()
 {
-    // Disable SysTick while we adjust it.
-    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk; //&= ~(SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
-
-    if (enable)
+    uint32_t load = SysTick->LOAD;
+    bool isPending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk);
+    uint32_t value = SysTick->VAL;
+    if (!isPending && (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
     {
-        // If the delay is 0, just make the SysTick interrupt pending.
-        if (delay_us == 0)
-        {
-            // Clear reload and counter so the elapsed time reads as 0 in ar_port_get_timer_elapsed_us().
-            SysTick->LOAD = 0;
-            SysTick->VAL = 0;
-
-            // Pend SysTick.
-            SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
-            return;
-        }
-
-        // Calculate SysTick reload value. If the desired delay overflows the SysTick counter,
-        // we just use the max delay (24 bits for SysTick).
-        uint32_t ticks = SystemCoreClock / 1000000 * delay_us - 1;
-        if (ticks > SysTick_LOAD_RELOAD_Msk)
-        {
-            ticks = SysTick_LOAD_RELOAD_Msk;
-        }
+        isPending = true;
+        value = SysTick->VAL;
+    }
 
-        // Update SysTick reload value.
-        SysTick->LOAD = ticks;
+    uint32_t elapsed = load - value;
+    if (isPending)
+    {
+        elapsed += load + 1;
+    }
+    return elapsed;
+}
 
-        // Reset the timer to count from the new load value. This also clears COUNTFLAG.
-        SysTick->VAL = 0;
+//! @brief Moves the clock's base time forward, optionally restarting SysTick.
+//!
+//! Must only be called from the SysTick or PendSV handlers, or before the kernel starts.
+//!
+//! @param elapsedCycles Number of cycles since the current base time.
+//! @param load New SysTick reload value. If 0, SysTick is left running untouched.
+static void ar_port_update_clock(uint32_t elapsedCycles, uint32_t load)
+{
+    uint32_t cycles = s_clock.remainderCycles + elapsedCycles;
+    uint64_t now = s_clock.baseTime + cycles / s_clock.cyclesPerMicrosecond;
 
-        // Enable SysTick and its IRQ.
-        SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+    uint64_t nowCycles;
+    uint32_t counter = 0;
+#if (__CORTEX_M >= 3)
+    if (s_clock.hasCycleCounter)
+    {
+        counter = DWT->CYCCNT;
+        nowCycles = s_clock.baseCycles + (counter - s_clock.baseCycleCounter);
     }
     else
+#endif // (__CORTEX_M >= 3)
     {
-        // Enable SysTick for maximum count but disable IRQ.
-        SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+        nowCycles = s_clock.baseCycles + elapsedCycles;
+    }
+
+    // Readers that interrupt the update use the time captured here.
+    s_clock.updateTime = now;
+    s_clock.updateCycles = nowCycles;
+    ++s_clock.sequence;
+
+    if (load)
+    {
+        SysTick->LOAD = load;
         SysTick->VAL = 0;
-        SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+        SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
     }
+
+    s_clock.baseTime = now;
+    s_clock.remainderCycles = cycles % s_clock.cyclesPerMicrosecond;
+    s_clock.baseCycles = nowCycles;
+    s_clock.baseCycleCounter = counter;
+    ++s_clock.sequence;
 }
 
-uint32_t ar_port_get_timer_elapsed_us()
+//! The SysTick is never stopped, because it also drives the microsecond clock. Disabling the
+//! timer delay just sets the maximum SysTick period. Delays shorter than 1 µs are rounded up.
+void ar_port_set_timer_delay(bool enable, uint32_t delay_us)
 {
-    uint32_t max = SysTick->LOAD;
-    uint32_t counter = max - SysTick->VAL;
-    if (SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk)
+    // Use the max delay if the desired delay overflows the SysTick counter (24 bits).
+    uint32_t load = SysTick_LOAD_RELOAD_Msk;
+    if (enable && delay_us < (SysTick_LOAD_RELOAD_Msk + 1) / s_clock.cyclesPerMicrosecond)
     {
-        counter += max;
+        load = s_clock.cyclesPerMicrosecond * (delay_us ? delay_us : 1) - 1;
     }
-    return counter / (SystemCoreClock / 1000000);
-}
 
+    ar_port_update_clock(ar_port_get_elapsed_cycles(), load);
+}
 
 //! A total of 64 bytes of stack space is required to hold the initial
 //! thread context.
@@ -305,8 +372,23 @@ bool ar_atomic_cas32(volatile int32_t * value, int32_t expectedValue, int32_t ne
 }
 #endif // (__CORTEX_M < 3)
 
+//! Pointers are 32 bits, so the 32-bit compare and swap does the job.
+bool ar_port_atomic_cas_pointer(void * volatile * value, void * expectedValue, void * newValue)
+{
+    return ar_atomic_cas32(reinterpret_cast<volatile int32_t *>(value), reinterpret_cast<int32_t>(expectedValue), reinterpret_cast<int32_t>(newValue));
+}
+
+//! The clock's base time is moved to the start of the new SysTick period before the kernel
+//! handles the tick. With tickless idle, SysTick is restarted at its maximum period so it acts
+//! like a one-shot timer until the kernel programs the next wakeup.
 void SysTick_Handler(void)
 {
+#if AR_ENABLE_TICKLESS_IDLE
+    ar_port_update_clock(SysTick->LOAD + 1 + ar_port_get_elapsed_cycles(), SysTick_LOAD_RELOAD_Msk);
+#else // AR_ENABLE_TICKLESS_IDLE
+    ar_port_update_clock(SysTick->LOAD + 1, 0);
+#endif // AR_ENABLE_TICKLESS_IDLE
+
     ar_kernel_periodic_timer_isr();
 }
 
@@ -341,54 +423,78 @@ void ar_port_service_call()
 }
 #endif // DEBUG
 
-WEAK uint64_t ar_get_microseconds()
-{
-    return static_cast<uint64_t>(ar_get_millisecond_count()) * 1000ull;
-}
-
-#if AR_ENABLE_TRACE
-void ar_trace_init()
+//! This function never blocks, so it may be called from any interrupt. An interrupt with a
+//! priority higher than the kernel's that runs while the clock is being updated gets the time
+//! as of the start of the update.
+uint64_t ar_get_microseconds()
 {
-}
+    // The clock doesn't run until the kernel is started.
+    if (!s_clock.cyclesPerMicrosecond)
+    {
+        return 0;
+    }
 
-//! @brief Send one trace event word via ITM port 31.
-void ar_trace_1(uint8_t eventID, uint32_t data)
-{
-    if (ITM->TCR & ITM_TCR_ITMENA_Msk)
+    while (true)
     {
-        // Wait until we can send the event.
-        while (!ITM->PORT[31].u32)
+        uint32_t sequence = s_clock.sequence;
+        if (sequence & 1)
         {
+            return s_clock.updateTime;
         }
 
-        // Event consists of 8-bit event ID plus 24-bits of event data.
-        ITM->PORT[31].u32 = (static_cast<uint32_t>(eventID) << 24) | (data & 0x00ffffff);
+        uint64_t base = s_clock.baseTime;
+        uint32_t cycles = s_clock.remainderCycles + ar_port_get_elapsed_cycles();
+
+        // Retry if the SysTick or PendSV handlers updated the clock while we were reading it.
+        if (sequence == s_clock.sequence)
+        {
+            return base + cycles / s_clock.cyclesPerMicrosecond;
+        }
     }
 }
 
-//! @brief Send a 2-word trace event via ITM ports 31 and 30.
-void ar_trace_2(uint8_t eventID, uint32_t data0, void * data1)
+//! Like ar_get_microseconds(), this never blocks and may be called from any interrupt.
+uint64_t ar_get_cycles()
 {
-    if (ITM->TCR & ITM_TCR_ITMENA_Msk)
+    // The clock doesn't run until the kernel is started.
+    if (!s_clock.cyclesPerMicrosecond)
     {
-        // Wait until we can send the event.
-        while (!ITM->PORT[31].u32)
+        return 0;
+    }
+
+    while (true)
+    {
+        uint32_t sequence = s_clock.sequence;
+        if (sequence & 1)
         {
+            return s_clock.updateCycles;
         }
 
-        // Event consists of 8-bit event ID plus 24-bits of event data.
-        ITM->PORT[31].u32 = (static_cast<uint32_t>(eventID) << 24) | (data0 & 0x00ffffff);
-
-        // Wait until we can send the event.
-        while (!ITM->PORT[30].u32)
+        uint64_t base = s_clock.baseCycles;
+        uint32_t elapsed;
+#if (__CORTEX_M >= 3)
+        if (s_clock.hasCycleCounter)
         {
+            elapsed = DWT->CYCCNT - s_clock.baseCycleCounter;
+        }
+        else
+#endif // (__CORTEX_M >= 3)
+        {
+            elapsed = ar_port_get_elapsed_cycles();
         }
 
-        // Send second data on port 30.
-        ITM->PORT[30].u32 = reinterpret_cast<uint32_t>(data1);
+        // Retry if the SysTick or PendSV handlers updated the clock while we were reading it.
+        if (sequence == s_clock.sequence)
+        {
+            return base + elapsed;
+        }
     }
 }
-#endif // AR_ENABLE_TRACE
+
+uint32_t ar_get_cycles_per_second()
+{
+    return SystemCoreClock;
+}
 
 //------------------------------------------------------------------------------
 // EOF
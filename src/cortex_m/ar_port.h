@@ -127,6 +127,56 @@ static inline bool ar_port_get_irq_state(void)
     return __get_IPSR() != 0;
 }
 
+//! @brief Returns the priority of the active exception, scaled to 8 bits.
+//!
+//! As with the NVIC, lower values are more urgent. Exceptions with a fixed priority return 0,
+//! and thread mode returns 0xff.
+static inline uint8_t ar_port_get_irq_priority(void)
+{
+    int32_t exception = __get_IPSR() & 0x1ff;
+    if (exception < 4)
+    {
+        return exception ? 0 : 0xff;
+    }
+    return NVIC_GetPriority((IRQn_Type)(exception - 16)) << (8 - __NVIC_PRIO_BITS);
+}
+
+//! @brief Returns the number of leading zero bits in a non-zero value.
+static inline uint32_t ar_port_count_leading_zeros(uint32_t value)
+{
+#if (__CORTEX_M >= 3)
+    return __CLZ(value);
+#else // (__CORTEX_M >= 3)
+    // Cortex-M0+ has no CLZ instruction, so do a binary search.
+    uint32_t count = 0;
+    if (!(value & 0xffff0000u))
+    {
+        count += 16;
+        value <<= 16;
+    }
+    if (!(value & 0xff000000u))
+    {
+        count += 8;
+        value <<= 8;
+    }
+    if (!(value & 0xf0000000u))
+    {
+        count += 4;
+        value <<= 4;
+    }
+    if (!(value & 0xc0000000u))
+    {
+        count += 2;
+        value <<= 2;
+    }
+    if (!(value & 0x80000000u))
+    {
+        count += 1;
+    }
+    return count;
+#endif // (__CORTEX_M >= 3)
+}
+
 #if defined(__cplusplus)
 extern "C" inline uint32_t ar_get_milliseconds_per_tick();
 #else
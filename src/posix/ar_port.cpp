@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file ar_port.cpp
+ * @ingroup ar_port
+ * @brief POSIX host simulation port for the Argon RTOS.
+ *
+ * This port runs the kernel on a single host thread so kernel code can be tested, benchmarked,
+ * and profiled on a development machine. Argon threads are ucontexts that are switched between
+ * with swapcontext(). POSIX signals stand in for interrupts: SIGALRM driven by an interval timer
+ * replaces SysTick, and SIGUSR1 is a user interrupt for testing kernel calls from IRQ state.
+ * Blocking those signals is the equivalent of masking interrupts.
+ *
+ * A simulated interrupt is "active" while its signal handler runs. A context switch requested
+ * with ar_port_service_call() is performed immediately from thread state, or as the outermost
+ * simulated interrupt exits, mirroring the PendSV behaviour of the Cortex-M port.
+ *
+ * Signal handlers run on the stack of the interrupted thread, so thread stacks must be much
+ * larger than on an MCU. 16 kB is a reasonable minimum.
+ */
+
+#include "../ar_internal.h"
+#include "ar_port.h"
+#include <assert.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace Ar;
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+enum
+{
+    //! Longest delay the timer is programmed with, similar to the SysTick's 24-bit limit.
+    kMaxTimerDelay_us = 100000
+};
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static uint64_t ar_port_get_host_nanoseconds();
+static void ar_port_switch_context();
+static void ar_port_irq_exit();
+static void ar_port_timer_handler(int signal);
+static void ar_port_user_irq_handler(int signal);
+static void ar_port_thread_entry(unsigned threadHigh, unsigned threadLow, unsigned paramHigh, unsigned paramLow);
+
+//------------------------------------------------------------------------------
+// Variables
+//------------------------------------------------------------------------------
+
+//! @brief Nesting depth of simulated interrupts, including the scheduler.
+static volatile int s_irqDepth = 0;
+
+//! @brief Set when a context switch has been requested.
+static volatile bool s_isSwitchPending = false;
+
+//! @brief The signals used as simulated interrupts.
+static sigset_t s_irqSignals;
+
+//! @brief Host time in nanoseconds when the kernel's time base started, less one microsecond.
+static uint64_t s_startTime = 0;
+
+//! @brief Handler for the simulated user interrupt.
+static void (*s_irqHandler)(void) = NULL;
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+//! @brief Read the host's monotonic clock.
+static uint64_t ar_port_get_host_nanoseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+//! @brief Run the scheduler and switch to the thread it selected.
+//!
+//! Must be called with the simulated interrupts blocked. The context of the previous thread is
+//! saved so that it resumes here, and then continues on from where it called this function.
+static void ar_port_switch_context()
+{
+    ar_thread_t * previous = g_ar.currentThread;
+    uint8_t marker;
+
+    s_isSwitchPending = false;
+    ar_kernel_yield_isr(reinterpret_cast<uintptr_t>(&marker));
+
+    ar_thread_t * next = g_ar.currentThread;
+    if (previous != next)
+    {
+        if (previous)
+        {
+            swapcontext(&previous->m_portData.m_context, &next->m_portData.m_context);
+        }
+        else
+        {
+            setcontext(&next->m_portData.m_context);
+        }
+    }
+}
+
+//! @brief Perform any pending context switch as the outermost simulated interrupt exits.
+static void ar_port_irq_exit()
+{
+    while (s_isSwitchPending && s_irqDepth == 1)
+    {
+        ar_port_switch_context();
+    }
+    --s_irqDepth;
+}
+
+//! @brief Simulated SysTick handler.
+static void ar_port_timer_handler(int signal)
+{
+    ++s_irqDepth;
+
+#if AR_ENABLE_TICKLESS_IDLE
+    // Like the Cortex-M port, keep the timer running at its max period until the kernel
+    // programs the next wakeup.
+    ar_port_set_timer_delay(false, 0);
+#endif // AR_ENABLE_TICKLESS_IDLE
+
+    ar_kernel_periodic_timer_isr();
+    ar_port_irq_exit();
+}
+
+//! @brief Simulated user interrupt handler.
+static void ar_port_user_irq_handler(int signal)
+{
+    ++s_irqDepth;
+    if (s_irqHandler)
+    {
+        s_irqHandler();
+    }
+    ar_port_irq_exit();
+}
+
+void ar_port_init_system()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_mask = s_irqSignals;
+    action.sa_handler = ar_port_user_irq_handler;
+    sigaction(SIGUSR1, &action, NULL);
+}
+
+//! The tick timer is set up before ar_port_init_system() is called, so the signal set and
+//! timer handler are installed here.
+void ar_port_init_tick_timer()
+{
+    sigemptyset(&s_irqSignals);
+    sigaddset(&s_irqSignals, SIGALRM);
+    sigaddset(&s_irqSignals, SIGUSR1);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_mask = s_irqSignals;
+    action.sa_handler = ar_port_timer_handler;
+    sigaction(SIGALRM, &action, NULL);
+
+    // Start the time base. It is offset by one so a started clock never reads as 0.
+    s_startTime = ar_port_get_host_nanoseconds() - 1000;
+
+#if AR_ENABLE_TICKLESS_IDLE
+    ar_port_set_timer_delay(false, 0);
+#else // AR_ENABLE_TICKLESS_IDLE
+    ar_port_set_timer_delay(true, kSchedulerQuanta_ms * 1000);
+#endif // AR_ENABLE_TICKLESS_IDLE
+}
+
+//! As with SysTick, the timer is never stopped. Disabling the delay selects the maximum delay.
+void ar_port_set_timer_delay(bool enable, uint32_t delay_us)
+{
+    if (!enable || delay_us > kMaxTimerDelay_us)
+    {
+        delay_us = kMaxTimerDelay_us;
+    }
+    else if (delay_us == 0)
+    {
+        delay_us = 1;
+    }
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value.tv_sec = delay_us / 1000000;
+    timer.it_value.tv_usec = delay_us % 1000000;
+#if !AR_ENABLE_TICKLESS_IDLE
+    timer.it_interval = timer.it_value;
+#endif // !AR_ENABLE_TICKLESS_IDLE
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+//! @brief Entry point for all threads' contexts.
+//!
+//! makecontext() only passes int arguments, so the pointers are split into halves.
+static void ar_port_thread_entry(unsigned threadHigh, unsigned threadLow, unsigned paramHigh, unsigned paramLow)
+{
+    ar_thread_t * thread = reinterpret_cast<ar_thread_t *>((static_cast<uint64_t>(threadHigh) << 32) | threadLow);
+    void * param = reinterpret_cast<void *>((static_cast<uint64_t>(paramHigh) << 32) | paramLow);
+
+    // A new thread is always started by the scheduler, so leave IRQ state.
+    s_irqDepth = 0;
+    sigprocmask(SIG_UNBLOCK, &s_irqSignals, NULL);
+
+    ar_thread_wrapper(thread, param);
+}
+
+//! The thread's registers are held in a ucontext rather than on the stack. The stack is still
+//! aligned and filled the same as on Cortex-M, so stack usage checks work unchanged.
+void ar_port_prepare_stack(ar_thread_t * thread, uint32_t stackSize, void * param)
+{
+    // 16-byte align stack.
+    uintptr_t sp = reinterpret_cast<uintptr_t>(thread->m_stackBottom) + stackSize;
+    uintptr_t delta = sp & 15;
+    sp -= delta;
+    stackSize = (stackSize - delta) & ~15;
+    thread->m_stackTop = reinterpret_cast<uint32_t *>(sp);
+    thread->m_stackBottom = reinterpret_cast<uint32_t *>(sp - stackSize);
+
+#if AR_THREAD_STACK_PATTERN_FILL
+    // Fill the stack with a pattern. We just take the low byte of the fill pattern since
+    // memset() is a byte fill. This assumes each byte of the fill pattern is the same.
+    memset(thread->m_stackBottom, kStackFillValue & 0xff, stackSize);
+#endif // AR_THREAD_STACK_PATTERN_FILL
+
+    thread->m_stackPointer = reinterpret_cast<uint8_t *>(sp);
+
+    // Set up the context to run on the thread's stack, leaving room for the check value.
+    ucontext_t * context = &thread->m_portData.m_context;
+    getcontext(context);
+    context->uc_stack.ss_sp = thread->m_stackBottom + 4;
+    context->uc_stack.ss_size = stackSize - 16;
+    context->uc_link = NULL;
+    sigemptyset(&context->uc_sigmask);
+    sigaddset(&context->uc_sigmask, SIGALRM);
+    sigaddset(&context->uc_sigmask, SIGUSR1);
+
+    uint64_t threadValue = reinterpret_cast<uintptr_t>(thread);
+    uint64_t paramValue = reinterpret_cast<uintptr_t>(param);
+    makecontext(context, reinterpret_cast<void (*)()>(ar_port_thread_entry), 4,
+        static_cast<unsigned>(threadValue >> 32), static_cast<unsigned>(threadValue),
+        static_cast<unsigned>(paramValue >> 32), static_cast<unsigned>(paramValue));
+
+    // Write a check value to the bottom of the stack.
+    *thread->m_stackBottom = kStackCheckValue;
+}
+
+//! From thread state, the simulated interrupts are blocked and the switch happens right away.
+//! Otherwise it is left pending until the outermost simulated interrupt exits.
+void ar_port_service_call()
+{
+    assert(g_ar.lockCount == 0);
+
+    s_isSwitchPending = true;
+    if (s_irqDepth)
+    {
+        return;
+    }
+
+    sigset_t savedSignals;
+    sigprocmask(SIG_BLOCK, &s_irqSignals, &savedSignals);
+    ++s_irqDepth;
+    while (s_isSwitchPending)
+    {
+        ar_port_switch_context();
+    }
+    --s_irqDepth;
+    sigprocmask(SIG_SETMASK, &savedSignals, NULL);
+}
+
+bool ar_port_get_irq_state()
+{
+    return s_irqDepth != 0;
+}
+
+void ar_port_wait_for_interrupt()
+{
+    // Atomically unblock the simulated interrupts and wait for one.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigset_t savedSignals;
+    sigprocmask(SIG_BLOCK, &s_irqSignals, &savedSignals);
+    sigsuspend(&signals);
+    sigprocmask(SIG_SETMASK, &savedSignals, NULL);
+}
+
+void ar_port_set_irq_handler(void (*handler)(void))
+{
+    s_irqHandler = handler;
+}
+
+void ar_port_trigger_irq()
+{
+    // The signal is delivered before kill() returns if it is not blocked.
+    kill(getpid(), SIGUSR1);
+}
+
+int8_t ar_atomic_add8(volatile int8_t * value, int8_t delta)
+{
+    return __atomic_fetch_add(value, delta, __ATOMIC_SEQ_CST);
+}
+
+int16_t ar_atomic_add16(volatile int16_t * value, int16_t delta)
+{
+    return __atomic_fetch_add(value, delta, __ATOMIC_SEQ_CST);
+}
+
+int32_t ar_atomic_add32(volatile int32_t * value, int32_t delta)
+{
+    return __atomic_fetch_add(value, delta, __ATOMIC_SEQ_CST);
+}
+
+bool ar_atomic_cas8(volatile int8_t * value, int8_t expectedValue, int8_t newValue)
+{
+    return __atomic_compare_exchange_n(value, &expectedValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+bool ar_atomic_cas16(volatile int16_t * value, int16_t expectedValue, int16_t newValue)
+{
+    return __atomic_compare_exchange_n(value, &expectedValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+bool ar_atomic_cas32(volatile int32_t * value, int32_t expectedValue, int32_t newValue)
+{
+    return __atomic_compare_exchange_n(value, &expectedValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+bool ar_port_atomic_cas_pointer(void * volatile * value, void * expectedValue, void * newValue)
+{
+    return __atomic_compare_exchange_n(value, &expectedValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+uint64_t ar_get_microseconds()
+{
+    // The clock doesn't run until the kernel is started.
+    if (!s_startTime)
+    {
+        return 0;
+    }
+    return (ar_port_get_host_nanoseconds() - s_startTime) / 1000;
+}
+
+//! There is no portable cycle counter on the host, so cycles are nanoseconds of the host's
+//! monotonic clock.
+uint64_t ar_get_cycles()
+{
+    if (!s_startTime)
+    {
+        return 0;
+    }
+    return ar_port_get_host_nanoseconds() - s_startTime;
+}
+
+uint32_t ar_get_cycles_per_second()
+{
+    return 1000000000;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
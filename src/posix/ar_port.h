@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file ar_port.h
+ * @ingroup ar_port
+ * @brief POSIX host simulation port for the Argon RTOS.
+ */
+
+#if !defined(_AR_PORT_H_)
+#define _AR_PORT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+//! @addtogroup ar_port
+//! @{
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! @name POSIX port config
+//!
+//! Host threads need much larger stacks than an MCU, and there is no linker-provided main
+//! thread stack, so these defaults override those in ar_config.h.
+//@{
+
+#if !defined(AR_IDLE_THREAD_STACK_SIZE)
+    //! @brief Size in bytes of the idle thread's stack.
+    #define AR_IDLE_THREAD_STACK_SIZE (64 * 1024)
+#endif // AR_IDLE_THREAD_STACK_SIZE
+
+#if !defined(AR_ENABLE_MAIN_THREAD)
+    //! @brief The POSIX port does not run main() in a thread.
+    #define AR_ENABLE_MAIN_THREAD (0)
+#endif // AR_ENABLE_MAIN_THREAD
+
+//@}
+
+/*!
+ * @brief POSIX specific thread struct fields.
+ */
+typedef struct _ar_thread_port_data {
+    ucontext_t m_context;       //!< Saved context of the thread.
+} ar_thread_port_data_t;
+
+enum
+{
+    kSchedulerQuanta_ms = 10
+};
+
+//! @}
+
+#if defined(__cplusplus)
+
+namespace Ar {
+
+//! @addtogroup ar_port
+//! @{
+
+/*!
+ * @brief Context for a thread saved on the stack.
+ *
+ * Thread contexts are held in ar_thread_port_data_t, so nothing is saved on the thread's stack.
+ * This space is only reserved to keep the stack layout similar to the Cortex-M port.
+ */
+struct ThreadContext
+{
+    uint32_t reserved[16];  //!< Unused.
+};
+
+//! @brief Stop the process because of a serious error.
+static inline void _halt()
+{
+    abort();
+}
+
+//! @}
+
+} // namespace Ar
+
+#endif // defined(__cplusplus)
+
+//! @name CMSIS intrinsics used by the kernel
+//@{
+#define __DSB() __sync_synchronize()
+#define __ISB() __sync_synchronize()
+#define __WFI() ar_port_wait_for_interrupt()
+//@}
+
+//! @brief Request a context switch, like pending PendSV.
+void ar_port_service_call(void);
+
+//! @brief Returns true if in IRQ state, i.e., a simulated interrupt handler is executing.
+bool ar_port_get_irq_state(void);
+
+//! @brief Wait until a simulated interrupt is delivered.
+void ar_port_wait_for_interrupt(void);
+
+//! @brief Set the handler for the simulated user interrupt.
+//!
+//! The handler runs in IRQ state, so kernel calls made from it are handled the same as they are
+//! from a real interrupt.
+void ar_port_set_irq_handler(void (*handler)(void));
+
+//! @brief Raise the simulated user interrupt.
+//!
+//! The handler set with ar_port_set_irq_handler() is invoked from a signal handler. If the
+//! simulated interrupt is raised from a thread, the handler will have run by the time this
+//! function returns.
+void ar_port_trigger_irq(void);
+
+//! @brief Returns the priority of the active simulated interrupt.
+//!
+//! The simulated interrupts all share a single priority.
+static inline uint8_t ar_port_get_irq_priority(void)
+{
+    return 0;
+}
+
+//! @brief Returns the number of leading zero bits in a non-zero value.
+static inline uint32_t ar_port_count_leading_zeros(uint32_t value)
+{
+    return __builtin_clz(value);
+}
+
+#if defined(__cplusplus)
+extern "C" inline uint32_t ar_get_milliseconds_per_tick();
+#else
+static inline uint32_t ar_get_milliseconds_per_tick(void);
+#endif
+
+//! @brief Returns the number of milliseconds per tick.
+inline uint32_t ar_get_milliseconds_per_tick()
+{
+    return kSchedulerQuanta_ms;
+}
+
+#endif // _AR_PORT_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file bench.cpp
+ * @brief Kernel microbenchmark harness and entry point.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static int bench_compare_samples(const void * a, const void * b);
+
+//------------------------------------------------------------------------------
+// Variables
+//------------------------------------------------------------------------------
+
+#if !AR_ENABLE_MAIN_THREAD
+//! @brief Thread that runs the benchmarks.
+static ar_thread_t s_benchThread;
+
+//! @brief Stack for the benchmark thread.
+static uint8_t s_benchThreadStack[BENCH_STACK_SIZE];
+#endif // !AR_ENABLE_MAIN_THREAD
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+static int bench_compare_samples(const void * a, const void * b)
+{
+    uint32_t sampleA = *static_cast<const uint32_t *>(a);
+    uint32_t sampleB = *static_cast<const uint32_t *>(b);
+    return (sampleA > sampleB) - (sampleA < sampleB);
+}
+
+void bench_report(const char * name, const char * unit, uint32_t * samples, uint32_t count)
+{
+    if (!count)
+    {
+        printf("BENCH %s unit=%s n=0\n", name, unit);
+        return;
+    }
+
+    qsort(samples, count, sizeof(uint32_t), bench_compare_samples);
+
+    printf("BENCH %s unit=%s n=%lu min=%lu median=%lu p99=%lu max=%lu\n",
+        name, unit,
+        static_cast<unsigned long>(count),
+        static_cast<unsigned long>(samples[0]),
+        static_cast<unsigned long>(samples[count / 2]),
+        static_cast<unsigned long>(samples[count * 99 / 100]),
+        static_cast<unsigned long>(samples[count - 1]));
+}
+
+#if AR_ENABLE_MAIN_THREAD
+int main(void)
+{
+    bench_platform_init();
+
+    // Benchmark helper threads must be able to preempt main.
+    ar_thread_set_priority(ar_thread_get_current(), kBenchLowPriority);
+    bench_run_all();
+    return 0;
+}
+#else // AR_ENABLE_MAIN_THREAD
+//! @brief Entry point for the benchmark thread.
+static void bench_thread(void * param)
+{
+    bench_run_all();
+}
+
+int main(void)
+{
+    bench_platform_init();
+
+    ar_thread_create(&s_benchThread, "bench", bench_thread, NULL, s_benchThreadStack, sizeof(s_benchThreadStack), kBenchLowPriority, kArStartThread);
+    ar_kernel_run();
+    return 0;
+}
+#endif // AR_ENABLE_MAIN_THREAD
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
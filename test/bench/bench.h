@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file bench.h
+ * @brief Kernel microbenchmark harness.
+ *
+ * Each benchmark collects a number of samples, usually cycle counts for one operation, and
+ * reports their distribution as a single line of the form:
+ *
+ * @code
+ * BENCH <name> unit=<unit> n=<samples> min=<min> median=<median> p99=<p99> max=<max>
+ * @endcode
+ *
+ * The platform layer provides the cycle counter, a software triggered interrupt, and the
+ * console.
+ */
+
+#if !defined(_BENCH_H_)
+#define _BENCH_H_
+
+#include "argon/argon.h"
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+#if !defined(BENCH_SAMPLE_COUNT)
+    //! @brief Number of samples collected by each benchmark.
+    #define BENCH_SAMPLE_COUNT (1000)
+#endif
+
+#if !defined(BENCH_STACK_SIZE)
+    //! @brief Size in bytes of the stacks of benchmark threads.
+    #define BENCH_STACK_SIZE (1024)
+#endif
+
+//! @brief Priorities of benchmark threads.
+enum _bench_priorities
+{
+    kBenchLowPriority = 50,     //!< Priority of the thread running the benchmarks.
+    kBenchHighPriority = 100,   //!< Priority of helper threads that must preempt.
+};
+
+//! @brief Signature of an interrupt handler for the software triggered benchmark interrupt.
+typedef void (*bench_irq_handler_t)(void);
+
+//------------------------------------------------------------------------------
+// API
+//------------------------------------------------------------------------------
+
+//! @name Platform
+//@{
+//! @brief Prepare the cycle counter and benchmark interrupt.
+void bench_platform_init(void);
+
+//! @brief Start the free running cycle counter. Called by bench_platform_init().
+void bench_cycle_counter_init(void);
+
+//! @brief Read the free running cycle counter.
+uint32_t bench_get_cycles(void);
+
+//! @brief Name of the unit counted by bench_get_cycles().
+const char * bench_get_cycle_unit(void);
+
+//! @brief Set the handler invoked by bench_trigger_irq().
+void bench_set_irq_handler(bench_irq_handler_t handler);
+
+//! @brief Raise the benchmark interrupt. The handler runs in IRQ state.
+void bench_trigger_irq(void);
+
+//! @brief Called when all benchmarks are done.
+void bench_platform_exit(int status);
+//@}
+
+//! @name Harness
+//@{
+//! @brief Sort the samples and print their distribution.
+void bench_report(const char * name, const char * unit, uint32_t * samples, uint32_t count);
+
+//! @brief Run all benchmarks.
+void bench_run_all(void);
+//@}
+
+#endif // _BENCH_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
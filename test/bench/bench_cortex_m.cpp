@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file bench_cortex_m.cpp
+ * @brief Benchmark platform layer for Cortex-M devices.
+ *
+ * Cycles are read from the DWT cycle counter. Cores or simulators without a DWT can override
+ * bench_cycle_counter_init(), bench_get_cycles() and bench_get_cycle_unit(), all of which are
+ * weak.
+ *
+ * The board must define BENCH_IRQn and BENCH_IRQ_HANDLER to name an otherwise unused
+ * interrupt that the benchmarks can pend from software.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(BENCH_IRQn) || !defined(BENCH_IRQ_HANDLER)
+#error "BENCH_IRQn and BENCH_IRQ_HANDLER must be defined for the benchmark interrupt"
+#endif
+
+//------------------------------------------------------------------------------
+// Variables
+//------------------------------------------------------------------------------
+
+//! @brief Handler invoked by the benchmark interrupt.
+static volatile bench_irq_handler_t s_irqHandler = NULL;
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void bench_platform_init(void)
+{
+    bench_cycle_counter_init();
+
+    NVIC_SetPriority(BENCH_IRQn, 0);
+    NVIC_EnableIRQ(BENCH_IRQn);
+}
+
+__attribute__((weak)) void bench_cycle_counter_init(void)
+{
+#if defined(DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif // DWT
+}
+
+__attribute__((weak)) uint32_t bench_get_cycles(void)
+{
+#if defined(DWT)
+    return DWT->CYCCNT;
+#else
+    return 0;
+#endif
+}
+
+__attribute__((weak)) const char * bench_get_cycle_unit(void)
+{
+    return "cycles";
+}
+
+void bench_set_irq_handler(bench_irq_handler_t handler)
+{
+    s_irqHandler = handler;
+}
+
+void bench_trigger_irq(void)
+{
+    NVIC_SetPendingIRQ(BENCH_IRQn);
+    __DSB();
+    __ISB();
+}
+
+void bench_platform_exit(int status)
+{
+    // The C library's _exit() decides what happens next; under semihosting it ends the session.
+    fflush(stdout);
+    exit(status);
+}
+
+extern "C" void BENCH_IRQ_HANDLER(void)
+{
+    bench_irq_handler_t handler = s_irqHandler;
+    if (handler)
+    {
+        handler();
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file bench_kernel.cpp
+ * @brief Kernel microbenchmarks.
+ *
+ * Each benchmark runs on the low priority benchmark thread, using a high priority helper thread
+ * where a context switch is being measured. Helper threads return from their entry point when
+ * the object they wait on is deleted, or when told to stop.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+static void bench_start_helper(const char * name, ar_thread_entry_t entry);
+static void bench_delete_helper(void);
+static void bench_context_switch(void);
+static void bench_semaphore_ping_pong(void);
+static void bench_queue(unsigned elementSize);
+static void bench_queue_batch(unsigned count);
+static void bench_channel(void);
+static void bench_mutex_uncontended(void);
+static void bench_mutex_contended(void);
+static void bench_seqlock_read(void);
+static void bench_isr_wake(void);
+static void bench_isr_notify(void);
+static void bench_timer_jitter(void);
+
+//------------------------------------------------------------------------------
+// Variables
+//------------------------------------------------------------------------------
+
+//! @brief Samples for the current benchmark.
+static uint32_t s_samples[BENCH_SAMPLE_COUNT];
+
+//! @brief Helper thread for the current benchmark.
+static ar_thread_t s_helperThread;
+
+//! @brief Stack for the helper thread.
+static uint8_t s_helperThreadStack[BENCH_STACK_SIZE];
+
+//! @brief Cycle count recorded by a helper thread or IRQ handler.
+static volatile uint32_t s_helperCycles;
+
+//! @brief Cycle count recorded by the benchmark IRQ handler.
+static volatile uint32_t s_irqCycles;
+
+//! @brief Tells a helper thread that waits by suspending itself to return.
+static volatile bool s_stopHelper;
+
+//! @brief Number of samples taken by the timer benchmark.
+static volatile uint32_t s_timerSampleCount;
+
+//! @brief Value of ar_get_cycles() at the previous expiry of the timer benchmark's timer.
+static uint64_t s_timerLastCycles;
+
+//! @brief Period of the timer benchmark's timer, in cycles of ar_get_cycles().
+static uint64_t s_timerPeriodCycles;
+
+static ar_semaphore_t s_semaphore;
+static ar_semaphore_t s_replySemaphore;
+static ar_mutex_t s_mutex;
+static ar_seqlock_t s_seqlock;
+static uint8_t s_seqlockStorage[64];
+static ar_channel_t s_channel;
+static ar_queue_t s_queue;
+static uint8_t s_queueStorage[8 * 64];
+static ar_runloop_t s_runloop;
+static ar_timer_t s_timer;
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+//! @brief Create and start the high priority helper thread.
+//!
+//! The helper runs until it blocks before this function returns.
+static void bench_start_helper(const char * name, ar_thread_entry_t entry)
+{
+    s_stopHelper = false;
+    ar_thread_create(&s_helperThread, name, entry, NULL, s_helperThreadStack, sizeof(s_helperThreadStack), kBenchHighPriority, kArStartThread);
+}
+
+//! @brief Delete the helper thread once it has nothing left to wait on.
+//!
+//! The objects the helper was blocked on must already be deleted, or the helper told to stop.
+static void bench_delete_helper(void)
+{
+    ar_thread_delete(&s_helperThread);
+}
+
+//! @brief Helper that records the time each time it is resumed.
+static void bench_context_switch_helper(void * param)
+{
+    while (true)
+    {
+        ar_thread_suspend(ar_thread_get_current());
+        s_helperCycles = bench_get_cycles();
+        if (s_stopHelper)
+        {
+            return;
+        }
+    }
+}
+
+//! @brief Time from resuming a higher priority thread until it runs.
+static void bench_context_switch(void)
+{
+    bench_start_helper("switch", bench_context_switch_helper);
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        uint32_t start = bench_get_cycles();
+        ar_thread_resume(&s_helperThread);
+        s_samples[i] = s_helperCycles - start;
+    }
+
+    s_stopHelper = true;
+    ar_thread_resume(&s_helperThread);
+    bench_delete_helper();
+    bench_report("context_switch", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Helper that answers each put of one semaphore with a put of another.
+static void bench_semaphore_helper(void * param)
+{
+    while (ar_semaphore_get(&s_semaphore, kArInfiniteTimeout) == kArSuccess)
+    {
+        ar_semaphore_put(&s_replySemaphore);
+    }
+}
+
+//! @brief Round trip time of a semaphore put answered by another thread.
+static void bench_semaphore_ping_pong(void)
+{
+    ar_semaphore_create(&s_semaphore, "ping", 0);
+    ar_semaphore_create(&s_replySemaphore, "pong", 0);
+    bench_start_helper("pong", bench_semaphore_helper);
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        uint32_t start = bench_get_cycles();
+        ar_semaphore_put(&s_semaphore);
+        ar_semaphore_get(&s_replySemaphore, kArInfiniteTimeout);
+        s_samples[i] = bench_get_cycles() - start;
+    }
+
+    ar_semaphore_delete(&s_semaphore);
+    ar_semaphore_delete(&s_replySemaphore);
+    bench_delete_helper();
+    bench_report("semaphore_ping_pong", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Cost of sending and receiving one element without blocking.
+static void bench_queue(unsigned elementSize)
+{
+    uint8_t element[64];
+    memset(element, 0xa5, sizeof(element));
+    ar_queue_create(&s_queue, "queue", s_queueStorage, elementSize, sizeof(s_queueStorage) / elementSize);
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        uint32_t start = bench_get_cycles();
+        ar_queue_send(&s_queue, element, kArNoTimeout);
+        ar_queue_receive(&s_queue, element, kArNoTimeout);
+        s_samples[i] = bench_get_cycles() - start;
+    }
+
+    ar_queue_delete(&s_queue);
+
+    char name[32];
+    snprintf(name, sizeof(name), "queue_send_receive_%u", elementSize);
+    bench_report(name, bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Cost of sending and receiving a batch of byte elements without blocking.
+static void bench_queue_batch(unsigned count)
+{
+    uint8_t elements[64];
+    memset(elements, 0xa5, sizeof(elements));
+    ar_queue_create(&s_queue, "queue", s_queueStorage, 1, sizeof(s_queueStorage));
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        uint32_t start = bench_get_cycles();
+        ar_queue_send_n(&s_queue, elements, count, NULL, kArNoTimeout);
+        ar_queue_receive_n(&s_queue, elements, count, NULL, kArNoTimeout);
+        s_samples[i] = bench_get_cycles() - start;
+    }
+
+    ar_queue_delete(&s_queue);
+
+    char name[32];
+    snprintf(name, sizeof(name), "queue_send_receive_n_%u", count);
+    bench_report(name, bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Helper that receives from the channel.
+static void bench_channel_helper(void * param)
+{
+    uint32_t value;
+    while (ar_channel_receive(&s_channel, &value, kArInfiniteTimeout) == kArSuccess)
+    {
+        s_helperCycles = bench_get_cycles();
+    }
+}
+
+//! @brief Time from a send until a thread waiting to receive has the value.
+static void bench_channel(void)
+{
+    ar_channel_create(&s_channel, "channel", sizeof(uint32_t));
+    bench_start_helper("receiver", bench_channel_helper);
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        uint32_t start = bench_get_cycles();
+        ar_channel_send(&s_channel, &i, kArInfiniteTimeout);
+        s_samples[i] = s_helperCycles - start;
+    }
+
+    ar_channel_delete(&s_channel);
+    bench_delete_helper();
+    bench_report("channel_rendezvous", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Cost of a get and put of a mutex that no other thread wants.
+static void bench_mutex_uncontended(void)
+{
+    ar_mutex_create(&s_mutex, "mutex");
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        uint32_t start = bench_get_cycles();
+        ar_mutex_get(&s_mutex, kArInfiniteTimeout);
+        ar_mutex_put(&s_mutex);
+        s_samples[i] = bench_get_cycles() - start;
+    }
+
+    ar_mutex_delete(&s_mutex);
+    bench_report("mutex_uncontended", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Helper that blocks on the mutex each time it is resumed.
+static void bench_mutex_helper(void * param)
+{
+    while (true)
+    {
+        ar_thread_suspend(ar_thread_get_current());
+        if (s_stopHelper)
+        {
+            return;
+        }
+
+        ar_mutex_get(&s_mutex, kArInfiniteTimeout);
+        s_helperCycles = bench_get_cycles();
+        ar_mutex_put(&s_mutex);
+    }
+}
+
+//! @brief Time from releasing a mutex until a higher priority waiter owns it.
+static void bench_mutex_contended(void)
+{
+    ar_mutex_create(&s_mutex, "mutex");
+    bench_start_helper("waiter", bench_mutex_helper);
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        ar_mutex_get(&s_mutex, kArInfiniteTimeout);
+        ar_thread_resume(&s_helperThread);
+
+        uint32_t start = bench_get_cycles();
+        ar_mutex_put(&s_mutex);
+        s_samples[i] = s_helperCycles - start;
+    }
+
+    s_stopHelper = true;
+    ar_thread_resume(&s_helperThread);
+    bench_delete_helper();
+    ar_mutex_delete(&s_mutex);
+    bench_report("mutex_contended", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Cost of reading a 64-byte snapshot from a seqlock with no write in progress.
+static void bench_seqlock_read(void)
+{
+    ar_seqlock_create(&s_seqlock, "seqlock", s_seqlockStorage, sizeof(s_seqlockStorage));
+
+    uint8_t snapshot[sizeof(s_seqlockStorage)];
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        uint32_t start = bench_get_cycles();
+        ar_seqlock_read(&s_seqlock, snapshot);
+        s_samples[i] = bench_get_cycles() - start;
+    }
+
+    ar_seqlock_delete(&s_seqlock);
+    bench_report("seqlock_read_64", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Benchmark IRQ handler that wakes the helper thread.
+static void bench_isr_wake_handler(void)
+{
+    s_irqCycles = bench_get_cycles();
+    ar_semaphore_put(&s_semaphore);
+}
+
+//! @brief Helper that records when it is woken by the IRQ handler.
+static void bench_isr_wake_helper(void * param)
+{
+    while (ar_semaphore_get(&s_semaphore, kArInfiniteTimeout) == kArSuccess)
+    {
+        s_helperCycles = bench_get_cycles();
+    }
+}
+
+//! @brief Time from an IRQ handler putting a semaphore until the waiting thread runs.
+static void bench_isr_wake(void)
+{
+    ar_semaphore_create(&s_semaphore, "irq", 0);
+    bench_set_irq_handler(bench_isr_wake_handler);
+    bench_start_helper("irq_waiter", bench_isr_wake_helper);
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        bench_trigger_irq();
+        s_samples[i] = s_helperCycles - s_irqCycles;
+    }
+
+    bench_set_irq_handler(NULL);
+    ar_semaphore_delete(&s_semaphore);
+    bench_delete_helper();
+    bench_report("isr_wake_latency", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Benchmark IRQ handler that notifies the helper thread.
+static void bench_isr_notify_handler(void)
+{
+    s_irqCycles = bench_get_cycles();
+    ar_thread_notify(&s_helperThread, kArNotifyIncrement, 0);
+}
+
+//! @brief Helper that records when it is woken by a notification.
+static void bench_isr_notify_helper(void * param)
+{
+    while (ar_thread_notify_wait(0xffffffff, NULL, kArInfiniteTimeout) == kArSuccess)
+    {
+        s_helperCycles = bench_get_cycles();
+    }
+}
+
+//! @brief Time from an IRQ handler notifying a thread until the thread runs.
+static void bench_isr_notify(void)
+{
+    bench_set_irq_handler(bench_isr_notify_handler);
+    bench_start_helper("irq_notified", bench_isr_notify_helper);
+
+    uint32_t i;
+    for (i = 0; i < BENCH_SAMPLE_COUNT; ++i)
+    {
+        bench_trigger_irq();
+        s_samples[i] = s_helperCycles - s_irqCycles;
+    }
+
+    bench_set_irq_handler(NULL);
+    bench_delete_helper();
+    bench_report("isr_notify_latency", bench_get_cycle_unit(), s_samples, BENCH_SAMPLE_COUNT);
+}
+
+//! @brief Timer callback that records how far each expiry is from one period after the last.
+static void bench_timer_callback(ar_timer_t * timer, void * param)
+{
+    uint64_t now = ar_get_cycles();
+    if (s_timerLastCycles)
+    {
+        int64_t error = static_cast<int64_t>(now - s_timerLastCycles - s_timerPeriodCycles);
+        s_samples[s_timerSampleCount] = static_cast<uint32_t>(error < 0 ? -error : error);
+        if (++s_timerSampleCount == BENCH_SAMPLE_COUNT)
+        {
+            ar_runloop_stop(&s_runloop);
+        }
+    }
+    s_timerLastCycles = now;
+}
+
+//! @brief Jitter of a 1 ms periodic timer, in cycles of ar_get_cycles().
+static void bench_timer_jitter(void)
+{
+    s_timerSampleCount = 0;
+    s_timerLastCycles = 0;
+    s_timerPeriodCycles = ar_get_cycles_per_second() / 1000;
+    ar_runloop_create(&s_runloop, "bench");
+    ar_timer_create(&s_timer, "timer", bench_timer_callback, NULL, kArPeriodicTimer, 1);
+    ar_runloop_add_timer(&s_runloop, &s_timer);
+    ar_timer_start(&s_timer);
+
+    ar_runloop_run(&s_runloop, kArInfiniteTimeout, NULL);
+
+    ar_timer_delete(&s_timer);
+    ar_runloop_delete(&s_runloop);
+    bench_report("timer_jitter", "cycles", s_samples, s_timerSampleCount);
+}
+
+void bench_run_all(void)
+{
+    bench_context_switch();
+    bench_semaphore_ping_pong();
+    bench_queue(4);
+    bench_queue(16);
+    bench_queue(64);
+    bench_queue_batch(64);
+    bench_channel();
+    bench_mutex_uncontended();
+    bench_mutex_contended();
+    bench_seqlock_read();
+    bench_isr_wake();
+    bench_isr_notify();
+    bench_timer_jitter();
+
+    printf("BENCH done\n");
+    bench_platform_exit(0);
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file bench_posix.cpp
+ * @brief Benchmark platform layer for the POSIX host port.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void bench_platform_init(void)
+{
+    // Don't let stdout buffering hide results if the process is killed.
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    bench_cycle_counter_init();
+}
+
+void bench_cycle_counter_init(void)
+{
+    // Host counters are always running.
+}
+
+uint32_t bench_get_cycles(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return static_cast<uint32_t>(__rdtsc());
+#elif defined(__aarch64__)
+    uint64_t count;
+    __asm__ volatile ("isb; mrs %0, cntvct_el0" : "=r" (count));
+    return static_cast<uint32_t>(count);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint32_t>(now.tv_sec * 1000000000ull + now.tv_nsec);
+#endif
+}
+
+const char * bench_get_cycle_unit(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return "cycles";
+#elif defined(__aarch64__)
+    return "ticks";
+#else
+    return "ns";
+#endif
+}
+
+void bench_set_irq_handler(bench_irq_handler_t handler)
+{
+    ar_port_set_irq_handler(handler);
+}
+
+void bench_trigger_irq(void)
+{
+    ar_port_trigger_irq();
+}
+
+void bench_platform_exit(int status)
+{
+    fflush(stdout);
+    exit(status);
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file bench_mps2.cpp
+ * @brief Benchmark cycle counter for the QEMU MPS2 boards.
+ *
+ * QEMU does not model the DWT cycle counter, so the free running CMSDK timer 0 is used in its
+ * place. It counts down at the 25 MHz system clock, which is also the core clock. Unless QEMU
+ * is run with `-icount`, the count follows host time rather than emulated instructions.
+ */
+
+#include "bench.h"
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void bench_cycle_counter_init(void)
+{
+    CMSDK_TIMER0->CTRL = 0;
+    CMSDK_TIMER0->RELOAD = 0xffffffff;
+    CMSDK_TIMER0->VALUE = 0xffffffff;
+    CMSDK_TIMER0->CTRL = CMSDK_TIMER_CTRL_EN_Msk;
+}
+
+uint32_t bench_get_cycles(void)
+{
+    // Invert the down counter so that differences are positive.
+    return ~CMSDK_TIMER0->VALUE;
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
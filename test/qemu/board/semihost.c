@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file semihost.c
+ * @brief Console output and program exit through Arm semihosting.
+ *
+ * These override the newlib system call stubs from libnosys so that stdout and stderr are
+ * written to the host terminal, and exit() ends the QEMU session with a pass/fail status.
+ * Run QEMU with `-semihosting-config enable=on,target=native`.
+ */
+
+#include <stdint.h>
+#include <errno.h>
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! @brief Semihosting operations.
+enum _semihost_ops
+{
+    kSemihostOpen = 0x01,   //!< SYS_OPEN
+    kSemihostWrite = 0x05,  //!< SYS_WRITE
+    kSemihostExit = 0x18,   //!< SYS_EXIT
+};
+
+//! @brief SYS_EXIT reasons.
+enum _semihost_exit_reasons
+{
+    kSemihostApplicationExit = 0x20026,    //!< ADP_Stopped_ApplicationExit
+    kSemihostRunTimeError = 0x20023,       //!< ADP_Stopped_RunTimeErrorUnknown
+};
+
+//! @brief SYS_OPEN mode for writing.
+#define SEMIHOST_OPEN_MODE_W (4)
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+int _write(int file, const char * ptr, int len);
+void _exit(int status);
+
+//------------------------------------------------------------------------------
+// Variables
+//------------------------------------------------------------------------------
+
+//! @brief Host handle for the console, or -1 if not yet opened.
+static int s_consoleHandle = -1;
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+//! @brief Issue a semihosting call.
+static int semihost_call(int op, void * arg)
+{
+    register int r0 __asm__("r0") = op;
+    register void * r1 __asm__("r1") = arg;
+    __asm__ volatile ("bkpt 0xab" : "+r" (r0) : "r" (r1) : "memory");
+    return r0;
+}
+
+int _write(int file, const char * ptr, int len)
+{
+    if (file != 1 && file != 2)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    // The special file ":tt" is the host's console.
+    if (s_consoleHandle < 0)
+    {
+        uint32_t args[3] = { (uint32_t)":tt", SEMIHOST_OPEN_MODE_W, 3 };
+        s_consoleHandle = semihost_call(kSemihostOpen, args);
+        if (s_consoleHandle < 0)
+        {
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    // SYS_WRITE returns the number of bytes not written.
+    uint32_t args[3] = { (uint32_t)s_consoleHandle, (uint32_t)ptr, (uint32_t)len };
+    return len - semihost_call(kSemihostWrite, args);
+}
+
+void _exit(int status)
+{
+    // On 32-bit targets SYS_EXIT only conveys success or failure.
+    semihost_call(kSemihostExit, (void *)(status ? kSemihostRunTimeError : kSemihostApplicationExit));
+
+    // Not running under a debugger or semihosting host.
+    while (1)
+    {
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
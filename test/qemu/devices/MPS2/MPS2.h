@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file MPS2.h
+ * @brief CMSIS peripheral access layer for the Arm MPS2 AN385 and AN386 images.
+ *
+ * AN385 is a Cortex-M3 and AN386 a Cortex-M4F, both built from the Cortex-M System Design Kit
+ * (CMSDK) peripherals and sharing one memory map. Only the parts used by the QEMU board layer
+ * are described here.
+ */
+
+#if !defined(_MPS2_H_)
+#define _MPS2_H_
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! @brief Interrupt numbers.
+typedef enum IRQn
+{
+    // Core exceptions
+    NonMaskableInt_IRQn = -14,
+    HardFault_IRQn = -13,
+    MemoryManagement_IRQn = -12,
+    BusFault_IRQn = -11,
+    UsageFault_IRQn = -10,
+    SVCall_IRQn = -5,
+    DebugMonitor_IRQn = -4,
+    PendSV_IRQn = -2,
+    SysTick_IRQn = -1,
+
+    // CMSDK peripherals
+    UART0RX_IRQn = 0,
+    UART0TX_IRQn = 1,
+    UART1RX_IRQn = 2,
+    UART1TX_IRQn = 3,
+    UART2RX_IRQn = 4,
+    UART2TX_IRQn = 5,
+    PORT0_ALL_IRQn = 6,
+    PORT1_ALL_IRQn = 7,
+    TIMER0_IRQn = 8,
+    TIMER1_IRQn = 9,
+    DUALTIMER_IRQn = 10,
+    SPI_IRQn = 11,
+    UARTOVF_IRQn = 12,
+    ETHERNET_IRQn = 13,
+    I2S_IRQn = 14,
+    TSC_IRQn = 15,
+    PORT0_0_IRQn = 16,
+    PORT0_1_IRQn = 17,
+    PORT0_2_IRQn = 18,
+    PORT0_3_IRQn = 19,
+    PORT0_4_IRQn = 20,
+    PORT0_5_IRQn = 21,
+    PORT0_6_IRQn = 22,
+    PORT0_7_IRQn = 23,
+    PORT0_8_IRQn = 24,
+    PORT0_9_IRQn = 25,
+    PORT0_10_IRQn = 26,
+    PORT0_11_IRQn = 27,
+    PORT0_12_IRQn = 28,
+    PORT0_13_IRQn = 29,
+    PORT0_14_IRQn = 30,
+    PORT0_15_IRQn = 31,
+} IRQn_Type;
+
+//! @name Core configuration
+//@{
+#define __MPU_PRESENT (1)
+#define __NVIC_PRIO_BITS (3)
+#define __Vendor_SysTickConfig (0)
+
+#if defined(CPU_MPS2_AN386)
+    #define __CM4_REV (0x0001)
+    #define __FPU_PRESENT (1)
+#else
+    #define __CM3_REV (0x0201)
+#endif
+//@}
+
+#if defined(CPU_MPS2_AN386)
+#include "core_cm4.h"
+#else
+#include "core_cm3.h"
+#endif
+#include "system_MPS2.h"
+
+//! @brief CMSDK APB timer.
+typedef struct
+{
+    __IO uint32_t CTRL;     //!< [0x00] Control
+    __IO uint32_t VALUE;    //!< [0x04] Current value, counts down
+    __IO uint32_t RELOAD;   //!< [0x08] Reload value
+    __IO uint32_t INTSTATUS;//!< [0x0c] Interrupt status; write 1 to clear
+} CMSDK_TIMER_TypeDef;
+
+#define CMSDK_TIMER_CTRL_EN_Msk (1UL << 0)
+#define CMSDK_TIMER_CTRL_IRQEN_Msk (1UL << 3)
+
+//! @name Peripheral instances
+//@{
+#define CMSDK_TIMER0_BASE (0x40000000UL)
+#define CMSDK_TIMER1_BASE (0x40001000UL)
+
+#define CMSDK_TIMER0 ((CMSDK_TIMER_TypeDef *)CMSDK_TIMER0_BASE)
+#define CMSDK_TIMER1 ((CMSDK_TIMER_TypeDef *)CMSDK_TIMER1_BASE)
+//@}
+
+#endif // _MPS2_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2013-2018 Immo Software
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * @file system_MPS2.h
+ * @brief System initialization for the Arm MPS2 AN385 and AN386 images.
+ */
+
+#if !defined(_SYSTEM_MPS2_H_)
+#define _SYSTEM_MPS2_H_
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! @brief Frequency of the core and peripheral clock in Hertz.
+#define MPS2_SYSCLK_HZ (25000000UL)
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+//! @brief Core clock frequency in Hertz.
+extern uint32_t SystemCoreClock;
+
+//! @brief Set up the core before C runtime initialization.
+//!
+//! Points VTOR at the vector table and, on AN386, enables access to the FPU.
+void SystemInit(void);
+
+//! @brief Update SystemCoreClock. The MPS2 clock is fixed, so this does nothing.
+void SystemCoreClockUpdate(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // _SYSTEM_MPS2_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
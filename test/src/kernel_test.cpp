@@ -32,10 +32,33 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+//------------------------------------------------------------------------------
+// Variables
+//------------------------------------------------------------------------------
+
+static volatile kernel_test_irq_handler_t s_irqHandler = NULL;
+static void * volatile s_irqArg = NULL;
+
 //------------------------------------------------------------------------------
 // Code
 //------------------------------------------------------------------------------
 
+static void kernel_test_irq()
+{
+    kernel_test_irq_handler_t handler = s_irqHandler;
+    if (handler)
+    {
+        handler(s_irqArg);
+    }
+}
+
+#if defined(KERNEL_TEST_IRQ_HANDLER)
+extern "C" void KERNEL_TEST_IRQ_HANDLER(void)
+{
+    kernel_test_irq();
+}
+#endif // KERNEL_TEST_IRQ_HANDLER
+
 const char * KernelTest::threadIdString() const
 {
     static char idString[32];
@@ -64,6 +87,27 @@ void KernelTest::log(const char * format...)
     va_end(args);
 }
 
+void KernelTest::runFromIrq(kernel_test_irq_handler_t handler, void * arg)
+{
+    s_irqHandler = handler;
+    s_irqArg = arg;
+
+#if defined(KERNEL_TEST_IRQn)
+    NVIC_SetPriority(KERNEL_TEST_IRQn, 0);
+    NVIC_EnableIRQ(KERNEL_TEST_IRQn);
+    NVIC_SetPendingIRQ(KERNEL_TEST_IRQn);
+    __DSB();
+    __ISB();
+#elif defined(__unix__) || defined(__APPLE__)
+    ar_port_set_irq_handler(kernel_test_irq);
+    ar_port_trigger_irq();
+#else
+    log("Assertion failed: no test interrupt is defined for this board\n");
+#endif
+
+    s_irqHandler = NULL;
+}
+
 void KernelTest::assert_true(bool predicate, const char * msg, const char * desc, const char * file, int line)
 {
     if (!predicate)
@@ -44,6 +44,9 @@
 // Definitions
 //------------------------------------------------------------------------------
 
+//! @brief Function run in interrupt context by KernelTest::runFromIrq().
+typedef void (*kernel_test_irq_handler_t)(void * arg);
+
 /*!
  * @brief Abstract kernel test class.
  */
@@ -83,6 +86,13 @@ protected:
     void printHello();
     void printTicks();
 
+    //! @brief Run a function in interrupt context, returning after it has finished.
+    //!
+    //! On Cortex-M, the board must define KERNEL_TEST_IRQn and KERNEL_TEST_IRQ_HANDLER to name
+    //! an otherwise unused interrupt that can be pended from software. The POSIX port uses its
+    //! simulated interrupt.
+    void runFromIrq(kernel_test_irq_handler_t handler, void * arg);
+
 };
 
 #endif // _KERNEL_TEST_H_
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_condvar.h"
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestCondVar1::run()
+{
+    memset(m_wakeOrder, 0, sizeof(m_wakeOrder));
+    m_wakeCount = 0;
+
+    m_mutex.init("mutex");
+    m_cv.init("cv");
+    m_aThread.init("a", this, &TestCondVar1::a_thread, 60);
+    m_bThread.init("b", this, &TestCondVar1::b_thread, 61);
+    m_cThread.init("c", this, &TestCondVar1::c_thread, 62);
+    m_signallerThread.init("signaller", this, &TestCondVar1::signaller_thread, 50);
+}
+
+void TestCondVar1::wait_for_broadcast_and_delete(char name)
+{
+    m_mutex.get();
+    ASSERT_EQUALS(m_cv.wait(m_mutex), kArSuccess, "woken by broadcast");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(self()), "mutex relocked");
+    m_wakeOrder[m_wakeCount++] = name;
+    m_mutex.put();
+
+    m_mutex.get();
+    ASSERT_EQUALS(m_cv.wait(m_mutex), kArObjectDeletedError, "woken by delete");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(self()), "mutex relocked after delete");
+    m_mutex.put();
+}
+
+void TestCondVar1::a_thread()
+{
+    printHello();
+
+    wait_for_broadcast_and_delete('a');
+}
+
+void TestCondVar1::b_thread()
+{
+    printHello();
+
+    wait_for_broadcast_and_delete('b');
+}
+
+void TestCondVar1::c_thread()
+{
+    printHello();
+
+    // Lock recursively, to check the count is restored after waiting.
+    m_mutex.get();
+    m_mutex.get();
+    ASSERT_EQUALS(m_cv.wait(m_mutex), kArSuccess, "woken by signal");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(self()), "mutex relocked");
+    ASSERT_EQUALS(m_mutex.m_ownerLockCount, 2u, "recursive lock count restored");
+    m_wakeOrder[m_wakeCount++] = 'c';
+    m_mutex.put();
+    m_mutex.put();
+
+    wait_for_broadcast_and_delete('c');
+}
+
+void TestCondVar1::signaller_thread()
+{
+    printHello();
+
+    log("waits that fail");
+    ASSERT_EQUALS(m_cv.wait(m_mutex, 10), kArNotOwnerError, "must own the mutex");
+    m_mutex.get();
+    ASSERT_EQUALS(m_cv.wait(m_mutex, kArNoTimeout), kArTimeoutError, "zero timeout");
+    ASSERT_EQUALS(m_cv.wait(m_mutex, 10), kArTimeoutError, "wait times out");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(self()), "mutex relocked after timeout");
+    ASSERT_EQUALS(m_mutex.m_ownerLockCount, 1u, "lock count after timeout");
+    m_mutex.put();
+
+    log("signal");
+    ASSERT_EQUALS(m_cv.signal(), kArSuccess, "signal");
+    ASSERT_EQUALS(m_wakeCount, 1u, "one thread woken");
+    ASSERT_EQUALS(m_wakeOrder[0], 'c', "highest priority waiter woken");
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadBlocked, "a still waiting");
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadBlocked, "b still waiting");
+
+    log("broadcast with the mutex locked");
+    m_mutex.get();
+    ASSERT_EQUALS(m_cv.broadcast(), kArSuccess, "broadcast");
+
+    // None of the waiters can run until the mutex is unlocked, so they were moved straight
+    // onto its blocked list, and its owner inherited the highest of their priorities.
+    ASSERT_EQUALS(m_wakeCount, 1u, "no thread ran yet");
+    ASSERT_TRUE(m_cv.m_blockedList.m_head == NULL, "condition variable has no waiters");
+    ASSERT_TRUE(m_mutex.m_blockedList.m_head != NULL, "waiters moved to the mutex");
+    ASSERT_EQUALS(self()->getPriority(), 62, "owner hoisted to highest waiter");
+    m_mutex.put();
+    ASSERT_EQUALS(self()->getPriority(), 50, "owner priority restored");
+    ASSERT_EQUALS(m_wakeCount, 4u, "all threads woken");
+    ASSERT_TRUE(strcmp(m_wakeOrder, "ccba") == 0, "woken in priority order");
+
+    log("delete while waiting");
+    ar_condvar_delete(&m_cv);
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadDone, "a finished");
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadDone, "b finished");
+    ASSERT_EQUALS(m_cThread.getState(), kArThreadDone, "c finished");
+    ASSERT_EQUALS(m_mutex.getOwner(), (void *)NULL, "mutex unlocked");
+    m_cv.init("cv");
+
+    log("done");
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
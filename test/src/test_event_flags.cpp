@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_event_flags.h"
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestEventFlags1::run()
+{
+    m_aResult = 0;
+    m_bResult = 0;
+    m_cResult = 0;
+
+    m_flags.init("flags");
+    m_aThread.init("a", this, &TestEventFlags1::a_thread, 70);
+    m_bThread.init("b", this, &TestEventFlags1::b_thread, 69);
+    m_cThread.init("c", this, &TestEventFlags1::c_thread, 68);
+    m_setterThread.init("setter", this, &TestEventFlags1::setter_thread, 50);
+}
+
+void TestEventFlags1::a_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_flags.wait(0x3, kArEventFlagsWaitAny | kArEventFlagsClearOnExit, &m_aResult), kArSuccess, "a wait any with clear");
+}
+
+void TestEventFlags1::b_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_flags.wait(0x6, kArEventFlagsWaitAll, &m_bResult), kArSuccess, "b wait all");
+}
+
+void TestEventFlags1::c_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_flags.wait(0x4, kArEventFlagsWaitAny, &m_cResult), kArSuccess, "c wait any");
+}
+
+void TestEventFlags1::setter_thread()
+{
+    printHello();
+
+    log("waits that do not block");
+    uint32_t result = 0;
+    m_flags.set(0x8);
+    ASSERT_EQUALS(m_flags.wait(0x18, kArEventFlagsWaitAny, &result, 0), kArSuccess, "any satisfied");
+    ASSERT_EQUALS(result, 0x8u, "any result");
+    ASSERT_EQUALS(m_flags.wait(0x18, kArEventFlagsWaitAll, &result, 0), kArTimeoutError, "all not satisfied");
+    ASSERT_EQUALS(m_flags.wait(0x10, kArEventFlagsWaitAny, &result, 0), kArTimeoutError, "any not satisfied");
+    ASSERT_EQUALS(m_flags.getFlags(), 0x8u, "flags kept without clear on exit");
+    ASSERT_EQUALS(m_flags.wait(0x18, kArEventFlagsWaitAny | kArEventFlagsClearOnExit, &result, 0), kArSuccess, "any with clear satisfied");
+    ASSERT_EQUALS(m_flags.getFlags(), 0u, "flag cleared on exit");
+
+    log("timeout");
+    uint32_t start = ar_get_millisecond_count();
+    ASSERT_EQUALS(m_flags.wait(0x10, kArEventFlagsWaitAny, &result, 20), kArTimeoutError, "wait times out");
+    ASSERT_TRUE(ar_get_millisecond_count() - start >= 20, "waited for the timeout");
+
+    log("waking waiters");
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadBlocked, "a blocked");
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadBlocked, "b blocked");
+    ASSERT_EQUALS(m_cThread.getState(), kArThreadBlocked, "c blocked");
+
+    m_flags.set(0x4);
+    ASSERT_EQUALS(m_cThread.getState(), kArThreadDone, "c woken");
+    ASSERT_EQUALS(m_cResult, 0x4u, "c result");
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadBlocked, "a still blocked");
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadBlocked, "b still blocked");
+
+    // One set satisfies both a and b. Thread a clears only the flags it waited for.
+    m_flags.set(0x2);
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadDone, "a woken");
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadDone, "b woken");
+    ASSERT_EQUALS(m_aResult, 0x6u, "a result");
+    ASSERT_EQUALS(m_bResult, 0x6u, "b result");
+    ASSERT_EQUALS(m_flags.getFlags(), 0x4u, "a cleared its flags on exit");
+
+    log("done");
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_message_buffer.h"
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! Longest message that fits in the 32 byte buffer along with its 16-bit length.
+#define TEST_MAX_MESSAGE_LENGTH (32 - sizeof(uint16_t))
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestMessageBuffer1::run()
+{
+    memset(m_received, 0, sizeof(m_received));
+    m_receivedLength = 0;
+    m_timeoutStatus = kArSuccess;
+    m_runLoopStatus = kArSuccess;
+
+    m_buffer.init("buffer");
+    m_runLoopBuffer.init("runloop buffer");
+    m_runLoop.init("runloop");
+
+    m_receiverThread.init("receiver", this, &TestMessageBuffer1::receiver_thread, 60, false);
+    m_runLoopThread.init("runloop", this, &TestMessageBuffer1::runloop_thread, 61, false);
+    m_controllerThread.init("controller", this, &TestMessageBuffer1::controller_thread, 40);
+}
+
+void TestMessageBuffer1::fill(uint8_t * data, uint32_t length, uint8_t seed)
+{
+    uint32_t i;
+    for (i = 0; i < length; ++i)
+    {
+        data[i] = static_cast<uint8_t>(seed + i);
+    }
+}
+
+bool TestMessageBuffer1::matches(const uint8_t * data, uint32_t length, uint8_t seed)
+{
+    uint32_t i;
+    for (i = 0; i < length; ++i)
+    {
+        if (data[i] != static_cast<uint8_t>(seed + i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestMessageBuffer1::receiver_thread()
+{
+    printHello();
+
+    // Blocks until the controller sends a message.
+    uint32_t length = 0;
+    ASSERT_EQUALS(m_buffer.receive(m_received, sizeof(m_received), &length), kArSuccess, "receiver got message");
+    m_receivedLength = length;
+
+    m_timeoutStatus = m_buffer.receive(m_received, sizeof(m_received), &length, 20);
+}
+
+void TestMessageBuffer1::runloop_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_runLoop.addMessageBuffer(&m_runLoopBuffer), kArSuccess, "add message buffer");
+
+    // Runs until a message arrives.
+    ar_runloop_result_t result;
+    m_runLoopStatus = m_runLoop.run(kArInfiniteTimeout, &result);
+    ASSERT_TRUE(result.m_messageBuffer == &m_runLoopBuffer, "runloop result is the buffer");
+
+    uint8_t data[4];
+    uint32_t length = 0;
+    ASSERT_EQUALS(m_runLoopBuffer.receive(data, sizeof(data), &length, kArNoTimeout), kArSuccess, "runloop receive");
+    ASSERT_EQUALS(length, 3U, "runloop message length");
+    ASSERT_TRUE(matches(data, length, 0x50), "runloop message contents");
+}
+
+void TestMessageBuffer1::controller_thread()
+{
+    printHello();
+
+    uint8_t data[32];
+    uint8_t received[32];
+    uint32_t length = 0;
+
+    // A message must fit in the buffer along with its length.
+    ASSERT_EQUALS(m_buffer.getFree(), 32U, "empty buffer free");
+    ASSERT_EQUALS(m_buffer.send(data, TEST_MAX_MESSAGE_LENGTH + 1, kArNoTimeout), kArInvalidParameterError, "oversize message");
+    ASSERT_EQUALS(m_buffer.receive(received, sizeof(received), &length, kArNoTimeout), kArQueueEmptyError, "receive from empty buffer");
+
+    // The largest message fills the buffer.
+    fill(data, TEST_MAX_MESSAGE_LENGTH, 0x10);
+    ASSERT_EQUALS(m_buffer.send(data, TEST_MAX_MESSAGE_LENGTH, kArNoTimeout), kArSuccess, "largest message");
+    ASSERT_EQUALS(m_buffer.getFree(), 0U, "buffer full");
+    ASSERT_EQUALS(m_buffer.send(data, 0, kArNoTimeout), kArQueueFullError, "send to full buffer");
+    ASSERT_EQUALS(m_buffer.receive(received, sizeof(received), &length, kArNoTimeout), kArSuccess, "receive largest message");
+    ASSERT_EQUALS(length, TEST_MAX_MESSAGE_LENGTH, "largest message length");
+    ASSERT_TRUE(matches(received, length, 0x10), "largest message contents");
+
+    // Messages keep their boundaries, including empty ones.
+    fill(data, 3, 0x20);
+    ASSERT_EQUALS(m_buffer.send(data, 3, kArNoTimeout), kArSuccess, "send 3 bytes");
+    ASSERT_EQUALS(m_buffer.send(NULL, 0, kArNoTimeout), kArSuccess, "send empty message");
+    fill(data, 5, 0x30);
+    ASSERT_EQUALS(m_buffer.send(data, 5, kArNoTimeout), kArSuccess, "send 5 bytes");
+    ASSERT_EQUALS(m_buffer.getCount(), 3U, "three messages");
+    ASSERT_EQUALS(m_buffer.getNextLength(), 3U, "next length");
+
+    // A message too long for the caller's buffer is left in place.
+    ASSERT_EQUALS(m_buffer.receive(received, 2, &length, kArNoTimeout), kArInvalidParameterError, "receive into short buffer");
+    ASSERT_EQUALS(length, 3U, "length of message left in place");
+    ASSERT_EQUALS(m_buffer.getCount(), 3U, "still three messages");
+
+    ASSERT_EQUALS(m_buffer.receive(received, sizeof(received), &length, kArNoTimeout), kArSuccess, "receive 3 bytes");
+    ASSERT_TRUE(length == 3 && matches(received, 3, 0x20), "3 byte message");
+    ASSERT_EQUALS(m_buffer.receive(received, sizeof(received), &length, kArNoTimeout), kArSuccess, "receive empty message");
+    ASSERT_EQUALS(length, 0U, "empty message");
+    ASSERT_EQUALS(m_buffer.receive(received, sizeof(received), &length, kArNoTimeout), kArSuccess, "receive 5 bytes");
+    ASSERT_TRUE(length == 5 && matches(received, 5, 0x30), "5 byte message");
+
+    // Messages of lengths that do not divide the capacity wrap at every possible offset,
+    // splitting both lengths and contents across the end of the storage.
+    uint32_t i;
+    for (i = 0; i < 40; ++i)
+    {
+        uint32_t messageLength = 1 + (i % 7);
+        fill(data, messageLength, static_cast<uint8_t>(i));
+        ASSERT_EQUALS(m_buffer.send(data, messageLength, kArNoTimeout), kArSuccess, "send wrapped");
+        if (i & 1)
+        {
+            ASSERT_EQUALS(m_buffer.receive(received, sizeof(received), &length, kArNoTimeout), kArSuccess, "receive wrapped");
+            ASSERT_TRUE(length == 1 + ((i - 1) % 7) && matches(received, length, static_cast<uint8_t>(i - 1)), "wrapped message");
+            ASSERT_EQUALS(m_buffer.receive(received, sizeof(received), &length, kArNoTimeout), kArSuccess, "receive wrapped");
+            ASSERT_TRUE(length == messageLength && matches(received, length, static_cast<uint8_t>(i)), "wrapped message");
+        }
+    }
+    ASSERT_EQUALS(m_buffer.getCount(), 0U, "wrapped messages all received");
+    ASSERT_EQUALS(m_buffer.getFree(), 32U, "buffer empty again");
+
+    // A blocked receiver is woken by a send, and times out when nothing more arrives.
+    m_receiverThread.resume();
+    ASSERT_EQUALS(m_receiverThread.getState(), kArThreadBlocked, "receiver blocked");
+    fill(data, 4, 0x40);
+    ASSERT_EQUALS(m_buffer.send(data, 4), kArSuccess, "send to receiver");
+    ASSERT_EQUALS(m_receivedLength, 4U, "receiver message length");
+    ASSERT_TRUE(matches(m_received, 4, 0x40), "receiver message contents");
+    ar_thread_sleep(50);
+    ASSERT_EQUALS(m_timeoutStatus, kArTimeoutError, "receiver timed out");
+
+    // A message wakes the runloop the buffer is attached to.
+    m_runLoopThread.resume();
+    ASSERT_EQUALS(m_runLoopThread.getState(), kArThreadSuspended, "runloop waiting");
+    ASSERT_EQUALS(m_runLoop.addMessageBuffer(&m_runLoopBuffer), kArSuccess, "add to same runloop again");
+    fill(data, 3, 0x50);
+    ASSERT_EQUALS(m_runLoopBuffer.send(data, 3), kArSuccess, "send to runloop");
+    ASSERT_EQUALS(m_runLoopStatus, kArRunLoopMessageBufferReceived, "runloop exited for message");
+    ASSERT_EQUALS(m_runLoopThread.getState(), kArThreadDone, "runloop thread done");
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(_KERNEL_TEST_MESSAGE_BUFFER_H_)
+#define _KERNEL_TEST_MESSAGE_BUFFER_H_
+
+#include "argon/argon.h"
+#include "argon/test/kernel_test.h"
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+/*!
+ * @brief Message buffer test.
+ *
+ * The receiver and runloop threads are created suspended and have higher priorities than the
+ * controller thread, so each runs until it blocks as soon as the controller resumes it.
+ */
+class TestMessageBuffer1 : public KernelTest
+{
+public:
+    TestMessageBuffer1() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_receiverThread;
+    Ar::ThreadWithStack<512> m_runLoopThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::StaticMessageBuffer<32> m_buffer;
+    Ar::StaticMessageBuffer<32> m_runLoopBuffer;
+    Ar::RunLoop m_runLoop;
+
+    uint8_t m_received[16];
+    volatile uint32_t m_receivedLength;
+    volatile ar_status_t m_timeoutStatus;
+    volatile ar_status_t m_runLoopStatus;
+
+    void receiver_thread();
+    void runloop_thread();
+    void controller_thread();
+
+    static void fill(uint8_t * data, uint32_t length, uint8_t seed);
+    static bool matches(const uint8_t * data, uint32_t length, uint8_t seed);
+
+};
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+#endif // _KERNEL_TEST_MESSAGE_BUFFER_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
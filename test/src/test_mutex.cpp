@@ -30,6 +30,7 @@
 
 #include "argon/argon.h"
 #include "test_mutex.h"
+#include <string.h>
 
 //------------------------------------------------------------------------------
 // Code
@@ -100,6 +101,79 @@ void TestMutex1::b_thread()
     }
 }
 
+void TestMutex2::run()
+{
+    memset(m_lockOrder, 0, sizeof(m_lockOrder));
+    m_lockCount = 0;
+
+    m_mutex.init("mutex");
+    m_aThread.init("a", this, &TestMutex2::a_thread, 70, false);
+    m_bThread.init("b", this, &TestMutex2::b_thread, 60, false);
+    m_ownerThread.init("owner", this, &TestMutex2::owner_thread, 50);
+}
+
+void TestMutex2::owner_thread()
+{
+    printHello();
+
+    log("recursive lock");
+    ASSERT_EQUALS(m_mutex.get(), kArSuccess, "get");
+    ASSERT_EQUALS(m_mutex.get(kArNoTimeout), kArSuccess, "recursive get does not block");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(self()), "owner");
+    ASSERT_EQUALS(m_mutex.m_ownerLockCount, 2u, "lock count");
+
+    log("hoisting");
+    m_bThread.resume();
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadBlocked, "b blocked");
+    ASSERT_EQUALS(self()->getPriority(), 60, "hoisted to b");
+    m_aThread.resume();
+
+    // Thread a times out once and then blocks again.
+    Ar::Thread::sleep(30);
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadBlocked, "a blocked");
+    ASSERT_EQUALS(self()->getPriority(), 70, "hoisted to a");
+
+    log("release");
+    ASSERT_EQUALS(m_mutex.put(), kArSuccess, "put");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(self()), "still owner");
+    ASSERT_EQUALS(self()->getPriority(), 70, "still hoisted");
+    ASSERT_EQUALS(m_lockCount, 0u, "no waiter ran yet");
+    ASSERT_EQUALS(m_mutex.put(), kArSuccess, "put");
+    ASSERT_EQUALS(self()->getPriority(), 50, "priority restored");
+    ASSERT_EQUALS(m_mutex.getOwner(), (void *)NULL, "no owner");
+    ASSERT_EQUALS(m_lockCount, 2u, "both waiters ran");
+    ASSERT_TRUE(strcmp(m_lockOrder, "ab") == 0, "waiters locked in priority order");
+    ASSERT_EQUALS(m_mutex.put(), kArAlreadyUnlockedError, "put when unlocked");
+
+    log("done");
+}
+
+void TestMutex2::a_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_mutex.get(10), kArTimeoutError, "get times out");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(&m_ownerThread), "owner unchanged");
+
+    ASSERT_EQUALS(m_mutex.get(), kArSuccess, "get");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(&m_aThread), "a is owner");
+    ASSERT_EQUALS(m_mutex.m_ownerLockCount, 1u, "lock count");
+    m_lockOrder[m_lockCount++] = 'a';
+    m_mutex.put();
+}
+
+void TestMutex2::b_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_mutex.put(), kArNotOwnerError, "put by non-owner");
+
+    ASSERT_EQUALS(m_mutex.get(), kArSuccess, "get");
+    ASSERT_EQUALS(m_mutex.getOwner(), static_cast<ar_thread_t *>(&m_bThread), "b is owner");
+    m_lockOrder[m_lockCount++] = 'b';
+    m_mutex.put();
+}
+
 //------------------------------------------------------------------------------
 // EOF
 //------------------------------------------------------------------------------
@@ -64,6 +64,36 @@ protected:
 
 };
 
+/*!
+ * @brief Mutex ownership and priority inheritance test.
+ *
+ * The owner thread has the lowest priority. It locks the mutex recursively, then starts
+ * threads a and b, which block on the mutex and raise its priority.
+ */
+class TestMutex2 : public KernelTest
+{
+public:
+    TestMutex2() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_ownerThread;
+    Ar::ThreadWithStack<512> m_aThread;
+    Ar::ThreadWithStack<512> m_bThread;
+
+    Ar::Mutex m_mutex;
+
+    char m_lockOrder[4];
+    uint32_t m_lockCount;
+
+    void owner_thread();
+    void a_thread();
+    void b_thread();
+
+};
+
 //------------------------------------------------------------------------------
 // Prototypes
 //------------------------------------------------------------------------------
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_notify.h"
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestNotify1::run()
+{
+    m_aThread.init("a", this, &TestNotify1::a_thread, 60);
+    m_bThread.init("b", this, &TestNotify1::b_thread, 50);
+}
+
+void TestNotify1::increment_from_irq(void * arg)
+{
+    static_cast<Ar::Thread *>(arg)->notify(kArNotifyIncrement);
+}
+
+void TestNotify1::a_thread()
+{
+    printHello();
+
+    uint32_t value = 0;
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, 0), kArTimeoutError, "nothing pending");
+
+    log("increment");
+    self()->notify(kArNotifyIncrement);
+    self()->notify(kArNotifyIncrement);
+    self()->notify(kArNotifyIncrement);
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, 0), kArSuccess, "increments pending");
+    ASSERT_EQUALS(value, 3u, "increments add up");
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, 0), kArTimeoutError, "wait clears pending");
+
+    log("set bits and clearBits");
+    self()->notify(kArNotifySetBits, 0x1);
+    self()->notify(kArNotifySetBits, 0x4);
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0x1, &value, 0), kArSuccess, "bits pending");
+    ASSERT_EQUALS(value, 0x5u, "bits are ORed");
+    self()->notify(kArNotifySetBits, 0x8);
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0, &value, 0), kArSuccess, "bits pending");
+    ASSERT_EQUALS(value, 0xcu, "only clearBits were cleared");
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, 0), kArTimeoutError, "wait clears pending");
+
+    log("overwrite");
+    self()->notify(kArNotifyOverwrite, 42);
+    self()->notify(kArNotifyOverwrite, 7);
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, 0), kArSuccess, "overwrite pending");
+    ASSERT_EQUALS(value, 7u, "last overwrite wins");
+
+    log("blocking wait woken by thread b");
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, kArInfiniteTimeout), kArSuccess, "woken by thread");
+    ASSERT_EQUALS(value, 0x10u, "value from thread b");
+
+    log("blocking wait woken by interrupt");
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, kArInfiniteTimeout), kArSuccess, "woken by interrupt");
+    ASSERT_EQUALS(value, 1u, "value from interrupt");
+
+    log("interrupt notifies while not waiting");
+    Ar::Thread::sleep(20);
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, 0), kArSuccess, "interrupt notifications pending");
+    ASSERT_EQUALS(value, 2u, "interrupt increments add up");
+
+    log("timeout");
+    ASSERT_EQUALS(Ar::Thread::notifyWait(0xffffffff, &value, 10), kArTimeoutError, "wait times out");
+
+    log("done");
+}
+
+void TestNotify1::b_thread()
+{
+    printHello();
+
+    // Each step runs once thread a has blocked again.
+    ASSERT_EQUALS(m_aThread.notify(kArNotifySetBits, 0x10), kArSuccess, "notify from thread");
+
+    runFromIrq(increment_from_irq, &m_aThread);
+
+    // Thread a is sleeping now.
+    runFromIrq(increment_from_irq, &m_aThread);
+    runFromIrq(increment_from_irq, &m_aThread);
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadSleeping, "thread a was not woken");
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -30,6 +30,7 @@
 
 #include "argon/argon.h"
 #include "test_queue.h"
+#include <string.h>
 
 //------------------------------------------------------------------------------
 // Code
@@ -99,6 +100,445 @@ void TestQueue1::consumer_b_thread()
     }
 }
 
+void TestQueue2::run()
+{
+    m_peekedValue = 0;
+    m_receivedValue = 0;
+
+    m_q.init("q");
+    m_releaseSem.init("release", 0);
+
+    m_senderThread.init("sender", this, &TestQueue2::sender_thread, 60, false);
+    m_receiverThread.init("receiver", this, &TestQueue2::receiver_thread, 61, false);
+    m_controllerThread.init("controller", this, &TestQueue2::controller_thread, 40);
+}
+
+void TestQueue2::sender_thread()
+{
+    printHello();
+
+    // Blocks until the controller commits its reservation.
+    ASSERT_EQUALS(m_q.send(2), kArSuccess, "send after commit");
+}
+
+void TestQueue2::receiver_thread()
+{
+    printHello();
+
+    // Blocks until the controller commits its reservation.
+    ar_status_t status;
+    int * element = m_q.peekReceive(kArInfiniteTimeout, &status);
+    ASSERT_EQUALS(status, kArSuccess, "peek");
+    m_peekedValue = *element;
+
+    m_releaseSem.get();
+
+    ASSERT_EQUALS(m_q.releaseReceive(), kArSuccess, "release");
+    m_receivedValue = m_q.receive();
+}
+
+void TestQueue2::controller_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_q.commitSend(), kArInvalidStateError, "commit without reservation");
+    ASSERT_EQUALS(m_q.releaseReceive(), kArInvalidStateError, "release without peek");
+
+    // A reserved slot is not visible to receivers, and holds off other senders.
+    ar_status_t status;
+    int * slot = m_q.reserveSend(kArNoTimeout, &status);
+    ASSERT_EQUALS(status, kArSuccess, "reserve");
+    *slot = 1;
+    ASSERT_EQUALS(m_q.getCount(), 0U, "reserved slot not counted");
+    ASSERT_EQUALS(m_q.send(9, kArNoTimeout), kArQueueFullError, "send while reserved");
+    ASSERT_TRUE(m_q.reserveSend(kArNoTimeout, &status) == NULL, "no second reservation");
+    ASSERT_EQUALS(status, kArQueueFullError, "reserve while reserved");
+
+    m_receiverThread.resume();
+    ASSERT_EQUALS(m_receiverThread.getState(), kArThreadBlocked, "receiver blocked by reservation");
+    m_senderThread.resume();
+    ASSERT_EQUALS(m_senderThread.getState(), kArThreadBlocked, "sender blocked by reservation");
+
+    // Committing wakes both the receiver and the sender.
+    ASSERT_EQUALS(m_q.commitSend(), kArSuccess, "commit");
+    ASSERT_EQUALS(m_peekedValue, 1, "peeked committed element");
+    ASSERT_EQUALS(m_senderThread.getState(), kArThreadDone, "sender done");
+    ASSERT_EQUALS(m_q.getCount(), 2U, "two elements");
+
+    // The peeked element stays in the queue and holds off other receivers.
+    int value = 0;
+    ASSERT_EQUALS(m_q.receive(&value, kArNoTimeout), kArQueueEmptyError, "receive while peeked");
+    ASSERT_TRUE(m_q.peekReceive(kArNoTimeout, &status) == NULL, "no second peek");
+    ASSERT_EQUALS(status, kArQueueEmptyError, "peek while peeked");
+
+    m_releaseSem.put();
+    ASSERT_EQUALS(m_receivedValue, 2, "received after release");
+    ASSERT_EQUALS(m_receiverThread.getState(), kArThreadDone, "receiver done");
+    ASSERT_EQUALS(m_q.getCount(), 0U, "queue empty");
+
+    // Slots are reused in order as the queue wraps.
+    int i;
+    for (i = 10; i < 20; ++i)
+    {
+        slot = m_q.reserveSend(kArNoTimeout, &status);
+        ASSERT_EQUALS(status, kArSuccess, "reserve in loop");
+        *slot = i;
+        ASSERT_EQUALS(m_q.commitSend(), kArSuccess, "commit in loop");
+
+        int * element = m_q.peekReceive(kArNoTimeout, &status);
+        ASSERT_EQUALS(status, kArSuccess, "peek in loop");
+        ASSERT_TRUE(element == slot, "peeked element is the committed slot");
+        ASSERT_EQUALS(*element, i, "peeked value");
+        ASSERT_EQUALS(m_q.releaseReceive(), kArSuccess, "release in loop");
+    }
+}
+
+void TestQueue3::run()
+{
+    memset(m_received, 0, sizeof(m_received));
+    m_receivedCount = 0;
+    m_sentCount = 0;
+
+    m_q.init("q");
+
+    m_senderThread.init("sender", this, &TestQueue3::sender_thread, 60, false);
+    m_receiverThread.init("receiver", this, &TestQueue3::receiver_thread, 61, false);
+    m_controllerThread.init("controller", this, &TestQueue3::controller_thread, 40);
+}
+
+void TestQueue3::sender_thread()
+{
+    printHello();
+
+    // Blocks while the queue is full, then sends only what fits.
+    const int elements[] = { 40, 41, 42, 43 };
+    uint32_t sentCount;
+    ASSERT_EQUALS(m_q.sendN(elements, 4, &sentCount), kArSuccess, "sender sendN");
+    m_sentCount = sentCount;
+}
+
+void TestQueue3::receiver_thread()
+{
+    printHello();
+
+    // Blocks while the queue is empty, then receives everything sent in one batch.
+    uint32_t receivedCount;
+    ASSERT_EQUALS(m_q.receiveN(m_received, 8, &receivedCount), kArSuccess, "receiver receiveN");
+    m_receivedCount = receivedCount;
+}
+
+void TestQueue3::controller_thread()
+{
+    printHello();
+
+    // Move the head and tail near the end of the storage.
+    int i;
+    for (i = 0; i < 3; ++i)
+    {
+        ASSERT_EQUALS(m_q.send(i, kArNoTimeout), kArSuccess, "send");
+        ASSERT_EQUALS(m_q.receive(kArNoTimeout), i, "receive");
+    }
+
+    // Sends wrap around and stop when the queue is full.
+    const int first[] = { 10, 11, 12, 13 };
+    const int second[] = { 20, 21, 22 };
+    uint32_t count = 0;
+    ASSERT_EQUALS(m_q.sendN(first, 4, &count, kArNoTimeout), kArSuccess, "sendN wraps");
+    ASSERT_EQUALS(count, 4U, "all sent");
+    ASSERT_EQUALS(m_q.sendN(second, 3, &count, kArNoTimeout), kArSuccess, "sendN partial");
+    ASSERT_EQUALS(count, 1U, "one fits");
+    ASSERT_EQUALS(m_q.getCount(), 5U, "queue full");
+    ASSERT_EQUALS(m_q.sendN(second, 3, &count, kArNoTimeout), kArQueueFullError, "sendN to full queue");
+    ASSERT_EQUALS(count, 0U, "none sent");
+
+    // Receives wrap around and return what is there.
+    int buffer[8];
+    ASSERT_EQUALS(m_q.receiveN(buffer, 3, &count, kArNoTimeout), kArSuccess, "receiveN");
+    ASSERT_EQUALS(count, 3U, "three received");
+    ASSERT_TRUE(buffer[0] == 10 && buffer[1] == 11 && buffer[2] == 12, "first elements in order");
+    ASSERT_EQUALS(m_q.receiveN(buffer, 8, &count, kArNoTimeout), kArSuccess, "receiveN wraps");
+    ASSERT_EQUALS(count, 2U, "rest received");
+    ASSERT_TRUE(buffer[0] == 13 && buffer[1] == 20, "wrapped elements in order");
+    ASSERT_EQUALS(m_q.receiveN(buffer, 8, &count, kArNoTimeout), kArQueueEmptyError, "receiveN from empty queue");
+    ASSERT_EQUALS(count, 0U, "none received");
+
+    // A blocked receiver gets a whole batch at once.
+    m_receiverThread.resume();
+    ASSERT_EQUALS(m_receiverThread.getState(), kArThreadBlocked, "receiver blocked");
+    const int third[] = { 30, 31, 32 };
+    ASSERT_EQUALS(m_q.sendN(third, 3, &count), kArSuccess, "sendN to receiver");
+    ASSERT_EQUALS(m_receiverThread.getState(), kArThreadDone, "receiver done");
+    ASSERT_EQUALS(m_receivedCount, 3U, "receiver got the batch");
+    ASSERT_TRUE(m_received[0] == 30 && m_received[1] == 31 && m_received[2] == 32, "batch in order");
+
+    // A blocked sender sends only as much as there is room for.
+    const int fourth[] = { 50, 51, 52, 53, 54 };
+    ASSERT_EQUALS(m_q.sendN(fourth, 5, &count, kArNoTimeout), kArSuccess, "fill queue");
+    ASSERT_EQUALS(count, 5U, "queue filled");
+    m_senderThread.resume();
+    ASSERT_EQUALS(m_senderThread.getState(), kArThreadBlocked, "sender blocked");
+    ASSERT_EQUALS(m_q.receiveN(buffer, 2, &count, kArNoTimeout), kArSuccess, "make room");
+    ASSERT_EQUALS(m_senderThread.getState(), kArThreadDone, "sender done");
+    ASSERT_EQUALS(m_sentCount, 2U, "sender sent what fit");
+
+    ASSERT_EQUALS(m_q.receiveN(buffer, 8, &count, kArNoTimeout), kArSuccess, "drain");
+    ASSERT_EQUALS(count, 5U, "five left");
+    ASSERT_TRUE(buffer[0] == 52 && buffer[1] == 53 && buffer[2] == 54 && buffer[3] == 40 && buffer[4] == 41, "sender's elements follow");
+}
+
+void TestQueue4::run()
+{
+    m_modelCount = 0;
+
+    m_q.init("q");
+
+    m_aThread.init("a", this, &TestQueue4::a_thread, 60, false);
+    m_bThread.init("b", this, &TestQueue4::b_thread, 70, false);
+    m_controllerThread.init("controller", this, &TestQueue4::controller_thread, 40);
+}
+
+void TestQueue4::model_push(int element)
+{
+    m_model[m_modelCount++] = element;
+}
+
+//! Removes the element with the highest priority that was sent first.
+int TestQueue4::model_pop()
+{
+    uint32_t best = 0;
+    uint32_t i;
+    for (i = 1; i < m_modelCount; ++i)
+    {
+        if (m_model[i] / 1000 > m_model[best] / 1000
+            || (m_model[i] / 1000 == m_model[best] / 1000 && m_model[i] < m_model[best]))
+        {
+            best = i;
+        }
+    }
+    int element = m_model[best];
+    m_model[best] = m_model[--m_modelCount];
+    return element;
+}
+
+void TestQueue4::send_from_irq(void * arg)
+{
+    Ar::StaticPriorityQueue<int, 8> * q = static_cast<Ar::StaticPriorityQueue<int, 8> *>(arg);
+    q->send(1001, 1);
+    q->send(3002, 3);
+    q->send(2003, 2);
+    q->send(3004, 3);
+}
+
+void TestQueue4::a_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_q.send(5001, 5), kArSuccess, "a send");
+}
+
+void TestQueue4::b_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_q.send(5002, 5), kArSuccess, "b send");
+}
+
+void TestQueue4::controller_thread()
+{
+    printHello();
+
+    void * element;
+    ASSERT_EQUALS(m_q.reserveSend(&element, kArNoTimeout), kArInvalidStateError, "no reservations");
+    ASSERT_EQUALS(m_q.peekReceive(&element, kArNoTimeout), kArInvalidStateError, "no peeking");
+
+    // Mixed sends and receives come out in priority order, and in sending order within a
+    // priority, however the heap is shaped.
+    uint32_t random = 1;
+    int sequence = 0;
+    bool isInOrder = true;
+    uint32_t i;
+    for (i = 0; i < 500; ++i)
+    {
+        random = random * 1103515245 + 12345;
+        if (m_modelCount == 0 || (m_modelCount < 8 && (random >> 16) & 1))
+        {
+            int value = static_cast<int>((random >> 20) % 4) * 1000 + (++sequence % 1000);
+            isInOrder = isInOrder && m_q.send(value, value / 1000, kArNoTimeout) == kArSuccess;
+            model_push(value);
+        }
+        else
+        {
+            isInOrder = isInOrder && m_q.receive(kArNoTimeout) == model_pop();
+        }
+        isInOrder = isInOrder && m_q.getCount() == m_modelCount;
+    }
+    ASSERT_TRUE(isInOrder, "received in priority order");
+    while (m_modelCount)
+    {
+        model_pop();
+        m_q.receive(kArNoTimeout);
+    }
+    ASSERT_EQUALS(m_q.getCount(), 0U, "queue empty");
+
+    // Batches are received in priority order.
+    for (i = 0; i < 8; ++i)
+    {
+        ASSERT_EQUALS(m_q.send(static_cast<int>(i % 3) * 1000 + i, i % 3, kArNoTimeout), kArSuccess, "fill");
+    }
+    ASSERT_EQUALS(m_q.send(9000, 9, kArNoTimeout), kArQueueFullError, "send to full queue");
+    int batch[8];
+    uint32_t count = 0;
+    ASSERT_EQUALS(m_q.receiveN(batch, 3, &count, kArNoTimeout), kArSuccess, "receive batch");
+    ASSERT_EQUALS(count, 3U, "batch size");
+    ASSERT_TRUE(batch[0] == 2002 && batch[1] == 2005 && batch[2] == 1001, "batch in priority order");
+    ASSERT_EQUALS(m_q.receiveN(batch, 8, &count, kArNoTimeout), kArSuccess, "receive rest");
+    ASSERT_EQUALS(count, 5U, "rest size");
+    ASSERT_TRUE(batch[0] == 1004 && batch[1] == 1007 && batch[2] == 0 && batch[3] == 3 && batch[4] == 6, "rest in priority order");
+
+    // Elements sent from an interrupt join the heap in order.
+    ASSERT_EQUALS(m_q.send(2000, 2, kArNoTimeout), kArSuccess, "send before irq");
+    runFromIrq(send_from_irq, &m_q);
+    ASSERT_EQUALS(m_q.getCount(), 5U, "irq elements added");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 3002, "irq element 1");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 3004, "irq element 2");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 2000, "thread element");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 2003, "irq element 3");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 1001, "irq element 4");
+
+    // Blocked senders get room in order of thread priority.
+    for (i = 0; i < 8; ++i)
+    {
+        ASSERT_EQUALS(m_q.send(0, 0, kArNoTimeout), kArSuccess, "fill again");
+    }
+    m_aThread.resume();
+    m_bThread.resume();
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadBlocked, "a blocked");
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadBlocked, "b blocked");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 0, "make room");
+    ASSERT_EQUALS(m_bThread.getState(), kArThreadDone, "b sent first");
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadBlocked, "a still blocked");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 5002, "b element received first");
+    ASSERT_EQUALS(m_aThread.getState(), kArThreadDone, "a sent");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 5001, "a element received next");
+}
+
+void TestQueue5::run()
+{
+    m_nextValue = 0;
+    m_receivedValue = -1;
+
+    m_q.init("q");
+
+    m_receiverThread.init("receiver", this, &TestQueue5::receiver_thread, 50, false);
+    m_controllerThread.init("controller", this, &TestQueue5::controller_thread, 40);
+}
+
+//! Sends @a count consecutive values from an interrupt, one at a time or as one batch.
+void TestQueue5::send_from_irq(uint32_t count, bool isBatch)
+{
+    m_irqSendCount = count;
+    m_isIrqBatch = isBatch;
+    runFromIrq(_send_from_irq, this);
+}
+
+void TestQueue5::_send_from_irq(void * arg)
+{
+    TestQueue5 * test = static_cast<TestQueue5 *>(arg);
+    if (test->m_isIrqBatch)
+    {
+        int values[4];
+        uint32_t i;
+        for (i = 0; i < test->m_irqSendCount; ++i)
+        {
+            values[i] = test->m_nextValue++;
+        }
+        test->m_irqStatus = test->m_q.sendN(values, test->m_irqSendCount, &test->m_irqSentCount, kArNoTimeout);
+        return;
+    }
+
+    test->m_irqStatus = kArSuccess;
+    test->m_irqSentCount = 0;
+    uint32_t i;
+    for (i = 0; i < test->m_irqSendCount; ++i)
+    {
+        ar_status_t status = test->m_q.send(test->m_nextValue++, kArNoTimeout);
+        if (status == kArSuccess)
+        {
+            ++test->m_irqSentCount;
+        }
+        else
+        {
+            test->m_irqStatus = status;
+        }
+    }
+}
+
+void TestQueue5::receiver_thread()
+{
+    printHello();
+
+    int value;
+    ASSERT_EQUALS(m_q.receive(&value, kArInfiniteTimeout), kArSuccess, "receive");
+    m_receivedValue = value;
+}
+
+void TestQueue5::controller_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_q.setOverwrite(true), kArSuccess, "set overwrite");
+
+    // Sends from an interrupt never fail, and only the newest elements are kept.
+    send_from_irq(10, false);
+    ASSERT_EQUALS(m_irqStatus, kArSuccess, "irq sends succeed");
+    ASSERT_EQUALS(m_irqSentCount, 10U, "all irq elements sent");
+    ASSERT_EQUALS(m_q.getCount(), 4U, "queue full");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 6, "oldest kept element");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 7, "kept element 2");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 8, "kept element 3");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 9, "newest element");
+
+    // A batch from an interrupt drops as many elements sent by threads as it needs.
+    int i;
+    for (i = 100; i < 104; ++i)
+    {
+        ASSERT_EQUALS(m_q.send(i, kArNoTimeout), kArSuccess, "fill");
+    }
+    send_from_irq(3, true);
+    ASSERT_EQUALS(m_irqStatus, kArSuccess, "irq batch succeeds");
+    ASSERT_EQUALS(m_irqSentCount, 3U, "whole irq batch sent");
+    int batch[4];
+    uint32_t count = 0;
+    ASSERT_EQUALS(m_q.receiveN(batch, 4, &count, kArNoTimeout), kArSuccess, "receive batch");
+    ASSERT_EQUALS(count, 4U, "batch size");
+    ASSERT_TRUE(batch[0] == 103 && batch[1] == 10 && batch[2] == 11 && batch[3] == 12, "oldest elements dropped");
+
+    // The head element is not dropped while it is peeked.
+    send_from_irq(4, false);
+    ar_status_t status;
+    int * element = m_q.peekReceive(kArNoTimeout, &status);
+    ASSERT_EQUALS(status, kArSuccess, "peek");
+    ASSERT_EQUALS(*element, 13, "peeked head");
+    send_from_irq(1, false);
+    ASSERT_EQUALS(m_irqStatus, kArQueueFullError, "irq send fails while head is peeked");
+    ASSERT_EQUALS(*element, 13, "peeked head unchanged");
+    ASSERT_EQUALS(m_q.releaseReceive(), kArSuccess, "release");
+    send_from_irq(2, false);
+    ASSERT_EQUALS(m_irqStatus, kArSuccess, "irq sends succeed after release");
+    ASSERT_EQUALS(m_q.receiveN(batch, 4, &count, kArNoTimeout), kArSuccess, "receive after release");
+    ASSERT_EQUALS(count, 4U, "queue full after release");
+    ASSERT_TRUE(batch[0] == 15 && batch[1] == 16 && batch[2] == 18 && batch[3] == 19, "newest elements kept");
+
+    // A blocked receiver gets the oldest element that was kept.
+    m_receiverThread.resume();
+    ASSERT_EQUALS(m_receiverThread.getState(), kArThreadBlocked, "receiver blocked");
+    send_from_irq(6, false);
+    ASSERT_EQUALS(m_receiverThread.getState(), kArThreadDone, "receiver woken");
+    ASSERT_EQUALS(m_receivedValue, 22, "receiver got oldest kept element");
+    ASSERT_EQUALS(m_q.getCount(), 3U, "rest kept");
+    ASSERT_EQUALS(m_q.receive(kArNoTimeout), 23, "oldest of the rest");
+}
+
 //------------------------------------------------------------------------------
 // EOF
 //------------------------------------------------------------------------------
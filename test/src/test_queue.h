@@ -66,6 +66,133 @@ protected:
 
 };
 
+/*!
+ * @brief Test of reserving and committing slots, and peeking and releasing elements.
+ *
+ * The sender and receiver are created suspended and have higher priorities than the
+ * controller thread, so each runs until it blocks as soon as the controller resumes it.
+ */
+class TestQueue2 : public KernelTest
+{
+public:
+    TestQueue2() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_senderThread;
+    Ar::ThreadWithStack<512> m_receiverThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::StaticQueue<int, 3> m_q;
+    Ar::Semaphore m_releaseSem;
+
+    volatile int m_peekedValue;
+    volatile int m_receivedValue;
+
+    void sender_thread();
+    void receiver_thread();
+    void controller_thread();
+
+};
+
+/*!
+ * @brief Test of sending and receiving several elements at once, wrapping around the end of
+ *     the queue storage.
+ */
+class TestQueue3 : public KernelTest
+{
+public:
+    TestQueue3() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_senderThread;
+    Ar::ThreadWithStack<512> m_receiverThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::StaticQueue<int, 5> m_q;
+
+    int m_received[8];
+    volatile uint32_t m_receivedCount;
+    volatile uint32_t m_sentCount;
+
+    void sender_thread();
+    void receiver_thread();
+    void controller_thread();
+
+};
+
+/*!
+ * @brief Prioritized queue test.
+ *
+ * Each element is a priority times 1000 plus a sequence number, so the order in which elements
+ * are received can be checked against a simple model.
+ */
+class TestQueue4 : public KernelTest
+{
+public:
+    TestQueue4() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_aThread;
+    Ar::ThreadWithStack<512> m_bThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::StaticPriorityQueue<int, 8> m_q;
+
+    int m_model[8];
+    uint32_t m_modelCount;
+
+    void a_thread();
+    void b_thread();
+    void controller_thread();
+
+    void model_push(int element);
+    int model_pop();
+
+    static void send_from_irq(void * arg);
+
+};
+
+/*!
+ * @brief Test of sending from interrupts to an overwriting queue.
+ */
+class TestQueue5 : public KernelTest
+{
+public:
+    TestQueue5() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_receiverThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::StaticQueue<int, 4> m_q;
+
+    int m_nextValue;
+    uint32_t m_irqSendCount;
+    bool m_isIrqBatch;
+    ar_status_t m_irqStatus;
+    uint32_t m_irqSentCount;
+    volatile int m_receivedValue;
+
+    void receiver_thread();
+    void controller_thread();
+
+    void send_from_irq(uint32_t count, bool isBatch);
+    static void _send_from_irq(void * arg);
+
+};
+
 //------------------------------------------------------------------------------
 // Prototypes
 //------------------------------------------------------------------------------
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_rcu.h"
+
+#if AR_ENABLE_RCU
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestRcu1::run()
+{
+    m_readVersion = NULL;
+    m_sectionCount = 0;
+    m_isIntact = true;
+    m_isSpinnerReading = false;
+    m_isSpinnerReleased = false;
+    m_hasSpinnerExited = false;
+    m_isSpinnerStopped = false;
+    m_irqValue = 0;
+
+    uint32_t i;
+    for (i = 0; i < 3; ++i)
+    {
+        m_versions[i].m_value = 100 + i;
+        m_versions[i].m_isRetired = false;
+    }
+    m_rcu.publish(&m_versions[0]);
+
+    m_startSem.init("start", 0);
+    m_releaseSem.init("release", 0);
+
+    m_readerThread.init("reader", this, &TestRcu1::reader_thread, 50, false);
+    m_releaserThread.init("releaser", this, &TestRcu1::releaser_thread, 30, false);
+    m_spinnerThread.init("spinner", this, &TestRcu1::spinner_thread, 30, false);
+    m_controllerThread.init("controller", this, &TestRcu1::controller_thread, 40);
+}
+
+//! Publishes a new version, making sure it is not marked retired from an earlier use.
+TestRcu1::Version * TestRcu1::replace(Version * newVersion)
+{
+    newVersion->m_isRetired = false;
+    return m_rcu.publish(newVersion);
+}
+
+void TestRcu1::read_from_irq(void * arg)
+{
+    TestRcu1 * test = static_cast<TestRcu1 *>(arg);
+    Ar::Rcu<Version>::ReadGuard version(test->m_rcu);
+    test->m_irqValue = version->m_value;
+}
+
+//! Each time it is started, reads the current version while blocked until released.
+void TestRcu1::reader_thread()
+{
+    printHello();
+
+    while (m_startSem.get() == kArSuccess)
+    {
+        {
+            Ar::Rcu<Version>::ReadGuard version(m_rcu);
+            m_readVersion = version.get();
+            uint32_t value = version->m_value;
+
+            m_releaseSem.get();
+
+            m_isIntact = m_isIntact && !version->m_isRetired && version->m_value == value;
+        }
+        ++m_sectionCount;
+    }
+}
+
+void TestRcu1::releaser_thread()
+{
+    printHello();
+
+    m_releaseSem.put();
+}
+
+//! Reads without blocking until released, then keeps running outside of the section.
+void TestRcu1::spinner_thread()
+{
+    printHello();
+
+    {
+        Ar::Rcu<Version>::ReadGuard version(m_rcu);
+        m_isSpinnerReading = true;
+        while (!m_isSpinnerReleased)
+        {
+        }
+        m_isIntact = m_isIntact && !version->m_isRetired;
+    }
+    m_hasSpinnerExited = true;
+
+    while (!m_isSpinnerStopped)
+    {
+    }
+}
+
+void TestRcu1::controller_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(ar_rcu_synchronize(kArNoTimeout), kArSuccess, "no readers");
+
+    ar_rcu_read_lock();
+    ar_rcu_read_lock();
+    ASSERT_EQUALS(ar_rcu_synchronize(kArInfiniteTimeout), kArInvalidStateError, "synchronize inside section");
+    ar_rcu_read_unlock();
+    ASSERT_EQUALS(ar_rcu_synchronize(kArInfiniteTimeout), kArInvalidStateError, "synchronize inside nested section");
+    ar_rcu_read_unlock();
+    ASSERT_EQUALS(ar_rcu_synchronize(kArNoTimeout), kArSuccess, "synchronize after section");
+
+    // Readers in interrupt handlers see the current version.
+    runFromIrq(read_from_irq, this);
+    ASSERT_EQUALS(m_irqValue, 100U, "irq reader");
+
+    // A reader blocked inside its section holds up the grace period, but not new readers.
+    m_readerThread.resume();
+    m_startSem.put();
+    ASSERT_EQUALS(m_readerThread.getState(), kArThreadBlocked, "reader blocked in section");
+    ASSERT_TRUE(m_readVersion == &m_versions[0], "reader has first version");
+    Version * old = replace(&m_versions[1]);
+    ASSERT_TRUE(old == &m_versions[0], "publish returns old version");
+    {
+        Ar::Rcu<Version>::ReadGuard version(m_rcu);
+        ASSERT_TRUE(version.get() == &m_versions[1], "new readers see new version");
+    }
+    ASSERT_EQUALS(ar_rcu_synchronize(kArNoTimeout), kArTimeoutError, "reader holds up grace period");
+    ASSERT_EQUALS(ar_rcu_synchronize(10), kArTimeoutError, "reader still holds up grace period");
+    m_releaseSem.put();
+    ASSERT_EQUALS(m_sectionCount, 1U, "reader exited section");
+    ASSERT_EQUALS(ar_rcu_synchronize(kArNoTimeout), kArSuccess, "grace period over");
+    old->m_isRetired = true;
+
+    // A writer waits for a reader that is blocked inside its section when the writer starts.
+    m_startSem.put();
+    ASSERT_TRUE(m_readVersion == &m_versions[1], "reader has second version");
+    old = replace(&m_versions[2]);
+    m_releaserThread.resume();
+    ASSERT_EQUALS(ar_rcu_synchronize(kArInfiniteTimeout), kArSuccess, "waited for grace period");
+    ASSERT_EQUALS(m_sectionCount, 2U, "reader exited before grace period ended");
+    old->m_isRetired = true;
+
+    // A reader that is preempted inside its section and then exits it without blocking ends the
+    // grace period right away. Exiting enters the scheduler, which releases the writer before
+    // the reader runs any further.
+    m_spinnerThread.resume();
+    ar_thread_sleep(5);
+    ASSERT_TRUE(m_isSpinnerReading, "spinner in section");
+    old = replace(&m_versions[0]);
+    m_isSpinnerReleased = true;
+    ASSERT_EQUALS(ar_rcu_synchronize(kArInfiniteTimeout), kArSuccess, "waited for spinner");
+    ASSERT_TRUE(!m_hasSpinnerExited, "writer released as soon as spinner exited section");
+    ASSERT_EQUALS(m_spinnerThread.getState(), kArThreadReady, "spinner still running");
+    old->m_isRetired = true;
+    m_isSpinnerStopped = true;
+
+    ASSERT_TRUE(m_isIntact, "no version retired while read");
+}
+
+#endif // AR_ENABLE_RCU
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(_KERNEL_TEST_RCU_H_)
+#define _KERNEL_TEST_RCU_H_
+
+#include "argon/argon.h"
+#include "argon/test/kernel_test.h"
+
+#if AR_ENABLE_RCU
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+/*!
+ * @brief Read-copy-update test.
+ *
+ * The writer marks each version it replaces as retired once a grace period has passed, so a
+ * reader that sees a retired version inside its critical section shows a grace period that
+ * ended too early.
+ *
+ * The reader thread has a higher priority than the controller, and blocks inside its section.
+ * The releaser and the spinning reader have lower priorities, so they only run while the
+ * controller is blocked or sleeping.
+ */
+class TestRcu1 : public KernelTest
+{
+public:
+    TestRcu1() {}
+
+    virtual void run();
+
+protected:
+
+    struct Version
+    {
+        uint32_t m_value;
+        volatile bool m_isRetired;
+    };
+
+    Ar::ThreadWithStack<512> m_readerThread;
+    Ar::ThreadWithStack<512> m_releaserThread;
+    Ar::ThreadWithStack<512> m_spinnerThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::Rcu<Version> m_rcu;
+    Version m_versions[3];
+    Ar::Semaphore m_startSem;
+    Ar::Semaphore m_releaseSem;
+
+    const Version * volatile m_readVersion;
+    volatile uint32_t m_sectionCount;
+    volatile bool m_isIntact;
+    volatile bool m_isSpinnerReading;
+    volatile bool m_isSpinnerReleased;
+    volatile bool m_hasSpinnerExited;
+    volatile bool m_isSpinnerStopped;
+    volatile uint32_t m_irqValue;
+
+    void reader_thread();
+    void releaser_thread();
+    void spinner_thread();
+    void controller_thread();
+
+    Version * replace(Version * newVersion);
+
+    static void read_from_irq(void * arg);
+
+};
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+#endif // AR_ENABLE_RCU
+
+#endif // _KERNEL_TEST_RCU_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_rwlock.h"
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestRWLock1::run()
+{
+    m_readerCount = 0;
+    m_writerTimeoutStatus = kArSuccess;
+    m_writerStatus = kArTimeoutError;
+
+    m_lock.init("rwlock");
+    m_releaseSem.init("release", 0);
+    m_writerSem.init("writer", 0);
+
+    uint32_t i;
+    for (i = 0; i < TEST_RWLOCK_READER_COUNT; ++i)
+    {
+        m_readerThreads[i].init("reader", this, &TestRWLock1::reader_thread, 50 + i, false);
+    }
+    m_writerThread.init("writer", this, &TestRWLock1::writer_thread, 70, false);
+    m_controllerThread.init("controller", this, &TestRWLock1::controller_thread, 40);
+}
+
+void TestRWLock1::reader_thread()
+{
+    uint32_t index = 0;
+    while (static_cast<Ar::Thread *>(&m_readerThreads[index]) != self())
+    {
+        ++index;
+    }
+
+    ASSERT_EQUALS(m_lock.getRead(), kArSuccess, "reader got read lock");
+    ++m_readerCount;
+
+    m_releaseSem.get();
+
+    ASSERT_EQUALS(m_lock.putRead(), kArSuccess, "reader put read lock");
+    ASSERT_EQUALS(self()->getPriority(), 50 + index, "reader priority restored");
+}
+
+void TestRWLock1::writer_thread()
+{
+    printHello();
+
+    // The first attempt times out while the readers still hold the lock.
+    m_writerTimeoutStatus = m_lock.getWrite(50);
+
+    m_writerSem.get();
+
+    // The second attempt waits for every reader to let go.
+    m_writerStatus = m_lock.getWrite();
+    ASSERT_TRUE(m_lock.isWriteLocked(), "write locked");
+    ASSERT_EQUALS(m_lock.getReaderCount(), 0U, "no readers while write locked");
+    ASSERT_EQUALS(m_lock.putWrite(), kArSuccess, "writer put write lock");
+}
+
+void TestRWLock1::check_recursion()
+{
+    // Both locks can be taken recursively, but not one while holding the other.
+    ASSERT_EQUALS(m_lock.getRead(), kArSuccess, "read lock");
+    ASSERT_EQUALS(m_lock.getRead(), kArSuccess, "recursive read lock");
+    ASSERT_EQUALS(m_lock.getReaderCount(), 1U, "one reader");
+    ASSERT_EQUALS(m_lock.getWrite(), kArInvalidStateError, "write lock while reading");
+    ASSERT_EQUALS(m_lock.putRead(), kArSuccess, "put recursive read lock");
+    ASSERT_EQUALS(m_lock.getReaderCount(), 1U, "still one reader");
+    ASSERT_EQUALS(m_lock.putRead(), kArSuccess, "put read lock");
+    ASSERT_EQUALS(m_lock.getReaderCount(), 0U, "no readers");
+    ASSERT_EQUALS(m_lock.putRead(), kArNotOwnerError, "put unheld read lock");
+
+    ASSERT_EQUALS(m_lock.getWrite(), kArSuccess, "write lock");
+    ASSERT_EQUALS(m_lock.getWrite(), kArSuccess, "recursive write lock");
+    ASSERT_EQUALS(m_lock.getRead(), kArInvalidStateError, "read lock while writing");
+    ASSERT_EQUALS(m_lock.putWrite(), kArSuccess, "put recursive write lock");
+    ASSERT_TRUE(m_lock.isWriteLocked(), "still write locked");
+    ASSERT_EQUALS(m_lock.putWrite(), kArSuccess, "put write lock");
+    ASSERT_TRUE(!m_lock.isWriteLocked(), "write unlocked");
+    ASSERT_EQUALS(m_lock.putWrite(), kArNotOwnerError, "put unheld write lock");
+}
+
+void TestRWLock1::controller_thread()
+{
+    printHello();
+
+    check_recursion();
+
+    // Two readers share the lock.
+    m_readerThreads[0].resume();
+    m_readerThreads[1].resume();
+    ASSERT_EQUALS(m_lock.getReaderCount(), 2U, "two readers");
+
+    // A waiting writer hoists every reader to its own priority.
+    m_writerThread.resume();
+    ASSERT_EQUALS(m_writerThread.getState(), kArThreadBlocked, "writer blocked by readers");
+    ASSERT_EQUALS(m_readerThreads[0].getPriority(), 70, "reader 0 hoisted");
+    ASSERT_EQUALS(m_readerThreads[1].getPriority(), 70, "reader 1 hoisted");
+
+    // New readers are held off while the writer waits, even though there is a free slot.
+    m_readerThreads[2].resume();
+    ASSERT_EQUALS(m_readerThreads[2].getState(), kArThreadBlocked, "reader held off by writer");
+    ASSERT_EQUALS(m_lock.getReaderCount(), 2U, "still two readers");
+
+    // When the writer gives up, the held off reader gets in.
+    ar_thread_sleep(100);
+    ASSERT_EQUALS(m_writerTimeoutStatus, kArTimeoutError, "writer timed out");
+    ASSERT_EQUALS(m_readerCount, 3U, "held off reader woken");
+    ASSERT_EQUALS(m_lock.getReaderCount(), 3U, "three readers");
+
+    // Fill the remaining slots, then one more reader has to wait for a slot.
+    uint32_t i;
+    for (i = 3; i < AR_RWLOCK_MAX_READERS; ++i)
+    {
+        m_readerThreads[i].resume();
+    }
+    ASSERT_EQUALS(m_lock.getReaderCount(), static_cast<unsigned>(AR_RWLOCK_MAX_READERS), "all slots taken");
+    m_readerThreads[AR_RWLOCK_MAX_READERS].resume();
+    ASSERT_EQUALS(m_readerThreads[AR_RWLOCK_MAX_READERS].getState(), kArThreadBlocked, "reader blocked without a slot");
+    ASSERT_EQUALS(m_readerCount, static_cast<unsigned>(AR_RWLOCK_MAX_READERS), "no extra reader");
+
+    // Releasing one reader hands its slot to the waiting one.
+    m_releaseSem.put();
+    ASSERT_EQUALS(m_readerCount, static_cast<unsigned>(TEST_RWLOCK_READER_COUNT), "waiting reader got a slot");
+    ASSERT_EQUALS(m_lock.getReaderCount(), static_cast<unsigned>(AR_RWLOCK_MAX_READERS), "all slots taken again");
+
+    // The writer waits again, this time without a timeout, and hoists all remaining readers.
+    m_writerSem.put();
+    ASSERT_EQUALS(m_writerThread.getState(), kArThreadBlocked, "writer blocked again");
+    for (i = 0; i < TEST_RWLOCK_READER_COUNT; ++i)
+    {
+        if (m_readerThreads[i].getState() != kArThreadDone)
+        {
+            ASSERT_EQUALS(m_readerThreads[i].getPriority(), 70, "reader hoisted by writer");
+        }
+    }
+
+    // The writer gets the lock only after the last reader lets go.
+    for (i = 0; i < AR_RWLOCK_MAX_READERS; ++i)
+    {
+        ASSERT_EQUALS(m_writerStatus, kArTimeoutError, "writer still waiting");
+        m_releaseSem.put();
+    }
+    ASSERT_EQUALS(m_writerStatus, kArSuccess, "writer got write lock");
+    ASSERT_EQUALS(m_writerThread.getState(), kArThreadDone, "writer done");
+    ASSERT_EQUALS(m_lock.getReaderCount(), 0U, "no readers left");
+    ASSERT_TRUE(!m_lock.isWriteLocked(), "unlocked");
+    for (i = 0; i < TEST_RWLOCK_READER_COUNT; ++i)
+    {
+        ASSERT_EQUALS(m_readerThreads[i].getState(), kArThreadDone, "reader done");
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
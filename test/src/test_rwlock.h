@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(_KERNEL_TEST_RWLOCK_H_)
+#define _KERNEL_TEST_RWLOCK_H_
+
+#include "argon/argon.h"
+#include "argon/test/kernel_test.h"
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! One reader more than there are read slots, so the last one has to wait for a slot.
+#define TEST_RWLOCK_READER_COUNT (AR_RWLOCK_MAX_READERS + 1)
+
+/*!
+ * @brief Reader-writer lock test.
+ *
+ * The readers and the writer are created suspended and have higher priorities than the
+ * controller thread, so each one runs until it holds the lock or blocks as soon as the
+ * controller resumes or releases it. The test needs at least three read slots.
+ */
+class TestRWLock1 : public KernelTest
+{
+public:
+    TestRWLock1() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_readerThreads[TEST_RWLOCK_READER_COUNT];
+    Ar::ThreadWithStack<512> m_writerThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::RWLock m_lock;
+    Ar::Semaphore m_releaseSem;
+    Ar::Semaphore m_writerSem;
+
+    volatile uint32_t m_readerCount;
+    volatile ar_status_t m_writerTimeoutStatus;
+    volatile ar_status_t m_writerStatus;
+
+    void reader_thread();
+    void writer_thread();
+    void controller_thread();
+
+    void check_recursion();
+
+};
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+#endif // _KERNEL_TEST_RWLOCK_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
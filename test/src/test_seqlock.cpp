@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_seqlock.h"
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestSeqLock1::run()
+{
+    m_isWriterDone = false;
+
+    fill(m_writeBuffer, 0);
+    m_state.init("state");
+    m_state.write(m_writeBuffer);
+
+    m_writerThread.init("writer", this, &TestSeqLock1::writer_thread, 60, false);
+    m_controllerThread.init("controller", this, &TestSeqLock1::controller_thread, 40);
+}
+
+void TestSeqLock1::fill(State & state, uint32_t value)
+{
+    uint32_t i;
+    for (i = 0; i < TEST_SEQLOCK_WORD_COUNT; ++i)
+    {
+        state.m_words[i] = value;
+    }
+}
+
+bool TestSeqLock1::is_consistent(const State & state)
+{
+    uint32_t i;
+    for (i = 1; i < TEST_SEQLOCK_WORD_COUNT; ++i)
+    {
+        if (state.m_words[i] != state.m_words[0])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestSeqLock1::write_from_irq(void * arg)
+{
+    TestSeqLock1 * test = static_cast<TestSeqLock1 *>(arg);
+    test->fill(test->m_writeBuffer, 1000);
+    test->m_state.write(test->m_writeBuffer);
+}
+
+void TestSeqLock1::writer_thread()
+{
+    printHello();
+
+    // Each value is the write count it produces, so readers can check it against the count.
+    uint32_t i;
+    for (i = 3; i <= TEST_SEQLOCK_WRITE_COUNT + 2; ++i)
+    {
+        fill(m_writeBuffer, i);
+        m_state.write(m_writeBuffer);
+        ar_thread_sleep(1);
+    }
+
+    m_isWriterDone = true;
+}
+
+void TestSeqLock1::controller_thread()
+{
+    printHello();
+
+    ASSERT_EQUALS(m_state.getWriteCount(), 1U, "initial write counted");
+    ASSERT_EQUALS(m_state.read(m_readBuffer), kArSuccess, "read");
+    ASSERT_TRUE(is_consistent(m_readBuffer) && m_readBuffer.m_words[0] == 0, "initial value");
+
+    // A write from an interrupt is seen by the next read.
+    runFromIrq(write_from_irq, this);
+    ASSERT_EQUALS(m_state.getWriteCount(), 2U, "irq write counted");
+    ASSERT_EQUALS(m_state.read(m_readBuffer), kArSuccess, "read after irq write");
+    ASSERT_TRUE(is_consistent(m_readBuffer) && m_readBuffer.m_words[0] == 1000, "irq value");
+
+    // Read until the writer finishes. Reads that a write overlapped must have been retried to
+    // return a consistent value, which is one of the values written during the read.
+    m_writerThread.resume();
+    uint32_t overlapCount = 0;
+    bool isConsistent = true;
+    while (!m_isWriterDone)
+    {
+        uint32_t before = m_state.getWriteCount();
+        isConsistent = isConsistent && m_state.read(m_readBuffer) == kArSuccess;
+        uint32_t after = m_state.getWriteCount();
+
+        uint32_t value = m_readBuffer.m_words[0];
+        isConsistent = isConsistent && is_consistent(m_readBuffer) && value >= before && value <= after;
+        if (after != before)
+        {
+            ++overlapCount;
+        }
+    }
+
+    ASSERT_TRUE(isConsistent, "no torn reads");
+    ASSERT_TRUE(overlapCount > 0, "writes overlapped reads");
+    ASSERT_EQUALS(m_state.getWriteCount(), TEST_SEQLOCK_WRITE_COUNT + 2U, "all writes counted");
+    ASSERT_EQUALS(m_state.read(m_readBuffer), kArSuccess, "final read");
+    ASSERT_TRUE(is_consistent(m_readBuffer) && m_readBuffer.m_words[0] == TEST_SEQLOCK_WRITE_COUNT + 2, "final value");
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
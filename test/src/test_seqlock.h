@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(_KERNEL_TEST_SEQLOCK_H_)
+#define _KERNEL_TEST_SEQLOCK_H_
+
+#include "argon/argon.h"
+#include "argon/test/kernel_test.h"
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! Number of words in the protected state. Large enough that the writer often preempts a read
+//! in the middle of its copy.
+#define TEST_SEQLOCK_WORD_COUNT (64)
+
+//! Number of writes made by the writer thread.
+#define TEST_SEQLOCK_WRITE_COUNT (100)
+
+/*!
+ * @brief Seqlock test.
+ *
+ * The controller thread reads continuously while a higher priority writer wakes every tick
+ * and writes, so writes land in the middle of reads. Every word of a write holds the same
+ * value, so a torn read shows up as words that differ.
+ */
+class TestSeqLock1 : public KernelTest
+{
+public:
+    TestSeqLock1() {}
+
+    virtual void run();
+
+protected:
+
+    struct State
+    {
+        uint32_t m_words[TEST_SEQLOCK_WORD_COUNT];
+    };
+
+    Ar::ThreadWithStack<512> m_writerThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::SeqLocked<State> m_state;
+    State m_writeBuffer;
+    State m_readBuffer;
+
+    volatile bool m_isWriterDone;
+
+    void writer_thread();
+    void controller_thread();
+
+    void fill(State & state, uint32_t value);
+    bool is_consistent(const State & state);
+
+    static void write_from_irq(void * arg);
+
+};
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+#endif // _KERNEL_TEST_SEQLOCK_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "argon/argon.h"
+#include "test_stream_buffer.h"
+
+//------------------------------------------------------------------------------
+// Code
+//------------------------------------------------------------------------------
+
+void TestStreamBuffer1::run()
+{
+    m_readIndex = 0;
+    uint32_t i;
+    for (i = 0; i < TEST_STREAM_READ_COUNT; ++i)
+    {
+        m_readStatus[i] = kArSuccess;
+        m_readLength[i] = 0;
+    }
+
+    m_stream.init("stream", 4);
+
+    m_readerThread.init("reader", this, &TestStreamBuffer1::reader_thread, 60, false);
+    m_controllerThread.init("controller", this, &TestStreamBuffer1::controller_thread, 40);
+}
+
+void TestStreamBuffer1::write_from_irq(void * arg)
+{
+    const uint8_t data[] = { 1, 2, 3, 4 };
+    static_cast<Ar::StreamBuffer *>(arg)->write(data, sizeof(data));
+}
+
+void TestStreamBuffer1::reader_thread()
+{
+    printHello();
+
+    // Each read records its status and length, then the reader moves on to the next one.
+    static const uint32_t timeouts[TEST_STREAM_READ_COUNT] = { kArInfiniteTimeout, 30, 20, kArInfiniteTimeout, kArInfiniteTimeout };
+    uint8_t data[16];
+    for (m_readIndex = 0; m_readIndex < TEST_STREAM_READ_COUNT; ++m_readIndex)
+    {
+        uint32_t length = 0;
+        m_readStatus[m_readIndex] = m_stream.read(data, sizeof(data), &length, timeouts[m_readIndex]);
+        m_readLength[m_readIndex] = length;
+    }
+}
+
+void TestStreamBuffer1::controller_thread()
+{
+    printHello();
+
+    uint8_t data[20];
+    uint32_t count;
+    uint32_t i;
+
+    // Reads without a timeout take whatever is there.
+    ASSERT_EQUALS(m_stream.write(data, 3, &count), kArSuccess, "write 3 bytes");
+    ASSERT_EQUALS(count, 3U, "3 bytes written");
+    ASSERT_EQUALS(m_stream.read(data, sizeof(data), &count, kArNoTimeout), kArSuccess, "read below trigger level");
+    ASSERT_EQUALS(count, 3U, "3 bytes read");
+    ASSERT_EQUALS(m_stream.read(data, sizeof(data), &count, kArNoTimeout), kArQueueEmptyError, "read from empty stream");
+    ASSERT_EQUALS(count, 0U, "nothing read");
+
+    // The reader is not woken until the trigger level is reached.
+    m_readerThread.resume();
+    ASSERT_EQUALS(m_readerThread.getState(), kArThreadBlocked, "reader blocked");
+    ASSERT_EQUALS(m_stream.write(data, 2), kArSuccess, "write below trigger level");
+    ASSERT_EQUALS(m_readerThread.getState(), kArThreadBlocked, "reader still blocked");
+    ASSERT_EQUALS(m_stream.write(data, 2), kArSuccess, "write up to trigger level");
+    ASSERT_EQUALS(m_readStatus[0], kArSuccess, "read at trigger level");
+    ASSERT_EQUALS(m_readLength[0], 4U, "all 4 bytes read");
+
+    // A read that times out returns the bytes that did arrive.
+    ASSERT_EQUALS(m_readIndex, 1U, "reader on second read");
+    ASSERT_EQUALS(m_stream.write(data, 1), kArSuccess, "write 1 byte");
+    ar_thread_sleep(50);
+    ASSERT_EQUALS(m_readStatus[1], kArSuccess, "partial read on timeout");
+    ASSERT_EQUALS(m_readLength[1], 1U, "partial read length");
+
+    // A read that times out with nothing to read fails.
+    ar_thread_sleep(40);
+    ASSERT_EQUALS(m_readStatus[2], kArTimeoutError, "empty read timed out");
+    ASSERT_EQUALS(m_readLength[2], 0U, "nothing read on timeout");
+
+    // Lowering the trigger level wakes the reader if the new level is already met.
+    ASSERT_EQUALS(m_readIndex, 3U, "reader on fourth read");
+    ASSERT_EQUALS(m_stream.write(data, 2), kArSuccess, "write 2 bytes");
+    ASSERT_EQUALS(m_readerThread.getState(), kArThreadBlocked, "reader blocked below trigger level");
+    ASSERT_EQUALS(m_stream.setTriggerLevel(2), kArSuccess, "lower trigger level");
+    ASSERT_EQUALS(m_readStatus[3], kArSuccess, "read after lowering trigger level");
+    ASSERT_EQUALS(m_readLength[3], 2U, "2 bytes read");
+
+    // Writes from interrupts wake the reader too.
+    ASSERT_EQUALS(m_readerThread.getState(), kArThreadBlocked, "reader blocked on last read");
+    runFromIrq(write_from_irq, &m_stream);
+    ASSERT_EQUALS(m_readStatus[4], kArSuccess, "read after write from irq");
+    ASSERT_EQUALS(m_readLength[4], 4U, "4 bytes read after write from irq");
+    ASSERT_EQUALS(m_readerThread.getState(), kArThreadDone, "reader done");
+
+    // Writes stop when the buffer is full, and wrap around the end of the storage.
+    for (i = 0; i < sizeof(data); ++i)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+    ASSERT_EQUALS(m_stream.write(data, sizeof(data), &count), kArSuccess, "write more than fits");
+    ASSERT_EQUALS(count, 16U, "only capacity written");
+    ASSERT_EQUALS(m_stream.getFree(), 0U, "stream full");
+    ASSERT_EQUALS(m_stream.write(data, 1, &count), kArQueueFullError, "write to full stream");
+    ASSERT_EQUALS(count, 0U, "nothing written");
+
+    uint8_t received[20];
+    ASSERT_EQUALS(m_stream.read(received, sizeof(received), &count, kArNoTimeout), kArSuccess, "read wrapped bytes");
+    ASSERT_EQUALS(count, 16U, "all bytes read");
+    bool isInOrder = true;
+    for (i = 0; i < 16; ++i)
+    {
+        isInOrder = isInOrder && received[i] == i;
+    }
+    ASSERT_TRUE(isInOrder, "wrapped bytes in order");
+
+    // Trigger levels are limited to between 1 and the capacity.
+    ASSERT_EQUALS(m_stream.setTriggerLevel(0), kArSuccess, "set trigger level 0");
+    ASSERT_EQUALS(m_stream.getTriggerLevel(), 1U, "trigger level raised to 1");
+    ASSERT_EQUALS(m_stream.setTriggerLevel(100), kArSuccess, "set trigger level 100");
+    ASSERT_EQUALS(m_stream.getTriggerLevel(), 16U, "trigger level limited to capacity");
+}
+
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2013 Immo Software
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its contributors may
+ *   be used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(_KERNEL_TEST_STREAM_BUFFER_H_)
+#define _KERNEL_TEST_STREAM_BUFFER_H_
+
+#include "argon/argon.h"
+#include "argon/test/kernel_test.h"
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+//! Number of reads made by the reader thread.
+#define TEST_STREAM_READ_COUNT (5)
+
+/*!
+ * @brief Stream buffer test.
+ *
+ * The reader thread is created suspended and has a higher priority than the controller
+ * thread, so it runs until it blocks as soon as the controller resumes it or writes enough.
+ */
+class TestStreamBuffer1 : public KernelTest
+{
+public:
+    TestStreamBuffer1() {}
+
+    virtual void run();
+
+protected:
+
+    Ar::ThreadWithStack<512> m_readerThread;
+    Ar::ThreadWithStack<512> m_controllerThread;
+
+    Ar::StaticStreamBuffer<16> m_stream;
+
+    volatile uint32_t m_readIndex;
+    volatile ar_status_t m_readStatus[TEST_STREAM_READ_COUNT];
+    volatile uint32_t m_readLength[TEST_STREAM_READ_COUNT];
+
+    void reader_thread();
+    void controller_thread();
+
+    static void write_from_irq(void * arg);
+
+};
+
+//------------------------------------------------------------------------------
+// Prototypes
+//------------------------------------------------------------------------------
+
+#endif // _KERNEL_TEST_STREAM_BUFFER_H_
+//------------------------------------------------------------------------------
+// EOF
+//------------------------------------------------------------------------------
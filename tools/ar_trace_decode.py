@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2013-2018 Immo Software
+#
+# Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+#
+# o Redistributions of source code must retain the above copyright notice, this list
+#   of conditions and the following disclaimer.
+#
+# o Redistributions in binary form must reproduce the above copyright notice, this
+#   list of conditions and the following disclaimer in the documentation and/or
+#   other materials provided with the distribution.
+#
+# o Neither the name of the copyright holder nor the names of its contributors may
+#   be used to endorse or promote products derived from this software without
+#   specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+# ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+"""Convert an Argon kernel trace buffer into Chrome trace JSON for Perfetto.
+
+Dump the `g_ar_trace` buffer from the target, for example with gdb:
+
+    dump binary value trace.bin g_ar_trace
+
+Then convert it and open the result at https://ui.perfetto.dev or chrome://tracing:
+
+    ar_trace_decode.py trace.bin -o trace.json
+
+The input may also be a larger memory dump that contains the buffer; it is located by its
+magic value. Each thread gets a track showing when it was running, with instant events for
+its state changes and the kernel object operations it performed.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+# Must match ar_trace_buffer_t in src/ar_internal.h.
+TRACE_MAGIC = 0x63727461
+TRACE_VERSION = 1
+HEADER_FORMAT = '<5I'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+RECORD_FORMAT = '<2I'
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+# Event IDs, from _ar_trace_events.
+TIME_SYNC = 1
+OBJECT_CREATED = 2
+OBJECT_NAME = 3
+OBJECT_DELETED = 4
+THREAD_SWITCH = 5
+THREAD_STATE = 6
+
+OPERATION_EVENTS = {
+    7: 'semaphore get',
+    8: 'semaphore put',
+    9: 'mutex get',
+    10: 'mutex put',
+    11: 'queue send',
+    12: 'queue receive',
+    13: 'channel send',
+    14: 'channel receive',
+    15: 'deferred post',
+    16: 'deferred run',
+    17: 'timer fire',
+    18: 'runloop function',
+    19: 'runloop queue',
+    20: 'notify',
+    21: 'notify wait',
+    22: 'event flags set',
+    23: 'event flags clear',
+    24: 'event flags wait',
+    25: 'condvar wait',
+    26: 'condvar signal',
+    27: 'condvar broadcast',
+    28: 'rwlock read get',
+    29: 'rwlock read put',
+    30: 'rwlock write get',
+    31: 'rwlock write put',
+    32: 'stream buffer write',
+    33: 'stream buffer read',
+    34: 'message buffer send',
+    35: 'message buffer receive',
+    36: 'seqlock write',
+    37: 'seqlock read',
+    38: 'rcu synchronize',
+}
+
+# Events whose argument is an ar_status_t.
+STATUS_EVENTS = set(range(7, 16)) | set(range(20, 39))
+
+DEFERRED_RUN = 16
+
+OBJECT_TYPES = ['thread', 'semaphore', 'mutex', 'queue', 'channel', 'timer', 'runloop', 'event flags', 'condvar', 'rwlock', 'stream buffer',
+                'message buffer', 'seqlock']
+
+THREAD_STATES = ['unknown', 'suspended', 'ready', 'running', 'blocked', 'sleeping', 'done']
+
+STATUSES = [
+    'success', 'timeout', 'object deleted', 'queue full', 'queue empty', 'invalid priority',
+    'stack too small', 'not from interrupt', 'not owner', 'already unlocked',
+    'invalid parameter', 'timer not running', 'timer no runloop', 'out of memory',
+    'invalid state', 'already attached', 'runloop already running', 'runloop stopped',
+    'runloop queue received', 'runloop message buffer received',
+]
+
+# Track for events recorded while no thread was running.
+KERNEL_TID = 0
+
+
+def find_buffer(data):
+    """Return the offset of the trace buffer header in data."""
+    magic = struct.pack('<I', TRACE_MAGIC)
+    offset = data.find(magic)
+    while offset >= 0:
+        if offset + HEADER_SIZE <= len(data):
+            _, version, size, _, _ = struct.unpack_from(HEADER_FORMAT, data, offset)
+            if (version == TRACE_VERSION and size and not (size & (size - 1))
+                    and offset + HEADER_SIZE + size * RECORD_SIZE <= len(data)):
+                return offset
+        offset = data.find(magic, offset + 1)
+    raise ValueError('no Argon trace buffer found')
+
+
+def read_records(data):
+    """Return the records in the buffer as (header, value) tuples, oldest first."""
+    offset = find_buffer(data)
+    _, _, size, head, _ = struct.unpack_from(HEADER_FORMAT, data, offset)
+    base = offset + HEADER_SIZE
+    records = [struct.unpack_from(RECORD_FORMAT, data, base + i * RECORD_SIZE) for i in range(size)]
+
+    if head <= size:
+        return records[:head]
+
+    # The ring has wrapped. The oldest surviving record may be partly overwritten by a writer
+    # that was active when the buffer was dumped, so skip it.
+    start = head % size
+    ordered = records[start:] + records[:start]
+    return ordered[1:]
+
+
+def decode(records):
+    """Yield (time_us, event_id, arg, value) for each record with an absolute time."""
+    time = None
+    for header, value in records:
+        event_id = header >> 24
+        arg = (header >> 16) & 0xff
+        low_bits = header & 0xffff
+        if event_id == 0:
+            continue
+
+        if event_id == TIME_SYNC:
+            if time is None:
+                time = value
+            else:
+                time += (value - time) & 0xffffffff
+        elif time is None:
+            time = low_bits
+        else:
+            time += (low_bits - time) & 0xffff
+
+        yield time, event_id, arg, value
+
+
+class Converter(object):
+    def __init__(self):
+        self.names = {}
+        self.types = {}
+        self.tids = {}
+        self.events = []
+        self.current = None
+        self.running_since = None
+        self.last_created = None
+        self.end_time = 0
+
+    def name_of(self, obj):
+        kind = self.types.get(obj, 'object')
+        return self.names.get(obj) or '%s 0x%08x' % (kind, obj)
+
+    def tid_of(self, thread):
+        if thread is None:
+            return KERNEL_TID
+        if thread not in self.tids:
+            self.tids[thread] = len(self.tids) + 1
+        return self.tids[thread]
+
+    def instant(self, time, name, args=None):
+        event = {'name': name, 'ph': 'i', 's': 't', 'ts': time, 'pid': 1, 'tid': self.tid_of(self.current)}
+        if args:
+            event['args'] = args
+        self.events.append(event)
+
+    def end_running(self, time):
+        if self.current is not None and self.running_since is not None:
+            self.events.append({
+                'name': 'running',
+                'ph': 'X',
+                'ts': self.running_since,
+                'dur': time - self.running_since,
+                'pid': 1,
+                'tid': self.tid_of(self.current),
+            })
+
+    def convert(self, decoded):
+        for time, event_id, arg, value in decoded:
+            self.end_time = time
+            if event_id == TIME_SYNC:
+                continue
+            elif event_id == OBJECT_CREATED:
+                self.types[value] = OBJECT_TYPES[arg] if arg < len(OBJECT_TYPES) else 'object'
+                self.names[value] = ''
+                self.last_created = value
+                if arg == 0:
+                    self.tid_of(value)
+                self.instant(time, 'create %s' % self.types[value], {'object': '0x%08x' % value})
+            elif event_id == OBJECT_NAME:
+                if self.last_created is not None:
+                    chars = struct.pack('<I', value).rstrip(b'\0').decode('latin-1')
+                    self.names[self.last_created] = self.names[self.last_created][:arg] + chars
+            elif event_id == OBJECT_DELETED:
+                self.last_created = None
+                self.instant(time, 'delete %s' % self.name_of(value))
+            elif event_id == THREAD_SWITCH:
+                self.types.setdefault(value, 'thread')
+                self.end_running(time)
+                self.current = value
+                self.running_since = time
+            elif event_id == THREAD_STATE:
+                self.types.setdefault(value, 'thread')
+                state = THREAD_STATES[arg] if arg < len(THREAD_STATES) else str(arg)
+                self.instant(time, '%s %s' % (self.name_of(value), state))
+            elif event_id in OPERATION_EVENTS:
+                args = {'object': self.name_of(value)}
+                if event_id in STATUS_EVENTS:
+                    args['status'] = STATUSES[arg] if arg < len(STATUSES) else str(arg)
+                elif event_id == DEFERRED_RUN:
+                    args['count'] = arg
+                self.instant(time, '%s %s' % (OPERATION_EVENTS[event_id], self.name_of(value)), args)
+        self.end_running(self.end_time)
+
+    def metadata(self):
+        result = [
+            {'name': 'process_name', 'ph': 'M', 'pid': 1, 'args': {'name': 'argon'}},
+            {'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': KERNEL_TID, 'args': {'name': 'kernel'}},
+        ]
+        for thread, tid in self.tids.items():
+            result.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': tid,
+                           'args': {'name': self.name_of(thread)}})
+        return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert an Argon kernel trace to Chrome trace JSON.')
+    parser.add_argument('input', help='binary dump containing g_ar_trace')
+    parser.add_argument('-o', '--output', help='output JSON file (default stdout)')
+    args = parser.parse_args()
+
+    with open(args.input, 'rb') as f:
+        data = f.read()
+
+    try:
+        records = read_records(data)
+    except ValueError as e:
+        sys.exit('error: %s' % e)
+
+    converter = Converter()
+    converter.convert(decode(records))
+    trace = {'traceEvents': converter.metadata() + converter.events, 'displayTimeUnit': 'ns'}
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()